@@ -0,0 +1,19 @@
+#----------------------------------------------------------------
+# Generated CMake target import file for configuration "RelWithDebInfo".
+#----------------------------------------------------------------
+
+# Commands may need to know the format version.
+set(CMAKE_IMPORT_FILE_VERSION 1)
+
+# Import target "accelerated-arrays::accelerated-arrays" for configuration "RelWithDebInfo"
+set_property(TARGET accelerated-arrays::accelerated-arrays APPEND PROPERTY IMPORTED_CONFIGURATIONS RELWITHDEBINFO)
+set_target_properties(accelerated-arrays::accelerated-arrays PROPERTIES
+  IMPORTED_LINK_INTERFACE_LANGUAGES_RELWITHDEBINFO "CXX"
+  IMPORTED_LOCATION_RELWITHDEBINFO "${_IMPORT_PREFIX}/lib/libaccelerated-arrays.a"
+  )
+
+list(APPEND _cmake_import_check_targets accelerated-arrays::accelerated-arrays )
+list(APPEND _cmake_import_check_files_for_accelerated-arrays::accelerated-arrays "${_IMPORT_PREFIX}/lib/libaccelerated-arrays.a" )
+
+# Commands beyond this point should not need to know the version.
+set(CMAKE_IMPORT_FILE_VERSION)
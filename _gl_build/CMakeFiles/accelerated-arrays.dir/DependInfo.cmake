@@ -0,0 +1,35 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/cpu/image.cpp" "CMakeFiles/accelerated-arrays.dir/src/cpu/image.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/cpu/image.cpp.o.d"
+  "/root/repo/src/cpu/operations.cpp" "CMakeFiles/accelerated-arrays.dir/src/cpu/operations.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/cpu/operations.cpp.o.d"
+  "/root/repo/src/cpu/simd.cpp" "CMakeFiles/accelerated-arrays.dir/src/cpu/simd.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/cpu/simd.cpp.o.d"
+  "/root/repo/src/function.cpp" "CMakeFiles/accelerated-arrays.dir/src/function.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/function.cpp.o.d"
+  "/root/repo/src/future.cpp" "CMakeFiles/accelerated-arrays.dir/src/future.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/future.cpp.o.d"
+  "/root/repo/src/image.cpp" "CMakeFiles/accelerated-arrays.dir/src/image.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/image.cpp.o.d"
+  "/root/repo/src/log_and_assert.cpp" "CMakeFiles/accelerated-arrays.dir/src/log_and_assert.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/log_and_assert.cpp.o.d"
+  "/root/repo/src/opengl/adapters.cpp" "CMakeFiles/accelerated-arrays.dir/src/opengl/adapters.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/opengl/adapters.cpp.o.d"
+  "/root/repo/src/opengl/glfw.cpp" "CMakeFiles/accelerated-arrays.dir/src/opengl/glfw.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/opengl/glfw.cpp.o.d"
+  "/root/repo/src/opengl/image.cpp" "CMakeFiles/accelerated-arrays.dir/src/opengl/image.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/opengl/image.cpp.o.d"
+  "/root/repo/src/opengl/operations.cpp" "CMakeFiles/accelerated-arrays.dir/src/opengl/operations.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/opengl/operations.cpp.o.d"
+  "/root/repo/src/opengl/read_adapters.cpp" "CMakeFiles/accelerated-arrays.dir/src/opengl/read_adapters.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/opengl/read_adapters.cpp.o.d"
+  "/root/repo/src/opengl/texture_formats.cpp" "CMakeFiles/accelerated-arrays.dir/src/opengl/texture_formats.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/opengl/texture_formats.cpp.o.d"
+  "/root/repo/src/queue.cpp" "CMakeFiles/accelerated-arrays.dir/src/queue.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/queue.cpp.o.d"
+  "/root/repo/src/standard_ops.cpp" "CMakeFiles/accelerated-arrays.dir/src/standard_ops.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/standard_ops.cpp.o.d"
+  "/root/repo/src/task_graph.cpp" "CMakeFiles/accelerated-arrays.dir/src/task_graph.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/task_graph.cpp.o.d"
+  "/root/repo/src/tracing.cpp" "CMakeFiles/accelerated-arrays.dir/src/tracing.cpp.o" "gcc" "CMakeFiles/accelerated-arrays.dir/src/tracing.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,43 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/accelerated-arrays.dir/src/cpu/image.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/cpu/image.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/cpu/operations.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/cpu/operations.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/cpu/simd.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/cpu/simd.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/function.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/function.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/future.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/future.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/image.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/image.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/log_and_assert.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/log_and_assert.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/opengl/adapters.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/opengl/adapters.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/opengl/glfw.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/opengl/glfw.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/opengl/image.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/opengl/image.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/opengl/operations.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/opengl/operations.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/opengl/read_adapters.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/opengl/read_adapters.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/opengl/texture_formats.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/opengl/texture_formats.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/queue.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/queue.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/standard_ops.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/standard_ops.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/task_graph.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/task_graph.cpp.o.d"
+  "CMakeFiles/accelerated-arrays.dir/src/tracing.cpp.o"
+  "CMakeFiles/accelerated-arrays.dir/src/tracing.cpp.o.d"
+  "libaccelerated-arrays.a"
+  "libaccelerated-arrays.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/accelerated-arrays.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
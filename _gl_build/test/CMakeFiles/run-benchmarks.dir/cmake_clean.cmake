@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/run-benchmarks.dir/benchmarks.cpp.o"
+  "CMakeFiles/run-benchmarks.dir/benchmarks.cpp.o.d"
+  "run-benchmarks"
+  "run-benchmarks.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/run-benchmarks.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
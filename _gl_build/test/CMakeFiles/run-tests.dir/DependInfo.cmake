@@ -0,0 +1,25 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/test/fixed_point.cpp" "test/CMakeFiles/run-tests.dir/fixed_point.cpp.o" "gcc" "test/CMakeFiles/run-tests.dir/fixed_point.cpp.o.d"
+  "/root/repo/test/main.cpp" "test/CMakeFiles/run-tests.dir/main.cpp.o" "gcc" "test/CMakeFiles/run-tests.dir/main.cpp.o.d"
+  "/root/repo/test/opengl.cpp" "test/CMakeFiles/run-tests.dir/opengl.cpp.o" "gcc" "test/CMakeFiles/run-tests.dir/opengl.cpp.o.d"
+  "/root/repo/test/operations.cpp" "test/CMakeFiles/run-tests.dir/operations.cpp.o" "gcc" "test/CMakeFiles/run-tests.dir/operations.cpp.o.d"
+  "/root/repo/test/task_graph.cpp" "test/CMakeFiles/run-tests.dir/task_graph.cpp.o" "gcc" "test/CMakeFiles/run-tests.dir/task_graph.cpp.o.d"
+  "/root/repo/test/thread_pool.cpp" "test/CMakeFiles/run-tests.dir/thread_pool.cpp.o" "gcc" "test/CMakeFiles/run-tests.dir/thread_pool.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_gl_build/CMakeFiles/accelerated-arrays.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
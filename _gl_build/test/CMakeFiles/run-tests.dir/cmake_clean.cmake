@@ -0,0 +1,21 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/run-tests.dir/fixed_point.cpp.o"
+  "CMakeFiles/run-tests.dir/fixed_point.cpp.o.d"
+  "CMakeFiles/run-tests.dir/main.cpp.o"
+  "CMakeFiles/run-tests.dir/main.cpp.o.d"
+  "CMakeFiles/run-tests.dir/opengl.cpp.o"
+  "CMakeFiles/run-tests.dir/opengl.cpp.o.d"
+  "CMakeFiles/run-tests.dir/operations.cpp.o"
+  "CMakeFiles/run-tests.dir/operations.cpp.o.d"
+  "CMakeFiles/run-tests.dir/task_graph.cpp.o"
+  "CMakeFiles/run-tests.dir/task_graph.cpp.o.d"
+  "CMakeFiles/run-tests.dir/thread_pool.cpp.o"
+  "CMakeFiles/run-tests.dir/thread_pool.cpp.o.d"
+  "run-tests"
+  "run-tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/run-tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,8 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/test
+# Build directory: /root/repo/_gl_build/test
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(run-tests "/root/repo/_gl_build/test/run-tests")
+set_tests_properties(run-tests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;36;add_test;/root/repo/test/CMakeLists.txt;0;")
@@ -1,5 +1,9 @@
 #include "image.hpp"
 
+#include <map>
+#include <mutex>
+#include <tuple>
+
 namespace accelerated {
 namespace cpu {
 namespace {
@@ -53,6 +57,7 @@ struct ImplementationBase : public Image {
         }
         #define X(type, name) case name: return static_cast<double>(getNative<type>(x, y, channel));
         ACCELERATED_IMAGE_FOR_EACH_NON_FLOAT_NAMED_TYPE(X)
+        X(Float16, DataType::FLOAT16)
         #undef X
         }
         ACCELERATED_ARRAYS_PIXEL_ASSERT(false);
@@ -69,6 +74,7 @@ struct ImplementationBase : public Image {
         }
         #define X(type, name) case name: setNative<type>(x, y, channel, type(value)); return;
         ACCELERATED_IMAGE_FOR_EACH_NON_FLOAT_NAMED_TYPE(X)
+        X(Float16, DataType::FLOAT16)
         #undef X
         }
         ACCELERATED_ARRAYS_PIXEL_ASSERT(false);
@@ -103,6 +109,134 @@ public:
     }
 };
 
+// 64-byte aligned memory buffer, recycled by PooledImageFactory
+class AlignedBuffer {
+private:
+    std::unique_ptr<std::uint8_t[]> storage;
+
+public:
+    static constexpr std::size_t ALIGNMENT = 64;
+    const std::size_t size;
+    std::uint8_t *data;
+
+    AlignedBuffer(std::size_t size) : storage(new std::uint8_t[size + ALIGNMENT]), size(size) {
+        const auto addr = reinterpret_cast<std::uintptr_t>(storage.get());
+        data = storage.get() + (ALIGNMENT - addr % ALIGNMENT) % ALIGNMENT;
+    }
+};
+
+class BufferPool {
+public:
+    // width, height, channels, data type
+    typedef std::tuple<int, int, int, ImageTypeSpec::DataType> Key;
+
+    BufferPool(bool padRows, bool zeroInitialize) : padRows(padRows), zeroInitialize(zeroInitialize) {}
+
+    std::size_t rowWidth(int w, int bytesPerPixel) const {
+        if (!padRows) return w;
+        // smallest multiple of pixels that is a multiple of the alignment in bytes
+        std::size_t a = AlignedBuffer::ALIGNMENT, b = bytesPerPixel;
+        while (b != 0) { const std::size_t t = a % b; a = b; b = t; }
+        const std::size_t step = AlignedBuffer::ALIGNMENT / a;
+        return ((w + step - 1) / step) * step;
+    }
+
+    std::unique_ptr<AlignedBuffer> acquire(const Key &key, std::size_t size) {
+        std::unique_ptr<AlignedBuffer> buffer;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto &free = buffers[key];
+            if (free.empty()) {
+                stats.misses++;
+                stats.allocatedBytes += size;
+            } else {
+                stats.hits++;
+                stats.pooledBuffers--;
+                buffer = std::move(free.back());
+                free.pop_back();
+            }
+        }
+        if (!buffer) buffer.reset(new AlignedBuffer(size));
+        if (zeroInitialize) std::memset(buffer->data, 0, size);
+        return buffer;
+    }
+
+    void release(const Key &key, std::unique_ptr<AlignedBuffer> buffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.pooledBuffers++;
+        buffers[key].push_back(std::move(buffer));
+    }
+
+    void releaseUnused() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &it : buffers) {
+            for (auto &buf : it.second) stats.allocatedBytes -= buf->size;
+        }
+        buffers.clear();
+        stats.pooledBuffers = 0;
+    }
+
+    Image::PooledFactory::Stats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+private:
+    const bool padRows, zeroInitialize;
+    mutable std::mutex mutex;
+    std::map< Key, std::vector< std::unique_ptr<AlignedBuffer> > > buffers;
+    Image::PooledFactory::Stats stats;
+};
+
+class PooledImage final : public ImplementationBase {
+private:
+    std::shared_ptr<BufferPool> pool;
+    BufferPool::Key key;
+    std::unique_ptr<AlignedBuffer> buffer;
+
+public:
+    PooledImage(int w, int h, int channels, DataType dtype, std::shared_ptr<BufferPool> pool) :
+        ImplementationBase(w, h, channels, dtype),
+        pool(pool),
+        key(w, h, channels, dtype)
+    {
+        rowWidth = pool->rowWidth(w, bytesPerPixel());
+        buffer = pool->acquire(key, rowWidth * h * bytesPerPixel());
+        data = buffer->data;
+    }
+
+    ~PooledImage() {
+        pool->release(key, std::move(buffer));
+    }
+};
+
+class PooledImageFactory final : public Image::PooledFactory {
+private:
+    // shared with the images, which may outlive the factory
+    std::shared_ptr<BufferPool> pool;
+
+public:
+    PooledImageFactory(bool padRows, bool zeroInitialize) :
+        pool(std::make_shared<BufferPool>(padRows, zeroInitialize))
+    {}
+
+    std::unique_ptr<::accelerated::Image> create(int w, int h, int channels, ImageTypeSpec::DataType dtype) final {
+        return std::unique_ptr<::accelerated::Image>(new PooledImage(w, h, channels, dtype, pool));
+    }
+
+    ImageTypeSpec getSpec(int channels, ImageTypeSpec::DataType dtype) final {
+        return Image::getSpec(channels, dtype);
+    }
+
+    Stats getStats() const final {
+        return pool->getStats();
+    }
+
+    void releaseUnused() final {
+        pool->releaseUnused();
+    }
+};
+
 class ImageFactory final : public Image::Factory {
 public:
     std::unique_ptr<::accelerated::Image> create(int w, int h, int channels, ImageTypeSpec::DataType dtype) final {
@@ -148,30 +282,64 @@ bool Image::applyBorder(int &x, int &y, Border border) const {
 
 Future Image::readRaw(std::uint8_t *outputData) {
     const auto &impl = reinterpret_cast<const ImplementationBase&>(*this);
-    aa_assert(impl.isContiguous());
-    std::memcpy(outputData, impl.data, size());
-    return Future::instantlyResolved();
+    if (impl.isContiguous()) {
+        std::memcpy(outputData, impl.data, size());
+        return Future::instantlyResolved();
+    }
+    return readRaw(outputData, width * bytesPerPixel());
 }
 
 Future Image::writeRaw(const std::uint8_t *inputData) {
     const auto &impl = reinterpret_cast<ImplementationBase&>(*this);
-    aa_assert(impl.isContiguous());
-    std::memcpy(impl.data, inputData, size());
+    if (impl.isContiguous()) {
+        std::memcpy(impl.data, inputData, size());
+        return Future::instantlyResolved();
+    }
+    return writeRaw(inputData, width * bytesPerPixel());
+}
+
+Future Image::readRaw(std::uint8_t *outputData, std::size_t rowPitch) {
+    const auto &impl = reinterpret_cast<const ImplementationBase&>(*this);
+    const std::size_t rowBytes = width * bytesPerPixel();
+    aa_assert(rowPitch >= rowBytes);
+    if (impl.isContiguous() && rowPitch == rowBytes) return readRaw(outputData);
+    for (int y = 0; y < height; ++y)
+        std::memcpy(outputData + y * rowPitch, impl.data + y * bytesPerRow(), rowBytes);
+    return Future::instantlyResolved();
+}
+
+Future Image::writeRaw(const std::uint8_t *inputData, std::size_t rowPitch) {
+    const auto &impl = reinterpret_cast<ImplementationBase&>(*this);
+    const std::size_t rowBytes = width * bytesPerPixel();
+    aa_assert(rowPitch >= rowBytes);
+    if (impl.isContiguous() && rowPitch == rowBytes) return writeRaw(inputData);
+    for (int y = 0; y < height; ++y)
+        std::memcpy(impl.data + y * bytesPerRow(), inputData + y * rowPitch, rowBytes);
     return Future::instantlyResolved();
 }
 
 Future Image::copyFrom(::accelerated::Image &other) {
     const auto &impl = reinterpret_cast<ImplementationBase&>(*this);
-    aa_assert(impl.isContiguous());
     aa_assert(isCopyCompatible(*this, other));
-    return other.readRaw(impl.data);
+    if (other.storageType == StorageType::CPU) {
+        // works for non-contiguous images too
+        return castFrom(other).copyTo(*this);
+    }
+    // the rows of a ROI are read in place, without a temporary copy
+    return other.readRaw(impl.data, bytesPerRow());
 }
 
 Future Image::copyTo(::accelerated::Image &other) const {
     const auto &impl = reinterpret_cast<const ImplementationBase&>(*this);
-    aa_assert(impl.isContiguous());
     aa_assert(isCopyCompatible(*this, other));
-    return other.writeRaw(impl.data);
+    if (other.storageType == StorageType::CPU && !impl.isContiguous()) {
+        auto &target = castFrom(other);
+        const std::size_t rowBytes = width * bytesPerPixel();
+        for (int y = 0; y < height; ++y)
+            std::memcpy(target.getDataRaw() + y * target.bytesPerRow(), impl.data + y * bytesPerRow(), rowBytes);
+        return Future::instantlyResolved();
+    }
+    return other.writeRaw(impl.data, bytesPerRow());
 }
 
 std::uint8_t *Image::getDataRaw() {
@@ -190,6 +358,7 @@ template<> void Image::set<dtype>(int x, int y, int channel, dtype value) { \
     reinterpret_cast<ImplementationBase&>(*this).setNative<dtype>(x, y, channel, value); \
 }
 ACCELERATED_IMAGE_FOR_EACH_NON_FLOAT_TYPE(X)
+X(Float16)
 #undef X
 
 template<> float Image::get<float>(int x, int y, int channel) const {
@@ -212,6 +381,10 @@ std::unique_ptr<Image::Factory> Image::createFactory() {
     return std::unique_ptr<Image::Factory>(new ImageFactory());
 }
 
+std::unique_ptr<Image::PooledFactory> Image::createPooledFactory(bool padRows, bool zeroInitialize) {
+    return std::unique_ptr<Image::PooledFactory>(new PooledImageFactory(padRows, zeroInitialize));
+}
+
 std::unique_ptr<Image> Image::createReference(int w, int h, int channels, DataType dtype, std::uint8_t *data) {
     return std::unique_ptr<Image>(new ImageReference(w, h, channels, dtype, data, 0));
 }
@@ -221,6 +394,22 @@ std::unique_ptr<Image> Image::createReference(int w, int h, int channels, DataTy
     return std::unique_ptr<Image>(new ImageReference(w, h, channels, dtype, data, rowWidthPixels));
 }
 
+YuvImage Image::createYuvReference(int w, int h, YuvLayout layout,
+    std::uint8_t *yData, std::uint8_t *uvData,
+    std::size_t yRowStride, std::size_t uvRowStride)
+{
+    const int cw = YuvImage::getChromaSize(w), ch = YuvImage::getChromaSize(h);
+    if (yRowStride == 0) yRowStride = w;
+    if (uvRowStride == 0) uvRowStride = cw * 2;
+    aa_assert(uvRowStride % 2 == 0);
+
+    YuvImage yuv;
+    yuv.layout = layout;
+    yuv.y = createReference(w, h, 1, DataType::UFIXED8, yData, yRowStride);
+    yuv.uv = createReference(cw, ch, 2, DataType::UFIXED8, uvData, uvRowStride / 2);
+    return yuv;
+}
+
 Image::Image(int w, int h, int ch, DataType dtype) :
     ::accelerated::Image(w, h, getSpec(ch, dtype))
 {}
@@ -67,6 +67,8 @@ public:
 
     Future readRaw(std::uint8_t *outputData) final;
     Future writeRaw(const std::uint8_t *inputData) final;
+    Future readRaw(std::uint8_t *outputData, std::size_t rowPitch) final;
+    Future writeRaw(const std::uint8_t *inputData, std::size_t rowPitch) final;
 
     /** Get pointer to raw data, use sparingly */
     std::uint8_t *getDataRaw();
@@ -85,6 +87,30 @@ public:
 
     static std::unique_ptr<Factory> createFactory();
 
+    /**
+     * Image factory that recycles the buffers of destroyed images for new
+     * images with the same dimensions and type. The buffers are 64-byte
+     * aligned. If padRows is set, so is each row, which means that the
+     * images are not contiguous, but vectorized row operations can safely
+     * read and write up to the alignment boundary. The contents of new images
+     * are undefined unless zeroInitialize is set.
+     */
+    class PooledFactory : public Factory {
+    public:
+        struct Stats {
+            std::size_t hits = 0;
+            std::size_t misses = 0;
+            std::size_t pooledBuffers = 0; // currently unused
+            std::size_t allocatedBytes = 0; // both used and unused buffers
+        };
+
+        virtual Stats getStats() const = 0;
+        /** Free all the currently unused buffers */
+        virtual void releaseUnused() = 0;
+    };
+
+    static std::unique_ptr<PooledFactory> createPooledFactory(bool padRows = false, bool zeroInitialize = false);
+
     /** Create a cpu::Image which as a reference to existing data */
     static std::unique_ptr<Image> createReference(
         int w, int h, int channels, DataType dtype, std::uint8_t *data);
@@ -101,6 +127,15 @@ public:
         return createReference(w, h, Chan, getType<T>(), reinterpret_cast<std::uint8_t*>(data));
     }
 
+    /**
+     * Reference the planes of an existing NV12 or NV21 frame. The row
+     * strides are given in bytes (as in most camera APIs), 0 means tightly
+     * packed. No data is copied.
+     */
+    static YuvImage createYuvReference(int w, int h, YuvLayout layout,
+        std::uint8_t *yData, std::uint8_t *uvData,
+        std::size_t yRowStride = 0, std::size_t uvRowStride = 0);
+
     static ImageTypeSpec getSpec(int channels, DataType dtype);
 
 protected:
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+
+#include "image.hpp"
+#include "operations.hpp"
+
+/**
+ * Helpers for writing custom CPU operations as per-pixel functors, which
+ * are inlined into row loops, instead of using per-scalar Image::get/set
+ * calls. Example:
+ *
+ *      auto grayscale = cpu::operations::pixelwise<FixedPoint<std::uint8_t>, 3, float, 1>(
+ *          [](const FixedPoint<std::uint8_t> *in, float *out) {
+ *              out[0] = 0.299f * in[0] + 0.587f * in[1] + 0.114f * in[2];
+ *          });
+ *      auto function = cpuFactory->wrap(grayscale);
+ */
+namespace accelerated {
+namespace cpu {
+namespace operations {
+namespace kernels {
+template <class T> inline T *row(Image &img, int y) {
+    return img.getData<T>() + y * (img.bytesPerRow() / sizeof(T));
+}
+
+template <class T, int Chan> inline void checkImage(Image &img, int width, int height) {
+    (void)img; (void)width; (void)height;
+    aa_assert(img.channels == Chan);
+    aa_assert(img.width == width && img.height == height);
+    aa_assert(img.dataType == ImageTypeSpec::getType<T>());
+}
+}
+
+/**
+ * Call f(const InT *inPixel, OutT *outPixel) for each pixel of images with
+ * the same dimensions. Rows may be padded (e.g., ROIs)
+ */
+template <class InT, int InC, class OutT, int OutC, class F>
+inline void forEachPixel(Image &input, Image &output, F &&f) {
+    kernels::checkImage<InT, InC>(input, output.width, output.height);
+    kernels::checkImage<OutT, OutC>(output, output.width, output.height);
+    for (int y = 0; y < output.height; ++y) {
+        const InT *in = kernels::row<InT>(input, y);
+        OutT *out = kernels::row<OutT>(output, y);
+        for (int x = 0; x < output.width; ++x) {
+            f(in, out);
+            in += InC;
+            out += OutC;
+        }
+    }
+}
+
+/**
+ * N-input version: f(const std::array<const InT*, N> &inPixels, OutT *outPixel).
+ * All inputs must have the same type and dimensions as the output
+ */
+template <class InT, int InC, std::size_t N, class OutT, int OutC, class F>
+inline void forEachPixel(Image **inputs, Image &output, F &&f) {
+    std::array<const InT*, N> in;
+    for (std::size_t i = 0; i < N; ++i)
+        kernels::checkImage<InT, InC>(*inputs[i], output.width, output.height);
+    kernels::checkImage<OutT, OutC>(output, output.width, output.height);
+    for (int y = 0; y < output.height; ++y) {
+        for (std::size_t i = 0; i < N; ++i) in[i] = kernels::row<InT>(*inputs[i], y);
+        OutT *out = kernels::row<OutT>(output, y);
+        for (int x = 0; x < output.width; ++x) {
+            f(in, out);
+            for (auto &p : in) p += InC;
+            out += OutC;
+        }
+    }
+}
+
+/** Unary operation from a per-pixel functor, to be used with Factory::wrap */
+template <class InT, int InC, class OutT, int OutC, class F>
+Unary pixelwise(F f) {
+    return [f](Image &input, Image &output) {
+        forEachPixel<InT, InC, OutT, OutC>(input, output, f);
+    };
+}
+
+/** N-ary operation from a per-pixel functor, to be used with Factory::wrapNAry */
+template <class InT, int InC, std::size_t N, class OutT, int OutC, class F>
+NAry pixelwise(F f) {
+    return [f](Image **inputs, int nInputs, Image &output) {
+        (void)nInputs;
+        aa_assert(nInputs == int(N));
+        forEachPixel<InT, InC, N, OutT, OutC>(inputs, output, f);
+    };
+}
+}
+}
+}
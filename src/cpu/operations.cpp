@@ -1,7 +1,13 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <limits>
 
 #include "operations.hpp"
 #include "image.hpp"
+#include "simd.hpp"
+#include "../tracing.hpp"
 
 namespace accelerated {
 namespace cpu {
@@ -10,37 +16,63 @@ namespace {
 typedef ::accelerated::Image BaseImage;
 typedef ::accelerated::operations::fixedConvolution2D::Spec FixedConvolution2DSpec;
 typedef ::accelerated::operations::fill::Spec FillSpec;
+typedef ::accelerated::operations::copy::Spec CopySpec;
 typedef ::accelerated::operations::rescale::Spec RescaleSpec;
 typedef ::accelerated::operations::swizzle::Spec SwizzleSpec;
 typedef ::accelerated::operations::pixelwiseAffineCombination::Spec PixelwiseAffineCombinationSpec;
 typedef ::accelerated::operations::channelwiseAffine::Spec ChannelwiseAffineSpec;
+typedef ::accelerated::operations::pixelwiseChain::Spec PixelwiseChainSpec;
+typedef ::accelerated::operations::pyramid::Spec PyramidSpec;
+typedef ::accelerated::operations::yuvToRgb::Spec YuvToRgbSpec;
+typedef ::accelerated::operations::warp::Spec WarpSpec;
+typedef ::accelerated::operations::reduce::Spec ReduceSpec;
 using ::accelerated::operations::Function;
+using ::accelerated::operations::MultiOutputFunction;
+
+// Operations that only compute the output rows [y0, y1). The inputs are
+// always full images so that rows outside the band, e.g., convolution halos,
+// can be read as well
+typedef std::function< void(Image **inputs, int nInputs, Image &output, int y0, int y1) > BandNAry;
+typedef std::function< void(Image &output, int y0, int y1) > BandNullary;
+typedef std::function< void(Image &input, Image &output, int y0, int y1) > BandUnary;
+
+BandNAry convertBands(const BandNullary &f) {
+    return [f](Image **inputs, int nInputs, Image &output, int y0, int y1) {
+        (void)inputs; (void)nInputs;
+        aa_assert(nInputs == 0);
+        f(output, y0, y1);
+    };
+}
+
+BandNAry convertBands(const BandUnary &f) {
+    return [f](Image **inputs, int nInputs, Image &output, int y0, int y1) {
+        aa_assert(nInputs == 1); (void)nInputs;
+        f(*inputs[0], output, y0, y1);
+    };
+}
 
 void checkSpec(const ImageTypeSpec &spec) {
     (void)spec;
     aa_assert(spec.storageType == ImageTypeSpec::StorageType::CPU);
 }
 
-double interpolateFloat(Image &img, double x, double y, int c, Image::Interpolation i, Image::Border b) {
-    aa_assert(i == Image::Interpolation::NEAREST || i == Image::Interpolation::UNDEFINED); // TODO
-    // note: not necessarily consisten rounding for negative vals
-    return img.get<float>(int(x + 0.5), int(y + 0.5), c, b);
-}
-
 namespace impl { // to avoid name clashes with StandardFactory
 
 template <class T>
 void forEachPixelFast(
-    Image &in, Image &out,
+    Image &in, Image &out, int y0, int y1,
     const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec,
     const std::function<void(const T *inPtr, T *outPtr)> &f)
 {
     aa_assert(in.width == out.width && in.height == out.height);
     aa_assert(in == inSpec);
     aa_assert(out == outSpec);
-    const T *inPtr = in.getData<T>();
-    T *outPtr = out.getData<T>();
-    for (int y = 0; y < in.height; ++y) {
+    // note: rows may be padded (ROIs)
+    const std::size_t inRowStride = in.bytesPerRow() / sizeof(T);
+    const std::size_t outRowStride = out.bytesPerRow() / sizeof(T);
+    for (int y = y0; y < y1; ++y) {
+        const T *inPtr = in.getData<T>() + y * inRowStride;
+        T *outPtr = out.getData<T>() + y * outRowStride;
         for (int x = 0; x < in.width; ++x) {
             f(inPtr, outPtr);
             inPtr += inSpec.channels;
@@ -49,8 +81,8 @@ void forEachPixelFast(
     }
 }
 
-void forEachPixelAndChannel(Image &img, const std::function<void(Image &img, int x, int y, int c)> &f) {
-    for (int y = 0; y < img.height; ++y) {
+void forEachPixelAndChannel(Image &img, int y0, int y1, const std::function<void(Image &img, int x, int y, int c)> &f) {
+    for (int y = y0; y < y1; ++y) {
         for (int x = 0; x < img.width; ++x) {
             for (int c = 0; c < img.channels; ++c) {
                 f(img, x, y, c);
@@ -59,38 +91,137 @@ void forEachPixelAndChannel(Image &img, const std::function<void(Image &img, int
     }
 }
 
-Nullary fill(const FillSpec &spec, const ImageTypeSpec &outSpec) {
+template <class T> inline T *rowPointer(Image &img, int y) {
+    return img.getData<T>() + y * (img.bytesPerRow() / sizeof(T));
+}
+
+inline bool isContiguous(Image &img) {
+    return img.bytesPerRow() == img.width * img.bytesPerPixel();
+}
+
+// Fill by replicating one pixel (converted as in Image::set<float>). Uses
+// memset if all the bytes of the pixel are equal, e.g., zero
+template <class T> BandNullary fillTyped(const FillSpec &spec, const ImageTypeSpec &outSpec) {
+    std::vector<T> pixel;
+    for (double v : spec.value) pixel.push_back(T(float(v)));
+    std::vector<std::uint8_t> bytes(pixel.size() * sizeof(T));
+    std::memcpy(bytes.data(), static_cast<const void*>(pixel.data()), bytes.size());
+    bool singleByte = true;
+    for (auto b : bytes) singleByte = singleByte && b == bytes.at(0);
+
+    return [bytes, singleByte, outSpec](Image &output, int y0, int y1) {
+        aa_assert(output == outSpec);
+        const std::size_t rowBytes = output.width * bytes.size();
+        if (singleByte) {
+            if (isContiguous(output)) {
+                std::memset(output.getDataRaw() + y0 * rowBytes, bytes.at(0), (y1 - y0) * rowBytes);
+            } else {
+                for (int y = y0; y < y1; ++y)
+                    std::memset(output.getDataRaw() + y * output.bytesPerRow(), bytes.at(0), rowBytes);
+            }
+            return;
+        }
+        for (int y = y0; y < y1; ++y) {
+            std::uint8_t *row = output.getDataRaw() + y * output.bytesPerRow();
+            if (y == y0) {
+                for (int x = 0; x < output.width; ++x)
+                    std::memcpy(row + x * bytes.size(), bytes.data(), bytes.size());
+            } else {
+                std::memcpy(row, output.getDataRaw() + y0 * output.bytesPerRow(), rowBytes);
+            }
+        }
+    };
+}
+
+BandNullary fill(const FillSpec &spec, const ImageTypeSpec &outSpec) {
     aa_assert(int(spec.value.size()) == outSpec.channels);
-    return [spec, outSpec](Image &output) {
+    #define X(type, name) if (outSpec.dataType == name) return fillTyped<type>(spec, outSpec);
+    ACCELERATED_IMAGE_FOR_EACH_NAMED_TYPE(X)
+    #undef X
+    aa_assert(false);
+    return {};
+}
+
+BandUnary copySameType(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    return [inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
+        aa_assert(input == inSpec);
         aa_assert(output == outSpec);
-        forEachPixelAndChannel(output, [&spec](Image &output, int x, int y, int c) {
-            output.set<float>(x, y, c, spec.value.at(c));
-        });
+        aa_assert(input.width == output.width && input.height == output.height);
+        const std::size_t rowBytes = output.width * output.bytesPerPixel();
+        if (isContiguous(input) && isContiguous(output)) {
+            std::memcpy(output.getDataRaw() + y0 * rowBytes, input.getDataRaw() + y0 * rowBytes, (y1 - y0) * rowBytes);
+        } else {
+            for (int y = y0; y < y1; ++y)
+                std::memcpy(output.getDataRaw() + y * output.bytesPerRow(), input.getDataRaw() + y * input.bytesPerRow(), rowBytes);
+        }
     };
 }
 
-Unary rescale(const RescaleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
-    return [spec, inSpec, outSpec](Image &input, Image &output) {
-        aa_assert(output.channels == input.channels);
+// Value conversions go through float, as in Image::get<float>/set<float>,
+// but out-of-range values saturate to the limits of integer output types
+template <class InT, class OutT> struct ConvertValue {
+    static inline OutT apply(InT v) {
+        if (!std::is_integral<OutT>::value) return OutT(float(v));
+        const double d = float(v);
+        if (!(d > double(std::numeric_limits<OutT>::min()))) return std::numeric_limits<OutT>::min();
+        if (d >= double(std::numeric_limits<OutT>::max())) return std::numeric_limits<OutT>::max();
+        return OutT(d);
+    }
+};
+
+template <class InT, class OutT> BandUnary convertTyped(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    return [inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
         aa_assert(input == inSpec);
         aa_assert(output == outSpec);
-        forEachPixelAndChannel(output, [&spec, &input](Image &output, int x, int y, int c) {
-            float relX = x / float(output.width);
-            float relY = y / float(output.height);
-            float newX = (relX * spec.xScale + spec.xTranslation) * input.width;
-            float newY = (relY * spec.yScale + spec.yTranslation) * input.height;
+        aa_assert(input.width == output.width && input.height == output.height);
+        const int n = output.width * output.channels;
+        for (int y = y0; y < y1; ++y) {
+            const InT *in = rowPointer<InT>(input, y);
+            OutT *out = rowPointer<OutT>(output, y);
+            for (int i = 0; i < n; ++i) out[i] = ConvertValue<InT, OutT>::apply(in[i]);
+        }
+    };
+}
 
-            output.set<float>(x, y, c, interpolateFloat(input, newX, newY, c, spec.interpolation, spec.border));
-        });
+// half <-> float conversions are exact or round like Float16, vectorized
+template <> BandUnary convertTyped<Float16, float>(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    return [inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
+        aa_assert(input == inSpec);
+        aa_assert(output == outSpec);
+        aa_assert(input.width == output.width && input.height == output.height);
+        for (int y = y0; y < y1; ++y)
+            simd::halfToFloat(reinterpret_cast<std::uint16_t*>(rowPointer<Float16>(input, y)), rowPointer<float>(output, y), output.width * output.channels);
+    };
+}
+
+template <> BandUnary convertTyped<float, Float16>(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    return [inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
+        aa_assert(input == inSpec);
+        aa_assert(output == outSpec);
+        aa_assert(input.width == output.width && input.height == output.height);
+        for (int y = y0; y < y1; ++y)
+            simd::floatToHalf(rowPointer<float>(input, y), reinterpret_cast<std::uint16_t*>(rowPointer<Float16>(output, y)), output.width * output.channels);
     };
 }
 
-Unary swizzleGeneric(const SwizzleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+BandUnary copy(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    aa_assert(inSpec.channels == outSpec.channels);
+    if (inSpec.dataType == outSpec.dataType) return copySameType(inSpec, outSpec);
+    #define X(inType, outType) \
+        if (inSpec.dataType == ImageTypeSpec::getType<inType>() && outSpec.dataType == ImageTypeSpec::getType<outType>()) \
+            return convertTyped<inType, outType>(inSpec, outSpec);
+    ACCELERATED_IMAGE_FOR_EACH_TYPE_PAIR(X)
+    #undef X
+    aa_assert(false);
+    return {};
+}
+
+BandUnary swizzleGeneric(const SwizzleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
     aa_assert(int(spec.channelList.size()) == outSpec.channels);
-    return [spec, inSpec, outSpec](Image &input, Image &output) {
+    return [spec, inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
         aa_assert(input == inSpec);
         aa_assert(output == outSpec);
-        forEachPixelAndChannel(output, [&spec, &input](Image &output, int x, int y, int c) {
+        forEachPixelAndChannel(output, y0, y1, [&spec, &input](Image &output, int x, int y, int c) {
             int chan = spec.channelList.at(c);
             if (chan == -1) {
                 output.set<float>(x, y, c, spec.constantList.at(c));
@@ -101,13 +232,393 @@ Unary swizzleGeneric(const SwizzleSpec &spec, const ImageTypeSpec &inSpec, const
     };
 }
 
-template <class T> Unary swizzle(const SwizzleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+// reinterpret raw bytes as a 1-byte type, e.g., FixedPoint<std::uint8_t>,
+// or vice versa. Only meaningful if sizeof(T) == 1
+template <class T> inline T fromByte(std::uint8_t b) {
+    T v = T();
+    std::memcpy(static_cast<void*>(&v), &b, 1);
+    return v;
+}
+
+template <class T> inline std::uint8_t toByte(T v) {
+    std::uint8_t b;
+    std::memcpy(&b, static_cast<const void*>(&v), 1);
+    return b;
+}
+
+// Out-of-bounds index handling as in cpu::Image. Returns -1 for zero
+int applyBorderIndex(int i, int size, Image::Border border) {
+    if (i >= 0 && i < size) return i;
+    switch (border) {
+    case Image::Border::ZERO:
+        return -1;
+    case Image::Border::MIRROR:
+        i = i < 0 ? -i : 2 * (size - 1) - i;
+        break; // multiple mirroring undefined (clamped here)
+    case Image::Border::REPEAT:
+        i %= size;
+        return i < 0 ? i + size : i;
+    case Image::Border::CLAMP:
+    case Image::Border::UNDEFINED: // any value is OK
+        break;
+    }
+    return std::min(std::max(i, 0), size - 1);
+}
+
+/**
+ * Resampling coefficients for one axis: the output pixel o is a weighted
+ * sum of the input pixels index[o * taps + k] with weights weight[o * taps + k]
+ * (k < taps). Index -1 means zero (border). Zero-weight taps are skipped.
+ *
+ * The sampling convention matches the GPU implementation: the output pixel o
+ * is centered at the input pixel coordinate o * alpha + translation * inSize,
+ * where alpha = scale * inSize / outSize. In the AREA mode, the output pixel
+ * covers the input interval [s, s + alpha), where s is the same coordinate.
+ */
+struct RescaleTable {
+    int taps;
+    std::vector<int> index;
+    std::vector<float> weight;
+
+    RescaleTable(int inSize, int outSize, double scale, double translation, Image::Interpolation interpolation, Image::Border border) {
+        const double alpha = scale * inSize / outSize;
+        const double t = translation * inSize;
+        switch (interpolation) {
+        case Image::Interpolation::LINEAR:
+            taps = 2;
+            break;
+        case Image::Interpolation::AREA:
+            taps = int(std::ceil(std::fabs(alpha))) + 1;
+            break;
+        case Image::Interpolation::NEAREST:
+        case Image::Interpolation::UNDEFINED:
+        default:
+            taps = 1;
+            break;
+        }
+
+        for (int o = 0; o < outSize; ++o) {
+            const double s = o * alpha + t;
+            const std::size_t first = index.size();
+            const auto addTap = [&](int i, double w) {
+                index.push_back(w == 0 ? -1 : applyBorderIndex(i, inSize, border));
+                weight.push_back(w);
+            };
+            if (taps == 1) {
+                addTap(int(std::floor(s + 0.5)), 1);
+            } else if (interpolation == Image::Interpolation::LINEAR) {
+                const double i0 = std::floor(s);
+                addTap(int(i0), 1 - (s - i0));
+                addTap(int(i0) + 1, s - i0);
+            } else {
+                const double width = std::fabs(alpha);
+                const double a = alpha < 0 ? s + alpha : s, b = a + width;
+                const int i0 = int(std::floor(a));
+                for (int k = 0; k < taps; ++k) {
+                    const int i = i0 + k;
+                    const double overlap = std::min(b, double(i + 1)) - std::max(a, double(i));
+                    addTap(i, overlap > 0 ? overlap / width : 0);
+                }
+            }
+            aa_assert(index.size() == first + taps); (void)first;
+        }
+    }
+};
+
+typedef std::function<void(Image &img, int y, float *values)> RowLoader;
+typedef std::function<void(Image &img, int y, const float *values)> RowStorer;
+
+template <class T> RowLoader typedRowLoader() {
+    return [](Image &img, int y, float *values) {
+        const T *row = rowPointer<T>(img, y);
+        const int n = img.width * img.channels;
+        for (int i = 0; i < n; ++i) values[i] = float(row[i]);
+    };
+}
+
+template <class T> RowStorer typedRowStorer() {
+    return [](Image &img, int y, const float *values) {
+        T *row = rowPointer<T>(img, y);
+        const int n = img.width * img.channels;
+        for (int i = 0; i < n; ++i) row[i] = T(values[i]);
+    };
+}
+
+template <> RowLoader typedRowLoader<Float16>() {
+    return [](Image &img, int y, float *values) {
+        simd::halfToFloat(reinterpret_cast<std::uint16_t*>(rowPointer<Float16>(img, y)), values, img.width * img.channels);
+    };
+}
+
+template <> RowStorer typedRowStorer<Float16>() {
+    return [](Image &img, int y, const float *values) {
+        simd::floatToHalf(values, reinterpret_cast<std::uint16_t*>(rowPointer<Float16>(img, y)), img.width * img.channels);
+    };
+}
+
+RowLoader genericRowLoader() {
+    return [](Image &img, int y, float *values) {
+        for (int x = 0; x < img.width; ++x)
+            for (int c = 0; c < img.channels; ++c)
+                *(values++) = img.get<float>(x, y, c);
+    };
+}
+
+RowStorer genericRowStorer() {
+    return [](Image &img, int y, const float *values) {
+        for (int x = 0; x < img.width; ++x)
+            for (int c = 0; c < img.channels; ++c)
+                img.set<float>(x, y, c, *(values++));
+    };
+}
+
+// Separable resampling: each needed input row is converted to float and
+// resampled horizontally once, and then combined vertically
+void rescaleRows(const RescaleSpec &spec, Image &input, Image &output, int y0, int y1,
+    const RowLoader &load, const RowStorer &store)
+{
+    const RescaleTable xTable(input.width, output.width, spec.xScale, spec.xTranslation, spec.interpolation, spec.border);
+    const RescaleTable yTable(input.height, output.height, spec.yScale, spec.yTranslation, spec.interpolation, spec.border);
+    const int channels = output.channels;
+    const int rowSize = output.width * channels;
+    const int nSlots = yTable.taps + 1;
+
+    std::vector<float> inRow(input.width * channels), outRow(rowSize), slots(nSlots * rowSize);
+    std::vector<int> slotRows(nSlots, -1);
+
+    const auto resampledRow = [&](int y, int r) -> const float* {
+        const int *needed = &yTable.index[y * yTable.taps];
+        for (int i = 0; i < nSlots; ++i) if (slotRows[i] == r) return &slots[i * rowSize];
+        // evict a row that is not needed for this output row
+        int slot = -1;
+        for (int i = 0; i < nSlots && slot < 0; ++i) {
+            if (slotRows[i] < 0 || std::find(needed, needed + yTable.taps, slotRows[i]) == needed + yTable.taps) slot = i;
+        }
+        aa_assert(slot >= 0);
+
+        load(input, r, inRow.data());
+        float *h = &slots[slot * rowSize];
+        for (int x = 0; x < output.width; ++x) {
+            const int *idx = &xTable.index[x * xTable.taps];
+            const float *w = &xTable.weight[x * xTable.taps];
+            for (int c = 0; c < channels; ++c) {
+                float v = 0;
+                for (int k = 0; k < xTable.taps; ++k) {
+                    if (idx[k] >= 0) v += w[k] * inRow[idx[k] * channels + c];
+                }
+                h[x * channels + c] = v;
+            }
+        }
+        slotRows[slot] = r;
+        return h;
+    };
+
+    for (int y = y0; y < y1; ++y) {
+        std::fill(outRow.begin(), outRow.end(), 0.0f);
+        for (int k = 0; k < yTable.taps; ++k) {
+            const int r = yTable.index[y * yTable.taps + k];
+            if (r < 0) continue;
+            const float w = yTable.weight[y * yTable.taps + k];
+            const float *h = resampledRow(y, r);
+            for (int i = 0; i < rowSize; ++i) outRow[i] += w * h[i];
+        }
+        store(output, y, outRow.data());
+    }
+}
+
+// Integer-ratio AREA downscaling. Gives identical results to rescaleRows,
+// since the weights (1/2 or 1/4) are powers of two and the summation order
+// is the same
+template <class InT, class OutT, int F> void boxDownscale(Image &input, Image &output, int y0, int y1) {
+    const int channels = output.channels;
+    const float norm = 1.0f / (F * F);
+    for (int y = y0; y < y1; ++y) {
+        const InT *rows[F];
+        for (int j = 0; j < F; ++j) rows[j] = rowPointer<InT>(input, y * F + j);
+        OutT *out = rowPointer<OutT>(output, y);
+        for (int x = 0; x < output.width; ++x) {
+            for (int c = 0; c < channels; ++c) {
+                float total = 0;
+                for (int j = 0; j < F; ++j) {
+                    const InT *in = rows[j] + x * F * channels + c;
+                    float rowSum = 0;
+                    for (int k = 0; k < F; ++k) rowSum += float(in[k * channels]);
+                    total += rowSum;
+                }
+                out[x * channels + c] = OutT(total * norm);
+            }
+        }
+    }
+}
+
+int integerDownscaleFactor(const RescaleSpec &spec, const Image &input, const Image &output) {
+    if (spec.interpolation != Image::Interpolation::AREA ||
+        spec.xScale != 1.0 || spec.yScale != 1.0 ||
+        spec.xTranslation != 0.0 || spec.yTranslation != 0.0) return 0;
+    for (int f : { 2, 4 }) {
+        if (input.width == f * output.width && input.height == f * output.height) return f;
+    }
+    return 0;
+}
+
+template <class InT, class OutT> BandUnary rescaleTyped(const RescaleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    const RowLoader load = typedRowLoader<InT>();
+    const RowStorer store = typedRowStorer<OutT>();
+    return [spec, inSpec, outSpec, load, store](Image &input, Image &output, int y0, int y1) {
+        aa_assert(output.channels == input.channels);
+        aa_assert(input == inSpec);
+        aa_assert(output == outSpec);
+        switch (integerDownscaleFactor(spec, input, output)) {
+        case 2: boxDownscale<InT, OutT, 2>(input, output, y0, y1); return;
+        case 4: boxDownscale<InT, OutT, 4>(input, output, y0, y1); return;
+        default: rescaleRows(spec, input, output, y0, y1, load, store); return;
+        }
+    };
+}
+
+BandUnary rescaleGeneric(const RescaleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    return [spec, inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
+        aa_assert(output.channels == input.channels);
+        aa_assert(input == inSpec);
+        aa_assert(output == outSpec);
+        rescaleRows(spec, input, output, y0, y1, genericRowLoader(), genericRowStorer());
+    };
+}
+
+BandUnary rescale(const RescaleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    #define X(type, name) \
+        if (inSpec.dataType == name && outSpec.dataType == name) \
+            return rescaleTyped<type, type>(spec, inSpec, outSpec); \
+        if (inSpec.dataType == name && outSpec.dataType == ImageTypeSpec::DataType::FLOAT32) \
+            return rescaleTyped<type, float>(spec, inSpec, outSpec);
+    ACCELERATED_IMAGE_FOR_EACH_NAMED_TYPE(X)
+    #undef X
+    return rescaleGeneric(spec, inSpec, outSpec);
+}
+
+RowStorer rowStorer(ImageTypeSpec::DataType dataType) {
+    #define X(type, name) if (dataType == name) return typedRowStorer<type>();
+    ACCELERATED_IMAGE_FOR_EACH_NAMED_TYPE(X)
+    #undef X
+    return genericRowStorer();
+}
+
+/**
+ * Warps are computed in tiles of output pixels: first the source
+ * coordinates of the whole tile (a vectorizable loop for the matrix
+ * warps), then the samples, which usually come from a few input rows.
+ */
+constexpr int WARP_TILE = 64;
+// Source coordinates are clamped to this range (NaN to its lower end), so
+// the integer conversions stay defined: beyond it, the pixels are out of
+// bounds for any image. Homography denominators closer to zero than
+// WARP_MIN_DENOMINATOR (points at infinity) are replaced by it
+constexpr float WARP_MAX_COORD = 1 << 24;
+constexpr float WARP_MIN_DENOMINATOR = 1e-12f;
+
+inline float warpSafeCoordinate(float c) {
+    if (!(c >= -WARP_MAX_COORD)) return -WARP_MAX_COORD; // also NaN
+    return std::min(c, WARP_MAX_COORD);
+}
+
+template <class InT> BandNAry warpTyped(const WarpSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    const bool useMap = spec.usesMap();
+    std::vector<float> homography;
+    if (!useMap) for (double v : spec.getHomography()) homography.push_back(float(v));
+    const bool linear = spec.interpolation == Image::Interpolation::LINEAR;
+    const Image::Border border = spec.border == Image::Border::UNDEFINED ? Image::Border::CLAMP : spec.border;
+    const RowStorer store = rowStorer(outSpec.dataType);
+
+    return [useMap, homography, linear, border, store, inSpec, outSpec](Image **inputs, int nInputs, Image &output, int y0, int y1) {
+        aa_assert(nInputs == (useMap ? 2 : 1)); (void)nInputs;
+        Image &input = *inputs[0];
+        aa_assert(input == inSpec && output == outSpec);
+        const int channels = output.channels;
+        if (useMap) {
+            const Image &map = *inputs[1];
+            (void)map;
+            aa_assert(map.channels == 2 && map.dataType == ImageTypeSpec::DataType::FLOAT32);
+            aa_assert(map.width == output.width && map.height == output.height);
+        }
+
+        const auto addSample = [&input, border, channels](int x, int y, float w, float *out) {
+            x = applyBorderIndex(x, input.width, border);
+            y = applyBorderIndex(y, input.height, border);
+            if (x < 0 || y < 0) return;
+            const InT *pixel = rowPointer<InT>(input, y) + x * channels;
+            for (int c = 0; c < channels; ++c) out[c] += w * float(pixel[c]);
+        };
+
+        std::vector<float> outRow(output.width * channels);
+        float srcX[WARP_TILE], srcY[WARP_TILE];
+        for (int y = y0; y < y1; ++y) {
+            std::fill(outRow.begin(), outRow.end(), 0.0f);
+            for (int x0 = 0; x0 < output.width; x0 += WARP_TILE) {
+                const int n = std::min(WARP_TILE, output.width - x0);
+                if (useMap) {
+                    const float *mapRow = rowPointer<float>(*inputs[1], y) + x0 * 2;
+                    for (int i = 0; i < n; ++i) {
+                        srcX[i] = mapRow[i * 2];
+                        srcY[i] = mapRow[i * 2 + 1];
+                    }
+                } else {
+                    const float *h = homography.data();
+                    const float py = float(y);
+                    for (int i = 0; i < n; ++i) {
+                        const float px = float(x0 + i);
+                        float w = h[6] * px + h[7] * py + h[8];
+                        if (std::abs(w) < WARP_MIN_DENOMINATOR) w = std::copysign(WARP_MIN_DENOMINATOR, w);
+                        const float invW = 1.0f / w;
+                        srcX[i] = (h[0] * px + h[1] * py + h[2]) * invW;
+                        srcY[i] = (h[3] * px + h[4] * py + h[5]) * invW;
+                    }
+                }
+                for (int i = 0; i < n; ++i) {
+                    srcX[i] = warpSafeCoordinate(srcX[i]);
+                    srcY[i] = warpSafeCoordinate(srcY[i]);
+                }
+
+                float *out = &outRow[x0 * channels];
+                for (int i = 0; i < n; ++i, out += channels) {
+                    if (!linear) {
+                        addSample(int(std::floor(srcX[i] + 0.5f)), int(std::floor(srcY[i] + 0.5f)), 1, out);
+                        continue;
+                    }
+                    const float fx = std::floor(srcX[i]), fy = std::floor(srcY[i]);
+                    const float ax = srcX[i] - fx, ay = srcY[i] - fy;
+                    const int ix = int(fx), iy = int(fy);
+                    addSample(ix, iy, (1 - ax) * (1 - ay), out);
+                    addSample(ix + 1, iy, ax * (1 - ay), out);
+                    addSample(ix, iy + 1, (1 - ax) * ay, out);
+                    addSample(ix + 1, iy + 1, ax * ay, out);
+                }
+            }
+            store(output, y, outRow.data());
+        }
+    };
+}
+
+BandNAry warp(const WarpSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    aa_assert(inSpec.channels == outSpec.channels);
+    aa_assert(spec.interpolation != Image::Interpolation::AREA);
+    #define X(type, name) if (inSpec.dataType == name) return warpTyped<type>(spec, inSpec, outSpec);
+    ACCELERATED_IMAGE_FOR_EACH_NAMED_TYPE(X)
+    #undef X
+    aa_assert(false);
+    return {};
+}
+
+template <class T> BandUnary swizzle(const SwizzleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
     aa_assert(int(spec.channelList.size()) == outSpec.channels);
-    return [spec, inSpec, outSpec](Image &input, Image &output) {
-        int n = spec.channelList.size();
+    std::vector<std::uint8_t> constantBytes;
+    if (sizeof(T) == 1) {
+        for (int c : spec.constantList) constantBytes.push_back(toByte(T(c)));
+    }
+    return [spec, inSpec, outSpec, constantBytes](Image &input, Image &output, int y0, int y1) {
+        const int n = spec.channelList.size();
         const int *chanList = spec.channelList.data();
         const int *constList = spec.constantList.data();
-        forEachPixelFast<T>(input, output, inSpec, outSpec, [n, chanList, constList](const T *in, T *out) {
+        const auto pixel = [n, chanList, constList](const T *in, T *out) {
             for (int c = 0; c < n; ++c) {
                 int chan = chanList[c];
                 if (chan == -1) {
@@ -116,16 +627,164 @@ template <class T> Unary swizzle(const SwizzleSpec &spec, const ImageTypeSpec &i
                     out[c] = in[chan];
                 }
             }
-        });
+        };
+
+        if (sizeof(T) != 1) {
+            forEachPixelFast<T>(input, output, y0, y1, inSpec, outSpec, pixel);
+            return;
+        }
+
+        aa_assert(input.width == output.width && input.height == output.height);
+        aa_assert(input == inSpec);
+        aa_assert(output == outSpec);
+        for (int y = y0; y < y1; ++y) {
+            const T *in = rowPointer<T>(input, y);
+            T *out = rowPointer<T>(output, y);
+            const int x0 = simd::swizzle8(
+                reinterpret_cast<const std::uint8_t*>(in),
+                reinterpret_cast<std::uint8_t*>(out),
+                output.width, input.channels, n, chanList, constantBytes.data());
+            for (int x = x0; x < output.width; ++x) pixel(in + x * input.channels, out + x * n);
+        }
     };
 }
 
-NAry pixelwiseAffineCombination(const PixelwiseAffineCombinationSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
-    return [spec, inSpec, outSpec](Image **inputs, int nInputs, Image &output) {
+// Affine operations from fixed-point to fixed-point types of up to 16 bits
+// use integer arithmetic. The raw value r of a FixedPoint means the float
+// scale * r + offset, and FixedPoint::fromFloat(v) truncates (towards zero)
+// t = tScale * v + tOffset and clamps it to the raw range. Therefore an
+// affine combination of fixed-point inputs is t = acc / 2^shift, where acc
+// is an integer combination of the raw inputs. The number of fraction bits
+// is chosen so that the int64 accumulator cannot overflow and the error of
+// t stays below MAX_FIXED_POINT_ERROR. The results hence only differ from
+// the float versions if t is (almost) an integer, where the float rounding
+// errors decide them arbitrarily
+constexpr double MAX_FIXED_POINT_ERROR = 1.0 / 1024;
+
+template <class T> struct FixedPointEncoding {
+    static constexpr double scale() { return T::isSigned() ? 2 / T::unsignedMax() : 1 / T::max(); }
+    static constexpr double offset() { return T::isSigned() ? 1 / T::unsignedMax() : 0.0; }
+    static constexpr double magnitude() { return -T::min() > T::max() ? -T::min() : T::max(); }
+    static constexpr double tScale() { return T::isSigned() ? T::unsignedMax() / 2 : T::max(); }
+    static constexpr double tOffset() { return T::isSigned() ? 0.0 : 0.5; }
+};
+
+inline std::int64_t shiftTowardsZero(std::int64_t v, int shift) {
+    return v >= 0 ? (v >> shift) : -((-v) >> shift);
+}
+
+template <class OutT> struct FixedPointAccumulator {
+    std::vector<std::int64_t> weights;
+    std::int64_t constant = 0;
+    int shift = 0;
+
+    /**
+     * Set up acc = constant + sum_j weights[j] * x_j for the output value
+     * bias + sum_j coeffs[j] * (scale * x_j + offset) of integers x_j, for
+     * which |x_j| <= magnitude and whose error is at most inputError.
+     * Returns false if this is not accurate enough with 64-bit integers
+     */
+    bool init(const std::vector<double> &coeffs, double bias,
+        double scale, double offset, double magnitude, double inputError = 0)
+    {
+        typedef FixedPointEncoding<OutT> Out;
+        double c0 = bias, bound = 0, error = 0;
+        for (double c : coeffs) {
+            const double w = std::fabs(Out::tScale() * c * scale);
+            c0 += c * offset;
+            bound += w * magnitude;
+            error += w * inputError;
+        }
+        c0 = Out::tScale() * c0 + Out::tOffset();
+        bound += std::fabs(c0);
+        if (!(bound < 1e15)) return false;
+
+        shift = 61 - int(std::ceil(std::log2(bound + 1)));
+        const double unit = std::ldexp(1.0, shift);
+        weights.clear();
+        for (double c : coeffs) weights.push_back(std::llround(Out::tScale() * c * scale * unit));
+        constant = std::llround(c0 * unit);
+        error += (0.5 * coeffs.size() * magnitude + 0.5) / unit;
+        return error <= MAX_FIXED_POINT_ERROR;
+    }
+
+    /** Set up for the raw values of the fixed-point type InT */
+    template <class InT> bool init(const std::vector<double> &coeffs, double bias) {
+        typedef FixedPointEncoding<InT> In;
+        return init(coeffs, bias, In::scale(), In::offset(), In::magnitude());
+    }
+
+    inline OutT store(std::int64_t acc) const {
+        const std::int64_t hi = std::int64_t(OutT::max());
+        const std::int64_t lo = OutT::isSigned() ? -hi : 0;
+        const std::int64_t t = shiftTowardsZero(acc, shift);
+        return OutT::fromValue(decltype(OutT::value)(t < lo ? lo : (t > hi ? hi : t)));
+    }
+};
+
+// for dispatching to the integer fixed-point versions
+#define ACCELERATED_ARRAYS_FOR_EACH_INTEGER_FIXED_POINT_TYPE(x) \
+    x(FixedPoint<std::uint8_t>, ImageTypeSpec::DataType::UFIXED8) \
+    x(FixedPoint<std::int8_t>, ImageTypeSpec::DataType::SFIXED8) \
+    x(FixedPoint<std::uint16_t>, ImageTypeSpec::DataType::UFIXED16) \
+    x(FixedPoint<std::int16_t>, ImageTypeSpec::DataType::SFIXED16)
+
+template <class InT, class OutT> BandNAry pixelwiseAffineCombinationFixed(const PixelwiseAffineCombinationSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    const int n = outSpec.channels, m = inSpec.channels;
+    const int nInputs = spec.linear.size();
+    std::vector< FixedPointAccumulator<OutT> > rows(n);
+    for (int c = 0; c < n; ++c) {
+        std::vector<double> coeffs;
+        for (const auto &mat : spec.linear) {
+            const auto &matRow = mat.at(c);
+            aa_assert(int(matRow.size()) == m);
+            coeffs.insert(coeffs.end(), matRow.begin(), matRow.end());
+        }
+        const double bias = spec.bias.empty() ? 0.0 : spec.bias.at(c);
+        if (!rows[c].template init<InT>(coeffs, bias)) return {};
+    }
+
+    return [rows, n, m, nInputs, inSpec, outSpec](Image **inputs, int nInputsGiven, Image &output, int y0, int y1) {
+        aa_assert(nInputsGiven == nInputs); (void)nInputsGiven;
+        aa_assert(output == outSpec);
+        for (int i = 0; i < nInputs; ++i) {
+            aa_assert(*inputs[i] == inSpec);
+            aa_assert(inputs[i]->width == output.width && inputs[i]->height == output.height);
+        }
+        std::vector<const InT*> in(nInputs);
+        for (int y = y0; y < y1; ++y) {
+            for (int i = 0; i < nInputs; ++i) in[i] = rowPointer<InT>(*inputs[i], y);
+            OutT *out = rowPointer<OutT>(output, y);
+            for (int x = 0; x < output.width; ++x) {
+                for (int c = 0; c < n; ++c) {
+                    const auto &row = rows[c];
+                    const std::int64_t *w = row.weights.data();
+                    std::int64_t acc = row.constant;
+                    for (int i = 0; i < nInputs; ++i) {
+                        const InT *p = in[i] + x * m;
+                        for (int j = 0; j < m; ++j) acc += *w++ * p[j].value;
+                    }
+                    out[x * n + c] = row.store(acc);
+                }
+            }
+        }
+    };
+}
+
+template <class InT> BandNAry pixelwiseAffineCombinationFixedFor(const PixelwiseAffineCombinationSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    #define X(type, name) if (outSpec.dataType == name) \
+        return pixelwiseAffineCombinationFixed<InT, type>(spec, inSpec, outSpec);
+    ACCELERATED_ARRAYS_FOR_EACH_INTEGER_FIXED_POINT_TYPE(X)
+    #undef X
+    return {};
+}
+
+BandNAry pixelwiseAffineCombination(const PixelwiseAffineCombinationSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    return [spec, inSpec, outSpec](Image **inputs, int nInputs, Image &output, int y0, int y1) {
         aa_assert(int(spec.linear.size()) == nInputs);
         aa_assert(output == outSpec);
         for (int i = 0; i < nInputs; ++i) aa_assert(*inputs[i] == inSpec);
-        forEachPixelAndChannel(output, [&spec, inputs, nInputs](Image &output, int x, int y, int c) {
+        forEachPixelAndChannel(output, y0, y1, [&spec, inputs, nInputs](Image &output, int x, int y, int c) {
             float v = spec.bias.empty() ? 0.0 : spec.bias.at(c);
             for (int i = 0; i < nInputs; ++i) {
                 auto &input = *inputs[i];
@@ -142,7 +801,7 @@ NAry pixelwiseAffineCombination(const PixelwiseAffineCombinationSpec &spec, cons
     };
 }
 
-template <class T> Unary pixelwiseAffineUnary(const PixelwiseAffineCombinationSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+template <class T> BandUnary pixelwiseAffineUnary(const PixelwiseAffineCombinationSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
     aa_assert(int(spec.linear.size()) == 1);
     std::vector<float> bias, matColMajor;
     const int n = outSpec.channels, m = inSpec.channels;
@@ -159,10 +818,51 @@ template <class T> Unary pixelwiseAffineUnary(const PixelwiseAffineCombinationSp
             }
         }
     }
-    return [bias, matColMajor, n, m, inSpec, outSpec](Image &input, Image &output) {
+
+    // for 1-byte types, all the products coefficient * input are tabulated
+    // (in the same float precision) so the result is identical
+    std::vector<float> productTable;
+    if (sizeof(T) == 1) {
+        for (float coeff : matColMajor)
+            for (int b = 0; b < 256; ++b)
+                productTable.push_back(coeff * float(fromByte<T>(std::uint8_t(b))));
+    }
+
+    return [bias, matColMajor, productTable, n, m, inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
         const float *biasData = bias.data();
         const float *matData = matColMajor.data();
-        forEachPixelFast<T>(input, output, inSpec, outSpec, [n, m, biasData, matData](const T *in, T *out) {
+
+        if (std::is_same<T, float>::value) {
+            aa_assert(input.width == output.width && input.height == output.height);
+            aa_assert(input == inSpec);
+            aa_assert(output == outSpec);
+            bool vectorized = true;
+            for (int y = y0; y < y1 && vectorized; ++y) {
+                vectorized = simd::pixelwiseAffine(
+                    reinterpret_cast<const float*>(rowPointer<T>(input, y)),
+                    reinterpret_cast<float*>(rowPointer<T>(output, y)),
+                    output.width, m, n, matData, biasData);
+            }
+            if (vectorized) return;
+        }
+
+        if (!productTable.empty()) {
+            const float *products = productTable.data();
+            forEachPixelFast<T>(input, output, y0, y1, inSpec, outSpec, [n, m, biasData, products](const T *in, T *out) {
+                const float *coeff = products;
+                for (int i = 0; i < n; ++i) {
+                    float v = biasData[i];
+                    for (int j = 0; j < m; ++j) {
+                        v += coeff[toByte(in[j])];
+                        coeff += 256;
+                    }
+                    out[i] = T(v);
+                }
+            });
+            return;
+        }
+
+        forEachPixelFast<T>(input, output, y0, y1, inSpec, outSpec, [n, m, biasData, matData](const T *in, T *out) {
             const float *coeff = matData;
             for (int i = 0; i < n; ++i) {
                 float v = biasData[i];
@@ -176,27 +876,100 @@ template <class T> Unary pixelwiseAffineUnary(const PixelwiseAffineCombinationSp
     };
 }
 
-Unary channelwiseAffine(const ChannelwiseAffineSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
-    return [spec, inSpec, outSpec](Image &input, Image &output) {
+BandUnary channelwiseAffine(const ChannelwiseAffineSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    return [spec, inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
         aa_assert(output.channels == input.channels);
         aa_assert(input == inSpec);
         aa_assert(output == outSpec);
-        forEachPixelAndChannel(output, [&spec, &input](Image &output, int x, int y, int c) {
+        forEachPixelAndChannel(output, y0, y1, [&spec, &input](Image &output, int x, int y, int c) {
             const float inValue = input.get<float>(x, y, c);
             output.set<float>(x, y, c, spec.scale * inValue + spec.bias);
         });
     };
 }
 
-Unary fixedConvolution2D(const FixedConvolution2DSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+template <class OutT> BandUnary channelwiseAffineLookup(const std::vector<OutT> &table, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    aa_assert(table.size() == 256);
+    return [table, inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
+        aa_assert(input.width == output.width && input.height == output.height);
+        aa_assert(input == inSpec);
+        aa_assert(output == outSpec);
+        const int n = output.width * output.channels;
+        const OutT *t = table.data();
+        for (int y = y0; y < y1; ++y) {
+            const std::uint8_t *in = input.getDataRaw() + y * input.bytesPerRow();
+            OutT *out = rowPointer<OutT>(output, y);
+            for (int i = 0; i < n; ++i) out[i] = t[in[i]];
+        }
+    };
+}
+
+// 1-byte input types: the output values for all the 256 possible inputs
+// are computed exactly as in the generic version
+template <class InT, class OutT> BandUnary channelwiseAffineTable(const ChannelwiseAffineSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    std::vector<OutT> table;
+    for (int b = 0; b < 256; ++b) {
+        const float inValue = double(fromByte<InT>(std::uint8_t(b)));
+        table.push_back(OutT(float(spec.scale * inValue + spec.bias)));
+    }
+    return channelwiseAffineLookup<OutT>(table, inSpec, outSpec);
+}
+
+// fixed-point to fixed-point with integers, tabulated for 1-byte inputs
+template <class InT, class OutT> BandUnary channelwiseAffineFixed(const ChannelwiseAffineSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    FixedPointAccumulator<OutT> affine;
+    if (!affine.template init<InT>({ spec.scale }, spec.bias)) return {};
+    const std::int64_t w = affine.weights.at(0);
+
+    if (sizeof(InT) == 1) {
+        std::vector<OutT> table;
+        for (int b = 0; b < 256; ++b)
+            table.push_back(affine.store(affine.constant + w * fromByte<InT>(std::uint8_t(b)).value));
+        return channelwiseAffineLookup<OutT>(table, inSpec, outSpec);
+    }
+
+    return [affine, w, inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
+        aa_assert(input.width == output.width && input.height == output.height);
+        aa_assert(input == inSpec);
+        aa_assert(output == outSpec);
+        const int n = output.width * output.channels;
+        for (int y = y0; y < y1; ++y) {
+            const InT *in = rowPointer<InT>(input, y);
+            OutT *out = rowPointer<OutT>(output, y);
+            for (int i = 0; i < n; ++i) out[i] = affine.store(affine.constant + w * in[i].value);
+        }
+    };
+}
+
+template <class InT> BandUnary channelwiseAffineFixedFor(const ChannelwiseAffineSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    #define X(type, name) if (outSpec.dataType == name) \
+        return channelwiseAffineFixed<InT, type>(spec, inSpec, outSpec);
+    ACCELERATED_ARRAYS_FOR_EACH_INTEGER_FIXED_POINT_TYPE(X)
+    #undef X
+    return {};
+}
+
+BandUnary channelwiseAffineFloat(const ChannelwiseAffineSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    return [spec, inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
+        aa_assert(input.width == output.width && input.height == output.height);
+        aa_assert(input == inSpec);
+        aa_assert(output == outSpec);
+        for (int y = y0; y < y1; ++y) {
+            simd::channelwiseAffine(rowPointer<float>(input, y), rowPointer<float>(output, y),
+                output.width * output.channels, spec.scale, spec.bias);
+        }
+    };
+}
+
+BandUnary fixedConvolution2DGeneric(const FixedConvolution2DSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
     aa_assert(!spec.kernel.empty());
-    return [spec, inSpec, outSpec](Image &input, Image &output) {
+    return [spec, inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
         aa_assert(input == inSpec);
         aa_assert(output == outSpec);
         const int kernelXOffset = spec.getKernelXOffset();
         const int kernelYOffset = spec.getKernelYOffset();
         // std::cout << spec.kernel.size() << " " << spec.kernel.at(0).size() << std::endl;
-        forEachPixelAndChannel(output, [kernelYOffset, kernelXOffset, &spec, &input](Image &output, int x, int y, int c) {
+        forEachPixelAndChannel(output, y0, y1, [kernelYOffset, kernelXOffset, &spec, &input](Image &output, int x, int y, int c) {
             float v = spec.bias;
             for (int i = 0; i < int(spec.kernel.size()); ++i) {
                 const int y1 = y * spec.yStride + i + kernelYOffset;
@@ -213,34 +986,667 @@ Unary fixedConvolution2D(const FixedConvolution2DSpec &spec, const ImageTypeSpec
         });
     };
 }
+
+// Range of output indices [begin, end) for which all the kernel taps are
+// inside the input image, i.e., no border handling is needed
+void convolutionInteriorRange(int inSize, int outSize, int kernelSize, int kernelOffset, int stride, int &begin, int &end) {
+    begin = kernelOffset >= 0 ? 0 : (-kernelOffset + stride - 1) / stride;
+    const int last = inSize - kernelSize - kernelOffset;
+    end = last < 0 ? 0 : std::min(last / stride + 1, outSize);
+    begin = std::min(begin, end);
+}
+
+struct ConvolutionKernel {
+    int width, height;
+    std::vector<double> values; // row-major
+    // non-empty if the kernel is separable: kernel[i][j] = column[i] * row[j]
+    std::vector<double> row, column;
+
+    ConvolutionKernel(const FixedConvolution2DSpec &spec) :
+        width(spec.kernel.at(0).size()),
+        height(spec.kernel.size())
+    {
+        for (const auto &krow : spec.kernel) {
+            aa_assert(int(krow.size()) == width);
+            values.insert(values.end(), krow.begin(), krow.end());
+        }
+        spec.getSeparableFactors(column, row);
+    }
+
+    bool isSeparable() const { return !row.empty(); }
+};
+
+// The arithmetic of TypedConvolution: the kernel weights, the accumulator
+// values of the inputs and how the accumulators are stored in the 2D pass
+// and in the row & column passes of a separable kernel
+template <class InT, class OutT> struct FloatConvolutionArithmetic {
+    typedef float Acc;
+    bool separable;
+    std::vector<float> values, row, column;
+    float bias2D, columnBias;
+
+    FloatConvolutionArithmetic(const FixedConvolution2DSpec &spec, const ConvolutionKernel &kernel) :
+        separable(kernel.isSeparable()),
+        values(kernel.values.begin(), kernel.values.end()),
+        row(kernel.row.begin(), kernel.row.end()),
+        column(kernel.column.begin(), kernel.column.end()),
+        bias2D(spec.bias),
+        columnBias(spec.bias)
+    {}
+
+    static inline float tap(InT v) { return float(v); }
+    inline OutT store2D(float v) const { return OutT(v); }
+    inline float storeRow(float v) const { return v; }
+    inline OutT storeColumn(float v) const { return OutT(v); }
+};
+
+// Integers for fixed-point types, see FixedPointAccumulator. The row pass
+// of a separable kernel keeps the rows to ROW_BITS bits (incl. fraction)
+template <class T> struct FixedPointConvolutionArithmetic {
+    typedef std::int64_t Acc;
+    static constexpr int ROW_BITS = 31;
+
+    bool separable = false;
+    std::vector<std::int64_t> values, row, column;
+    std::int64_t bias2D = 0, columnBias = 0;
+    int rowShift = 0;
+    FixedPointAccumulator<T> full, columns;
+
+    // returns false if the kernel cannot be applied accurately with integers
+    bool init(const FixedConvolution2DSpec &spec, const ConvolutionKernel &kernel) {
+        typedef FixedPointEncoding<T> In;
+        if (kernel.isSeparable()) {
+            double rowSum = 0, rowAbsSum = 0;
+            for (double r : kernel.row) {
+                rowSum += r;
+                rowAbsSum += std::fabs(r);
+            }
+            const int magnitudeBits = int(std::ceil(std::log2(rowAbsSum * In::magnitude() + 1)));
+            const int weightBits = 61 - magnitudeBits, rowBits = ROW_BITS - magnitudeBits;
+            rowShift = weightBits - rowBits;
+            row.clear();
+            for (double r : kernel.row) row.push_back(std::llround(std::ldexp(r, weightBits)));
+            const double rowUnit = std::ldexp(1.0, rowBits);
+            const double rowError = 0.5 * kernel.width * In::magnitude() / std::ldexp(1.0, rowShift) + 1;
+            separable = rowBits >= 0 && columns.init(kernel.column, spec.bias,
+                In::scale() / rowUnit, In::offset() * rowSum,
+                rowAbsSum * In::magnitude() * rowUnit + 1, rowError);
+            if (separable) {
+                column = columns.weights;
+                columnBias = columns.constant;
+                return true;
+            }
+        }
+        if (!full.init(kernel.values, spec.bias, In::scale(), In::offset(), In::magnitude())) return false;
+        values = full.weights;
+        bias2D = full.constant;
+        return true;
+    }
+
+    static inline std::int64_t tap(T v) { return v.value; }
+    inline T store2D(std::int64_t acc) const { return full.store(acc); }
+    inline std::int64_t storeRow(std::int64_t acc) const { return shiftTowardsZero(acc, rowShift); }
+    inline T storeColumn(std::int64_t acc) const { return columns.store(acc); }
+};
+
+/**
+ * Convolution with a fixed input and output data type. The interior of the
+ * image is processed using raw row pointers and only the strips near the
+ * borders, whose width is determined by the kernel radius, require the
+ * (slower) border handling.
+ */
+template <class InT, class OutT, class Arithmetic> class TypedConvolution {
+private:
+    typedef typename Arithmetic::Acc Acc;
+    const FixedConvolution2DSpec spec;
+    const Arithmetic arithmetic;
+    const int kernelWidth, kernelHeight;
+    const int kernelXOffset, kernelYOffset;
+
+    inline Acc tapWithBorder(const Image &input, int x1, int y1, int c) const {
+        return Arithmetic::tap(input.get<InT>(x1, y1, c, spec.border));
+    }
+
+    void convolve2D(Image &input, Image &output, int y0, int y1) const {
+        const int channels = output.channels;
+        const int kw = kernelWidth, kh = kernelHeight;
+        const Acc *k = arithmetic.values.data();
+        int xBegin, xEnd, yBegin, yEnd;
+        convolutionInteriorRange(input.width, output.width, kw, kernelXOffset, spec.xStride, xBegin, xEnd);
+        convolutionInteriorRange(input.height, output.height, kh, kernelYOffset, spec.yStride, yBegin, yEnd);
+
+        std::vector<const InT*> inRows(kh);
+        for (int y = y0; y < y1; ++y) {
+            OutT *out = rowPointer<OutT>(output, y);
+            const int yIn = y * spec.yStride + kernelYOffset;
+
+            const auto borderPixel = [&](int x) {
+                for (int c = 0; c < channels; ++c) {
+                    Acc v = arithmetic.bias2D;
+                    for (int i = 0; i < kh; ++i) {
+                        for (int j = 0; j < kw; ++j) {
+                            v += tapWithBorder(input, x * spec.xStride + j + kernelXOffset, yIn + i, c) * k[i * kw + j];
+                        }
+                    }
+                    out[x * channels + c] = arithmetic.store2D(v);
+                }
+            };
+
+            if (y < yBegin || y >= yEnd) {
+                for (int x = 0; x < output.width; ++x) borderPixel(x);
+                continue;
+            }
+
+            for (int i = 0; i < kh; ++i) inRows[i] = rowPointer<InT>(input, yIn + i);
+            for (int x = 0; x < xBegin; ++x) borderPixel(x);
+            for (int x = xBegin; x < xEnd; ++x) {
+                const int offs = (x * spec.xStride + kernelXOffset) * channels;
+                for (int c = 0; c < channels; ++c) {
+                    Acc v = arithmetic.bias2D;
+                    for (int i = 0; i < kh; ++i) {
+                        const InT *in = inRows[i] + offs + c;
+                        const Acc *krow = k + i * kw;
+                        for (int j = 0; j < kw; ++j) v += Arithmetic::tap(in[j * channels]) * krow[j];
+                    }
+                    out[x * channels + c] = arithmetic.store2D(v);
+                }
+            }
+            for (int x = xEnd; x < output.width; ++x) borderPixel(x);
+        }
+    }
+
+    // horizontal pass of a separable kernel for the input row yIn, which may
+    // be outside the image
+    void convolveRow(Image &input, int yIn, int outWidth, Acc *out) const {
+        const int channels = input.channels;
+        const int kw = kernelWidth;
+        const Acc *k = arithmetic.row.data();
+
+        const auto borderPixel = [&](int x) {
+            for (int c = 0; c < channels; ++c) {
+                Acc v = 0;
+                for (int j = 0; j < kw; ++j) {
+                    v += tapWithBorder(input, x * spec.xStride + j + kernelXOffset, yIn, c) * k[j];
+                }
+                out[x * channels + c] = arithmetic.storeRow(v);
+            }
+        };
+
+        if (yIn < 0 || yIn >= input.height) {
+            for (int x = 0; x < outWidth; ++x) borderPixel(x);
+            return;
+        }
+
+        int xBegin, xEnd;
+        convolutionInteriorRange(input.width, outWidth, kw, kernelXOffset, spec.xStride, xBegin, xEnd);
+        const InT *inRow = rowPointer<InT>(input, yIn);
+        for (int x = 0; x < xBegin; ++x) borderPixel(x);
+        for (int x = xBegin; x < xEnd; ++x) {
+            const InT *in = inRow + (x * spec.xStride + kernelXOffset) * channels;
+            for (int c = 0; c < channels; ++c) {
+                Acc v = 0;
+                for (int j = 0; j < kw; ++j) v += Arithmetic::tap(in[j * channels + c]) * k[j];
+                out[x * channels + c] = arithmetic.storeRow(v);
+            }
+        }
+        for (int x = xEnd; x < outWidth; ++x) borderPixel(x);
+    }
+
+    void convolveSeparable(Image &input, Image &output, int y0, int y1) const {
+        const int kh = kernelHeight;
+        const int rowSize = output.width * output.channels;
+        const Acc *column = arithmetic.column.data();
+        // ring buffer of horizontally convolved input rows
+        std::vector<Acc> rows(kh * rowSize);
+        const auto ringRow = [&](int yIn) {
+            return rows.data() + (((yIn % kh) + kh) % kh) * rowSize;
+        };
+
+        int nextRow = y0 * spec.yStride + kernelYOffset;
+        for (int y = y0; y < y1; ++y) {
+            const int yIn = y * spec.yStride + kernelYOffset;
+            for (int r = std::max(yIn, nextRow); r < yIn + kh; ++r)
+                convolveRow(input, r, output.width, ringRow(r));
+            nextRow = yIn + kh;
+
+            OutT *out = rowPointer<OutT>(output, y);
+            for (int x = 0; x < rowSize; ++x) {
+                Acc v = arithmetic.columnBias;
+                for (int i = 0; i < kh; ++i) v += ringRow(yIn + i)[x] * column[i];
+                out[x] = arithmetic.storeColumn(v);
+            }
+        }
+    }
+
+public:
+    TypedConvolution(const FixedConvolution2DSpec &spec, const ConvolutionKernel &kernel, const Arithmetic &arithmetic) :
+        spec(spec),
+        arithmetic(arithmetic),
+        kernelWidth(kernel.width),
+        kernelHeight(kernel.height),
+        kernelXOffset(spec.getKernelXOffset()),
+        kernelYOffset(spec.getKernelYOffset())
+    {}
+
+    void operator()(Image &input, Image &output, int y0, int y1) const {
+        if (arithmetic.separable) convolveSeparable(input, output, y0, y1);
+        else convolve2D(input, output, y0, y1);
+    }
+};
+
+template <class InT, class OutT, class Arithmetic> BandUnary typedConvolution(const FixedConvolution2DSpec &spec, const ConvolutionKernel &kernel, const Arithmetic &arithmetic, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    aa_assert(inSpec.channels == outSpec.channels);
+    typedef TypedConvolution<InT, OutT, Arithmetic> Convolution;
+    std::shared_ptr<Convolution> conv(new Convolution(spec, kernel, arithmetic));
+    return [conv, inSpec, outSpec](Image &input, Image &output, int y0, int y1) {
+        aa_assert(input == inSpec);
+        aa_assert(output == outSpec);
+        (*conv)(input, output, y0, y1);
+    };
+}
+
+template <class InT, class OutT> BandUnary fixedConvolution2DTyped(const FixedConvolution2DSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    const ConvolutionKernel kernel(spec);
+    return typedConvolution<InT, OutT>(spec, kernel, FloatConvolutionArithmetic<InT, OutT>(spec, kernel), inSpec, outSpec);
+}
+
+// fixed-point to the same type with integers, if accurate enough
+template <class T> BandUnary fixedConvolution2DFixed(const FixedConvolution2DSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    const ConvolutionKernel kernel(spec);
+    FixedPointConvolutionArithmetic<T> arithmetic;
+    if (!arithmetic.init(spec, kernel)) return fixedConvolution2DTyped<T, T>(spec, inSpec, outSpec);
+    return typedConvolution<T, T>(spec, kernel, arithmetic, inSpec, outSpec);
+}
+
+BandUnary fixedConvolution2D(const FixedConvolution2DSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    aa_assert(!spec.kernel.empty());
+    if (inSpec.channels == outSpec.channels) {
+        #define X(type, name) \
+            if (inSpec.dataType == name && outSpec.dataType == name) \
+                return fixedConvolution2DFixed<type>(spec, inSpec, outSpec);
+        ACCELERATED_ARRAYS_FOR_EACH_INTEGER_FIXED_POINT_TYPE(X)
+        #undef X
+        #define X(type, name) \
+            if (inSpec.dataType == name && outSpec.dataType == name) \
+                return fixedConvolution2DTyped<type, type>(spec, inSpec, outSpec); \
+            if (inSpec.dataType == name && outSpec.dataType == ImageTypeSpec::DataType::FLOAT32) \
+                return fixedConvolution2DTyped<type, float>(spec, inSpec, outSpec);
+        ACCELERATED_IMAGE_FOR_EACH_NAMED_TYPE(X)
+        #undef X
+    }
+    return fixedConvolution2DGeneric(spec, inSpec, outSpec);
+}
+
+// Fused pixelwise operations: each block of pixels is converted to doubles,
+// run through all the steps and stored, without intermediary images
+template <class T> void loadValues(const std::uint8_t *src, double *dst, int n) {
+    const T *p = reinterpret_cast<const T*>(src);
+    for (int i = 0; i < n; ++i) dst[i] = double(float(p[i]));
+}
+
+template <class T> void storeValues(const double *src, std::uint8_t *dst, int n) {
+    T *p = reinterpret_cast<T*>(dst);
+    for (int i = 0; i < n; ++i) p[i] = ConvertValue<float, T>::apply(float(src[i]));
+}
+
+// same rounding and clamping as storing to an image of type T and reading back
+template <class T> void quantizeValues(double *values, int n) {
+    for (int i = 0; i < n; ++i) values[i] = double(float(ConvertValue<float, T>::apply(float(values[i]))));
+}
+
+struct ChainValueOps {
+    void (*load)(const std::uint8_t *src, double *dst, int n);
+    void (*store)(const double *src, std::uint8_t *dst, int n);
+    void (*quantize)(double *values, int n);
+};
+
+ChainValueOps getChainValueOps(ImageTypeSpec::DataType dataType) {
+    #define X(type, name) if (dataType == name) \
+        return { loadValues<type>, storeValues<type>, quantizeValues<type> };
+    ACCELERATED_IMAGE_FOR_EACH_NAMED_TYPE(X)
+    #undef X
+    aa_assert(false);
+    return {};
+}
+
+BandNAry pixelwiseChain(const PixelwiseChainSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    typedef ::accelerated::operations::pixelwiseChain::AffineStep AffineStep;
+    const int nInputs = spec.getInputCount();
+    const std::vector<AffineStep> steps = spec.getAffineSteps(nInputs > 0 ? inSpec.channels : 0);
+    aa_assert(steps.back().channels == outSpec.channels);
+    aa_assert(steps.back().dataType == outSpec.dataType);
+
+    struct Step {
+        std::vector<double> mat; // row-major, all inputs concatenated
+        std::vector<double> bias;
+        int inChannels, outChannels;
+        ChainValueOps ops;
+    };
+    auto compiled = std::make_shared< std::vector<Step> >();
+    int channels = inSpec.channels;
+    for (const auto &s : steps) {
+        Step step;
+        step.inChannels = s.linear.size() * channels;
+        step.outChannels = s.channels;
+        step.bias = s.bias;
+        step.ops = getChainValueOps(s.dataType);
+        for (int i = 0; i < s.channels; ++i)
+            for (const auto &m : s.linear)
+                for (int j = 0; j < channels; ++j)
+                    step.mat.push_back(m.at(i).at(j));
+        compiled->push_back(step);
+        channels = s.channels;
+    }
+    const ChainValueOps inOps = getChainValueOps(inSpec.dataType);
+
+    return [compiled, inOps, nInputs, inSpec, outSpec](Image **inputs, int n, Image &output, int y0, int y1) {
+        (void)n;
+        aa_assert(n == nInputs);
+        aa_assert(output == outSpec);
+        for (int i = 0; i < nInputs; ++i) {
+            aa_assert(*inputs[i] == inSpec);
+            aa_assert(inputs[i]->width == output.width && inputs[i]->height == output.height);
+        }
+
+        constexpr int BLOCK = 64, MAX_CHANNELS = 4;
+        // the inputs of the first step are interleaved per pixel, as in step.mat
+        std::vector<double> bufA(BLOCK * MAX_CHANNELS * std::max(nInputs, 1)), bufB(BLOCK * MAX_CHANNELS);
+        std::vector<double> inRow(BLOCK * MAX_CHANNELS);
+        const int inChannels = inSpec.channels;
+
+        for (int y = y0; y < y1; ++y) {
+            for (int x0 = 0; x0 < output.width; x0 += BLOCK) {
+                const int nPix = std::min(BLOCK, output.width - x0);
+                double *cur = bufA.data(), *next = bufB.data();
+
+                for (int i = 0; i < nInputs; ++i) {
+                    auto &input = *inputs[i];
+                    inOps.load(input.getDataRaw() + y * input.bytesPerRow() + x0 * input.bytesPerPixel(),
+                        inRow.data(), nPix * inChannels);
+                    for (int x = 0; x < nPix; ++x)
+                        for (int c = 0; c < inChannels; ++c)
+                            cur[(x * nInputs + i) * inChannels + c] = inRow[x * inChannels + c];
+                }
+
+                for (const Step &step : *compiled) {
+                    const double *mat = step.mat.data();
+                    for (int x = 0; x < nPix; ++x) {
+                        const double *in = cur + x * step.inChannels;
+                        double *out = next + x * step.outChannels;
+                        for (int i = 0; i < step.outChannels; ++i) {
+                            const double *row = mat + i * step.inChannels;
+                            double v = step.bias[i];
+                            for (int j = 0; j < step.inChannels; ++j) v += row[j] * in[j];
+                            out[i] = v;
+                        }
+                    }
+                    if (&step != &compiled->back()) step.ops.quantize(next, nPix * step.outChannels);
+                    std::swap(cur, next);
+                }
+
+                compiled->back().ops.store(cur,
+                    output.getDataRaw() + y * output.bytesPerRow() + x0 * output.bytesPerPixel(),
+                    nPix * output.channels);
+            }
+        }
+    };
+}
+simd::YuvCoefficients fixedPointYuvCoefficients(const YuvToRgbSpec &spec) {
+    const auto c = spec.getCoefficients();
+    const auto q13 = [](double v) { return int(std::round(v * 8192)); };
+    return { int(std::round(c.yOffset * 255)), q13(c.y), q13(c.rv), q13(c.gu), q13(c.gv), q13(c.bu) };
+}
+
+void checkYuvPlanes(Image **inputs, int nInputs, Image &output, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    (void)inputs; (void)nInputs; (void)output; (void)inSpec; (void)outSpec;
+    aa_assert(nInputs == 2);
+    aa_assert(*inputs[0] == inSpec && output == outSpec);
+    aa_assert(inputs[1]->channels == 2 && inputs[1]->dataType == inSpec.dataType);
+    aa_assert(output.width == inputs[0]->width && output.height == inputs[0]->height);
+    aa_assert(inputs[1]->width == YuvImage::getChromaSize(output.width));
+    aa_assert(inputs[1]->height == YuvImage::getChromaSize(output.height));
+}
+
+// bytes to bytes in Q13 fixed point, matches simd::yuvToRgb8
+BandNAry yuvToRgb8(const YuvToRgbSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    const simd::YuvCoefficients c = fixedPointYuvCoefficients(spec);
+    const bool vuOrder = spec.layout == Image::YuvLayout::NV21;
+    return [c, vuOrder, inSpec, outSpec](Image **inputs, int nInputs, Image &output, int y0, int y1) {
+        checkYuvPlanes(inputs, nInputs, output, inSpec, outSpec);
+        const int channels = output.channels;
+        const auto clampByte = [](int v) {
+            return std::uint8_t(std::min(255, std::max(0, v >> 13)));
+        };
+        for (int y = y0; y < y1; ++y) {
+            const std::uint8_t *yRow = inputs[0]->getDataRaw() + y * inputs[0]->bytesPerRow();
+            const std::uint8_t *uvRow = inputs[1]->getDataRaw() + (y / 2) * inputs[1]->bytesPerRow();
+            std::uint8_t *out = output.getDataRaw() + y * output.bytesPerRow();
+            const int x0 = channels == 1 ? 0 : simd::yuvToRgb8(yRow, uvRow, out, output.width, channels, vuOrder, c);
+            for (int x = x0; x < output.width; ++x) {
+                const int luma = c.y * (yRow[x] - c.yOffset) + 4096;
+                std::uint8_t *pixel = out + x * channels;
+                if (channels == 1) {
+                    pixel[0] = clampByte(luma);
+                    continue;
+                }
+                const int u = uvRow[(x / 2) * 2 + (vuOrder ? 1 : 0)] - 128;
+                const int v = uvRow[(x / 2) * 2 + (vuOrder ? 0 : 1)] - 128;
+                pixel[0] = clampByte(luma + c.rv * v);
+                pixel[1] = clampByte(luma + c.gu * u + c.gv * v);
+                pixel[2] = clampByte(luma + c.bu * u);
+                if (channels == 4) pixel[3] = 0xff;
+            }
+        }
+    };
+}
+
+BandNAry yuvToRgb(const YuvToRgbSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    const auto c = spec.getCoefficients();
+    const bool vuOrder = spec.layout == Image::YuvLayout::NV21;
+    return [c, vuOrder, inSpec, outSpec](Image **inputs, int nInputs, Image &output, int y0, int y1) {
+        checkYuvPlanes(inputs, nInputs, output, inSpec, outSpec);
+        Image &yPlane = *inputs[0], &uvPlane = *inputs[1];
+        const auto clamp01 = [](double v) { return float(std::min(1.0, std::max(0.0, v))); };
+        for (int y = y0; y < y1; ++y) {
+            for (int x = 0; x < output.width; ++x) {
+                const double luma = c.y * (yPlane.get<float>(x, y, 0) - c.yOffset);
+                const double u = uvPlane.get<float>(x / 2, y / 2, vuOrder ? 1 : 0) - c.chromaOffset;
+                const double v = uvPlane.get<float>(x / 2, y / 2, vuOrder ? 0 : 1) - c.chromaOffset;
+                const double rgba[4] = {
+                    luma + c.rv * v,
+                    luma + c.gu * u + c.gv * v,
+                    luma + c.bu * u,
+                    1.0
+                };
+                if (output.channels == 1) output.set<float>(x, y, 0, clamp01(luma));
+                else for (int i = 0; i < output.channels; ++i) output.set<float>(x, y, i, clamp01(rgba[i]));
+            }
+        }
+    };
+}
+
+// Reductions are computed in bands of input rows, each to its own
+// accumulator of getOutputWidth() * channels values, which are combined
+// after all the bands are done
+struct Reduction {
+    typedef ::accelerated::operations::reduce::Type Type;
+    Type type;
+    int channels, outputWidth;
+    std::function<void(Image &input, int y0, int y1, double *acc)> reduceRows;
+
+    std::size_t size() const {
+        return std::size_t(outputWidth) * channels;
+    }
+
+    double initialValue() const {
+        if (type == Type::MIN) return std::numeric_limits<double>::infinity();
+        if (type == Type::MAX) return -std::numeric_limits<double>::infinity();
+        return 0;
+    }
+
+    void combine(double *acc, const double *other) const {
+        for (std::size_t i = 0; i < size(); ++i) {
+            if (type == Type::MIN) acc[i] = std::min(acc[i], other[i]);
+            else if (type == Type::MAX) acc[i] = std::max(acc[i], other[i]);
+            else acc[i] += other[i];
+        }
+    }
+
+    void store(const double *acc, std::size_t nPixels, Image &output) const {
+        aa_assert(output.channels == channels);
+        aa_assert(output.width == outputWidth && output.height == 1);
+        const double scale = type == Type::MEAN ? 1.0 / std::max(std::size_t(1), nPixels) : 1.0;
+        for (int x = 0; x < outputWidth; ++x)
+            for (int c = 0; c < channels; ++c)
+                output.set<float>(x, 0, c, float(acc[x * channels + c] * scale));
+    }
+};
+
+template <class T, class F> void forEachValue(Image &input, int y0, int y1, const F &f) {
+    const int channels = input.channels;
+    for (int y = y0; y < y1; ++y) {
+        const T *row = rowPointer<T>(input, y);
+        for (int x = 0; x < input.width; ++x, row += channels)
+            for (int c = 0; c < channels; ++c) f(c, double(row[c]));
+    }
+}
+
+template <class T> Reduction reductionTyped(const ReduceSpec &spec, const ImageTypeSpec &inSpec) {
+    typedef Reduction::Type Type;
+    Reduction r;
+    r.type = spec.type;
+    r.channels = inSpec.channels;
+    r.outputWidth = spec.getOutputWidth();
+    switch (spec.type) {
+    case Type::SUM:
+    case Type::MEAN:
+        r.reduceRows = [](Image &input, int y0, int y1, double *acc) {
+            forEachValue<T>(input, y0, y1, [acc](int c, double v) { acc[c] += v; });
+        };
+        break;
+    case Type::MIN:
+        r.reduceRows = [](Image &input, int y0, int y1, double *acc) {
+            forEachValue<T>(input, y0, y1, [acc](int c, double v) { acc[c] = std::min(acc[c], v); });
+        };
+        break;
+    case Type::MAX:
+        r.reduceRows = [](Image &input, int y0, int y1, double *acc) {
+            forEachValue<T>(input, y0, y1, [acc](int c, double v) { acc[c] = std::max(acc[c], v); });
+        };
+        break;
+    case Type::HISTOGRAM: {
+        aa_assert(spec.bins >= 1 && spec.histogramMax > spec.histogramMin);
+        // same as ReduceSpec::getBin
+        const double offset = spec.histogramMin;
+        const double scale = spec.bins / (spec.histogramMax - spec.histogramMin);
+        const int bins = spec.bins;
+        r.reduceRows = [offset, scale, bins](Image &input, int y0, int y1, double *acc) {
+            const int channels = input.channels;
+            forEachValue<T>(input, y0, y1, [offset, scale, bins, channels, acc](int c, double v) {
+                const double bin = std::floor((v - offset) * scale);
+                acc[int(std::min(double(bins - 1), std::max(0.0, bin))) * channels + c] += 1;
+            });
+        };
+        break;
+    }
+    }
+    return r;
+}
+
+Reduction reduction(const ReduceSpec &spec, const ImageTypeSpec &inSpec) {
+    #define X(type, name) if (inSpec.dataType == name) return reductionTyped<type>(spec, inSpec);
+    ACCELERATED_IMAGE_FOR_EACH_NAMED_TYPE(X)
+    #undef X
+    aa_assert(false);
+    return {};
+}
 }
 
 class CpuFactory : public Factory {
 private:
     Processor &processor;
+    const int nParallelBands;
+
+    // avoid splitting small images to tiny bands
+    static constexpr int MIN_ROWS_PER_BAND = 4;
+
+    // the label is used for tracing the enqueued tasks
+    static Function labeled(const Function &f, const char *label) {
+        return [f, label](BaseImage **inputs, int nInputs, BaseImage &output) -> Future {
+            tracing::ScopedLabel scopedLabel(label);
+            return f(inputs, nInputs, output);
+        };
+    }
+
+    Function wrapBands(const BandNAry &f, const char *label) {
+        if (nParallelBands <= 1) {
+            return labeled(wrapNAry([f](Image **inputs, int nInputs, Image &output) {
+                f(inputs, nInputs, output, 0, output.height);
+            }), label);
+        }
+
+        Processor &p = processor;
+        const int maxBands = nParallelBands;
+        return [f, &p, maxBands, label](BaseImage **inputs, int nInputs, BaseImage &output) -> Future {
+            tracing::ScopedLabel scopedLabel(label);
+            auto &out = Image::castFrom(output);
+            const int nBands = std::max(1, std::min(maxBands, out.height / MIN_ROWS_PER_BAND));
+
+            // shared by all bands
+            auto args = std::make_shared< std::vector<Image*> >();
+            for (int i = 0; i < nInputs; ++i) args->push_back(&Image::castFrom(*inputs[i]));
+
+            std::vector<Future> futures;
+            for (int band = 0; band < nBands; ++band) {
+                const int y0 = (band * out.height) / nBands;
+                const int y1 = ((band + 1) * out.height) / nBands;
+                futures.push_back(p.enqueue([f, args, &out, y0, y1]() {
+                    f(args->data(), args->size(), out, y0, y1);
+                }));
+            }
+            return Future::all(futures);
+        };
+    }
+
+    template <class T> Function wrapBands(const T &f, const char *label) {
+        return wrapBands(convertBands(f), label);
+    }
 
 public:
-    CpuFactory(Processor &processor) : processor(processor) {}
+    CpuFactory(Processor &processor, int nParallelBands) :
+        processor(processor), nParallelBands(nParallelBands)
+    {}
 
     Function wrapNAry(const NAry &f) final {
         return ::accelerated::operations::sync::wrap(f, processor);
     }
 
+    MultiOutputFunction wrapMultiOutput(const MultiOutputNAry &f) final {
+        return ::accelerated::operations::sync::wrapMultiOutput(f, processor);
+    }
+
     Function create(const FixedConvolution2DSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
         checkSpec(inSpec);
         checkSpec(outSpec);
-        return wrap<Unary>(impl::fixedConvolution2D(spec, inSpec, outSpec));
+        return wrapBands(impl::fixedConvolution2D(spec, inSpec, outSpec), "fixedConvolution2D");
+    }
+
+    Function create(const CopySpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
+        (void)spec;
+        checkSpec(inSpec);
+        checkSpec(outSpec);
+        return wrapBands(impl::copy(inSpec, outSpec), "copy");
     }
 
     Function create(const FillSpec &spec, const ImageTypeSpec &imageSpec) final {
         checkSpec(imageSpec);
-        return wrap<Nullary>(impl::fill(spec, imageSpec));
+        return wrapBands(impl::fill(spec, imageSpec), "fill");
     }
 
     Function create(const RescaleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
         checkSpec(inSpec);
         checkSpec(outSpec);
-        return wrap<Unary>(impl::rescale(spec, inSpec, outSpec));
+        return wrapBands(impl::rescale(spec, inSpec, outSpec), "rescale");
     }
 
     Function create(const SwizzleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
@@ -248,35 +1654,154 @@ public:
         checkSpec(outSpec);
         if (inSpec.dataType == outSpec.dataType) {
             #define X(type, name) if (inSpec.dataType == name) \
-                return wrap<Unary>(impl::swizzle<type>(spec, inSpec, outSpec));
+                return wrapBands(impl::swizzle<type>(spec, inSpec, outSpec), "swizzle");
             ACCELERATED_IMAGE_FOR_EACH_NAMED_TYPE(X)
             #undef X
         }
-        return wrap<Unary>(impl::swizzleGeneric(spec, inSpec, outSpec));
+        return wrapBands(impl::swizzleGeneric(spec, inSpec, outSpec), "swizzle");
     }
 
     Function create(const PixelwiseAffineCombinationSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
         checkSpec(inSpec);
         checkSpec(outSpec);
+        #define X(type, name) if (inSpec.dataType == name) { \
+                const auto f = impl::pixelwiseAffineCombinationFixedFor<type>(spec, inSpec, outSpec); \
+                if (f) return wrapBands(f, "pixelwiseAffineCombination"); \
+            }
+        ACCELERATED_ARRAYS_FOR_EACH_INTEGER_FIXED_POINT_TYPE(X)
+        #undef X
         if (spec.linear.size() == 1 && inSpec.dataType == outSpec.dataType) {
             #define X(type, name) if (inSpec.dataType == name) \
-                return wrap<Unary>(impl::pixelwiseAffineUnary<type>(spec, inSpec, outSpec));
+                return wrapBands(impl::pixelwiseAffineUnary<type>(spec, inSpec, outSpec), "pixelwiseAffineCombination");
             ACCELERATED_IMAGE_FOR_EACH_NAMED_TYPE(X)
             #undef X
         }
-        return wrapNAry(impl::pixelwiseAffineCombination(spec, inSpec, outSpec));
+        return wrapBands(impl::pixelwiseAffineCombination(spec, inSpec, outSpec), "pixelwiseAffineCombination");
     }
 
     Function create(const ChannelwiseAffineSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
         checkSpec(inSpec);
         checkSpec(outSpec);
-        return wrap<Unary>(impl::channelwiseAffine(spec, inSpec, outSpec));
+        if (inSpec.channels == outSpec.channels) {
+            typedef ImageTypeSpec::DataType DataType;
+            if (inSpec.dataType == DataType::FLOAT32 && outSpec.dataType == DataType::FLOAT32)
+                return wrapBands(impl::channelwiseAffineFloat(spec, inSpec, outSpec), "channelwiseAffine");
+
+            #define X(type, name) if (inSpec.dataType == name) { \
+                    const auto f = impl::channelwiseAffineFixedFor<type>(spec, inSpec, outSpec); \
+                    if (f) return wrapBands(f, "channelwiseAffine"); \
+                }
+            ACCELERATED_ARRAYS_FOR_EACH_INTEGER_FIXED_POINT_TYPE(X)
+            #undef X
+
+            #define X(type, name) if (outSpec.dataType == name) \
+                return wrapBands(impl::channelwiseAffineTable<InType, type>(spec, inSpec, outSpec), "channelwiseAffine");
+            #define ACCELERATED_ARRAYS_FOR_INPUT_TYPE(inType, inName) \
+                if (inSpec.dataType == inName) { \
+                    typedef inType InType; \
+                    ACCELERATED_IMAGE_FOR_EACH_NAMED_TYPE(X) \
+                }
+            ACCELERATED_ARRAYS_FOR_INPUT_TYPE(std::uint8_t, DataType::UINT8)
+            ACCELERATED_ARRAYS_FOR_INPUT_TYPE(std::int8_t, DataType::SINT8)
+            ACCELERATED_ARRAYS_FOR_INPUT_TYPE(FixedPoint<std::uint8_t>, DataType::UFIXED8)
+            ACCELERATED_ARRAYS_FOR_INPUT_TYPE(FixedPoint<std::int8_t>, DataType::SFIXED8)
+            #undef ACCELERATED_ARRAYS_FOR_INPUT_TYPE
+            #undef X
+        }
+        return wrapBands(impl::channelwiseAffine(spec, inSpec, outSpec), "channelwiseAffine");
+    }
+
+    Function create(const PixelwiseChainSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
+        checkSpec(inSpec);
+        checkSpec(outSpec);
+        return wrapBands(impl::pixelwiseChain(spec, inSpec, outSpec), "pixelwiseChain");
+    }
+
+    Function create(const YuvToRgbSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
+        checkSpec(inSpec);
+        checkSpec(outSpec);
+        aa_assert(inSpec.channels == 1 && inSpec.dataType == ImageTypeSpec::DataType::UFIXED8);
+        aa_assert(outSpec.channels != 2);
+        aa_assert(!ImageTypeSpec::isIntegerType(outSpec.dataType));
+        if (outSpec.dataType == ImageTypeSpec::DataType::UFIXED8)
+            return wrapBands(impl::yuvToRgb8(spec, inSpec, outSpec), "yuvToRgb");
+        return wrapBands(impl::yuvToRgb(spec, inSpec, outSpec), "yuvToRgb");
+    }
+
+    Function create(const WarpSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
+        checkSpec(inSpec);
+        checkSpec(outSpec);
+        return wrapBands(impl::warp(spec, inSpec, outSpec), "warp");
+    }
+
+    // the bands reduce the input rows in parallel to their own partial
+    // results, which are combined when all of them are done
+    Function create(const ReduceSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
+        checkSpec(inSpec);
+        checkSpec(outSpec);
+        aa_assert(inSpec.channels == outSpec.channels);
+        auto reduction = std::make_shared<const impl::Reduction>(impl::reduction(spec, inSpec));
+        Processor &p = processor;
+        const int maxBands = nParallelBands;
+        return [reduction, &p, maxBands, inSpec, outSpec](BaseImage **inputs, int nInputs, BaseImage &output) -> Future {
+            tracing::ScopedLabel scopedLabel("reduce");
+            aa_assert(nInputs == 1); (void)nInputs;
+            auto &in = Image::castFrom(*inputs[0]);
+            auto &out = Image::castFrom(output);
+            aa_assert(in == inSpec && out == outSpec);
+            const int nBands = std::max(1, std::min(maxBands, in.height / MIN_ROWS_PER_BAND));
+
+            const std::size_t size = reduction->size();
+            auto partials = std::make_shared< std::vector<double> >(nBands * size, reduction->initialValue());
+            std::vector<Future> futures;
+            for (int band = 0; band < nBands; ++band) {
+                const int y0 = (band * in.height) / nBands;
+                const int y1 = ((band + 1) * in.height) / nBands;
+                double *acc = partials->data() + band * size;
+                futures.push_back(p.enqueue([reduction, partials, &in, y0, y1, acc]() {
+                    reduction->reduceRows(in, y0, y1, acc);
+                }));
+            }
+            return Future::all(futures).then([reduction, partials, nBands, &in, &out]() {
+                const std::size_t size = reduction->size();
+                for (int band = 1; band < nBands; ++band)
+                    reduction->combine(partials->data(), partials->data() + band * size);
+                reduction->store(partials->data(), std::size_t(in.width) * in.height, out);
+            });
+        };
+    }
+
+    // runs all the levels sequentially in one task. The strided (and
+    // usually separable) convolution only computes the decimated pixels
+    MultiOutputFunction create(const PyramidSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
+        checkSpec(inSpec);
+        checkSpec(outSpec);
+        const auto conv = spec.getLevelConvolution();
+        const BandUnary first = impl::fixedConvolution2D(conv, inSpec, outSpec);
+        const BandUnary next = impl::fixedConvolution2D(conv, outSpec, outSpec);
+        const int levels = spec.levels;
+        auto function = wrapMultiOutput([first, next, levels](Image **inputs, int nInputs, Image **outputs, int nOutputs) {
+            aa_assert(nInputs == 1 && nOutputs == levels);
+            (void)nInputs; (void)nOutputs;
+            for (int level = 0; level < levels; ++level) {
+                Image &input = level == 0 ? *inputs[0] : *outputs[level - 1];
+                Image &output = *outputs[level];
+                aa_assert(output.width == PyramidSpec::getLevelSize(input.width, 1));
+                aa_assert(output.height == PyramidSpec::getLevelSize(input.height, 1));
+                (level == 0 ? first : next)(input, output, 0, output.height);
+            }
+        });
+        return [function](BaseImage **inputs, int nInputs, BaseImage **outputs, int nOutputs) -> Future {
+            tracing::ScopedLabel scopedLabel("pyramid");
+            return function(inputs, nInputs, outputs, nOutputs);
+        };
     }
 };
 }
 
-std::unique_ptr<Factory> createFactory(Processor &processor) {
-    return std::unique_ptr<Factory>(new CpuFactory(processor));
+std::unique_ptr<Factory> createFactory(Processor &processor, int nParallelBands) {
+    aa_assert(nParallelBands >= 1);
+    return std::unique_ptr<Factory>(new CpuFactory(processor, nParallelBands));
 }
 
 }
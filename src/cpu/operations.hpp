@@ -1,3 +1,5 @@
+#pragma once
+
 #include "../standard_ops.hpp"
 
 namespace accelerated {
@@ -9,6 +11,7 @@ typedef std::function< void(Image **inputs, int nInputs, Image &output) > NAry;
 typedef std::function< void(Image &output) > Nullary;
 typedef std::function< void(Image &input, Image &output) > Unary;
 typedef std::function< void(Image &a, Image &b, Image &output) > Binary;
+typedef std::function< void(Image **inputs, int nInputs, Image **outputs, int nOutputs) > MultiOutputNAry;
 
 class Factory : public ::accelerated::operations::StandardFactory {
 public:
@@ -16,11 +19,18 @@ public:
     template <class T> ::accelerated::operations::Function wrap(const T &func) {
         return wrapNAry(::accelerated::operations::sync::convert(func));
     }
+    /** Operation that writes several outputs of the same size in one call */
+    virtual ::accelerated::operations::MultiOutputFunction wrapMultiOutput(const MultiOutputNAry &func) = 0;
 };
 
 // may confuse the compiler due to the inherited "create" methods if inside
 // the above class and called just "create"
-std::unique_ptr<Factory> createFactory(Processor &processor);
+//
+// If nParallelBands > 1, each operation call is split into (at most) that
+// many horizontal bands, which are enqueued to the processor separately.
+// The returned Future resolves when all of them are ready. This is useful
+// for processing large images with a thread pool processor.
+std::unique_ptr<Factory> createFactory(Processor &processor, int nParallelBands = 1);
 }
 }
 }
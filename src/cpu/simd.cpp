@@ -0,0 +1,417 @@
+#include "simd.hpp"
+#include "../float16.hpp"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+    #define ACCELERATED_ARRAYS_SIMD_X86
+    #include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    #define ACCELERATED_ARRAYS_SIMD_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace accelerated {
+namespace cpu {
+namespace simd {
+namespace {
+void channelwiseAffineScalar(const float *in, float *out, int n, double scale, double bias) {
+    for (int i = 0; i < n; ++i) out[i] = float(scale * in[i] + bias);
+}
+
+// shuffle indices for as many pixels as fit in 16 bytes, both in the
+// input and the output. Returns the number of pixels
+int buildSwizzleMask(int inChannels, int outChannels, const int *chanList, const std::uint8_t *constants,
+    std::uint8_t zeroIndex, std::uint8_t *mask, std::uint8_t *constantBytes)
+{
+    const int nPixels = 16 / std::max(inChannels, outChannels);
+    for (int i = 0; i < 16; ++i) {
+        mask[i] = zeroIndex;
+        constantBytes[i] = 0;
+    }
+    for (int p = 0; p < nPixels; ++p) {
+        for (int c = 0; c < outChannels; ++c) {
+            const int i = p * outChannels + c;
+            if (chanList[c] < 0) constantBytes[i] = constants[c];
+            else mask[i] = std::uint8_t(p * inChannels + chanList[c]);
+        }
+    }
+    return nPixels;
+}
+
+void halfToFloatScalar(const std::uint16_t *in, float *out, int n) {
+    for (int i = 0; i < n; ++i) out[i] = Float16::toFloat(in[i]);
+}
+
+void floatToHalfScalar(const float *in, std::uint16_t *out, int n) {
+    for (int i = 0; i < n; ++i) out[i] = Float16::fromFloat(in[i]);
+}
+
+inline bool canProcessSwizzleBlock(int x, int nPixels, int inChannels, int outChannels) {
+    // 16-byte loads and stores must stay inside the row. Extra bytes written
+    // past the block are overwritten by the next block or the scalar tail
+    return x * inChannels + 16 <= nPixels * inChannels && x * outChannels + 16 <= nPixels * outChannels;
+}
+
+#ifdef ACCELERATED_ARRAYS_SIMD_X86
+__attribute__((target("avx")))
+void channelwiseAffineAvx(const float *in, float *out, int n, double scale, double bias) {
+    const __m256d s = _mm256_set1_pd(scale), b = _mm256_set1_pd(bias);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d v = _mm256_cvtps_pd(_mm_loadu_ps(in + i));
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(_mm256_add_pd(_mm256_mul_pd(s, v), b)));
+    }
+    channelwiseAffineScalar(in + i, out + i, n - i, scale, bias);
+}
+
+void channelwiseAffineSse2(const float *in, float *out, int n, double scale, double bias) {
+    const __m128d s = _mm_set1_pd(scale), b = _mm_set1_pd(bias);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 v = _mm_loadu_ps(in + i);
+        const __m128d lo = _mm_cvtps_pd(v), hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+        const __m128 outLo = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(s, lo), b));
+        const __m128 outHi = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(s, hi), b));
+        _mm_storeu_ps(out + i, _mm_movelh_ps(outLo, outHi));
+    }
+    channelwiseAffineScalar(in + i, out + i, n - i, scale, bias);
+}
+
+__attribute__((target("ssse3")))
+int swizzle8Ssse3(const std::uint8_t *in, std::uint8_t *out, int nPixels,
+    int inChannels, int outChannels, const int *chanList, const std::uint8_t *constants)
+{
+    alignas(16) std::uint8_t maskBytes[16], constantBytes[16];
+    const int block = buildSwizzleMask(inChannels, outChannels, chanList, constants, 0x80, maskBytes, constantBytes);
+    const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(maskBytes));
+    const __m128i constant = _mm_load_si128(reinterpret_cast<const __m128i*>(constantBytes));
+    int x = 0;
+    for (; canProcessSwizzleBlock(x, nPixels, inChannels, outChannels); x += block) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x * inChannels));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * outChannels),
+            _mm_or_si128(_mm_shuffle_epi8(v, mask), constant));
+    }
+    return x;
+}
+
+// 32-bit lanes of (first, second) 16-bit coefficients for _mm_madd_epi16
+inline __m128i coefficientPair(int first, int second) {
+    return _mm_set1_epi32(int((std::uint32_t(std::uint16_t(second)) << 16) | std::uint16_t(first)));
+}
+
+int yuvToRgb8Sse2(const std::uint8_t *y, const std::uint8_t *uv, std::uint8_t *out, int width,
+    int outChannels, bool vuOrder, const YuvCoefficients &c)
+{
+    const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi16(1);
+    const __m128i yOffset = _mm_set1_epi16(c.yOffset), chromaOffset = _mm_set1_epi16(128);
+    // the rounding term is multiplied by one
+    const __m128i yCoeffs = coefficientPair(c.y, 4096);
+    const auto chromaCoeffs = [vuOrder](int cu, int cv) {
+        return vuOrder ? coefficientPair(cv, cu) : coefficientPair(cu, cv);
+    };
+    const __m128i rCoeffs = chromaCoeffs(0, c.rv), gCoeffs = chromaCoeffs(c.gu, c.gv), bCoeffs = chromaCoeffs(c.bu, 0);
+    const __m128i alpha = _mm_set1_epi8(char(0xff));
+
+    alignas(16) std::uint8_t rgba[32];
+    int x = 0;
+    // 8 pixels and 4 chroma samples per block
+    for (; x + 8 <= width; x += 8) {
+        const __m128i y16 = _mm_sub_epi16(_mm_unpacklo_epi8(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x)), zero), yOffset);
+        const __m128i uv16 = _mm_sub_epi16(_mm_unpacklo_epi8(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(uv + x)), zero), chromaOffset);
+        const __m128i yLo = _mm_madd_epi16(_mm_unpacklo_epi16(y16, one), yCoeffs);
+        const __m128i yHi = _mm_madd_epi16(_mm_unpackhi_epi16(y16, one), yCoeffs);
+
+        const auto channel = [uv16, yLo, yHi, zero](__m128i coeffs) {
+            // one value per chroma sample, duplicated for two pixels
+            const __m128i chroma = _mm_madd_epi16(uv16, coeffs);
+            const __m128i lo = _mm_srai_epi32(_mm_add_epi32(yLo, _mm_unpacklo_epi32(chroma, chroma)), 13);
+            const __m128i hi = _mm_srai_epi32(_mm_add_epi32(yHi, _mm_unpackhi_epi32(chroma, chroma)), 13);
+            return _mm_packus_epi16(_mm_packs_epi32(lo, hi), zero);
+        };
+        const __m128i rg = _mm_unpacklo_epi8(channel(rCoeffs), channel(gCoeffs));
+        const __m128i ba = _mm_unpacklo_epi8(channel(bCoeffs), alpha);
+        const __m128i lo = _mm_unpacklo_epi16(rg, ba), hi = _mm_unpackhi_epi16(rg, ba);
+
+        if (outChannels == 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), lo);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 16), hi);
+        } else {
+            _mm_store_si128(reinterpret_cast<__m128i*>(rgba), lo);
+            _mm_store_si128(reinterpret_cast<__m128i*>(rgba + 16), hi);
+            std::uint8_t *rgb = out + x * 3;
+            for (int i = 0; i < 8; ++i)
+                for (int j = 0; j < 3; ++j) rgb[i * 3 + j] = rgba[i * 4 + j];
+        }
+    }
+    return x;
+}
+
+__attribute__((target("f16c")))
+void halfToFloatF16c(const std::uint16_t *in, float *out, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+    }
+    halfToFloatScalar(in + i, out + i, n - i);
+}
+
+__attribute__((target("f16c")))
+void floatToHalfF16c(const float *in, std::uint16_t *out, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+    }
+    floatToHalfScalar(in + i, out + i, n - i);
+}
+
+struct Dispatch {
+    void (*channelwiseAffine)(const float*, float*, int, double, double);
+    int (*swizzle8)(const std::uint8_t*, std::uint8_t*, int, int, int, const int*, const std::uint8_t*);
+    void (*halfToFloat)(const std::uint16_t*, float*, int);
+    void (*floatToHalf)(const float*, std::uint16_t*, int);
+
+    Dispatch() {
+        __builtin_cpu_init();
+        channelwiseAffine = __builtin_cpu_supports("avx") ? channelwiseAffineAvx : channelwiseAffineSse2;
+        swizzle8 = __builtin_cpu_supports("ssse3") ? swizzle8Ssse3 : nullptr;
+        const bool f16c = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+        halfToFloat = f16c ? halfToFloatF16c : halfToFloatScalar;
+        floatToHalf = f16c ? floatToHalfF16c : floatToHalfScalar;
+    }
+};
+
+const Dispatch &dispatch() {
+    static Dispatch d;
+    return d;
+}
+#endif
+
+#if defined(ACCELERATED_ARRAYS_SIMD_X86) || defined(ACCELERATED_ARRAYS_SIMD_NEON)
+#ifdef ACCELERATED_ARRAYS_SIMD_X86
+typedef __m128 Vec4;
+inline Vec4 load4(const float *p) { return _mm_loadu_ps(p); }
+inline Vec4 broadcast4(float f) { return _mm_set1_ps(f); }
+inline Vec4 mulAdd4(Vec4 acc, Vec4 a, Vec4 b) { return _mm_add_ps(acc, _mm_mul_ps(a, b)); }
+inline void store4(float *p, Vec4 v) { _mm_storeu_ps(p, v); }
+inline void store3(float *p, Vec4 v) {
+    _mm_storel_pi(reinterpret_cast<__m64*>(p), v);
+    _mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+}
+#else
+typedef float32x4_t Vec4;
+inline Vec4 load4(const float *p) { return vld1q_f32(p); }
+inline Vec4 broadcast4(float f) { return vdupq_n_f32(f); }
+inline Vec4 mulAdd4(Vec4 acc, Vec4 a, Vec4 b) { return vaddq_f32(acc, vmulq_f32(a, b)); }
+inline void store4(float *p, Vec4 v) { vst1q_f32(p, v); }
+inline void store3(float *p, Vec4 v) {
+    vst1_f32(p, vget_low_f32(v));
+    vst1q_lane_f32(p + 2, v, 2);
+}
+#endif
+
+// one pixel per vector, the lanes are the output channels
+template <int InChannels, int OutChannels>
+void pixelwiseAffineVec(const float *in, float *out, int nPixels, const float *mat, const float *bias) {
+    float colData[4][4] = {}, biasData[4] = {};
+    for (int i = 0; i < OutChannels; ++i) {
+        biasData[i] = bias[i];
+        for (int j = 0; j < InChannels; ++j) colData[j][i] = mat[i * InChannels + j];
+    }
+    Vec4 cols[InChannels];
+    for (int j = 0; j < InChannels; ++j) cols[j] = load4(colData[j]);
+    const Vec4 b = load4(biasData);
+
+    for (int x = 0; x < nPixels; ++x) {
+        Vec4 acc = b;
+        for (int j = 0; j < InChannels; ++j) acc = mulAdd4(acc, cols[j], broadcast4(in[j]));
+        if (OutChannels == 4) store4(out, acc);
+        else store3(out, acc);
+        in += InChannels;
+        out += OutChannels;
+    }
+}
+
+// single channel: four pixels per vector
+void pixelwiseAffine1(const float *in, float *out, int nPixels, float m, float bias) {
+    const Vec4 vm = broadcast4(m), vb = broadcast4(bias);
+    int x = 0;
+    for (; x + 4 <= nPixels; x += 4) store4(out + x, mulAdd4(vb, vm, load4(in + x)));
+    for (; x < nPixels; ++x) {
+        float v = bias;
+        v += m * in[x];
+        out[x] = v;
+    }
+}
+#endif
+
+#ifdef ACCELERATED_ARRAYS_SIMD_NEON
+// the conversions use the FPCR rounding mode, round to nearest even by default
+void halfToFloatNeon(const std::uint16_t *in, float *out, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(in + i))));
+    halfToFloatScalar(in + i, out + i, n - i);
+}
+
+void floatToHalfNeon(const float *in, std::uint16_t *out, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) vst1_u16(out + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(in + i))));
+    floatToHalfScalar(in + i, out + i, n - i);
+}
+
+void channelwiseAffineNeon(const float *in, float *out, int n, double scale, double bias) {
+    const float64x2_t s = vdupq_n_f64(scale), b = vdupq_n_f64(bias);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float32x4_t v = vld1q_f32(in + i);
+        const float64x2_t lo = vcvt_f64_f32(vget_low_f32(v)), hi = vcvt_high_f64_f32(v);
+        const float32x2_t outLo = vcvt_f32_f64(vaddq_f64(vmulq_f64(s, lo), b));
+        vst1q_f32(out + i, vcvt_high_f32_f64(outLo, vaddq_f64(vmulq_f64(s, hi), b)));
+    }
+    channelwiseAffineScalar(in + i, out + i, n - i, scale, bias);
+}
+
+int swizzle8Neon(const std::uint8_t *in, std::uint8_t *out, int nPixels,
+    int inChannels, int outChannels, const int *chanList, const std::uint8_t *constants)
+{
+    std::uint8_t maskBytes[16], constantBytes[16];
+    // out-of-range indices give zero in vqtbl1q
+    const int block = buildSwizzleMask(inChannels, outChannels, chanList, constants, 0xff, maskBytes, constantBytes);
+    const uint8x16_t mask = vld1q_u8(maskBytes), constant = vld1q_u8(constantBytes);
+    int x = 0;
+    for (; canProcessSwizzleBlock(x, nPixels, inChannels, outChannels); x += block) {
+        const uint8x16_t v = vld1q_u8(in + x * inChannels);
+        vst1q_u8(out + x * outChannels, vorrq_u8(vqtbl1q_u8(v, mask), constant));
+    }
+    return x;
+}
+int yuvToRgb8Neon(const std::uint8_t *y, const std::uint8_t *uv, std::uint8_t *out, int width,
+    int outChannels, bool vuOrder, const YuvCoefficients &c)
+{
+    const int16x8_t yOffset = vdupq_n_s16(c.yOffset), chromaOffset = vdupq_n_s16(128);
+    const int32x4_t rounding = vdupq_n_s32(4096);
+    int x = 0;
+    // 8 pixels and 4 chroma samples per block
+    for (; x + 8 <= width; x += 8) {
+        const int16x8_t y16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + x))), yOffset);
+        const int16x8_t uv16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(uv + x))), chromaOffset);
+        const int16x8x2_t split = vuzpq_s16(uv16, uv16);
+        const int16x4_t first = vget_low_s16(split.val[0]), second = vget_low_s16(split.val[1]);
+        // each chroma sample is used for two pixels
+        const int16x4x2_t u = vuOrder ? vzip_s16(second, second) : vzip_s16(first, first);
+        const int16x4x2_t v = vuOrder ? vzip_s16(first, first) : vzip_s16(second, second);
+        const int32x4_t yLo = vmlal_n_s16(rounding, vget_low_s16(y16), std::int16_t(c.y));
+        const int32x4_t yHi = vmlal_n_s16(rounding, vget_high_s16(y16), std::int16_t(c.y));
+
+        const auto channel = [&u, &v, yLo, yHi](int cu, int cv) {
+            const int32x4_t lo = vmlal_n_s16(vmlal_n_s16(yLo, u.val[0], std::int16_t(cu)), v.val[0], std::int16_t(cv));
+            const int32x4_t hi = vmlal_n_s16(vmlal_n_s16(yHi, u.val[1], std::int16_t(cu)), v.val[1], std::int16_t(cv));
+            return vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 13)), vqmovn_s32(vshrq_n_s32(hi, 13))));
+        };
+        const uint8x8_t r = channel(0, c.rv), g = channel(c.gu, c.gv), b = channel(c.bu, 0);
+
+        if (outChannels == 4) {
+            uint8x8x4_t pixels;
+            pixels.val[0] = r;
+            pixels.val[1] = g;
+            pixels.val[2] = b;
+            pixels.val[3] = vdup_n_u8(0xff);
+            vst4_u8(out + x * 4, pixels);
+        } else {
+            uint8x8x3_t pixels;
+            pixels.val[0] = r;
+            pixels.val[1] = g;
+            pixels.val[2] = b;
+            vst3_u8(out + x * 3, pixels);
+        }
+    }
+    return x;
+}
+#endif
+}
+
+void channelwiseAffine(const float *in, float *out, int n, double scale, double bias) {
+#if defined(ACCELERATED_ARRAYS_SIMD_X86)
+    dispatch().channelwiseAffine(in, out, n, scale, bias);
+#elif defined(ACCELERATED_ARRAYS_SIMD_NEON)
+    channelwiseAffineNeon(in, out, n, scale, bias);
+#else
+    channelwiseAffineScalar(in, out, n, scale, bias);
+#endif
+}
+
+bool pixelwiseAffine(const float *in, float *out, int nPixels,
+    int inChannels, int outChannels, const float *mat, const float *bias)
+{
+#if defined(ACCELERATED_ARRAYS_SIMD_X86) || defined(ACCELERATED_ARRAYS_SIMD_NEON)
+    if (inChannels == 1 && outChannels == 1) {
+        pixelwiseAffine1(in, out, nPixels, mat[0], bias[0]);
+        return true;
+    }
+    #define X(m, n) if (inChannels == m && outChannels == n) { \
+        pixelwiseAffineVec<m, n>(in, out, nPixels, mat, bias); \
+        return true; }
+    X(1, 3) X(2, 3) X(3, 3) X(4, 3)
+    X(1, 4) X(2, 4) X(3, 4) X(4, 4)
+    #undef X
+#else
+    (void)in; (void)out; (void)nPixels; (void)inChannels; (void)outChannels; (void)mat; (void)bias;
+#endif
+    return false;
+}
+
+int swizzle8(const std::uint8_t *in, std::uint8_t *out, int nPixels,
+    int inChannels, int outChannels, const int *chanList, const std::uint8_t *constants)
+{
+#if defined(ACCELERATED_ARRAYS_SIMD_X86)
+    const auto f = dispatch().swizzle8;
+    if (f) return f(in, out, nPixels, inChannels, outChannels, chanList, constants);
+#elif defined(ACCELERATED_ARRAYS_SIMD_NEON)
+    return swizzle8Neon(in, out, nPixels, inChannels, outChannels, chanList, constants);
+#else
+    (void)in; (void)out; (void)nPixels; (void)inChannels; (void)outChannels; (void)chanList; (void)constants;
+#endif
+    return 0;
+}
+
+int yuvToRgb8(const std::uint8_t *y, const std::uint8_t *uv, std::uint8_t *out, int width,
+    int outChannels, bool vuOrder, const YuvCoefficients &coeffs)
+{
+    if (outChannels != 3 && outChannels != 4) return 0;
+#if defined(ACCELERATED_ARRAYS_SIMD_X86)
+    return yuvToRgb8Sse2(y, uv, out, width, outChannels, vuOrder, coeffs);
+#elif defined(ACCELERATED_ARRAYS_SIMD_NEON)
+    return yuvToRgb8Neon(y, uv, out, width, outChannels, vuOrder, coeffs);
+#else
+    (void)y; (void)uv; (void)out; (void)width; (void)vuOrder; (void)coeffs;
+    return 0;
+#endif
+}
+
+void halfToFloat(const std::uint16_t *in, float *out, int n) {
+#if defined(ACCELERATED_ARRAYS_SIMD_X86)
+    dispatch().halfToFloat(in, out, n);
+#elif defined(ACCELERATED_ARRAYS_SIMD_NEON)
+    halfToFloatNeon(in, out, n);
+#else
+    halfToFloatScalar(in, out, n);
+#endif
+}
+
+void floatToHalf(const float *in, std::uint16_t *out, int n) {
+#if defined(ACCELERATED_ARRAYS_SIMD_X86)
+    dispatch().floatToHalf(in, out, n);
+#elif defined(ACCELERATED_ARRAYS_SIMD_NEON)
+    floatToHalfNeon(in, out, n);
+#else
+    floatToHalfScalar(in, out, n);
+#endif
+}
+
+}
+}
+}
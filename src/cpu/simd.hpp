@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+// Vectorized row kernels for the CPU operations. The implementation is
+// selected at runtime based on the CPU features (x86) or at compile time
+// (NEON). All of these produce bit-identical results to the corresponding
+// scalar loops in operations.cpp.
+namespace accelerated {
+namespace cpu {
+namespace simd {
+
+/** out[i] = float(scale * double(in[i]) + bias) for i in [0, n) */
+void channelwiseAffine(const float *in, float *out, int n, double scale, double bias);
+
+/**
+ * out = bias + mat * in for each pixel, with the float operations done in
+ * the same order as the scalar version (no fused multiply-add). The matrix
+ * is stored row-major (outChannels x inChannels). Returns false if the
+ * channel combination is not supported, in which case nothing is written.
+ */
+bool pixelwiseAffine(const float *in, float *out, int nPixels,
+    int inChannels, int outChannels, const float *mat, const float *bias);
+
+/**
+ * Byte swizzle: out[c] = chanList[c] < 0 ? constants[c] : in[chanList[c]].
+ * Returns the number of pixels processed, which may be less than nPixels,
+ * the rest should be handled by the caller.
+ */
+int swizzle8(const std::uint8_t *in, std::uint8_t *out, int nPixels,
+    int inChannels, int outChannels, const int *chanList, const std::uint8_t *constants);
+
+/**
+ * YUV to RGB coefficients in Q13 fixed point. Each channel is computed as
+ * clamp((y * (Y - yOffset) + cu * (U - 128) + cv * (V - 128) + 4096) >> 13)
+ * with the chroma coefficients rv, gu, gv, bu (the others are zero)
+ */
+struct YuvCoefficients {
+    int yOffset, y, rv, gu, gv, bu;
+};
+
+/**
+ * Convert one row of semi-planar YUV 4:2:0 pixels to 3 or 4 channel bytes
+ * (alpha = 255). If vuOrder, the chroma plane is V, U, V, U, ... (NV21).
+ * Returns the number of pixels processed, the rest should be handled by
+ * the caller.
+ */
+int yuvToRgb8(const std::uint8_t *y, const std::uint8_t *uv, std::uint8_t *out, int width,
+    int outChannels, bool vuOrder, const YuvCoefficients &coeffs);
+
+/** IEEE half-precision values (Float16::value) to float */
+void halfToFloat(const std::uint16_t *in, float *out, int n);
+
+/** float to half precision, rounding to nearest even as Float16 */
+void floatToHalf(const float *in, std::uint16_t *out, int n);
+
+}
+}
+}
@@ -1,10 +1,19 @@
 #pragma once
 
+#include <cstdint>
 #include <limits>
 
-// NOTE: these are not fast but primarily for use test compatiblity with
-// the OpenGL versions, which often use these
+// NOTE: these are primarily for use test compatiblity with the OpenGL
+// versions, which often use these. The rounding rules are defined by the
+// double-precision conversions (toFloat & fromFloat). For the up to 16-bit
+// types, the arithmetic operators use integers and give fromFloat of the
+// exact result. The double-based versions, used for the 32-bit types, only
+// differ from them when the truncation in fromFloat hits an integer and the
+// double rounding errors decide the result. The 8-bit toFloat conversions
+// use lookup tables
 namespace accelerated {
+template <class T> struct FixedPointLookup;
+
 template <class T> struct FixedPoint {
     T value;
 
@@ -14,11 +23,14 @@ template <class T> struct FixedPoint {
     operator float() const { return toFloat(); }
 
     double toFloat() const {
-        const double c = value;
-        const double v = isSigned()
-            ? (2 * c + 1) / unsignedMax()
-            : c / max();
-        return clamp(v);
+        if (sizeof(T) == 1) return FixedPointLookup<T>::table.values[static_cast<std::uint8_t>(value)];
+        return valueToFloat(value);
+    }
+
+    static constexpr double valueToFloat(T value) {
+        return clamp(isSigned()
+            ? (2 * double(value) + 1) / unsignedMax()
+            : double(value) / max());
     }
 
     static T fromFloat(double value) {
@@ -41,31 +53,87 @@ template <class T> struct FixedPoint {
     inline static constexpr double floatMin() { return isSigned() ? -1.0 : 0.0; }
     inline static constexpr double floatMax() { return 1.0;  }
 
-    static double clamp(double d) {
-        if (d < floatMin()) return floatMin();
-        if (d > floatMax()) return floatMax();
-        return d;
+    static constexpr double clamp(double d) {
+        return d < floatMin() ? floatMin() : (d > floatMax() ? floatMax() : d);
     }
 
-    #define X(sym) inline FixedPoint<T> operator sym(const FixedPoint<T> &other) const \
-        { return FixedPoint<T>(toFloat() sym other.toFloat()); }
-    X(*)
-    X(-)
-    X(+)
-    X(/)
-    #undef X
+    inline FixedPoint<T> operator *(const FixedPoint<T> &other) const {
+        if (!isExactIntegerType()) return FixedPoint<T>(toFloat() * other.toFloat());
+        const std::int64_t a = value, b = other.value;
+        // no ties in either case since the numerators are odd, unsignedMax is odd
+        if (isSigned()) return fromValue(T(((2 * a + 1) * (2 * b + 1)) / (2 * std::int64_t(unsignedMax()))));
+        return fromValue(T((2 * a * b + std::int64_t(max())) / (2 * std::int64_t(max()))));
+    }
 
-    #define X(sym) inline FixedPoint<T> &operator sym(const FixedPoint<T> &other) \
-        { double v = toFloat(); v sym other.toFloat(); value = fromFloat(v); return *this; }
-    X(*=)
-    X(-=)
-    X(+=)
-    X(/=)
+    inline FixedPoint<T> operator +(const FixedPoint<T> &other) const {
+        if (!isExactIntegerType()) return FixedPoint<T>(toFloat() + other.toFloat());
+        const std::int64_t a = value, b = other.value;
+        // signed: U/2 * ((2a + 1) + (2b + 1)) / U = a + b + 1
+        return fromClamped(isSigned() ? a + b + 1 : a + b);
+    }
+
+    inline FixedPoint<T> operator -(const FixedPoint<T> &other) const {
+        if (!isExactIntegerType()) return FixedPoint<T>(toFloat() - other.toFloat());
+        return fromClamped(std::int64_t(value) - other.value);
+    }
+
+    inline FixedPoint<T> operator /(const FixedPoint<T> &other) const {
+        if (!isExactIntegerType()) return FixedPoint<T>(toFloat() / other.toFloat());
+        const std::int64_t a = value, b = other.value;
+        // integer division truncates towards zero like fromFloat
+        if (isSigned()) return fromClamped(std::int64_t(unsignedMax()) * (2 * a + 1) / (2 * (2 * b + 1)));
+        if (b == 0) return fromValue(a == 0 ? T(0) : T(max()));
+        return fromClamped((2 * std::int64_t(max()) * a + b) / (2 * b));
+    }
+
+    #define X(sym, op) inline FixedPoint<T> &operator sym(const FixedPoint<T> &other) \
+        { *this = *this op other; return *this; }
+    X(*=, *)
+    X(-=, -)
+    X(+=, +)
+    X(/=, /)
     #undef X
 
-    inline FixedPoint<T> operator -() const { return FixedPoint<T>(-toFloat()); }
+    inline FixedPoint<T> operator -() const {
+        if (!isExactIntegerType()) return FixedPoint<T>(-toFloat());
+        return fromClamped(isSigned() ? -(2 * std::int64_t(value) + 1) / 2 : 0);
+    }
 
     inline bool operator ==(const FixedPoint<T> &other) const { return value == other.value; }
     inline bool operator !=(const FixedPoint<T> &other) const { return value != other.value; }
+
+    static FixedPoint<T> fromValue(T value) {
+        FixedPoint<T> r;
+        r.value = value;
+        return r;
+    }
+
+private:
+    // 64-bit integers are enough for the products
+    inline static constexpr bool isExactIntegerType() { return sizeof(T) <= 2; }
+
+    // the raw values fromFloat can produce
+    static FixedPoint<T> fromClamped(std::int64_t v) {
+        const std::int64_t hi = std::int64_t(max()), lo = isSigned() ? -hi : 0;
+        return fromValue(T(v < lo ? lo : (v > hi ? hi : v)));
+    }
+};
+
+// toFloat lookup table for 8-bit types
+template <class T> struct FixedPointFloatTable {
+    double values[256];
+
+    constexpr FixedPointFloatTable() : values() {
+        for (int i = 0; i < 256; ++i) {
+            const int v = (FixedPoint<T>::isSigned() && i > 127) ? i - 256 : i;
+            values[i] = FixedPoint<T>::valueToFloat(T(v));
+        }
+    }
 };
+
+template <class T> struct FixedPointLookup {
+    static constexpr FixedPointFloatTable<T> table = FixedPointFloatTable<T>();
+};
+
+template <class T> constexpr FixedPointFloatTable<T> FixedPointLookup<T>::table;
 }
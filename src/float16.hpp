@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// IEEE 754 half-precision float, the CPU counterpart of FLOAT16 textures.
+// This is only a storage type: the arithmetic is done in float and the
+// result is rounded back to half precision (to nearest even), which is
+// what the bulk conversions in cpu/simd.hpp (F16C / NEON) do too. Values
+// beyond the range become infinite, also in the OpenGL half-float outputs
+namespace accelerated {
+struct Float16 {
+    std::uint16_t value;
+
+    Float16() : value(0) {}
+    Float16(double f) : value(fromFloat(float(f))) {}
+    operator double() const { return toFloat(value); }
+    operator float() const { return toFloat(value); }
+
+    static float toFloat(std::uint16_t h) {
+        const std::uint32_t sign = std::uint32_t(h & 0x8000) << 16;
+        std::uint32_t exponent = (h >> 10) & 0x1f, mantissa = h & 0x3ff;
+        std::uint32_t bits;
+        if (exponent == 0x1f) {
+            // inf or NaN (quiet)
+            bits = sign | 0x7f800000 | (mantissa << 13) | (mantissa != 0 ? 0x400000 : 0);
+        } else if (exponent == 0) {
+            if (mantissa == 0) {
+                bits = sign;
+            } else {
+                // subnormal: normalize
+                exponent = 127 - 14;
+                while (!(mantissa & 0x400)) {
+                    mantissa <<= 1;
+                    exponent--;
+                }
+                bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+            }
+        } else {
+            bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        }
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    static std::uint16_t fromFloat(float f) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        const std::uint16_t sign = (bits >> 16) & 0x8000;
+        const std::uint32_t abs = bits & 0x7fffffff;
+        if (abs > 0x7f800000) return sign | 0x7e00 | ((abs >> 13) & 0x3ff); // NaN
+        // 65520 and above round to infinity
+        if (abs >= 0x477ff000) return sign | 0x7c00;
+        if (abs >= 0x38800000) {
+            // normal: rebias the exponent and round the mantissa
+            std::uint32_t h = (abs - 0x38000000) >> 13;
+            const std::uint32_t rem = abs & 0x1fff;
+            if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) h++;
+            return sign | std::uint16_t(h);
+        }
+        // below 2^-25 rounds to zero (ties to even)
+        if (abs <= 0x33000000) return sign;
+        // subnormal: value in units of 2^-24
+        const std::uint32_t mantissa = (abs & 0x7fffff) | 0x800000;
+        const int shift = 126 - int(abs >> 23);
+        std::uint32_t h = mantissa >> shift;
+        const std::uint32_t rem = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (h & 1))) h++;
+        return sign | std::uint16_t(h);
+    }
+
+    inline float toFloat() const { return toFloat(value); }
+
+    #define X(sym) inline Float16 operator sym(const Float16 &other) const \
+        { return Float16(toFloat() sym other.toFloat()); }
+    X(*)
+    X(+)
+    X(-)
+    X(/)
+    #undef X
+
+    #define X(sym, op) inline Float16 &operator sym(const Float16 &other) \
+        { *this = *this op other; return *this; }
+    X(*=, *)
+    X(-=, -)
+    X(+=, +)
+    X(/=, /)
+    #undef X
+
+    inline Float16 operator -() const { return fromValue(value ^ 0x8000); }
+
+    // as floats: +0 == -0 and NaN != NaN
+    inline bool operator ==(const Float16 &other) const { return toFloat() == other.toFloat(); }
+    inline bool operator !=(const Float16 &other) const { return !(*this == other); }
+
+    static Float16 fromValue(std::uint16_t value) {
+        Float16 r;
+        r.value = value;
+        return r;
+    }
+};
+}
@@ -30,6 +30,17 @@ Function convert(const Binary &f) {
     };
 }
 
+MultiOutputFunction combineOutputs(const std::vector<Function> &functions) {
+    return [functions](Image** inputs, int nInputs, Image** outputs, int nOutputs) -> Future {
+        aa_assert(nOutputs == int(functions.size()));
+        std::vector<Future> futures;
+        for (int i = 0; i < nOutputs; ++i) {
+            futures.push_back(functions.at(i)(inputs, nInputs, *outputs[i]));
+        }
+        return Future::all(futures);
+    };
+}
+
 Future callNullary(const Function &f, Image &output) {
     std::array<Image*, 0> arr = {};
     return call(f, arr, output);
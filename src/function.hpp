@@ -16,6 +16,15 @@ typedef std::function< Future(Image &output) > Nullary;
 typedef std::function< Future(Image &input, Image &output) > Unary;
 typedef std::function< Future(Image &a, Image &b, Image &output) > Binary;
 
+/**
+ * Operation with several outputs that are computed together, e.g., in a
+ * single GPU pass with multiple render targets, or an image pyramid
+ */
+typedef std::function< Future(Image** inputs, int nInputs, Image** outputs, int nOutputs) > MultiOutputFunction;
+
+/** Fallback that computes each output with a separate Function */
+MultiOutputFunction combineOutputs(const std::vector<Function> &functions);
+
 Function convert(const Nullary &f);
 Function convert(const Unary &f);
 Function convert(const Binary &f);
@@ -28,11 +37,16 @@ template <std::size_t N> Future call(const Function &f, std::array<Image*, N> &i
     return f(reinterpret_cast<Image**>(&inputs), N, output);
 }
 
+template <std::size_t N, std::size_t M> Future call(const MultiOutputFunction &f, std::array<Image*, N> &inputs, std::array<Image*, M> &outputs) {
+    return f(reinterpret_cast<Image**>(&inputs), N, reinterpret_cast<Image**>(&outputs), M);
+}
+
 namespace sync {
 typedef std::function< void(Image **inputs, int nInputs, Image &output) > Function;
 typedef std::function< void(Image &output) > Nullary;
 typedef std::function< void(Image &input, Image &output) > Unary;
 typedef std::function< void(Image &a, Image &b, Image &output) > Binary;
+typedef std::function< void(Image **inputs, int nInputs, Image **outputs, int nOutputs) > MultiOutputFunction;
 
 template <class T, int N> Future wrapNAryBody(
     const std::function<void(T **inputs, int nInputs, T &output)> &syncFunc,
@@ -78,6 +92,21 @@ wrap(const std::function<void(T **inputs, int nInputs, T &output)> &syncFunc, Pr
     };
 }
 
+template <class T>
+::accelerated::operations::MultiOutputFunction
+wrapMultiOutput(const std::function<void(T **inputs, int nInputs, T **outputs, int nOutputs)> &syncFunc, Processor &p) {
+    return [syncFunc, &p](Image **inputs, int nInputs, Image **outputs, int nOutputs) -> Future {
+        std::vector<T*> args, outs;
+        for (int i = 0; i < nInputs; ++i) args.push_back(&T::castFrom(*inputs[i]));
+        for (int i = 0; i < nOutputs; ++i) outs.push_back(&T::castFrom(*outputs[i]));
+        return p.enqueue([syncFunc, args, outs]() {
+            syncFunc(
+                const_cast<T**>(reinterpret_cast<T* const*>(args.data())), args.size(),
+                const_cast<T**>(reinterpret_cast<T* const*>(outs.data())), outs.size());
+        });
+    };
+}
+
 template <class T>
 std::function<void(T **inputs, int nInputs, T &output)>
 convert(const std::function<void(T &output)> &syncFunc) {
@@ -1,5 +1,3 @@
-#include <future>
-
 #include "future.hpp"
 #include "assert.hpp"
 
@@ -7,38 +5,67 @@ namespace accelerated {
 namespace {
 struct InstantState : Future::State {
     void wait() final {};
+    bool waitFor(std::chrono::nanoseconds) final { return true; }
+    bool isReady() final { return true; }
+    void onReady(const std::function<void()> &callback) final { callback(); }
 };
 
-class StdWrapper : public Future::State {
-private:
-    std::promise<void> p;
-    std::future<void> f;
+struct AllFuturesState : Future::State {
+    std::vector<Future> futures;
 
-public:
-    StdWrapper() : f(p.get_future()) {}
+    AllFuturesState(const std::vector<Future> &futures) : futures(futures) {}
 
-    void resolve() {
-        p.set_value();
+    void wait() final {
+        for (auto &f : futures) f.wait();
     }
 
-    void wait() final {
-        f.wait();
+    bool waitFor(std::chrono::nanoseconds timeout) final {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        for (auto &f : futures) {
+            const auto now = std::chrono::steady_clock::now();
+            if (!f.waitFor(now < deadline ? deadline - now : std::chrono::nanoseconds(0))) return false;
+        }
+        return true;
+    }
+
+    bool isReady() final {
+        for (auto &f : futures) if (!f.isReady()) return false;
+        return true;
+    }
+
+    void onReady(const std::function<void()> &callback) final {
+        if (futures.empty()) {
+            callback();
+            return;
+        }
+        // the last one to resolve calls the callback
+        auto remaining = std::make_shared< std::atomic<int> >(futures.size());
+        for (auto &f : futures) {
+            f.state->onReady([remaining, callback]() {
+                if (--*remaining == 0) callback();
+            });
+        }
+    }
+
+    bool isFailed() final {
+        for (auto &f : futures) if (f.isFailed()) return true;
+        return false;
     }
 };
 
 class PromiseImplementation : public Promise {
 private:
-    std::shared_ptr<StdWrapper> wrapper;
+    std::shared_ptr<ResolvableState> state;
 
 public:
-    PromiseImplementation() : wrapper(new StdWrapper) {}
+    PromiseImplementation() : state(std::make_shared<ResolvableState>()) {}
 
     void resolve() final {
-        wrapper->resolve();
+        state->resolve();
     }
 
     Future getFuture() final {
-        return Future(wrapper);
+        return Future(state);
     }
 };
 }
@@ -51,14 +78,131 @@ std::unique_ptr<Promise> Promise::create() {
 Future::Future(std::shared_ptr<State> state) : state(state) {}
 
 Future::State::~State() = default;
+bool Future::State::waitFor(std::chrono::nanoseconds) {
+    wait();
+    return true;
+}
+
+bool Future::State::isReady() {
+    // blocks if waitFor is not overridden either, but never reports a
+    // resolved operation as pending
+    return waitFor(std::chrono::nanoseconds(0));
+}
+
+void Future::State::onReady(const std::function<void()> &callback) {
+    if (!isReady()) wait();
+    callback();
+}
+
+bool Future::State::isFailed() {
+    return false;
+}
+
+ResolvableState::ResolvableState() : ready(false), failed(false) {}
+
+void ResolvableState::resolve() {
+    std::vector< std::function<void()> > toCall;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        aa_assert(!ready.load(std::memory_order_relaxed) && "already resolved");
+        ready.store(true, std::memory_order_release);
+        toCall.swap(callbacks);
+    }
+    readyCondition.notify_all();
+    for (auto &callback : toCall) callback();
+}
+
+void ResolvableState::fail() {
+    failed.store(true, std::memory_order_relaxed);
+    resolve();
+}
+
+bool ResolvableState::isFailed() {
+    return failed.load(std::memory_order_relaxed);
+}
+
+void ResolvableState::wait() {
+    if (ready.load(std::memory_order_acquire)) return;
+    std::unique_lock<std::mutex> lock(mutex);
+    readyCondition.wait(lock, [this] { return ready.load(std::memory_order_relaxed); });
+}
+
+bool ResolvableState::waitFor(std::chrono::nanoseconds timeout) {
+    if (ready.load(std::memory_order_acquire)) return true;
+    std::unique_lock<std::mutex> lock(mutex);
+    return readyCondition.wait_for(lock, timeout, [this] { return ready.load(std::memory_order_relaxed); });
+}
+
+bool ResolvableState::isReady() {
+    return ready.load(std::memory_order_acquire);
+}
+
+void ResolvableState::onReady(const std::function<void()> &callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ready.load(std::memory_order_relaxed)) {
+            callbacks.push_back(callback);
+            return;
+        }
+    }
+    callback();
+}
+
 Future Future::instantlyResolved() {
     return Future(std::unique_ptr<Future::State>(new InstantState));
 }
 
+Future Future::whenAll(const std::vector<Future> &futures) {
+    return Future(std::make_shared<AllFuturesState>(futures));
+}
+
+Future Future::all(const std::vector<Future> &futures) {
+    return whenAll(futures);
+}
+
 void Future::wait() {
     aa_assert(state);
     return state->wait();
 }
 
+bool Future::waitFor(std::chrono::nanoseconds timeout) {
+    aa_assert(state);
+    return state->waitFor(timeout);
+}
+
+bool Future::isReady() {
+    aa_assert(state);
+    return state->isReady();
+}
+
+bool Future::isFailed() {
+    aa_assert(state);
+    return state->isReady() && state->isFailed();
+}
+
+Future Future::then(const std::function<void()> &callback) {
+    aa_assert(state);
+    auto next = std::make_shared<ResolvableState>();
+    auto source = state;
+    state->onReady([source, callback, next]() {
+        if (source->isFailed()) {
+            next->fail();
+            return;
+        }
+        callback();
+        next->resolve();
+    });
+    return Future(next);
+}
+
 Processor::~Processor() = default;
+
+Future Processor::enqueueCoalescing(int key, const std::function<void()> &op) {
+    (void)key;
+    return enqueue(op);
+}
+
+QueueStats Processor::getQueueStats() {
+    return {};
+}
 }
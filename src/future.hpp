@@ -1,7 +1,12 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <functional>
+#include <vector>
 
 namespace accelerated {
 
@@ -12,6 +17,30 @@ struct Future {
     struct State {
         virtual ~State();
         virtual void wait() = 0;
+        /**
+         * Wait at most the given time. Returns true if the operation is
+         * ready. The default implementation blocks using wait()
+         */
+        virtual bool waitFor(std::chrono::nanoseconds timeout);
+        /**
+         * Check if the operation is ready. The default calls waitFor with
+         * zero timeout, which blocks using wait() unless waitFor is also
+         * overridden. Override this (or waitFor) for a non-blocking check,
+         * which Future::isReady, whenAll and the TaskGraph rely on
+         */
+        virtual bool isReady();
+        /**
+         * Call the callback once the operation is ready, in the thread that
+         * completes it, or immediately if it is already ready. The default
+         * implementation blocks using wait() if not ready
+         */
+        virtual void onReady(const std::function<void()> &callback);
+        /**
+         * True if the operation was resolved without being executed, e.g.,
+         * rejected or dropped by a bounded queue. Only meaningful when
+         * ready. The default is false
+         */
+        virtual bool isFailed();
     };
 
     std::shared_ptr<State> state;
@@ -19,8 +48,57 @@ struct Future {
 
     /** Block & wait until the operation is ready */
     void wait();
+    /** Wait at most the given time, returns true if ready */
+    bool waitFor(std::chrono::nanoseconds timeout);
+    /**
+     * Check if the operation is ready without blocking (if the State
+     * overrides isReady or waitFor, as all the library's states do)
+     */
+    bool isReady();
+    /**
+     * Non-blocking check: ready but the operation was never executed,
+     * e.g., because a bounded queue rejected or dropped it (QueueOptions)
+     */
+    bool isFailed();
+    /**
+     * Call the callback when this operation is ready, without blocking
+     * (see State::onReady). The returned Future resolves after the callback.
+     * If this Future fails, the callback is not called and the returned
+     * Future fails too
+     */
+    Future then(const std::function<void()> &callback);
 
     static Future instantlyResolved();
+    /** Resolved when all the given futures are resolved. Fails if any fails */
+    static Future whenAll(const std::vector<Future> &futures);
+    /** Same as whenAll */
+    static Future all(const std::vector<Future> &futures);
+};
+
+/**
+ * Lightweight state for Futures that are resolved manually: no std::promise
+ * and no allocations beyond the state itself (and registered callbacks).
+ * Can be used as a base class to store the operation in the same object
+ */
+class ResolvableState : public Future::State {
+private:
+    std::atomic<bool> ready, failed;
+    std::mutex mutex;
+    std::condition_variable readyCondition;
+    std::vector< std::function<void()> > callbacks;
+
+public:
+    ResolvableState();
+    /** Mark as ready, wake the waiting threads and run the callbacks */
+    void resolve();
+    /** Resolve as failed, see Future::isFailed */
+    void fail();
+
+    void wait() override;
+    bool waitFor(std::chrono::nanoseconds timeout) override;
+    bool isReady() override;
+    void onReady(const std::function<void()> &callback) override;
+    bool isFailed() override;
 };
 
 // Packages std::future & std::promise to avoid non-trivial lifetime issues
@@ -32,14 +110,83 @@ struct Promise {
     virtual Future getFuture() = 0;
 };
 
+/**
+ * Bounds the number of pending tasks in Processor::createQueue and
+ * createThreadPool, so that latency and memory do not grow without limit if
+ * the processing thread falls behind
+ */
+struct QueueOptions {
+    /** Maximum number of pending (not yet started) tasks, 0 = unbounded */
+    std::size_t capacity = 0;
+
+    /** What to do if a task is enqueued to a full queue */
+    enum class FullPolicy {
+        /**
+         * Wait until there is room. Must not be used if the tasks are
+         * enqueued from the thread that processes them (deadlock)
+         */
+        BLOCK,
+        /** Do not enqueue the new task, its Future fails (isFailed) */
+        REJECT,
+        /**
+         * Drop the oldest pending task with the same coalescing key as the
+         * new one (see Processor::enqueueCoalescing) so that the newest
+         * wins, e.g., the latest camera frame. The Future of the dropped
+         * task fails. Falls back to BLOCK if there is no such task
+         */
+        DROP_OLDEST
+    } fullPolicy = FullPolicy::BLOCK;
+};
+
+/**
+ * The tasks enqueued by this thread while the object exists are always
+ * admitted to bounded queues, regardless of the capacity and fullPolicy.
+ * Used for internal tasks that must not fail or block, e.g., the cleanup
+ * of GL resources in destructors and the GPU fence polls
+ */
+class ScopedUnboundedEnqueue {
+private:
+    const bool previous;
+public:
+    ScopedUnboundedEnqueue();
+    ~ScopedUnboundedEnqueue();
+};
+
+struct QueueStats {
+    /** Number of currently pending tasks */
+    std::size_t depth = 0;
+    std::size_t maxDepth = 0;
+    /** Totals, including rejected and dropped tasks */
+    std::size_t enqueued = 0;
+    std::size_t rejected = 0;
+    std::size_t dropped = 0;
+};
+
 struct Queue;
 struct Processor {
     virtual ~Processor();
     virtual Future enqueue(const std::function<void()> &op) = 0;
+    /**
+     * Enqueue a task that may be dropped in favor of a newer task with the
+     * same key, see QueueOptions::FullPolicy::DROP_OLDEST. Same as enqueue
+     * in processors without such a policy
+     */
+    virtual Future enqueueCoalescing(int key, const std::function<void()> &op);
+    /** Queue depth metrics. All zeros if not supported by the processor */
+    virtual QueueStats getQueueStats();
 
     static std::unique_ptr<Processor> createInstant();
     static std::unique_ptr<Processor> createThreadPool(int nThreads);
+    static std::unique_ptr<Processor> createThreadPool(int nThreads, const QueueOptions &options);
+    /**
+     * Thread pool with a work-stealing deque per worker: tasks enqueued
+     * from a worker thread go to its own deque, and idle workers steal
+     * from the others. Scales better with many small tasks, but there
+     * is no ordering guarantee, even with one thread
+     */
+    static std::unique_ptr<Processor> createWorkStealingPool(int nThreads);
     static std::unique_ptr<Queue> createQueue();
+    static std::unique_ptr<Queue> createQueue(const QueueOptions &options);
 };
 
 struct Queue : Processor {
@@ -12,6 +12,14 @@ std::unique_ptr<Image> Image::Factory::createLike(const Image &image) {
     return create(image.width, image.height, image.channels, image.dataType);
 }
 
+YuvImage Image::Factory::createYuv(int w, int h, YuvLayout layout) {
+    YuvImage yuv;
+    yuv.layout = layout;
+    yuv.y = create(w, h, 1, DataType::UFIXED8);
+    yuv.uv = create(YuvImage::getChromaSize(w), YuvImage::getChromaSize(h), 2, DataType::UFIXED8);
+    return yuv;
+}
+
 #define Y(dtype, name, n) \
     template <> std::unique_ptr<Image> Image::Factory::create<dtype, n>(int w, int h) \
     { return create(w, h, n, name); } \
@@ -56,6 +64,7 @@ bool ImageTypeSpec::isIntegerType(DataType dtype) {
         case DataType::SFIXED16: return false;
         case DataType::UFIXED32: return false;
         case DataType::SFIXED32: return false;
+        case DataType::FLOAT16: return false;
 
         default: aa_assert(false);
     }
@@ -65,6 +74,7 @@ bool ImageTypeSpec::isIntegerType(DataType dtype) {
 bool ImageTypeSpec::isSigned(DataType dtype) {
     switch (dtype) {
         case DataType::FLOAT32: return true;
+        case DataType::FLOAT16: return true;
 
         case DataType::UINT8: return false;
         case DataType::SINT8: return true;
@@ -92,6 +102,7 @@ bool ImageTypeSpec::isFixedPoint(DataType dtype) {
         case DataType::UINT32: return false;
         case DataType::SINT32: return false;
         case DataType::FLOAT32: return false;
+        case DataType::FLOAT16: return false;
 
         case DataType::UFIXED8: return true;
         case DataType::SFIXED8: return true;
@@ -105,7 +116,7 @@ bool ImageTypeSpec::isFixedPoint(DataType dtype) {
 }
 
 bool ImageTypeSpec::isFloat(DataType dtype) {
-    return dtype == DataType::FLOAT32;
+    return dtype == DataType::FLOAT32 || dtype == DataType::FLOAT16;
 }
 
 }
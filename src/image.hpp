@@ -6,9 +6,11 @@
 
 #include "future.hpp"
 #include "fixed_point.hpp"
+#include "float16.hpp"
 #include "assert.hpp"
 
 namespace accelerated {
+struct YuvImage;
 struct ImageTypeSpec {
     /**
      * Number of "channels" per pixel. Possible values range from 1 to 4.
@@ -32,7 +34,8 @@ struct ImageTypeSpec {
         UFIXED16,
         SFIXED16,
         UFIXED32,
-        SFIXED32
+        SFIXED32,
+        FLOAT16 // half precision, see Float16
     } dataType;
 
     /**
@@ -105,7 +108,14 @@ struct Image : ImageTypeSpec {
     enum class Interpolation {
         UNDEFINED, // whatever is currently set / don't care
         NEAREST,
-        LINEAR
+        LINEAR,
+        AREA // pixel area averaging, used for downscaling in rescale (CPU and OpenGL)
+    };
+
+    // chroma order in semi-planar YUV 4:2:0 images, see YuvImage
+    enum class YuvLayout {
+        NV12, // U, V (e.g., iOS, video decoders)
+        NV21 // V, U (Android camera default)
     };
 
     class Factory {
@@ -119,6 +129,8 @@ struct Image : ImageTypeSpec {
          * factory.
          */
         std::unique_ptr<Image> createLike(const Image &image);
+        /** Create the planes of a new semi-planar YUV 4:2:0 image */
+        YuvImage createYuv(int w, int h, YuvLayout layout);
         virtual std::unique_ptr<Image> create(int w, int h, int channels, DataType dtype) = 0;
         virtual ImageTypeSpec getSpec(int channels, DataType dtype) = 0;
     };
@@ -130,6 +142,14 @@ struct Image : ImageTypeSpec {
     /** Asyncronous write operation */
     virtual Future writeRaw(const std::uint8_t *inputData) = 0;
 
+    /**
+     * Read to / write from a buffer whose rows are rowPitch bytes apart
+     * (at least width * bytesPerPixel()), e.g., a padded or ROI cv::Mat.
+     * The padding between the rows is not accessed.
+     */
+    virtual Future readRaw(std::uint8_t *outputData, std::size_t rowPitch) = 0;
+    virtual Future writeRaw(const std::uint8_t *inputData, std::size_t rowPitch) = 0;
+
     /**
      * Create a Region-of-Interest, a reference to a region in this image.
      * All image operations may currently not be supported for ROIs in all
@@ -148,6 +168,16 @@ struct Image : ImageTypeSpec {
         return writeRaw(reinterpret_cast<const std::uint8_t*>(inputData));
     }
 
+    template <class T> Future read(T *outputData, std::size_t rowPitch) {
+        aa_assert(isType<T>());
+        return readRaw(reinterpret_cast<std::uint8_t*>(outputData), rowPitch);
+    }
+
+    template <class T> Future write(const T *inputData, std::size_t rowPitch) {
+        aa_assert(isType<T>());
+        return writeRaw(reinterpret_cast<const std::uint8_t*>(inputData), rowPitch);
+    }
+
     template <class T> inline Future read(std::vector<T> &output) {
         output.resize(numberOfScalars());
         return read<T>(output.data());
@@ -167,6 +197,23 @@ struct Image : ImageTypeSpec {
     }
 };
 
+/**
+ * Semi-planar YUV 4:2:0 image, e.g., a camera frame, represented as two
+ * ordinary images: a full-resolution single-channel Y plane and an
+ * interleaved two-channel chroma plane of size ceil(w/2) x ceil(h/2), both
+ * of type FixedPoint<std::uint8_t>. Convert to RGB with
+ * operations::yuvToRgb.
+ */
+struct YuvImage {
+    Image::YuvLayout layout;
+    std::unique_ptr<Image> y, uv;
+
+    inline int width() const { return y->width; }
+    inline int height() const { return y->height; }
+
+    static int getChromaSize(int lumaSize) { return (lumaSize + 1) / 2; }
+};
+
 #define ACCELERATED_IMAGE_FOR_EACH_NON_FLOAT_TYPE(x) \
     x(std::uint8_t) \
     x(std::int8_t) \
@@ -183,7 +230,8 @@ struct Image : ImageTypeSpec {
 
 #define ACCELERATED_IMAGE_FOR_EACH_TYPE(x) \
     ACCELERATED_IMAGE_FOR_EACH_NON_FLOAT_TYPE(x) \
-    x(float)
+    x(float) \
+    x(Float16)
 
 #define ACCELERATED_IMAGE_FOR_EACH_TYPE_WITH_EXTRAS(x, extra) \
     x(std::uint8_t, extra) \
@@ -198,7 +246,8 @@ struct Image : ImageTypeSpec {
     x(FixedPoint<std::uint16_t>, extra) \
     x(FixedPoint<std::int16_t>, extra) \
     x(FixedPoint<std::uint32_t>, extra) \
-    x(FixedPoint<std::int32_t>, extra)
+    x(FixedPoint<std::int32_t>, extra) \
+    x(Float16, extra)
 
 // quite heavy, use sparingly
 #define ACCELERATED_IMAGE_FOR_EACH_TYPE_PAIR(x) \
@@ -214,7 +263,8 @@ struct Image : ImageTypeSpec {
     ACCELERATED_IMAGE_FOR_EACH_TYPE_WITH_EXTRAS(x, FixedPoint<std::uint16_t>) \
     ACCELERATED_IMAGE_FOR_EACH_TYPE_WITH_EXTRAS(x, FixedPoint<std::int16_t>) \
     ACCELERATED_IMAGE_FOR_EACH_TYPE_WITH_EXTRAS(x, FixedPoint<std::uint32_t>) \
-    ACCELERATED_IMAGE_FOR_EACH_TYPE_WITH_EXTRAS(x, FixedPoint<std::int32_t>)
+    ACCELERATED_IMAGE_FOR_EACH_TYPE_WITH_EXTRAS(x, FixedPoint<std::int32_t>) \
+    ACCELERATED_IMAGE_FOR_EACH_TYPE_WITH_EXTRAS(x, Float16)
 
 #define ACCELERATED_IMAGE_FOR_EACH_NON_FLOAT_NAMED_TYPE(x) \
     x(std::uint8_t, ImageTypeSpec::DataType::UINT8) \
@@ -232,7 +282,8 @@ struct Image : ImageTypeSpec {
 
 #define ACCELERATED_IMAGE_FOR_EACH_NAMED_TYPE(x) \
     ACCELERATED_IMAGE_FOR_EACH_NON_FLOAT_NAMED_TYPE(x) \
-    x(float, ImageTypeSpec::DataType::FLOAT32)
+    x(float, ImageTypeSpec::DataType::FLOAT32) \
+    x(Float16, ImageTypeSpec::DataType::FLOAT16)
 
 #define Y(dtype, n) \
     template <> std::unique_ptr<Image> Image::Factory::create<dtype, n>(int w, int h); \
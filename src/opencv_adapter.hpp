@@ -45,13 +45,12 @@ struct opencv {
             spec.dataType).release()));
     }
 
+    // ROIs and other padded matrices are copied with their row pitch, in place
     static Future copy(const cv::Mat &from, Image &to) {
-        // TODO: copy using OpenCV to support ROIs
         return ref(from, ImageTypeSpec::isFixedPoint(to.dataType))->copyTo(to);
     }
 
     static Future copy(Image &from, cv::Mat &to) {
-        // TODO: copy using OpenCV to support ROIs
         if (to.empty()) to = emptyLike(from);
         return ref(to, ImageTypeSpec::isFixedPoint(from.dataType))->copyFrom(from);
     }
@@ -82,6 +81,9 @@ struct opencv {
             case DataType::SFIXED16: return CV_16S;
             case DataType::UFIXED32: aa_assert(false && "UINT32 (fixed-point) type is not supported by OpenCV"); return 0;
             case DataType::SFIXED32: return CV_32S;
+        #ifdef CV_16F
+            case DataType::FLOAT16: return CV_16F; // OpenCV 4
+        #endif
             default: aa_assert(false);
         }
         return 0;
@@ -108,6 +110,10 @@ struct opencv {
                 else return DataType::SINT32;
             case CV_32F:
                 return DataType::FLOAT32;
+        #ifdef CV_16F
+            case CV_16F:
+                return DataType::FLOAT16;
+        #endif
             default:
                 aa_assert(false && "unsupported OpenCV data type");
                 break;
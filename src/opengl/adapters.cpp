@@ -1,16 +1,58 @@
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <tuple>
 
 #include "adapters.hpp"
 #include "../image.hpp"
 #include "../log.hpp"
 
+#ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+#include <EGL/egl.h>
+#endif
+
+// compute shaders need OpenGL 4.3 / ES 3.1 headers (opt-in, see CMakeLists.txt),
+// while Mac only has OpenGL 4.1
+#if defined(ACCELERATED_ARRAYS_COMPUTE_SHADERS) && defined(__APPLE__)
+#error "compute shaders are not supported on macOS"
+#endif
+
 #define _THING_AS_STRING(x) #x
 #define _CHECK_ERROR_MARKER(line) __FILE__ ":" _THING_AS_STRING(line)
-#define CHECK_ERROR(func) checkError(_CHECK_ERROR_MARKER(__LINE__), func)
+#define CHECK_ERROR(func) do { \
+        if (!errorChecksPerOperation) checkError(_CHECK_ERROR_MARKER(__LINE__), func); \
+    } while (0)
 
 namespace accelerated {
 namespace opengl {
+namespace {
+std::atomic<bool> errorChecksPerOperation { false };
+std::atomic<bool> stateCachingEnabled { false };
+std::atomic<int> stateCacheGeneration { 0 };
+// incremented before each texture deletion in any context: the IDs are
+// shared (and may be reused) between the contexts of a share group
+std::atomic<unsigned> textureDeletions { 0 };
+
+thread_local const char threadContextKey = 0;
+thread_local const void *explicitContext = nullptr;
+
+// The key of the current GL context: set explicitly (e.g., by the GLFW
+// processors), the native EGL context in OpenGL ES builds, or one per thread
+const void *currentContext() {
+    if (explicitContext != nullptr) return explicitContext;
+#ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+    const EGLContext context = eglGetCurrentContext();
+    if (context != EGL_NO_CONTEXT) return context;
+#endif
+    return &threadContextKey;
+}
+}
+
 static void checkError(const char *tag, const char *tag2) {
     GLint error;
     bool any = false;
@@ -28,18 +70,164 @@ static void checkError(const char *tag, const char *tag2) {
 }
 
 void checkError(const char *tag) { checkError(tag, nullptr); }
+void checkOperationErrors(const char *tag) {
+    if (errorChecksPerOperation) checkError(tag, nullptr);
+}
 
 // could be exposed in the hpp file but not used currently elsewhere
 struct Texture : Destroyable, Binder::Target {
     static std::unique_ptr<Texture> create(int w, int h, const ImageTypeSpec &spec);
     virtual int getId() const = 0;
+    /** Allocated with glTexStorage2D, required for image load/store in OpenGL ES */
+    virtual bool hasImmutableStorage() const = 0;
 };
 
 namespace {
 
+/**
+ * Shadow copy of the GL state set through this class in the current
+ * thread and context. All binds etc. in this file go through it so that,
+ * if state caching is enabled, redundant calls and state queries can be
+ * skipped and unbinding (restoring the state) becomes a no-op.
+ */
+class StateCache {
+private:
+    static constexpr GLint UNKNOWN = -1;
+    const void *context = nullptr;
+    int generation = -1;
+    unsigned textureDeletionsSeen = 0;
+    GLint program, frameBuffer, vertexArray, activeTexture;
+    // (texture unit, target) -> texture
+    std::map<std::pair<GLint, GLenum>, GLint> textures;
+    // (texture, parameter) -> value
+    std::map<std::pair<GLuint, GLenum>, GLint> textureParameters;
+    std::map<GLenum, GLint> flags, pixelStore;
+
+    void reset() {
+        program = frameBuffer = vertexArray = activeTexture = UNKNOWN;
+        textures.clear();
+        textureParameters.clear();
+        textureDeletionsSeen = textureDeletions;
+        flags.clear();
+        pixelStore.clear();
+    }
+
+    static bool set(GLint &cached, GLint value) {
+        if (stateCachingEnabled && cached == value) return false;
+        cached = value;
+        return true;
+    }
+
+    template <class K> static bool set(std::map<K, GLint> &cache, const K &key, GLint value) {
+        auto it = cache.find(key);
+        if (it == cache.end()) {
+            cache[key] = value;
+            return true;
+        }
+        return set(it->second, value);
+    }
+
+public:
+    static StateCache &current() {
+        thread_local StateCache cache;
+        const int gen = stateCacheGeneration;
+        const void *context = currentContext();
+        if (cache.context != context || cache.generation != gen) {
+            cache.reset();
+            cache.context = context;
+            cache.generation = gen;
+        }
+        return cache;
+    }
+
+    static bool enabled() { return stateCachingEnabled; }
+
+    void useProgram(GLuint id) {
+        if (set(program, id)) glUseProgram(id);
+    }
+
+    void bindFrameBuffer(GLuint id) {
+        if (set(frameBuffer, id)) glBindFramebuffer(GL_FRAMEBUFFER, id);
+    }
+
+    void bindVertexArray(GLuint id) {
+        if (set(vertexArray, id)) glBindVertexArray(id);
+    }
+
+    void setActiveTexture(unsigned slot) {
+        if (set(activeTexture, slot)) glActiveTexture(GL_TEXTURE0 + slot);
+    }
+
+    // to the active texture unit
+    void bindTexture(GLenum target, GLuint id) {
+        if (activeTexture == UNKNOWN) {
+            glBindTexture(target, id);
+            return;
+        }
+        if (set(textures, std::make_pair(activeTexture, target), id)) glBindTexture(target, id);
+    }
+
+    // the texture must be bound to the target
+    void setTextureParameter(GLenum target, GLuint texture, GLenum name, GLint value) {
+        const unsigned deletions = textureDeletions;
+        if (deletions != textureDeletionsSeen) {
+            textureParameters.clear();
+            textureDeletionsSeen = deletions;
+        }
+        if (set(textureParameters, std::make_pair(texture, name), value)) glTexParameteri(target, name, value);
+    }
+
+    GLint getPixelStore(GLenum name) {
+        auto it = pixelStore.find(name);
+        if (it != pixelStore.end() && enabled()) return it->second;
+        GLint value;
+        glGetIntegerv(name, &value);
+        pixelStore[name] = value;
+        return value;
+    }
+
+    void setPixelStore(GLenum name, GLint value) {
+        if (set(pixelStore, name, value)) glPixelStorei(name, value);
+    }
+
+    bool isEnabled(GLenum flag) {
+        auto it = flags.find(flag);
+        if (it != flags.end() && enabled()) return it->second;
+        const bool value = glIsEnabled(flag);
+        flags[flag] = value;
+        return value;
+    }
+
+    void setFlag(GLenum flag, bool value) {
+        if (set(flags, flag, value)) {
+            if (value) glEnable(flag);
+            else glDisable(flag);
+        }
+    }
+
+    // deleted objects are unbound and their IDs may be reused. The texture
+    // parameters are forgotten through textureDeletions
+    void forgetTexture(GLuint id) {
+        for (auto &it : textures) if (it.second == GLint(id)) it.second = 0;
+    }
+
+    void forgetFrameBuffer(GLuint id) {
+        if (frameBuffer == GLint(id)) frameBuffer = 0;
+    }
+
+    void forgetProgram(GLuint id) {
+        // a deleted program remains in use until another is used
+        if (program == GLint(id)) program = UNKNOWN;
+    }
+
+    void forgetVertexArray(GLuint id) {
+        if (vertexArray == GLint(id)) vertexArray = 0;
+    }
+};
+
 /**
  * Ensures an OpenGL flag is in the given state and returns it to its
- * original state afterwards
+ * original state afterwards (unless state caching is enabled)
  */
 template <GLuint flag, bool targetState> class GlFlagSetter {
 private:
@@ -53,27 +241,114 @@ private:
     }
 
 public:
-    GlFlagSetter() : origState(glIsEnabled(flag)) {
-        if (origState != targetState) {
+    GlFlagSetter() : origState(StateCache::enabled() ? targetState : StateCache::current().isEnabled(flag)) {
+        if (StateCache::enabled() || origState != targetState) {
             logChange(targetState);
-            if (targetState) glEnable(flag);
-            else glDisable(flag);
+            StateCache::current().setFlag(flag, targetState);
         }
     }
 
     ~GlFlagSetter() {
         if (origState != targetState) {
             logChange(origState);
-            if (origState) glEnable(flag);
-            else glDisable(flag);
+            StateCache::current().setFlag(flag, origState);
         }
     }
 };
 
+/**
+ * GL_PACK_ROW_LENGTH (in pixels) and GL_PACK_ALIGNMENT (or the UNPACK
+ * equivalents) that give rows of exactly rowPitch bytes. Returns false if
+ * there is no such combination, e.g., an odd pitch with 2-byte pixels
+ */
+bool getRowLayout(std::size_t rowPitch, std::size_t bytesPerPixel, GLint &rowLength, GLint &alignment) {
+    rowLength = GLint(rowPitch / bytesPerPixel);
+    for (alignment = 1; alignment <= 8; alignment *= 2) {
+        const std::size_t alignedRow = (rowLength * bytesPerPixel + alignment - 1) / alignment * alignment;
+        if (alignedRow == rowPitch) return true;
+    }
+    return false;
+}
+
+void copyRows(const std::uint8_t *in, std::size_t inPitch, std::uint8_t *out, std::size_t outPitch, std::size_t rowBytes, int nRows) {
+    if (inPitch == rowBytes && outPitch == rowBytes) {
+        std::memcpy(out, in, rowBytes * nRows);
+        return;
+    }
+    for (int i = 0; i < nRows; ++i) std::memcpy(out + i * outPitch, in + i * inPitch, rowBytes);
+}
+
+/**
+ * Sets the pixel pack or unpack row length and alignment and returns them
+ * to their original state afterwards (unless state caching is enabled)
+ */
+class RowLayoutSetter {
+private:
+    const GLenum rowLengthName, alignmentName;
+    const GLint origRowLength, origAlignment;
+
+public:
+    RowLayoutSetter(bool pack, GLint rowLength, GLint alignment) :
+        rowLengthName(pack ? GL_PACK_ROW_LENGTH : GL_UNPACK_ROW_LENGTH),
+        alignmentName(pack ? GL_PACK_ALIGNMENT : GL_UNPACK_ALIGNMENT),
+        origRowLength(StateCache::current().getPixelStore(rowLengthName)),
+        origAlignment(StateCache::current().getPixelStore(alignmentName))
+    {
+        aa_assert(origAlignment >= 1 && origAlignment <= 8);
+        StateCache::current().setPixelStore(rowLengthName, rowLength);
+        StateCache::current().setPixelStore(alignmentName, alignment);
+    }
+
+    ~RowLayoutSetter() {
+        if (StateCache::enabled()) return;
+        StateCache::current().setPixelStore(rowLengthName, origRowLength);
+        StateCache::current().setPixelStore(alignmentName, origAlignment);
+    }
+};
+
+bool hasExtension(const char *name) {
+    GLint n = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for (GLint i = 0; i < n; ++i) {
+        const GLubyte *ext = glGetStringi(GL_EXTENSIONS, i);
+        if (ext && std::strcmp(reinterpret_cast<const char*>(ext), name) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * glTexStorage2D requires OpenGL 4.2 (or ARB_texture_storage) or OpenGL ES
+ * 3.0. Not available in OpenGL 4.1 (the latest on Mac). Checked once per
+ * thread and context
+ */
+bool textureStorageSupported() {
+#ifdef __APPLE__
+    return false;
+#else
+    thread_local const void *checkedContext = nullptr;
+    thread_local bool supported = false;
+    if (checkedContext == currentContext()) return supported;
+    checkedContext = currentContext();
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    CHECK_ERROR(__FUNCTION__);
+    #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+    supported = major >= 3;
+    #else
+    supported = major > 4 || (major == 4 && minor >= 2) || hasExtension("GL_ARB_texture_storage");
+    #endif
+    if (!supported) log_warn("glTexStorage2D not supported, using glTexImage2D");
+    return supported;
+#endif
+}
+
 class TextureImplementation : public Texture {
 private:
     const GLuint bindType;
     GLuint id;
+    bool immutable = false;
 
 public:
     TextureImplementation(int width, int height, const ImageTypeSpec &spec)
@@ -84,18 +359,46 @@ public:
         // glActiveTexture(GL_TEXTURE0); // TODO: required?
 
         Binder binder(*this);
-        glTexImage2D(bindType, 0,
-            getTextureInternalFormat(spec),
-            width, height, 0,
-            getCpuFormat(spec),
-            getCpuType(spec), nullptr);
+        // immutable storage is allocated only once, if supported
+        if (textureStorageSupported()) {
+        #ifndef __APPLE__
+            glTexStorage2D(bindType, 1, getTextureInternalFormat(spec), width, height);
+            immutable = true;
+        #endif
+        } else {
+            glTexImage2D(bindType, 0,
+                getTextureInternalFormat(spec),
+                width, height, 0,
+                getCpuFormat(spec),
+                getCpuType(spec), nullptr);
+        }
+        setDefaultParameters();
+    }
+
+#ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+    // the storage (and the format) is defined by the EGLImage
+    TextureImplementation(void *eglImage, const ImageTypeSpec &spec)
+    : bindType(getBindType(spec)), id(0) {
+        aa_assert(bindType == GL_TEXTURE_2D);
+        static const auto imageTargetTexture = reinterpret_cast<PFNGLEGLIMAGETARGETTEXTURE2DOESPROC>(
+            eglGetProcAddress("glEGLImageTargetTexture2DOES"));
+        aa_assert(imageTargetTexture && "GL_OES_EGL_image not supported");
+
+        glGenTextures(1, &id);
+        LOG_TRACE("created texture %d from EGLImage %p", id, eglImage);
+        Binder binder(*this);
+        imageTargetTexture(GL_TEXTURE_2D, static_cast<GLeglImageOES>(eglImage));
+        setDefaultParameters();
+    }
+#endif
 
-        // set default texture parameters
-        glTexParameteri(bindType, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(bindType, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    void setDefaultParameters() {
+        auto &state = StateCache::current();
+        state.setTextureParameter(bindType, id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        state.setTextureParameter(bindType, id, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-        glTexParameteri(bindType, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(bindType, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        state.setTextureParameter(bindType, id, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        state.setTextureParameter(bindType, id, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
         CHECK_ERROR(__FUNCTION__);
     }
@@ -103,7 +406,9 @@ public:
     void destroy() final {
         if (id != 0) {
             LOG_TRACE("deleting texture %d", id);
+            textureDeletions++;
             glDeleteTextures(1, &id);
+            StateCache::current().forgetTexture(id);
         }
         id = 0;
     }
@@ -115,7 +420,7 @@ public:
     }
 
     void bind() final {
-        glBindTexture(bindType, id);
+        StateCache::current().bindTexture(bindType, id);
         LOG_TRACE("bound texture %d", id);
         CHECK_ERROR(__FUNCTION__);
     }
@@ -130,12 +435,14 @@ public:
         // optimally in the middle of any other OpenGL processing. Usually
         // whatever other operation cares about the bound texture state will
         // just overwrite this anyway.
-        glBindTexture(bindType, 0);
+        if (StateCache::enabled()) return;
+        StateCache::current().bindTexture(bindType, 0);
         LOG_TRACE("unbound texture");
         CHECK_ERROR(__FUNCTION__);
     }
 
     int getId() const { return id; }
+    bool hasImmutableStorage() const final { return immutable; }
 };
 
 class FrameBufferImplementation : public FrameBuffer {
@@ -161,6 +468,29 @@ private:
         return id == 0;
     }
 
+    // owns the frame buffer object but not the texture
+    bool sharedContextReference = false;
+
+    void createFrameBufferObject() {
+        GLuint genId;
+        glGenFramebuffers(1, &genId);
+        id = genId;
+        LOG_TRACE("generated frame buffer %d", id);
+        CHECK_ERROR(__FUNCTION__);
+
+        aa_assert(spec.storageType == Image::StorageType::GPU_OPENGL);
+
+        Binder binder(*this);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture->getId(), 0);
+        CHECK_ERROR(__FUNCTION__);
+        aa_assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+        GLenum bufs[1] = { GL_COLOR_ATTACHMENT0 }; // single output at location 0
+        glDrawBuffers(1, bufs);
+        CHECK_ERROR(__FUNCTION__);
+    }
+
 public:
     FrameBufferImplementation(int w, int h, const ImageTypeSpec &spec, int existingFboId = -1, const Viewport *viewportPtr = nullptr) :
         width(w), height(h), spec(spec), id(existingFboId),
@@ -171,27 +501,36 @@ public:
         if (existingFboId >= 0) {
             LOG_TRACE("creating a reference to an existing frame buffer object %d", existingFboId);
         } else {
-            GLuint genId;
-            glGenFramebuffers(1, &genId);
-            id = genId;
-            LOG_TRACE("generated frame buffer %d", id);
-            CHECK_ERROR(__FUNCTION__);
-
-            aa_assert(spec.storageType == Image::StorageType::GPU_OPENGL);
-
-            Binder binder(*this);
+            createFrameBufferObject();
+        }
+    }
 
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture->getId(), 0);
-            CHECK_ERROR(__FUNCTION__);
-            aa_assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    FrameBufferImplementation(int w, int h, const ImageTypeSpec &spec, std::shared_ptr<Texture> existingTexture) :
+        width(w), height(h), spec(spec), id(-1), texture(existingTexture), viewport(Viewport { 0, 0, w, h })
+    {
+        createFrameBufferObject();
+    }
 
-            GLenum bufs[1] = { GL_COLOR_ATTACHMENT0 }; // single output at location 0
-            glDrawBuffers(1, bufs);
-            CHECK_ERROR(__FUNCTION__);
-        }
+    FrameBufferImplementation(const FrameBufferImplementation &other, std::shared_ptr<Texture> sharedTexture) :
+        width(other.width), height(other.height), spec(other.spec), id(-1),
+        texture(sharedTexture), viewport(other.viewport), sharedContextReference(true)
+    {
+        LOG_TRACE("creating a shared context reference to frame buffer %d", other.id);
+        createFrameBufferObject();
     }
 
     void destroy() final {
+        if (sharedContextReference) {
+            if (id > 0) {
+                LOG_TRACE("destroying shared context frame buffer %d", id);
+                GLuint uid = id;
+                glDeleteFramebuffers(1, &uid);
+                StateCache::current().forgetFrameBuffer(uid);
+            }
+            id = 0;
+            texture.reset();
+            return;
+        }
         if (texture) {
             // this is a bit messy
             if (texture.unique()) {
@@ -199,6 +538,7 @@ public:
                     LOG_TRACE("destroying frame buffer %d", id);
                     GLuint uid = id;
                     glDeleteFramebuffers(1, &uid);
+                    StateCache::current().forgetFrameBuffer(uid);
                 }
                 id = 0;
                 texture->destroy();
@@ -228,18 +568,24 @@ public:
         return std::unique_ptr<FrameBuffer>(r);
     }
 
+    std::unique_ptr<FrameBuffer> createSharedContextReference() final {
+        aa_assert(texture && "cannot share an external frame buffer");
+        return std::unique_ptr<FrameBuffer>(new FrameBufferImplementation(*this, texture));
+    }
+
     void bind() final {
         // texture.bind();
         LOG_TRACE("bound frame buffer %d", id);
-        glBindFramebuffer(GL_FRAMEBUFFER, id);
+        StateCache::current().bindFrameBuffer(id);
         CHECK_ERROR(__FUNCTION__);
     }
 
     void unbind() final {
         if (isScreen()) return; // skip, already bound 0
+        if (StateCache::enabled()) return;
 
         LOG_TRACE("unbound frame buffer");
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        StateCache::current().bindFrameBuffer(0);
         // texture.unbind();
         CHECK_ERROR(__FUNCTION__);
     }
@@ -250,8 +596,19 @@ public:
         CHECK_ERROR(__FUNCTION__);
     }
 
-    void readPixels(uint8_t *pixels) final {
-        LOG_TRACE("reading frame buffer %d");
+    // rowPitch = 0: tightly packed
+    void readPixels(uint8_t *pixels, std::size_t rowPitch) final {
+        const std::size_t rowBytes = viewport.width * spec.bytesPerPixel();
+        GLint rowLength = 0, alignment = 1;
+        if (rowPitch != 0 && rowPitch != rowBytes && !getRowLayout(rowPitch, spec.bytesPerPixel(), rowLength, alignment)) {
+            LOG_TRACE("row pitch %zu not supported by glReadPixels, copying rows", rowPitch);
+            std::vector<uint8_t> packed(rowBytes * viewport.height);
+            readPixels(packed.data(), 0);
+            copyRows(packed.data(), rowBytes, pixels, rowPitch, rowBytes, viewport.height);
+            return;
+        }
+
+        LOG_TRACE("reading frame buffer %d", id);
         Binder binder(*this);
 
         if (isScreen()) {
@@ -263,68 +620,547 @@ public:
             CHECK_ERROR(__FUNCTION__);
         }
 
-        // our CPU data is tightly packed and not 4-byte aligned (default)
-        GLint origPackAlignment;
-        glGetIntegerv(GL_PACK_ALIGNMENT, &origPackAlignment);
-        aa_assert(origPackAlignment >= 1 && origPackAlignment <= 4);
-        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        // our CPU data is not 4-byte aligned (default) and the rows may be
+        // padded, e.g., in an OpenCV ROI
+        {
+            RowLayoutSetter layout(true, rowLength, alignment);
+            CHECK_ERROR(__FUNCTION__);
+
+            // Note: check this
+            // https://www.khronos.org/opengl/wiki/Common_Mistakes#Slow_pixel_transfer_performance
+            glReadPixels(viewport.x0, viewport.y0, viewport.width, viewport.height, getReadPixelFormat(spec), getCpuType(spec), pixels);
+
+            if (!isScreen()) {
+                aa_assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+                CHECK_ERROR(__FUNCTION__);
+            }
+        }
         CHECK_ERROR(__FUNCTION__);
+    }
 
-        // Note: check this
-        // https://www.khronos.org/opengl/wiki/Common_Mistakes#Slow_pixel_transfer_performance
-        glReadPixels(viewport.x0, viewport.y0, viewport.width, viewport.height, getReadPixelFormat(spec), getCpuType(spec), pixels);
+    void writePixels(const uint8_t *pixels, std::size_t rowPitch) final {
+        aa_assert(!isScreen() && "won't write pixels directly to screen");
+        aa_assert(texture && "won't write directly to external frame buffer");
+
+        const std::size_t rowBytes = viewport.width * spec.bytesPerPixel();
+        GLint rowLength = 0, alignment = 1;
+        if (rowPitch != 0 && rowPitch != rowBytes && !getRowLayout(rowPitch, spec.bytesPerPixel(), rowLength, alignment)) {
+            LOG_TRACE("row pitch %zu not supported by glTexSubImage2D, copying rows", rowPitch);
+            std::vector<uint8_t> packed(rowBytes * viewport.height);
+            copyRows(pixels, rowPitch, packed.data(), rowBytes, rowBytes, viewport.height);
+            writePixels(packed.data(), 0);
+            return;
+        }
+
+        Binder binder(*texture);
+
+        {
+            RowLayoutSetter layout(false, rowLength, alignment);
+            CHECK_ERROR(__FUNCTION__);
+
+            // the texture storage is allocated once, always write a sub image (which
+            // may be the full texture). If a pixel unpack buffer is bound,
+            // pixels is an offset to that buffer
+            LOG_TRACE("writing %s of frame buffer %d", fullViewport() ? "all" : "a sub image", id);
+            glTexSubImage2D(GL_TEXTURE_2D, 0,
+                viewport.x0, viewport.y0,
+                viewport.width, viewport.height,
+                getCpuFormat(spec),
+                getCpuType(spec),
+                pixels);
 
-        if (!isScreen()) {
-            aa_assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
             CHECK_ERROR(__FUNCTION__);
         }
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    int getId() const { return id; }
 
-        glPixelStorei(GL_PACK_ALIGNMENT, origPackAlignment);
+    int getTextureId() const final {
+        aa_assert(texture && "cannot get texture ID of external frame buffer");
+        aa_assert(fullViewport() && "cannot use ROI as a texture");
+        return texture->getId();
+    }
+
+    bool supportsImageStore() const final {
+        return texture && fullViewport() && texture->hasImmutableStorage() && !getGlslImageFormat(spec).empty();
+    }
+
+    void bindImageTexture(unsigned unit) final {
+        aa_assert(supportsImageStore());
+    #ifdef ACCELERATED_ARRAYS_COMPUTE_SHADERS
+        LOG_TRACE("binding texture %d to image unit %u", texture->getId(), unit);
+        glBindImageTexture(unit, texture->getId(), 0, GL_FALSE, 0, GL_WRITE_ONLY, getTextureInternalFormat(spec));
+        CHECK_ERROR(__FUNCTION__);
+    #else
+        (void)unit;
+    #endif
+    }
+};
+
+class MultiTargetFrameBufferImplementation : public MultiTargetFrameBuffer {
+private:
+    GLuint id = 0;
+    int width = 0, height = 0;
+    int nAttached = 0;
+    int maxTargets = 0;
+
+public:
+    MultiTargetFrameBufferImplementation() {
+        GLint maxDrawBuffers = 0, maxAttachments = 0;
+        glGetIntegerv(GL_MAX_DRAW_BUFFERS, &maxDrawBuffers);
+        glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS, &maxAttachments);
+        maxTargets = std::min(maxDrawBuffers, maxAttachments);
+        glGenFramebuffers(1, &id);
+        LOG_TRACE("generated multi-target frame buffer %d (max %d targets)", id, maxTargets);
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    ~MultiTargetFrameBufferImplementation() {
+        if (id != 0) log_warn("leaking frame buffer %d", id);
+    }
+
+    void setTargets(FrameBuffer **targets, int n) final {
+        aa_assert(n >= 1 && n <= maxTargets);
+        width = targets[0]->getViewportWidth();
+        height = targets[0]->getViewportHeight();
+
+        Binder binder(*this);
+        std::vector<GLenum> drawBuffers;
+        for (int i = 0; i < std::max(n, nAttached); ++i) {
+            GLuint textureId = 0;
+            if (i < n) {
+                aa_assert(targets[i]->getViewportWidth() == width && targets[i]->getViewportHeight() == height);
+                textureId = targets[i]->getTextureId();
+                drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+            }
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, textureId, 0);
+        }
+        nAttached = n;
+        CHECK_ERROR(__FUNCTION__);
+        aa_assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+        glDrawBuffers(n, drawBuffers.data());
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    void destroy() final {
+        if (id == 0) return;
+        LOG_TRACE("destroying multi-target frame buffer %d", id);
+        glDeleteFramebuffers(1, &id);
+        StateCache::current().forgetFrameBuffer(id);
+        id = 0;
+    }
+
+    void bind() final {
+        StateCache::current().bindFrameBuffer(id);
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    void unbind() final {
+        if (StateCache::enabled()) return;
+        StateCache::current().bindFrameBuffer(0);
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    void setViewport() final {
+        glViewport(0, 0, width, height);
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    int getViewportWidth() const final { return width; }
+    int getViewportHeight() const final { return height; }
+    int getId() const final { return id; }
+
+    std::unique_ptr<FrameBuffer> createROI(int, int, int, int) final {
+        aa_assert(false && "not supported for multiple render targets");
+        return {};
+    }
+
+    std::unique_ptr<FrameBuffer> createSharedContextReference() final {
+        aa_assert(false && "not supported for multiple render targets");
+        return {};
+    }
+
+    void readPixels(uint8_t *, std::size_t) final {
+        aa_assert(false && "cannot read multiple render targets directly");
+    }
+
+    void writePixels(const uint8_t *, std::size_t) final {
+        aa_assert(false && "cannot write multiple render targets directly");
+    }
+
+    int getTextureId() const final {
+        aa_assert(false && "multiple render targets have no single texture");
+        return 0;
+    }
+
+    bool supportsImageStore() const final { return false; }
+
+    void bindImageTexture(unsigned) final {
+        aa_assert(false && "not supported for multiple render targets");
+    }
+};
+
+class PixelPackRingImplementation : public PixelPackRing {
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        std::size_t capacity = 0;
+        GLsync fence = nullptr;
+        std::uint8_t *target = nullptr;
+        std::size_t size = 0, rowBytes = 0, rowPitch = 0;
+        std::shared_ptr<Read> read;
+    };
+
+    std::vector<Slot> slots;
+    std::size_t next = 0;
+
+    // blocks until the fence is signaled if wait = true
+    bool complete(Slot &slot, bool wait) {
+        if (!slot.read) return true;
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            if (!wait) return false;
+            LOG_TRACE("waiting for PBO %d fence", slot.pbo);
+            // the fence was already flushed in startRead
+            constexpr GLuint64 TIMEOUT_NS = 100000000;
+            while ((status = glClientWaitSync(slot.fence, 0, TIMEOUT_NS)) == GL_TIMEOUT_EXPIRED) {
+                log_warn("still waiting for PBO read");
+            }
+        }
+        aa_assert(status != GL_WAIT_FAILED);
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        const void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+        aa_assert(data);
+        // the PBO is tightly packed, the target may not be
+        copyRows(static_cast<const std::uint8_t*>(data), slot.rowBytes, slot.target, slot.rowPitch,
+            slot.rowBytes, int(slot.size / slot.rowBytes));
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        CHECK_ERROR(__FUNCTION__);
+
+        LOG_TRACE("PBO %d read complete", slot.pbo);
+        slot.read->done = true;
+        slot.read.reset();
+        return true;
+    }
+
+public:
+    PixelPackRingImplementation(int nBuffers) : slots(nBuffers) {
+        aa_assert(nBuffers > 0);
+        for (auto &slot : slots) glGenBuffers(1, &slot.pbo);
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    std::shared_ptr<Read> startRead(FrameBuffer &fb, std::uint8_t *pixels, std::size_t size, std::size_t rowPitch) final {
+        poll();
+        Slot &slot = slots.at(next);
+        next = (next + 1) % slots.size();
+        complete(slot, true);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        if (slot.capacity < size) {
+            LOG_TRACE("allocating PBO %d of size %zu", slot.pbo, size);
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+            slot.capacity = size;
+        }
+        // with a bound PBO, the pointer argument is an offset to the buffer
+        fb.readPixels(nullptr, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        CHECK_ERROR(__FUNCTION__);
+
+        slot.target = pixels;
+        slot.size = size;
+        slot.rowBytes = size / fb.getViewportHeight();
+        slot.rowPitch = rowPitch == 0 ? slot.rowBytes : rowPitch;
+        slot.read = std::make_shared<Read>();
+        return slot.read;
+    }
+
+    void finishRead(const Read &read) final {
+        for (auto &slot : slots) {
+            if (slot.read.get() == &read) {
+                complete(slot, true);
+                return;
+            }
+        }
+    }
+
+    void poll() final {
+        for (auto &slot : slots) complete(slot, false);
+    }
+
+    void destroy() final {
+        for (auto &slot : slots) {
+            complete(slot, true);
+            if (slot.pbo != 0) glDeleteBuffers(1, &slot.pbo);
+            slot.pbo = 0;
+        }
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    ~PixelPackRingImplementation() {
+        for (auto &slot : slots) {
+            if (slot.pbo != 0) {
+                log_warn("leaking pixel pack buffer %d", slot.pbo);
+                break;
+            }
+        }
+    }
+};
+
+class TimerQueriesImplementation : public TimerQueries {
+private:
+    #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+    static constexpr GLenum TIME_ELAPSED = GL_TIME_ELAPSED_EXT;
+    #else
+    static constexpr GLenum TIME_ELAPSED = GL_TIME_ELAPSED;
+    #endif
+
+    bool supported = false;
+    GLuint active = 0;
+    int activeTag = 0;
+    std::deque< std::pair<GLuint, int> > pending;
+    std::vector<GLuint> unused;
+
+    static bool detectSupport() {
+    #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+        if (hasExtension("GL_EXT_disjoint_timer_query")) return true;
+        log_warn("GL_EXT_disjoint_timer_query not supported, GPU timers disabled");
+        return false;
+    #else
+        return true; // core since OpenGL 3.3
+    #endif
+    }
+
+public:
+    TimerQueriesImplementation() : supported(detectSupport()) {}
+
+    bool isSupported() const final { return supported; }
+
+    void begin(int tag) final {
+        if (!supported) return;
+        aa_assert(active == 0);
+        if (unused.empty()) {
+            GLuint q;
+            glGenQueries(1, &q);
+            unused.push_back(q);
+        }
+        active = unused.back();
+        activeTag = tag;
+        unused.pop_back();
+        glBeginQuery(TIME_ELAPSED, active);
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    void end() final {
+        if (!supported) return;
+        aa_assert(active != 0);
+        glEndQuery(TIME_ELAPSED);
+        CHECK_ERROR(__FUNCTION__);
+        pending.push_back({ active, activeTag });
+        active = 0;
+    }
+
+    void poll(const std::function<void(int, double)> &callback) final {
+        #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        if (disjoint) {
+            // e.g., a frequency change: the pending results are invalid
+            LOG_TRACE("discarding %zu disjoint timer queries", pending.size());
+            for (const auto &p : pending) unused.push_back(p.first);
+            pending.clear();
+            return;
+        }
+        #endif
+        while (!pending.empty()) {
+            const GLuint q = pending.front().first;
+            GLuint available = 0;
+            glGetQueryObjectuiv(q, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) break;
+            // 32 bits of nanoseconds is enough for a single operation
+            GLuint ns = 0;
+            glGetQueryObjectuiv(q, GL_QUERY_RESULT, &ns);
+            callback(pending.front().second, ns * 1e-6);
+            unused.push_back(q);
+            pending.pop_front();
+        }
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    void destroy() final {
+        for (const auto &p : pending) unused.push_back(p.first);
+        pending.clear();
+        if (!unused.empty()) glDeleteQueries(unused.size(), unused.data());
+        unused.clear();
+    }
+
+    ~TimerQueriesImplementation() {
+        if (!unused.empty() || !pending.empty()) log_warn("leaking GL timer queries");
+    }
+};
+
+class FenceTrackerImplementation : public FenceTracker {
+private:
+    struct Pending {
+        GLsync sync;
+        std::shared_ptr<Fence> fence;
+    };
+    // in the order of insertion, which is also the order of completion
+    std::deque<Pending> pending;
+
+    void signalUntil(std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            glDeleteSync(pending.front().sync);
+            pending.front().fence->signaled = true;
+            pending.pop_front();
+        }
+    }
+
+public:
+    void insert(const std::shared_ptr<Fence> &fence) final {
+        poll();
+        GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        aa_assert(sync);
+        // flush so that the fence is eventually signaled even if no other
+        // commands are issued
+        glFlush();
         CHECK_ERROR(__FUNCTION__);
+        pending.push_back({ sync, fence });
+    }
+
+    void poll() final {
+        std::size_t n = 0;
+        for (const auto &p : pending) {
+            const GLenum status = glClientWaitSync(p.sync, 0, 0);
+            aa_assert(status != GL_WAIT_FAILED);
+            if (status == GL_TIMEOUT_EXPIRED) break;
+            n++;
+        }
+        signalUntil(n);
+    }
+
+    bool wait(const Fence &fence, std::chrono::nanoseconds timeout) final {
+        for (std::size_t i = 0; i < pending.size(); ++i) {
+            if (pending.at(i).fence.get() != &fence) continue;
+            const GLuint64 timeoutNs = std::max(timeout.count(), decltype(timeout.count())(0));
+            const GLenum status = glClientWaitSync(pending.at(i).sync, GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNs);
+            aa_assert(status != GL_WAIT_FAILED);
+            if (status == GL_TIMEOUT_EXPIRED) return false;
+            signalUntil(i + 1);
+            return true;
+        }
+        // already signaled (or never inserted)
+        return fence.signaled;
     }
 
-    void writePixels(const uint8_t *pixels) final {
-        aa_assert(!isScreen() && "won't write pixels directly to screen");
-        aa_assert(texture && "won't write directly to external frame buffer");
+    void destroy() final {
+        if (pending.empty()) return;
+        glFinish();
+        signalUntil(pending.size());
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    ~FenceTrackerImplementation() {
+        if (!pending.empty()) log_warn("leaking %zu GL sync objects", pending.size());
+    }
+};
+
+class CrossContextFenceImplementation : public CrossContextFence {
+private:
+    GLsync sync;
+
+public:
+    CrossContextFenceImplementation() {
+        sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        aa_assert(sync);
+        // the other context can only wait for a flushed fence
+        glFlush();
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    void gpuWait() final {
+        aa_assert(sync);
+        glWaitSync(sync, 0, GL_TIMEOUT_IGNORED);
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    void destroy() final {
+        // deletion is deferred by GL if the sync object is still waited for
+        if (sync) glDeleteSync(sync);
+        sync = nullptr;
+    }
+
+    ~CrossContextFenceImplementation() {
+        if (sync) log_warn("leaking GL sync object");
+    }
+};
+
+class PixelUnpackRingImplementation : public PixelUnpackRing {
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        std::size_t capacity = 0;
+    };
 
-        Binder binder(*texture);
+    std::vector<Slot> slots;
+    std::size_t next = 0;
 
-        // our CPU data is tightly packed and not 4-byte aligned (default)
-        GLint origPackAlignment;
-        glGetIntegerv(GL_PACK_ALIGNMENT, &origPackAlignment);
-        aa_assert(origPackAlignment >= 1 && origPackAlignment <= 4);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+public:
+    PixelUnpackRingImplementation(int nBuffers) : slots(nBuffers) {
+        aa_assert(nBuffers > 0);
+        for (auto &slot : slots) glGenBuffers(1, &slot.pbo);
         CHECK_ERROR(__FUNCTION__);
+    }
 
-        if (fullViewport()) {
-            glTexImage2D(GL_TEXTURE_2D, 0,
-                getTextureInternalFormat(spec),
-                width, height, 0,
-                getCpuFormat(spec),
-                getCpuType(spec),
-                pixels);
-        } else {
-            LOG_TRACE("writing a sub image of frame buffer %d", id);
-            glTexSubImage2D(GL_TEXTURE_2D, 0,
-                viewport.x0, viewport.y0,
-                viewport.width, viewport.height,
-                getCpuFormat(spec),
-                getCpuType(spec),
-                pixels);
-        }
+    void write(FrameBuffer &fb, const std::uint8_t *pixels, std::size_t size, std::size_t rowPitch) final {
+        Slot &slot = slots.at(next);
+        next = (next + 1) % slots.size();
 
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        if (slot.capacity < size) {
+            LOG_TRACE("allocating PBO %d of size %zu", slot.pbo, size);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            slot.capacity = size;
+        }
+        // invalidating (orphaning) the buffer avoids waiting for the
+        // previous upload from it to complete
+        void *data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        aa_assert(data);
+        const std::size_t rowBytes = size / fb.getViewportHeight();
+        copyRows(pixels, rowPitch == 0 ? rowBytes : rowPitch, static_cast<std::uint8_t*>(data),
+            rowBytes, rowBytes, fb.getViewportHeight());
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
         CHECK_ERROR(__FUNCTION__);
 
-        glPixelStorei(GL_PACK_ALIGNMENT, origPackAlignment);
+        fb.writePixels(nullptr, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
         CHECK_ERROR(__FUNCTION__);
     }
 
-    int getId() const { return id; }
+    void destroy() final {
+        for (auto &slot : slots) {
+            if (slot.pbo != 0) glDeleteBuffers(1, &slot.pbo);
+            slot.pbo = 0;
+        }
+        CHECK_ERROR(__FUNCTION__);
+    }
 
-    int getTextureId() const final {
-        aa_assert(texture && "cannot get texture ID of external frame buffer");
-        aa_assert(fullViewport() && "cannot use ROI as a texture");
-        return texture->getId();
+    ~PixelUnpackRingImplementation() {
+        for (auto &slot : slots) {
+            if (slot.pbo != 0) {
+                log_warn("leaking pixel unpack buffer %d", slot.pbo);
+                break;
+            }
+        }
     }
 };
 
@@ -361,15 +1197,26 @@ static GLuint loadShader(GLenum shaderType, const char* shaderSource) {
     return shader;
 }
 
-GLuint createProgram(const char* vertexSource, const char* fragmentSource) {
-    const GLuint vertexShader = loadShader(GL_VERTEX_SHADER, vertexSource);
-    const GLuint fragmentShader = loadShader(GL_FRAGMENT_SHADER, fragmentSource);
+// a compute shader program if the vertex shader source is empty
+GLuint createProgram(const char* vertexSource, const char* fragmentSource, bool retrievableBinary) {
+    std::vector<GLuint> shaders;
+    if (*vertexSource == '\0') {
+    #ifdef ACCELERATED_ARRAYS_COMPUTE_SHADERS
+        shaders.push_back(loadShader(GL_COMPUTE_SHADER, fragmentSource));
+    #else
+        aa_assert(false && "compute shaders not supported");
+    #endif
+    } else {
+        shaders.push_back(loadShader(GL_VERTEX_SHADER, vertexSource));
+        shaders.push_back(loadShader(GL_FRAGMENT_SHADER, fragmentSource));
+    }
     const GLuint program = glCreateProgram();
     aa_assert(program);
-    glAttachShader(program, vertexShader);
-    CHECK_ERROR(__FUNCTION__);
-    glAttachShader(program, fragmentShader);
-    CHECK_ERROR(__FUNCTION__);
+    for (GLuint shader : shaders) {
+        glAttachShader(program, shader);
+        CHECK_ERROR(__FUNCTION__);
+    }
+    if (retrievableBinary) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(program);
     GLint linkStatus = GL_FALSE;
     glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
@@ -387,33 +1234,202 @@ GLuint createProgram(const char* vertexSource, const char* fragmentSource) {
     return program;
 }
 
+// 64-bit FNV-1a, stable across runs (unlike std::hash) for file names
+std::uint64_t stableHash(const std::string &s) {
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (char c : s) {
+        h ^= std::uint8_t(c);
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+class ProgramCache {
+private:
+    typedef std::tuple<const void*, std::string, std::string> Key;
+    struct Entry {
+        GLuint program;
+        int refs;
+    };
+
+    std::mutex mutex;
+    std::map<Key, Entry> entries;
+    std::string binaryDirectory;
+    programCache::Stats stats;
+
+    static const std::string &driverId() {
+        // the same in all contexts of the process, in practice
+        static const std::string id = [] {
+            std::ostringstream oss;
+            for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+                const GLubyte *str = glGetString(name);
+                oss << (str ? reinterpret_cast<const char*>(str) : "") << "\n";
+            }
+            return oss.str();
+        }();
+        return id;
+    }
+
+    std::string binaryPath(const std::string &sources) const {
+        std::ostringstream oss;
+        oss << binaryDirectory << "/aa-program-" << std::hex << stableHash(sources) << ".bin";
+        return oss.str();
+    }
+
+    // file contents: driver ID, sources, binary format and the binary data.
+    // A different driver or sources (hash collision) is a cache miss
+    GLuint loadBinary(const std::string &sources) {
+        std::ifstream file(binaryPath(sources), std::ios::binary);
+        if (!file) return 0;
+        const std::string header = driverId() + sources;
+        std::string fileHeader(header.size(), '\0');
+        GLenum format = 0;
+        GLsizei length = 0;
+        if (!file.read(&fileHeader[0], fileHeader.size()) || fileHeader != header) return 0;
+        if (!file.read(reinterpret_cast<char*>(&format), sizeof(format))) return 0;
+        if (!file.read(reinterpret_cast<char*>(&length), sizeof(length)) || length <= 0) return 0;
+        std::vector<char> binary(length);
+        if (!file.read(binary.data(), length)) return 0;
+
+        const GLuint program = glCreateProgram();
+        aa_assert(program);
+        glProgramBinary(program, format, binary.data(), length);
+        GLint linkStatus = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+        // clear possible GL_INVALID_ENUM for an unsupported format
+        while (glGetError() != GL_NO_ERROR) {}
+        if (linkStatus != GL_TRUE) {
+            log_debug("rejected stale program binary");
+            glDeleteProgram(program);
+            return 0;
+        }
+        LOG_TRACE("loaded program binary of %d bytes", int(length));
+        return program;
+    }
+
+    void saveBinary(GLuint program, const std::string &sources) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &format, binary.data());
+        CHECK_ERROR(__FUNCTION__);
+        if (written <= 0) return;
+
+        const std::string path = binaryPath(sources);
+        std::ofstream file(path, std::ios::binary);
+        const std::string header = driverId() + sources;
+        file.write(header.data(), header.size());
+        file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+        file.write(reinterpret_cast<const char*>(&written), sizeof(written));
+        file.write(binary.data(), written);
+        if (!file) log_warn("failed to write program binary %s", path.c_str());
+    }
+
+    GLuint build(const std::string &vs, const std::string &fs) {
+        const bool persist = !binaryDirectory.empty();
+        const std::string sources = vs + fs;
+        if (persist) {
+            const GLuint program = loadBinary(sources);
+            if (program != 0) {
+                stats.loadedBinaries++;
+                return program;
+            }
+        }
+        stats.compiled++;
+        const GLuint program = createProgram(vs.c_str(), fs.c_str(), persist);
+        if (persist) saveBinary(program, sources);
+        return program;
+    }
+
+public:
+    GLuint acquire(const void *context, const std::string &vs, const std::string &fs) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Key key(context, vs, fs);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            it->second.refs++;
+            stats.hits++;
+            return it->second.program;
+        }
+        const GLuint program = build(vs, fs);
+        entries[key] = Entry { program, 1 };
+        return program;
+    }
+
+    void release(const void *context, const std::string &vs, const std::string &fs, GLuint program) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(Key(context, vs, fs));
+        if (it == entries.end() || it->second.program != program) {
+            // the context was forgotten: the ID may already belong to a
+            // program of a new context with the same key
+            return;
+        }
+        if (--it->second.refs == 0) {
+            LOG_TRACE("deleting GL program %d", program);
+            glDeleteProgram(program);
+            StateCache::current().forgetProgram(program);
+            entries.erase(it);
+        }
+    }
+
+    void forget(const void *context) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (std::get<0>(it->first) == context) it = entries.erase(it);
+            else ++it;
+        }
+    }
+
+    void setBinaryDirectory(const std::string &directory) {
+        std::lock_guard<std::mutex> lock(mutex);
+        binaryDirectory = directory;
+    }
+
+    programCache::Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        programCache::Stats result = stats;
+        result.programs = entries.size();
+        return result;
+    }
+};
+
+ProgramCache &getProgramCache() {
+    static ProgramCache cache;
+    return cache;
+}
+
 class GlslProgramImplementation : public GlslProgram {
 private:
     std::string vertSrc, fragSrc;
+    const void *context;
     GLuint program;
 
 public:
     GlslProgramImplementation(const char *vs, const char *fs) :
         vertSrc(vs), fragSrc(fs),
-        program(createProgram(vertSrc.c_str(), fragSrc.c_str()))
+        context(currentContext()),
+        program(getProgramCache().acquire(context, vertSrc, fragSrc))
     {}
 
     int getId() const final { return program; }
 
     void bind() final {
         LOG_TRACE("activating shader: glUseProgram(%d)", program);
-        glUseProgram(program);
+        StateCache::current().useProgram(program);
     }
 
     void unbind() final {
+        if (StateCache::enabled()) return;
         LOG_TRACE("deactivating shader: glUseProgram(0)");
-        glUseProgram(0);
+        StateCache::current().useProgram(0);
     }
 
     void destroy() final {
         if (program != 0) {
-            LOG_TRACE("deleting GL program %d", program);
-            glDeleteProgram(program);
+            getProgramCache().release(context, vertSrc, fragSrc, program);
             program = 0;
         }
     }
@@ -474,7 +1490,8 @@ public:
         glGenBuffers(1, &vertexBuffer);
         glGenBuffers(1, &vertexIndexBuffer);
         glGenVertexArrays(1, &vao);
-        glBindVertexArray(vao);
+        auto &state = StateCache::current();
+        state.bindVertexArray(vao);
 
         // Set up vertices
         float vertexData[] {
@@ -492,18 +1509,29 @@ public:
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexIndexBuffer);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
+        // The attribute setup and the index buffer binding are stored in
+        // the VAO so binding it is enough in call()
+        aVertexData = glGetAttribLocation(program.getId(), "a_vertexData");
+        glEnableVertexAttribArray(aVertexData);
+        glVertexAttribPointer(aVertexData, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+
         // Unbind evrything
-        glBindVertexArray(0); // Has to happen before unbinding other buffers
+        state.bindVertexArray(0); // Has to happen before unbinding other buffers
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-        aVertexData = glGetAttribLocation(program.getId(), "a_vertexData");
+        CHECK_ERROR(__FUNCTION__);
     }
 
     void destroy() final {
         if (vertexBuffer != 0) {
             glDeleteBuffers(1, &vertexBuffer);
             glDeleteBuffers(1, &vertexIndexBuffer);
+            vertexBuffer = vertexIndexBuffer = 0;
+        }
+        if (vao != 0) {
+            glDeleteVertexArrays(1, &vao);
+            StateCache::current().forgetVertexArray(vao);
+            vao = 0;
         }
         program.destroy();
     }
@@ -513,28 +1541,13 @@ public:
 
     void bind() final {
         program.bind();
-
-        glBindVertexArray(vao);
-        CHECK_ERROR(__FUNCTION__);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexIndexBuffer);
-        CHECK_ERROR(__FUNCTION__);
-
-        glEnableVertexAttribArray(aVertexData);
-        glVertexAttribPointer(aVertexData, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+        StateCache::current().bindVertexArray(vao);
         CHECK_ERROR(__FUNCTION__);
     }
 
     void unbind() final {
-        glDisableVertexAttribArray(aVertexData);
-        CHECK_ERROR(__FUNCTION__);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (!StateCache::enabled()) StateCache::current().bindVertexArray(0);
         CHECK_ERROR(__FUNCTION__);
-        glBindVertexArray(0);
-        CHECK_ERROR(__FUNCTION__);
-
         program.unbind();
     }
 
@@ -551,14 +1564,16 @@ public:
         if (frameBuffer.getId() == 0) {
             #ifndef ACCELERATED_ARRAYS_USE_OPENGL_ES
                 // probably not changed, but good to set explicitly
-                GLint origDrawBuffer;
-                glGetIntegerv(GL_DRAW_BUFFER, &origDrawBuffer);
-                CHECK_ERROR(__FUNCTION__);
+                GLint origDrawBuffer = GL_BACK;
+                if (!StateCache::enabled()) {
+                    glGetIntegerv(GL_DRAW_BUFFER, &origDrawBuffer);
+                    CHECK_ERROR(__FUNCTION__);
+                }
                 glDrawBuffer(GL_BACK);
             #endif
             glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
             #ifndef ACCELERATED_ARRAYS_USE_OPENGL_ES
-                glDrawBuffer(origDrawBuffer);
+                if (origDrawBuffer != GL_BACK) glDrawBuffer(origDrawBuffer);
             #endif
         } else {
             glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
@@ -594,31 +1609,34 @@ public:
 
     void bind() final {
         LOG_TRACE("bind texture / uniform at slot %u -> %d", slot, textureId);
-        glActiveTexture(GL_TEXTURE0 + slot);
-        glBindTexture(bindType, textureId);
+        auto &state = StateCache::current();
+        state.setActiveTexture(slot);
+        state.bindTexture(bindType, textureId);
 
         const int interpType = getGlInterpType();
         if (interpType != 0) {
             LOG_TRACE("set texture interpolation 0x%x", interpType);
-            glTexParameteri(bindType, GL_TEXTURE_MAG_FILTER, interpType);
-            glTexParameteri(bindType, GL_TEXTURE_MIN_FILTER, interpType);
+            state.setTextureParameter(bindType, textureId, GL_TEXTURE_MAG_FILTER, interpType);
+            state.setTextureParameter(bindType, textureId, GL_TEXTURE_MIN_FILTER, interpType);
         }
         const int borderType = getGlBorderType();
         if (borderType != 0) {
             LOG_TRACE("set border type 0x%x", borderType);
-            glTexParameteri(bindType, GL_TEXTURE_WRAP_S, borderType);
-            glTexParameteri(bindType, GL_TEXTURE_WRAP_T, borderType);
+            state.setTextureParameter(bindType, textureId, GL_TEXTURE_WRAP_S, borderType);
+            state.setTextureParameter(bindType, textureId, GL_TEXTURE_WRAP_T, borderType);
         }
 
         glUniform1i(uniformId, slot);
     }
 
     void unbind() final {
+        if (StateCache::enabled()) return;
         LOG_TRACE("unbind texture / uniform at slot %u", slot);
-        glActiveTexture(GL_TEXTURE0 + slot);
-        glBindTexture(bindType, 0);
+        auto &state = StateCache::current();
+        state.setActiveTexture(slot);
+        state.bindTexture(bindType, 0);
         // restore active texture to the default slot
-        glActiveTexture(GL_TEXTURE0);
+        state.setActiveTexture(0);
     }
 
     // avoid clang warning
@@ -647,39 +1665,49 @@ private:
             case Image::Interpolation::UNDEFINED: return 0;
             case Image::Interpolation::NEAREST: return GL_NEAREST;
             case Image::Interpolation::LINEAR: return GL_LINEAR;
+            // not a texture filter: the rescale shader averages LINEAR lookups
+            case Image::Interpolation::AREA: break;
         }
         aa_assert(false);
         return 0;
     }
 };
 
+// input texture uniform names of GlslPipeline and GlslComputeShader
+std::string textureName(unsigned index, unsigned nTextures) {
+    std::ostringstream oss;
+    aa_assert(index < nTextures);
+    oss << "u_texture";
+    if (nTextures >= 2 || index > 1) {
+        oss << (index + 1);
+    }
+    return oss.str();
+}
+
+std::string outSizeName() {
+    return "u_outSize";
+}
+
 class GlslPipelineImplementation : public GlslPipeline {
 private:
     GLuint outSizeUniform;
     GlslFragmentShaderImplementation program;
     std::vector<TextureUniformBinder> textureBinders;
 
-    std::string textureName(unsigned index, unsigned nTextures) const {
-        std::ostringstream oss;
-        aa_assert(index < nTextures);
-        oss << "u_texture";
-        if (nTextures >= 2 || index > 1) {
-            oss << (index + 1);
-        }
-        return oss.str();
-    }
-
-    static std::string outSizeName() {
-        return "u_outSize";
-    }
-
     static bool hasExternal(const std::vector<ImageTypeSpec> &inputs) {
         for (const auto &in : inputs)
             if (getBindType(in) != GL_TEXTURE_2D) return true;
         return false;
     }
 
-    std::string buildShaderSource(const char *fragmentMain, const std::vector<ImageTypeSpec> &inputs, const ImageTypeSpec &output) const {
+    static std::string outValueName(unsigned index, unsigned nOutputs) {
+        std::ostringstream oss;
+        oss << "outValue";
+        if (nOutputs >= 2) oss << (index + 1);
+        return oss.str();
+    }
+
+    std::string buildShaderSource(const char *fragmentMain, const std::vector<ImageTypeSpec> &inputs, const std::vector<ImageTypeSpec> &outputs) const {
         std::ostringstream oss;
         #ifdef __APPLE__
             oss << "#version 330\n";
@@ -690,7 +1718,11 @@ private:
             oss << "#extension GL_OES_EGL_image_external_essl3 : require\n";
         }
         oss << "precision highp float;\n";
-        oss << "layout(location = 0) out " << getGlslVecType(output) << " outValue;\n";
+        for (std::size_t i = 0; i < outputs.size(); ++i) {
+            oss << "layout(location = " << i << ") out "
+                << getGlslVecType(outputs.at(i)) << " "
+                << outValueName(i, outputs.size()) << ";\n";
+        }
 
         for (std::size_t i = 0; i < inputs.size(); ++i) {
             oss << "uniform "
@@ -701,18 +1733,36 @@ private:
 
         oss << "uniform ivec2 " << outSizeName() << ";\n";
         oss << "in vec2 v_texCoord;\n";
+
+        // half float outputs are post-processed after the given main()
+        bool halfOutputs = false;
+        for (const auto &output : outputs)
+            if (output.dataType == ImageTypeSpec::DataType::FLOAT16) halfOutputs = true;
+        if (halfOutputs) oss << "#define main userMain\n";
         oss << fragmentMain;
         oss << std::endl;
+        if (halfOutputs) {
+            oss << "#undef main\n";
+            oss << "void main() {\n";
+            oss << "    userMain();\n";
+            for (std::size_t i = 0; i < outputs.size(); ++i) {
+                if (outputs.at(i).dataType != ImageTypeSpec::DataType::FLOAT16) continue;
+                const std::string name = outValueName(i, outputs.size());
+                oss << "    " << name << " = " << glslHalfOverflowToInf(name, outputs.at(i).channels) << ";\n";
+            }
+            oss << "}\n";
+        }
 
         return oss.str();
     }
 
 public:
-    GlslPipelineImplementation(const char *fragmentMain, const std::vector<ImageTypeSpec> &inputs, const ImageTypeSpec &output)
+    GlslPipelineImplementation(const char *fragmentMain, const std::vector<ImageTypeSpec> &inputs, const std::vector<ImageTypeSpec> &outputs)
     :
         outSizeUniform(0),
-        program(buildShaderSource(fragmentMain, inputs, output).c_str())
+        program(buildShaderSource(fragmentMain, inputs, outputs).c_str())
     {
+        aa_assert(!outputs.empty());
         outSizeUniform = glGetUniformLocation(program.getId(), outSizeName().c_str());
         for (std::size_t i = 0; i < inputs.size(); ++i) {
             textureBinders.push_back(TextureUniformBinder(
@@ -723,26 +1773,28 @@ public:
         }
         CHECK_ERROR(__FUNCTION__);
 
-        if (ImageTypeSpec::isFixedPoint(output.dataType) && ImageTypeSpec::isSigned(output.dataType)) {
-            // https://www.reddit.com/r/opengl/comments/bqe1jo/how_to_render_to_a_snorm_texture/
-            #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
-                // NOTE: it is possible to tolerate this but then it's possible
-                // that all negative output values get clamped to 0
-                log_warn("glClampColor not available in OpenGL ES so can't use SNORM render targets");
-
-                #ifndef ACCELERATED_ARRAYS_DODGY_READS
-                    aa_assert(false);
-                #endif
-            #else
-                #if defined(__APPLE__)
-                    log_error("glClampColor() and GL_CLAMP_FRAGMENT_COLOR not supported on MacOS");
-                    assert(false);
+        for (const auto &output : outputs) {
+            if (ImageTypeSpec::isFixedPoint(output.dataType) && ImageTypeSpec::isSigned(output.dataType)) {
+                // https://www.reddit.com/r/opengl/comments/bqe1jo/how_to_render_to_a_snorm_texture/
+                #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+                    // NOTE: it is possible to tolerate this but then it's possible
+                    // that all negative output values get clamped to 0
+                    log_warn("glClampColor not available in OpenGL ES so can't use SNORM render targets");
+
+                    #ifndef ACCELERATED_ARRAYS_DODGY_READS
+                        aa_assert(false);
+                    #endif
                 #else
-                    log_warn("SNORM render target requires GL bug fixes only found on Reddit. Use with caution.");
-                    //constexpr int GL_CLAMP_FRAGMENT_COLOR = 0x891B;
-                    glClampColor(GL_CLAMP_FRAGMENT_COLOR, GL_FALSE);
+                    #if defined(__APPLE__)
+                        log_error("glClampColor() and GL_CLAMP_FRAGMENT_COLOR not supported on MacOS");
+                        assert(false);
+                    #else
+                        log_warn("SNORM render target requires GL bug fixes only found on Reddit. Use with caution.");
+                        //constexpr int GL_CLAMP_FRAGMENT_COLOR = 0x891B;
+                        glClampColor(GL_CLAMP_FRAGMENT_COLOR, GL_FALSE);
+                    #endif
                 #endif
-            #endif
+            }
         }
     }
 
@@ -777,6 +1829,146 @@ public:
     std::string getVertexShaderSource() const { return program.getVertexShaderSource(); }
 };
 
+class GlslComputeShaderImplementation : public GlslComputeShader {
+private:
+    GLuint outSizeUniform;
+    // the program cache treats an empty vertex shader as a compute shader
+    GlslProgramImplementation program;
+    std::vector<TextureUniformBinder> textureBinders;
+
+    static std::string buildShaderSource(const char *computeMain, const std::vector<ImageTypeSpec> &inputs, const ImageTypeSpec &output, int localSizeX, int localSizeY) {
+        std::ostringstream oss;
+        #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+            oss << "#version 310 es\n";
+        #else
+            oss << "#version 430\n";
+        #endif
+        oss << "precision highp float;\n";
+        oss << "precision highp int;\n";
+        oss << "layout(local_size_x = " << localSizeX << ", local_size_y = " << localSizeY << ") in;\n";
+
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            aa_assert(getBindType(inputs.at(i)) == GL_TEXTURE_2D);
+            oss << "uniform "
+                << getGlslPrecision(inputs.at(i)) << " "
+                << getGlslSamplerType(inputs.at(i)) << " "
+                << textureName(i, inputs.size()) << ";\n";
+        }
+
+        const std::string format = getGlslImageFormat(output);
+        aa_assert(!format.empty() && "output type not supported for image stores");
+        oss << "layout(" << format << ", binding = 0) writeonly uniform highp "
+            << getGlslImageType(output) << " u_output;\n";
+        oss << "uniform ivec2 " << outSizeName() << ";\n";
+        oss << computeMain;
+        oss << std::endl;
+
+        return oss.str();
+    }
+
+public:
+    GlslComputeShaderImplementation(const char *computeMain, const std::vector<ImageTypeSpec> &inputs, const ImageTypeSpec &output, int localSizeX, int localSizeY)
+    :
+        outSizeUniform(0),
+        program("", buildShaderSource(computeMain, inputs, output, localSizeX, localSizeY).c_str())
+    {
+        outSizeUniform = glGetUniformLocation(program.getId(), outSizeName().c_str());
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            textureBinders.push_back(TextureUniformBinder(
+                i,
+                getBindType(inputs.at(i)),
+                glGetUniformLocation(program.getId(), textureName(i, inputs.size()).c_str())
+            ));
+        }
+        CHECK_ERROR(__FUNCTION__);
+    }
+
+    Binder::Target &bindTexture(unsigned index, int textureId) final {
+        auto &binder = textureBinders.at(index);
+        binder.textureId = textureId;
+        return binder;
+    }
+
+    void setTextureInterpolation(unsigned index, ::accelerated::Image::Interpolation i) final {
+        textureBinders.at(index).interpolation = i;
+    }
+
+    void setTextureBorder(unsigned index, ::accelerated::Image::Border b) final {
+        textureBinders.at(index).border = b;
+    }
+
+    void dispatch(FrameBuffer &output, int groupsX, int groupsY) final {
+    #ifdef ACCELERATED_ARRAYS_COMPUTE_SHADERS
+        LOG_TRACE("dispatching %d x %d work groups", groupsX, groupsY);
+        glUniform2i(outSizeUniform, output.getViewportWidth(), output.getViewportHeight());
+        output.bindImageTexture(0);
+        glDispatchCompute(groupsX, groupsY, 1);
+        // the next operation may use the output in any way
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT |
+            GL_SHADER_IMAGE_ACCESS_BARRIER_BIT |
+            GL_SHADER_STORAGE_BARRIER_BIT |
+            GL_FRAMEBUFFER_BARRIER_BIT |
+            GL_TEXTURE_UPDATE_BARRIER_BIT |
+            GL_PIXEL_BUFFER_BARRIER_BIT);
+        CHECK_ERROR(__FUNCTION__);
+    #else
+        (void)output; (void)groupsX; (void)groupsY;
+        aa_assert(false && "compute shaders not supported");
+    #endif
+    }
+
+    void destroy() final { program.destroy(); }
+    void bind() final { program.bind(); }
+    void unbind() final { program.unbind(); }
+    int getId() const final { return program.getId(); }
+    std::string getComputeShaderSource() const final { return program.getFragmentShaderSource(); }
+    std::string getFragmentShaderSource() const { return ""; }
+    std::string getVertexShaderSource() const { return ""; }
+};
+
+class ShaderStorageBufferImplementation : public ShaderStorageBuffer {
+private:
+    GLuint id = 0;
+    std::size_t bytes;
+
+public:
+    ShaderStorageBufferImplementation(std::size_t size) : bytes(size) {
+    #ifdef ACCELERATED_ARRAYS_COMPUTE_SHADERS
+        glGenBuffers(1, &id);
+        LOG_TRACE("created shader storage buffer %d of %zu bytes", id, size);
+        const std::vector<std::uint8_t> zeros(size, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, zeros.data(), GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        CHECK_ERROR(__FUNCTION__);
+    #else
+        aa_assert(false && "shader storage buffers not supported");
+    #endif
+    }
+
+    ~ShaderStorageBufferImplementation() {
+        if (id != 0) log_warn("leaking shader storage buffer %d", id);
+    }
+
+    std::size_t size() const final { return bytes; }
+
+    void bind(unsigned index) final {
+    #ifdef ACCELERATED_ARRAYS_COMPUTE_SHADERS
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, id);
+        CHECK_ERROR(__FUNCTION__);
+    #else
+        (void)index;
+    #endif
+    }
+
+    void destroy() final {
+        if (id == 0) return;
+        LOG_TRACE("deleting shader storage buffer %d", id);
+        glDeleteBuffers(1, &id);
+        id = 0;
+    }
+};
+
 }
 
 Binder::Binder(Target &target) : target(target) { target.bind(); }
@@ -791,16 +1983,87 @@ std::unique_ptr<FrameBuffer> FrameBuffer::create(int w, int h, const ImageTypeSp
     return std::unique_ptr<FrameBuffer>(new FrameBufferImplementation(w, h, spec));
 }
 
+std::unique_ptr<CrossContextFence> CrossContextFence::insert() {
+    return std::unique_ptr<CrossContextFence>(new CrossContextFenceImplementation());
+}
+
+std::unique_ptr<MultiTargetFrameBuffer> MultiTargetFrameBuffer::create() {
+    return std::unique_ptr<MultiTargetFrameBuffer>(new MultiTargetFrameBufferImplementation);
+}
+
 std::unique_ptr<FrameBuffer> FrameBuffer::createReference(int existingFboId, int w, int h, const ImageTypeSpec &spec) {
     return std::unique_ptr<FrameBuffer>(new FrameBufferImplementation(w, h, spec, existingFboId));
 }
 
+std::unique_ptr<FrameBuffer> FrameBuffer::createFromEglImage(void *eglImage, int w, int h, const ImageTypeSpec &spec) {
+#ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+    std::shared_ptr<Texture> texture(new TextureImplementation(eglImage, spec));
+    return std::unique_ptr<FrameBuffer>(new FrameBufferImplementation(w, h, spec, texture));
+#else
+    (void)eglImage; (void)w; (void)h; (void)spec;
+    aa_assert(false && "EGLImages are only supported with OpenGL ES");
+    return {};
+#endif
+}
+
 std::unique_ptr<FrameBuffer> FrameBuffer::createScreenReference(int w, int h) {
     auto spec = getScreenImageTypeSpec();
     // note: 0 is handled as a special case (hacky-ish)
     return createReference(0, w, h, *spec);
 }
 
+std::unique_ptr<PixelPackRing> PixelPackRing::create(int nBuffers) {
+    return std::unique_ptr<PixelPackRing>(new PixelPackRingImplementation(nBuffers));
+}
+
+std::unique_ptr<TimerQueries> TimerQueries::create() {
+    return std::unique_ptr<TimerQueries>(new TimerQueriesImplementation);
+}
+
+std::unique_ptr<FenceTracker> FenceTracker::create() {
+    return std::unique_ptr<FenceTracker>(new FenceTrackerImplementation);
+}
+
+std::unique_ptr<PixelUnpackRing> PixelUnpackRing::create(int nBuffers) {
+    return std::unique_ptr<PixelUnpackRing>(new PixelUnpackRingImplementation(nBuffers));
+}
+
+namespace glState {
+void setCaching(bool enabled) {
+    // the state may have been changed while caching was disabled
+    if (enabled) stateCacheGeneration++;
+    stateCachingEnabled = enabled;
+}
+
+void invalidate() {
+    stateCacheGeneration++;
+}
+
+void setPerOperationErrorChecks(bool enabled) {
+    errorChecksPerOperation = enabled;
+}
+}
+
+namespace programCache {
+void setCurrentContext(const void *context) {
+    explicitContext = context;
+}
+
+void forgetContext(const void *context) {
+    getProgramCache().forget(context == nullptr ? currentContext() : context);
+    // the tracked state of a recreated context with the same key is stale too
+    stateCacheGeneration++;
+}
+
+void setBinaryDirectory(const std::string &directory) {
+    getProgramCache().setBinaryDirectory(directory);
+}
+
+Stats getStats() {
+    return getProgramCache().getStats();
+}
+}
+
 std::unique_ptr<GlslProgram> GlslProgram::create(const char *vs, const char *fs) {
     return std::unique_ptr<GlslProgram>(new GlslProgramImplementation(vs, fs));
 }
@@ -810,7 +2073,35 @@ std::unique_ptr<GlslFragmentShader> GlslFragmentShader::create(const char *frage
 }
 
 std::unique_ptr<GlslPipeline> GlslPipeline::create(const char *fragmentMain, const std::vector<ImageTypeSpec> &inputs, const ImageTypeSpec &output) {
-    return std::unique_ptr<GlslPipeline>(new GlslPipelineImplementation(fragmentMain, inputs, output));
+    return create(fragmentMain, inputs, std::vector<ImageTypeSpec> { output });
+}
+
+bool GlslComputeShader::isSupported() {
+#ifdef ACCELERATED_ARRAYS_COMPUTE_SHADERS
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    CHECK_ERROR(__FUNCTION__);
+    #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+    return major > 3 || (major == 3 && minor >= 1);
+    #else
+    return major > 4 || (major == 4 && minor >= 3);
+    #endif
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<GlslComputeShader> GlslComputeShader::create(const char *computeMain, const std::vector<ImageTypeSpec> &inputs, const ImageTypeSpec &output, int localSizeX, int localSizeY) {
+    return std::unique_ptr<GlslComputeShader>(new GlslComputeShaderImplementation(computeMain, inputs, output, localSizeX, localSizeY));
+}
+
+std::unique_ptr<ShaderStorageBuffer> ShaderStorageBuffer::create(std::size_t size) {
+    return std::unique_ptr<ShaderStorageBuffer>(new ShaderStorageBufferImplementation(size));
+}
+
+std::unique_ptr<GlslPipeline> GlslPipeline::create(const char *fragmentMain, const std::vector<ImageTypeSpec> &inputs, const std::vector<ImageTypeSpec> &outputs) {
+    return std::unique_ptr<GlslPipeline>(new GlslPipelineImplementation(fragmentMain, inputs, outputs));
 }
 
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -8,7 +11,11 @@
 #endif
 
 #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
-    #include <GLES3/gl3.h>
+    #ifdef ACCELERATED_ARRAYS_COMPUTE_SHADERS
+        #include <GLES3/gl31.h>
+    #else
+        #include <GLES3/gl3.h>
+    #endif
     #include <GLES3/gl3ext.h>
     // NDK bug workaround: https://stackoverflow.com/a/31025110
     #define __gl2_h_
@@ -28,6 +35,8 @@
 namespace accelerated {
 namespace opengl {
 void checkError(const char *tag);
+/** Check errors at the end of an operation if setPerOperationErrorChecks is on */
+void checkOperationErrors(const char *tag);
 int getTextureInternalFormat(const ImageTypeSpec &spec);
 int getCpuFormat(const ImageTypeSpec &spec);
 int getReadPixelFormat(const ImageTypeSpec &spec);
@@ -37,6 +46,15 @@ std::string getGlslPrecision(const ImageTypeSpec &spec);
 std::string getGlslSamplerType(const ImageTypeSpec &spec);
 std::string getGlslScalarType(const ImageTypeSpec &spec);
 std::string getGlslVecType(const ImageTypeSpec &spec);
+/** Format layout qualifier for image load/store, or empty if not supported */
+std::string getGlslImageFormat(const ImageTypeSpec &spec);
+std::string getGlslImageType(const ImageTypeSpec &spec);
+/**
+ * GLSL expression that maps the float vector v with values beyond the half
+ * float range to infinity, like Float16. Converting them to a half float
+ * is implementation-defined otherwise (infinity or the max value)
+ */
+std::string glslHalfOverflowToInf(const std::string &v, int channels);
 std::unique_ptr<ImageTypeSpec> getScreenImageTypeSpec();
 
 class Binder {
@@ -78,15 +96,29 @@ struct FrameBuffer : Destroyable, Binder::Target {
     static std::unique_ptr<FrameBuffer> create(int w, int h, const ImageTypeSpec &spec);
     static std::unique_ptr<FrameBuffer> createReference(int existingFboId, int w, int h, const ImageTypeSpec &spec);
     static std::unique_ptr<FrameBuffer> createScreenReference(int w, int h);
+    /** Texture (and frame buffer) whose storage is an EGLImage. OpenGL ES only */
+    static std::unique_ptr<FrameBuffer> createFromEglImage(void *eglImage, int w, int h, const ImageTypeSpec &spec);
 
     virtual std::unique_ptr<FrameBuffer> createROI(int x0, int y0, int w, int h) = 0;
+    /**
+     * New frame buffer object for the same texture and viewport in the
+     * current GL context, which must share objects with the original one.
+     * Textures are shared between such contexts but frame buffers are not
+     */
+    virtual std::unique_ptr<FrameBuffer> createSharedContextReference() = 0;
 
     virtual int getViewportWidth() const = 0;
     virtual int getViewportHeight() const = 0;
 
-    // these bind the frame buffer automatically
-    virtual void readPixels(uint8_t *pixels) = 0;
-    virtual void writePixels(const uint8_t *pixels) = 0;
+    /**
+     * These bind the frame buffer automatically. The CPU rows are rowPitch
+     * bytes apart (0 = tightly packed), set with GL_PACK_ROW_LENGTH /
+     * GL_UNPACK_ROW_LENGTH when possible and otherwise copied through a
+     * temporary buffer. If a pixel pack / unpack buffer is bound, pixels is
+     * an offset to it and rowPitch should be 0
+     */
+    virtual void readPixels(uint8_t *pixels, std::size_t rowPitch) = 0;
+    virtual void writePixels(const uint8_t *pixels, std::size_t rowPitch) = 0;
 
     /** set glViewport to the viewport defined for this frame buffer (reference) */
     virtual void setViewport() = 0;
@@ -94,7 +126,152 @@ struct FrameBuffer : Destroyable, Binder::Target {
     virtual int getId() const = 0;
     virtual int getTextureId() const = 0;
 
+    /**
+     * True if the whole texture can be bound as an image for compute shader
+     * image stores. False for the screen, ROIs, multiple render targets,
+     * external frame buffers and formats without image load/store support
+     */
+    virtual bool supportsImageStore() const = 0;
+    /** Bind the texture to the given image unit (write only) */
+    virtual void bindImageTexture(unsigned unit) = 0;
+};
+
+/**
+ * Frame buffer object for rendering to the textures of several frame
+ * buffers at once (multiple render targets). Cannot be read or written
+ */
+struct MultiTargetFrameBuffer : FrameBuffer {
+    static std::unique_ptr<MultiTargetFrameBuffer> create();
+    /**
+     * (Re)attach the textures of the given frame buffers, which must have
+     * the same size, to GL_COLOR_ATTACHMENT0 ... n-1
+     */
+    virtual void setTargets(FrameBuffer **targets, int n) = 0;
+};
+
+/**
+ * GL sync object for ordering commands between two contexts that share
+ * objects: insert() in one GL thread, then gpuWait() in the other makes the
+ * GPU wait for the commands issued before the fence without blocking the
+ * CPU. destroy() deletes the sync object and can be called in either thread
+ */
+struct CrossContextFence : Destroyable {
+    /** Insert a fence after the commands issued so far (and flush) */
+    static std::unique_ptr<CrossContextFence> insert();
+    virtual void gpuWait() = 0;
+};
+
+/**
+ * Asynchronous frame buffer reads through a ring of pixel pack buffers
+ * (PBOs). glReadPixels into a PBO returns without waiting for the GPU.
+ * The data is copied to the target CPU memory later, after a fence has
+ * been signaled. All methods must be called from the OpenGL thread.
+ */
+struct PixelPackRing : Destroyable {
+    struct Read {
+        /** set when the data has been copied to the target memory */
+        std::atomic<bool> done { false };
+    };
+
+    static std::unique_ptr<PixelPackRing> create(int nBuffers);
+
+    /**
+     * Start reading the frame buffer to the given memory, whose rows are
+     * rowPitch bytes apart (0 = tightly packed). If all buffers are in use,
+     * first waits for the oldest read to complete.
+     */
+    virtual std::shared_ptr<Read> startRead(FrameBuffer &fb, std::uint8_t *pixels, std::size_t size, std::size_t rowPitch) = 0;
+    /** Wait for the given read to complete (if not done already) */
+    virtual void finishRead(const Read &read) = 0;
+    /** Finish all complete reads, without blocking */
+    virtual void poll() = 0;
+};
+
+/**
+ * Texture uploads through a ring of pixel unpack buffers. The data is
+ * copied to a mapped buffer and the texture is updated from there, so the
+ * driver does not need to wait for the GPU to finish with the texture.
+ * Must be used from the OpenGL thread.
+ */
+struct PixelUnpackRing : Destroyable {
+    static std::unique_ptr<PixelUnpackRing> create(int nBuffers);
+    /** size is the tightly packed size, rowPitch as in startRead */
+    virtual void write(FrameBuffer &fb, const std::uint8_t *pixels, std::size_t size, std::size_t rowPitch) = 0;
+};
+
+/**
+ * GL sync objects that track when the GPU has actually executed the
+ * commands issued before them. Must be used from the OpenGL thread, except
+ * for Fence::signaled, which can be read from any thread.
+ */
+struct FenceTracker : Destroyable {
+    struct Fence {
+        std::atomic<bool> signaled { false };
+    };
+
+    static std::unique_ptr<FenceTracker> create();
+
+    /** Insert a fence after the commands issued so far (and flush) */
+    virtual void insert(const std::shared_ptr<Fence> &fence) = 0;
+    /** Update the status of all pending fences, without blocking */
+    virtual void poll() = 0;
+    /** Wait until the fence is signaled or the timeout expires */
+    virtual bool wait(const Fence &fence, std::chrono::nanoseconds timeout) = 0;
+};
+
+/**
+ * GPU timer queries (GL_TIME_ELAPSED) whose results are collected
+ * asynchronously. Must be used from the OpenGL thread. Only one timing
+ * can be active at a time.
+ */
+struct TimerQueries : Destroyable {
+    static std::unique_ptr<TimerQueries> create();
+
+    /** False if timer queries are not supported (e.g., OpenGL ES w/o EXT_disjoint_timer_query) */
+    virtual bool isSupported() const = 0;
+    /** Start timing the following GL commands, if supported */
+    virtual void begin(int tag) = 0;
+    virtual void end() = 0;
+    /** Report the elapsed times of all the finished timings, without blocking */
+    virtual void poll(const std::function<void(int tag, double gpuMilliseconds)> &callback) = 0;
+};
+
+/** See setStateCaching etc. in operations.hpp */
+namespace glState {
+void setCaching(bool enabled);
+void invalidate();
+void setPerOperationErrorChecks(bool enabled);
+}
+
+/**
+ * Process-wide cache of linked GL programs, keyed by the GL context and
+ * the shader sources (which include the input and output types). Programs
+ * are shared by reference counting: GlslProgram::destroy only deletes the
+ * GL program when no other GlslProgram uses it. Must be used from the
+ * OpenGL thread(s).
+ */
+namespace programCache {
+/** See opengl::setCurrentContext (operations.hpp) */
+void setCurrentContext(const void *context);
+/**
+ * Forget the programs of a destroyed or lost context (without deleting
+ * them) and the tracked GL state. The current context by default
+ */
+void forgetContext(const void *context = nullptr);
+/**
+ * Directory for storing program binaries (glGetProgramBinary). Empty
+ * (the default) disables persistence
+ */
+void setBinaryDirectory(const std::string &directory);
+
+struct Stats {
+    int programs = 0;
+    int hits = 0;
+    int compiled = 0;
+    int loadedBinaries = 0;
 };
+Stats getStats();
+}
 
 struct GlslProgram : Destroyable, Binder::Target {
     static std::unique_ptr<GlslProgram> create(
@@ -126,6 +303,15 @@ struct GlslPipeline : GlslFragmentShader {
         const std::vector<ImageTypeSpec> &inputs,
         const ImageTypeSpec &output);
 
+    /**
+     * Shader with several outputs, outValue1, outValue2, ..., at locations
+     * 0, 1, ... Must be called with a MultiTargetFrameBuffer
+     */
+    static std::unique_ptr<GlslPipeline> create(
+        const char *fragmentMain,
+        const std::vector<ImageTypeSpec> &inputs,
+        const std::vector<ImageTypeSpec> &outputs);
+
     virtual Binder::Target &bindTexture(unsigned index, int textureId) = 0;
 
     // Note: different from how OpenGL works as the texture parameters are
@@ -136,5 +322,44 @@ struct GlslPipeline : GlslFragmentShader {
     virtual void setTextureBorder(unsigned index, ::accelerated::Image::Border b) = 0;
 };
 
+/**
+ * Compute shader (OpenGL ES 3.1 / OpenGL 4.3) with N input textures named
+ * as in GlslPipeline and one output image, u_output, which is written with
+ * imageStore. u_outSize is set to the size of the output.
+ */
+struct GlslComputeShader : GlslProgram {
+    /** If the current GL context supports compute shaders */
+    static bool isSupported();
+
+    static std::unique_ptr<GlslComputeShader> create(
+        const char *computeMain,
+        const std::vector<ImageTypeSpec> &inputs,
+        const ImageTypeSpec &output,
+        int localSizeX,
+        int localSizeY);
+
+    virtual Binder::Target &bindTexture(unsigned index, int textureId) = 0;
+    virtual void setTextureInterpolation(unsigned index, ::accelerated::Image::Interpolation i) = 0;
+    virtual void setTextureBorder(unsigned index, ::accelerated::Image::Border b) = 0;
+
+    /**
+     * Run groupsX x groupsY work groups. The output must support image
+     * stores. Followed by a memory barrier, so that the results are visible
+     * to all later GL commands
+     */
+    virtual void dispatch(FrameBuffer &output, int groupsX, int groupsY) = 0;
+
+    virtual std::string getComputeShaderSource() const = 0;
+};
+
+/** Shader storage buffer (SSBO) for compute shaders */
+struct ShaderStorageBuffer : Destroyable {
+    /** Zero-initialized buffer of the given size in bytes */
+    static std::unique_ptr<ShaderStorageBuffer> create(std::size_t size);
+    virtual std::size_t size() const = 0;
+    /** glBindBufferBase to the given binding point */
+    virtual void bind(unsigned index) = 0;
+};
+
 }
 }
@@ -0,0 +1,96 @@
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "egl.hpp"
+#include "../assert.hpp"
+#include "../log.hpp"
+
+namespace accelerated {
+namespace opengl {
+namespace egl {
+namespace {
+template <class F> F getProc(const char *name) {
+    auto f = reinterpret_cast<F>(eglGetProcAddress(name));
+    if (!f) log_warn("EGL function %s not available", name);
+    return f;
+}
+
+EGLDisplay currentDisplay() {
+    EGLDisplay display = eglGetCurrentDisplay();
+    aa_assert(display != EGL_NO_DISPLAY && "no current EGL context in this thread");
+    return display;
+}
+
+void *createImage(EGLContext context, EGLenum target, EGLClientBuffer buffer, const EGLint *attributes) {
+    static const auto createImageKHR = getProc<PFNEGLCREATEIMAGEKHRPROC>("eglCreateImageKHR");
+    aa_assert(createImageKHR && "EGL_KHR_image_base not supported");
+    EGLImageKHR image = createImageKHR(currentDisplay(), context, target, buffer, attributes);
+    if (image == EGL_NO_IMAGE_KHR) {
+        log_error("eglCreateImageKHR failed: 0x%x", eglGetError());
+        aa_assert(false && "failed to create EGLImage");
+    }
+    return image;
+}
+}
+
+void *importDmaBuf(const DmaBuf &buffer) {
+    aa_assert(buffer.fd >= 0 && buffer.width > 0 && buffer.height > 0);
+    const EGLint attributes[] = {
+        EGL_WIDTH, buffer.width,
+        EGL_HEIGHT, buffer.height,
+        EGL_LINUX_DRM_FOURCC_EXT, EGLint(buffer.drmFourcc),
+        EGL_DMA_BUF_PLANE0_FD_EXT, buffer.fd,
+        EGL_DMA_BUF_PLANE0_OFFSET_EXT, buffer.offset,
+        EGL_DMA_BUF_PLANE0_PITCH_EXT, buffer.stride,
+        EGL_NONE
+    };
+    // the context must be EGL_NO_CONTEXT for dmabufs
+    return createImage(EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, attributes);
+}
+
+void *importHardwareBuffer(const AHardwareBuffer *buffer) {
+    aa_assert(buffer);
+    static const auto getNativeClientBuffer =
+        getProc<PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC>("eglGetNativeClientBufferANDROID");
+    aa_assert(getNativeClientBuffer && "EGL_ANDROID_get_native_client_buffer not supported");
+    const EGLint attributes[] = { EGL_IMAGE_PRESERVED_KHR, EGL_TRUE, EGL_NONE };
+    return createImage(EGL_NO_CONTEXT, EGL_NATIVE_BUFFER_ANDROID, getNativeClientBuffer(buffer), attributes);
+}
+
+void *createImageFromTexture(int textureId) {
+    aa_assert(textureId > 0);
+    const EGLint attributes[] = { EGL_IMAGE_PRESERVED_KHR, EGL_TRUE, EGL_NONE };
+    return createImage(eglGetCurrentContext(), EGL_GL_TEXTURE_2D_KHR,
+        reinterpret_cast<EGLClientBuffer>(static_cast<std::intptr_t>(textureId)), attributes);
+}
+
+bool exportDmaBuf(void *eglImage, DmaBuf &buffer) {
+    static const auto query = getProc<PFNEGLEXPORTDMABUFIMAGEQUERYMESAPROC>("eglExportDMABUFImageQueryMESA");
+    static const auto exportImage = getProc<PFNEGLEXPORTDMABUFIMAGEMESAPROC>("eglExportDMABUFImageMESA");
+    if (!query || !exportImage) return false;
+
+    const EGLDisplay display = currentDisplay();
+    int fourcc = 0, planes = 0;
+    if (!query(display, eglImage, &fourcc, &planes, nullptr)) return false;
+    if (planes != 1) {
+        log_warn("cannot export a dmabuf with %d planes", planes);
+        return false;
+    }
+    int fd = -1;
+    EGLint stride = 0, offset = 0;
+    if (!exportImage(display, eglImage, &fd, &stride, &offset)) return false;
+    buffer.fd = fd;
+    buffer.drmFourcc = std::uint32_t(fourcc);
+    buffer.stride = stride;
+    buffer.offset = offset;
+    return true;
+}
+
+void destroyImage(void *eglImage) {
+    static const auto destroyImageKHR = getProc<PFNEGLDESTROYIMAGEKHRPROC>("eglDestroyImageKHR");
+    aa_assert(destroyImageKHR);
+    if (eglImage != nullptr) destroyImageKHR(currentDisplay(), eglImage);
+}
+}
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+struct AHardwareBuffer;
+
+namespace accelerated {
+namespace opengl {
+/**
+ * Zero-copy buffer sharing through EGLImages in OpenGL ES builds (Android
+ * and Linux with EGL). The EGLImage handles are passed as void* so that
+ * this header does not depend on the EGL headers. Wrap the imported images
+ * with opengl::Image::Factory::wrapEglImage. All functions must be called
+ * in the OpenGL thread, and each EGLImage must be destroyed with
+ * destroyImage after the opengl::Images that use it.
+ */
+namespace egl {
+/** Single-plane Linux dmabuf, see drm_fourcc.h for the formats */
+struct DmaBuf {
+    int fd = -1;
+    int width = 0;
+    int height = 0;
+    std::uint32_t drmFourcc = 0;
+    int stride = 0; // in bytes
+    int offset = 0;
+};
+
+/** Import a dmabuf (EGL_EXT_image_dma_buf_import). The fd is not closed */
+void *importDmaBuf(const DmaBuf &buffer);
+
+/**
+ * Import an Android hardware buffer (EGL_ANDROID_get_native_client_buffer),
+ * which should be allocated with AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE
+ * and, for output images, AHARDWAREBUFFER_USAGE_GPU_COLOR_OUTPUT. Writing
+ * to such an image "exports" it, e.g., to a video encoder, without copies
+ */
+void *importHardwareBuffer(const AHardwareBuffer *buffer);
+
+/**
+ * EGLImage referencing an existing texture (EGL_KHR_gl_texture_2D_image),
+ * e.g., opengl::Image::getTextureId() of an output image, for exportDmaBuf
+ */
+void *createImageFromTexture(int textureId);
+
+/**
+ * Export an EGLImage as a single-plane dmabuf (EGL_MESA_image_dma_buf_export).
+ * Sets fd, drmFourcc, stride and offset, and the caller owns the fd.
+ * Returns false if not supported
+ */
+bool exportDmaBuf(void *eglImage, DmaBuf &buffer);
+
+void destroyImage(void *eglImage);
+}
+}
+}
@@ -2,6 +2,7 @@
 #include "adapters.hpp"
 #include "../assert.hpp"
 #include "../log.hpp"
+#include "../tracing.hpp"
 
 #if defined(__APPLE__)
 #define GLFW_INCLUDE_GLCOREARB // Select gl3.h within glfw3.h
@@ -12,9 +13,20 @@
 namespace accelerated {
 namespace opengl {
 namespace {
+void setContextHints() {
+    #ifdef __APPLE__
+    // We need to explicitly ask for specific version context on OS X
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    #endif
+}
+
 struct GLFWProcessor : Processor {
     std::unique_ptr<Processor> processor;
     GLFWwindow *window = nullptr;
+    bool async = false;
 
     GLFWProcessor(bool visible, int w, int h, const char *t, GLFWwindow **windowOut, GLFWProcessorMode mode) {
         if (mode == GLFWProcessorMode::AUTO) {
@@ -37,6 +49,7 @@ struct GLFWProcessor : Processor {
         #endif
             log_debug("Initializing GLFW processor with its own thread");
             processor = Processor::createThreadPool(1);
+            async = true;
             break;
         default:
             aa_assert(false);
@@ -50,18 +63,12 @@ struct GLFWProcessor : Processor {
         processor->enqueue([this, w, h, title, visible, windowOut]() {
             if (glfwInit()) {
                 if (!visible) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
-
-                #ifdef __APPLE__
-                // We need to explicitly ask for specific version context on OS X
-                glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-                glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-                glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-                glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-                #endif
+                setContextHints();
 
                 window = glfwCreateWindow(w, h, title.c_str(), NULL, NULL);
                 if (!window) glfwTerminate();
                 log_debug("GLFWProcessor initialized window");
+                if (async) tracing::setThreadName("GL");
                 if (windowOut != nullptr) {
                     log_debug("setting window reference");
                     *windowOut = window;
@@ -73,6 +80,7 @@ struct GLFWProcessor : Processor {
     ~GLFWProcessor() {
         processor->enqueue([this]() {
             if (window) {
+                programCache::forgetContext(window);
                 glfwDestroyWindow(window);
                 glfwTerminate();
                 log_debug("GLFWProcessor destroyed window");
@@ -87,10 +95,56 @@ struct GLFWProcessor : Processor {
             // not which of these are really required. It might be slow
             // to call them after each operation
             glfwMakeContextCurrent(window);
+            programCache::setCurrentContext(window);
             op();
             glfwPollEvents();
         });
     }
+
+    QueueStats getQueueStats() final {
+        return processor->getQueueStats();
+    }
+};
+
+// hidden window whose context shares objects with the main window. Only
+// used for transfers, which do not need events or a visible surface
+struct GLFWTransferProcessor : Processor {
+    std::unique_ptr<Processor> processor;
+    GLFWwindow *window = nullptr;
+
+    GLFWTransferProcessor(GLFWProcessor &main) {
+        aa_assert(main.async && "transfer processor requires GLFWProcessorMode::ASYNC");
+        GLFWwindow *mainWindow = nullptr;
+        main.processor->enqueue([&main, &mainWindow]() { mainWindow = main.window; }).wait();
+        aa_assert(mainWindow && "GLFW window was not created");
+
+        log_debug("Initializing GLFW transfer processor with its own thread");
+        processor = Processor::createThreadPool(1);
+        processor->enqueue([this, mainWindow]() {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            setContextHints();
+            window = glfwCreateWindow(1, 1, "accelerated-arrays transfers", NULL, mainWindow);
+            aa_assert(window && "failed to create a shared GLFW context");
+            log_debug("GLFWTransferProcessor initialized shared context");
+            tracing::setThreadName("GL transfers");
+        }).wait();
+    }
+
+    ~GLFWTransferProcessor() {
+        processor->enqueue([this]() {
+            programCache::forgetContext(window);
+            glfwDestroyWindow(window);
+            log_debug("GLFWTransferProcessor destroyed shared context");
+        }).wait();
+    }
+
+    Future enqueue(const std::function<void()> &op) final {
+        return processor->enqueue([this, op]() {
+            glfwMakeContextCurrent(window);
+            programCache::setCurrentContext(window);
+            op();
+        });
+    }
 };
 
 constexpr int DEFAULT_W = 640;
@@ -101,6 +155,12 @@ std::unique_ptr<Processor> createGLFWProcessor(GLFWProcessorMode mode) {
     return std::unique_ptr<Processor>(new GLFWProcessor(false, DEFAULT_W, DEFAULT_H, nullptr, nullptr, mode));
 }
 
+std::unique_ptr<Processor> createGLFWTransferProcessor(Processor &glfwProcessor) {
+    auto *main = dynamic_cast<GLFWProcessor*>(&glfwProcessor);
+    aa_assert(main && "not a GLFW processor");
+    return std::unique_ptr<Processor>(new GLFWTransferProcessor(*main));
+}
+
 std::unique_ptr<Processor> createGLFWWindow(int w, int h, const char *title, GLFWProcessorMode mode, void **window) {
     return std::unique_ptr<Processor>(new GLFWProcessor(true, w, h, title, reinterpret_cast<GLFWwindow**>(window), mode));
 }
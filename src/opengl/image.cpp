@@ -1,6 +1,10 @@
 #include <atomic>
 #include <cassert>
+#include <future>
+#include <list>
 #include <mutex>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
 
 #include "adapters.hpp"
@@ -61,6 +65,16 @@ public:
         return Future({});
     }
 
+    Future readRaw(std::uint8_t *outputData, std::size_t rowPitch) final {
+        (void)rowPitch;
+        return readRaw(outputData);
+    }
+
+    Future writeRaw(const std::uint8_t *inputData, std::size_t rowPitch) final {
+        (void)rowPitch;
+        return writeRaw(inputData);
+    }
+
     bool supportsDirectRead() const final {
         return false;
     }
@@ -83,6 +97,229 @@ public:
     }
 };
 
+// Resolved when the data has been copied from the pixel pack buffer. This
+// happens in the GL thread, either opportunistically or on wait(). If waited
+// in the GL thread itself (e.g., in a continuation), the data is mapped
+// inline instead of enqueuing work behind the current task
+struct AsyncReadState : Future::State, std::enable_shared_from_this<AsyncReadState> {
+    Processor &processor;
+    Future issued;
+    // set in the GL thread, before issued resolves
+    std::shared_ptr<PixelPackRing> ring;
+    std::shared_ptr<PixelPackRing::Read> read;
+    std::atomic<std::thread::id> glThread;
+
+    std::shared_ptr<std::atomic<bool>> pollPending;
+
+    AsyncReadState(Processor &p, std::thread::id glThread) :
+        processor(p), issued(std::shared_ptr<Future::State>()), glThread(glThread),
+        pollPending(std::make_shared<std::atomic<bool>>(false))
+    {}
+
+    bool inGlThread() const {
+        return std::this_thread::get_id() == glThread.load();
+    }
+
+    void wait() final {
+        const bool inGl = inGlThread();
+        aa_assert((!inGl || issued.isReady()) && "waiting for a read enqueued after the current GL task (deadlock)");
+        issued.wait();
+        if (!read || read->done) return;
+        if (inGl) {
+            ring->finishRead(*read);
+            return;
+        }
+        auto r = read;
+        auto pboRing = ring;
+        ScopedUnboundedEnqueue unbounded;
+        processor.enqueue([pboRing, r]() { pboRing->finishRead(*r); }).wait();
+    }
+
+    bool waitFor(std::chrono::nanoseconds timeout) final {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        if (!issued.waitFor(timeout)) return false;
+        if (!read || read->done) return true;
+        // polls (instead of finishRead) so that the GL thread is not blocked
+        // after the deadline
+        auto pboRing = ring;
+        const bool inGl = inGlThread();
+        for (auto now = std::chrono::steady_clock::now(); now < deadline; now = std::chrono::steady_clock::now()) {
+            if (inGl) {
+                pboRing->poll();
+                if (!read->done) std::this_thread::yield();
+            } else {
+                ScopedUnboundedEnqueue unbounded;
+                processor.enqueue([pboRing]() { pboRing->poll(); }).waitFor(deadline - now);
+            }
+            if (read->done) return true;
+        }
+        return read->done;
+    }
+
+    bool isReady() final {
+        if (!issued.isReady()) return false;
+        if (!read || read->done) return true;
+        if (inGlThread()) {
+            ring->poll();
+            return read->done;
+        }
+        // at most one pending poll per read
+        if (!pollPending->exchange(true)) {
+            auto pboRing = ring;
+            auto pending = pollPending;
+            ScopedUnboundedEnqueue unbounded;
+            processor.enqueue([pboRing, pending]() {
+                pboRing->poll();
+                *pending = false;
+            });
+        }
+        return false;
+    }
+
+    // the callback is called in the GL thread
+    void onReady(const std::function<void()> &callback) final {
+        auto self = shared_from_this();
+        issued.state->onReady([self, callback]() {
+            if (!self->read || self->read->done) {
+                callback();
+                return;
+            }
+            auto r = self->read;
+            auto pboRing = self->ring;
+            ScopedUnboundedEnqueue unbounded;
+            self->processor.enqueue([pboRing, r, callback]() {
+                pboRing->finishRead(*r);
+                callback();
+            });
+        });
+    }
+};
+
+// Recycles the frame buffers (and textures) of destroyed images. Used in
+// the GL thread, except for getStats
+class FrameBufferPool {
+private:
+    // determines the texture internal format and the CPU transfer format
+    typedef std::tuple<int, int, int, ImageTypeSpec::DataType> Key;
+    struct Unused {
+        Key key;
+        std::shared_ptr<FrameBuffer> frameBuffer;
+        std::size_t bytes;
+    };
+
+    mutable std::mutex mutex;
+    // most recently released first
+    std::list<Unused> unused;
+    std::unordered_map<const FrameBuffer*, std::pair<Key, std::size_t> > inUse;
+    const std::size_t maxPooledBytes;
+    Image::PooledFactory::Stats stats;
+
+    void evict(std::size_t maxBytes) {
+        while (stats.pooledBytes > maxBytes) {
+            auto &lru = unused.back();
+            LOG_TRACE("evicting pooled frame buffer %d", lru.frameBuffer->getId());
+            lru.frameBuffer->destroy();
+            stats.pooledBytes -= lru.bytes;
+            stats.pooledBuffers--;
+            unused.pop_back();
+        }
+    }
+
+public:
+    FrameBufferPool(std::size_t maxPooledBytes) : maxPooledBytes(maxPooledBytes) {}
+
+    std::shared_ptr<FrameBuffer> acquire(int w, int h, const ImageTypeSpec &spec) {
+        const Key key(w, h, spec.channels, spec.dataType);
+        const std::size_t bytes = std::size_t(w) * h * spec.bytesPerPixel();
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<FrameBuffer> fb;
+        for (auto it = unused.begin(); it != unused.end(); ++it) {
+            if (it->key == key) {
+                fb = it->frameBuffer;
+                stats.pooledBytes -= it->bytes;
+                stats.pooledBuffers--;
+                unused.erase(it);
+                break;
+            }
+        }
+        if (fb) {
+            stats.hits++;
+        } else {
+            stats.misses++;
+            fb = FrameBuffer::create(w, h, spec);
+        }
+        stats.bytesInUse += bytes;
+        inUse[fb.get()] = std::make_pair(key, bytes);
+        return fb;
+    }
+
+    /** Returns false if the frame buffer is not from this pool */
+    bool release(const std::shared_ptr<FrameBuffer> &fb) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = inUse.find(fb.get());
+        if (it == inUse.end()) return false;
+        const std::size_t bytes = it->second.second;
+        unused.push_front({ it->second.first, fb, bytes });
+        inUse.erase(it);
+        stats.bytesInUse -= bytes;
+        stats.pooledBytes += bytes;
+        stats.pooledBuffers++;
+        evict(maxPooledBytes);
+        return true;
+    }
+
+    void releaseUnused() {
+        std::lock_guard<std::mutex> lock(mutex);
+        evict(0);
+    }
+
+    Image::PooledFactory::Stats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+};
+
+// A read or write in the transfer processor. The main GL thread waits for
+// it before the image is used next
+struct PendingTransfer {
+    Future done;
+    // set in the transfer thread before done resolves
+    std::shared_ptr<CrossContextFence> fence;
+
+    PendingTransfer() : done(std::shared_ptr<Future::State>()) {}
+};
+
+// Shared with the GL thread tasks, which may outlive the FrameBufferManager
+class PendingTransfers {
+private:
+    std::mutex mutex;
+    std::unordered_map<const void*, std::vector< std::shared_ptr<PendingTransfer> > > transfers;
+
+public:
+    void add(const void *ref, const std::shared_ptr<PendingTransfer> &transfer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        transfers[ref].push_back(transfer);
+    }
+
+    /** Called in the GL thread before the image is used */
+    void sync(const void *ref) {
+        std::vector< std::shared_ptr<PendingTransfer> > pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = transfers.find(ref);
+            if (it == transfers.end()) return;
+            pending.swap(it->second);
+            transfers.erase(it);
+        }
+        for (auto &transfer : pending) {
+            transfer->done.wait();
+            if (!transfer->fence) continue;
+            transfer->fence->gpuWait();
+            transfer->fence->destroy();
+        }
+    }
+};
+
 class FrameBufferManager {
 public:
     class Reference;
@@ -90,17 +327,127 @@ public:
 private:
     std::mutex mutex;
     std::unordered_map<const Reference*, std::shared_ptr<FrameBuffer> > frameBuffers;
+    // frame buffer objects in the transfer context, used in the transfer thread
+    std::unordered_map<const Reference*, std::shared_ptr<FrameBuffer> > transferFrameBuffers;
+    const std::shared_ptr<PendingTransfers> pendingTransfers = std::make_shared<PendingTransfers>();
     std::unique_ptr<operations::Factory> converterFactory;
+    // created and used in the GL thread
+    std::shared_ptr<PixelPackRing> readRing;
+    std::shared_ptr<PixelUnpackRing> uploadRing;
+    // the thread that last ran a task of this manager (see AsyncReadState)
+    std::atomic<std::thread::id> glThread;
 
 public:
     Processor &processor;
     Image::Factory &imageFactory;
+    const Image::FactoryOptions options;
+    // null if not pooled
+    const std::shared_ptr<FrameBufferPool> pool;
+
+    FrameBufferManager(Processor &p, Image::Factory &imageFactory, const Image::FactoryOptions &options, std::shared_ptr<FrameBufferPool> pool)
+    : converterFactory(operations::createFactory(p)), processor(p), imageFactory(imageFactory),
+      options(options), pool(pool)
+    {}
+
+    ~FrameBufferManager() {
+        // the cleanup must not be rejected by a bounded queue
+        ScopedUnboundedEnqueue unbounded;
+        // the queued transfers use this object: wait for them
+        if (options.transferProcessor) options.transferProcessor->enqueue([this]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto &it : transferFrameBuffers) it.second->destroy();
+            transferFrameBuffers.clear();
+        }).wait();
+
+        std::shared_ptr<PixelPackRing> rr;
+        std::shared_ptr<PixelUnpackRing> ur;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            rr = readRing;
+            ur = uploadRing;
+        }
+        auto p = pool;
+        if (rr || ur || p) processor.enqueue([rr, ur, p]() {
+            if (rr) rr->destroy();
+            if (ur) ur->destroy();
+            if (p) p->releaseUnused();
+        });
+    }
+
+    Future enqueueUpload(const Reference *ref, const std::uint8_t *inputData, std::size_t size, std::size_t rowPitch) {
+        return enqueue(ref, [this, inputData, size, rowPitch](FrameBuffer &fb) {
+            std::shared_ptr<PixelUnpackRing> ring;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!uploadRing) {
+                    LOG_TRACE("creating a ring of %d pixel unpack buffers", options.uploadBuffers);
+                    uploadRing = PixelUnpackRing::create(options.uploadBuffers);
+                }
+                ring = uploadRing;
+            }
+            ring->write(fb, inputData, size, rowPitch);
+        });
+    }
 
-    FrameBufferManager(Processor &p, Image::Factory &imageFactory)
-    : converterFactory(operations::createFactory(p)), processor(p), imageFactory(imageFactory) {}
+    Future enqueueAsyncRead(const Reference *ref, std::uint8_t *outputData, std::size_t size, std::size_t rowPitch) {
+        auto state = std::make_shared<AsyncReadState>(processor, glThread.load());
+        state->issued = enqueue(ref, [this, state, outputData, size, rowPitch](FrameBuffer &fb) {
+            state->glThread = std::this_thread::get_id();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!readRing) {
+                    LOG_TRACE("creating a ring of %d pixel pack buffers", options.asyncReadBuffers);
+                    readRing = PixelPackRing::create(options.asyncReadBuffers);
+                }
+                state->ring = readRing;
+            }
+            state->read = readRing->startRead(fb, outputData, size, rowPitch);
+        });
+        return Future(state);
+    }
+
+    /**
+     * Run f in the transfer processor after the operations enqueued so far:
+     * a fence is inserted in the GL thread (in order), and the transfer
+     * thread makes the GPU wait for it. The transfer is registered for
+     * syncTransfers at the same point, so that the earlier operations never
+     * wait for it
+     */
+    Future enqueueTransfer(const Reference *ref, const std::function<void(FrameBuffer &)> &f) {
+        auto pending = std::make_shared<PendingTransfer>();
+        auto before = std::make_shared< std::promise< std::shared_ptr<CrossContextFence> > >();
+        std::shared_future< std::shared_ptr<CrossContextFence> > issued = before->get_future().share();
+
+        pending->done = options.transferProcessor->enqueue([this, ref, f, issued, pending]() {
+            auto fence = issued.get();
+            fence->gpuWait();
+            fence->destroy();
+            auto fb = getTransferFrameBuffer(ref);
+            if (!fb) return;
+            f(*fb);
+            pending->fence = CrossContextFence::insert();
+            checkOperationErrors("transfer");
+        });
+
+        auto registry = pendingTransfers;
+        // the transfer waits for this fence
+        ScopedUnboundedEnqueue unbounded;
+        processor.enqueue([registry, ref, before, pending]() {
+            registry->add(ref, pending);
+            before->set_value(CrossContextFence::insert());
+        });
+        return pending->done;
+    }
+
+    /** Called in the GL thread before the image is used */
+    void syncTransfers(const Reference *ref) {
+        if (options.transferProcessor == nullptr) return;
+        pendingTransfers->sync(ref);
+    }
 
     Future enqueue(const Reference *ref, const std::function<void(FrameBuffer &)> &f) {
         return processor.enqueue([this, f, ref]() {
+            glThread = std::this_thread::get_id();
             std::shared_ptr<FrameBuffer> buf;
             {
                 std::lock_guard<std::mutex> lock(mutex);
@@ -111,6 +458,7 @@ public:
                 buf = frameBuffers.at(ref);
             }
             f(*buf);
+            checkOperationErrors("frame buffer operation");
         });
     }
 
@@ -118,8 +466,11 @@ public:
         // easier to implement with shared_ptr in the argument, even if it
         // "should" be unique_ptr and the Reference ctor effectively transfers
         // the ownership here
+        ScopedUnboundedEnqueue unbounded;
         processor.enqueue([this, ref, builder]() {
+            glThread = std::this_thread::get_id();
             auto fb = builder();
+            checkOperationErrors("frame buffer creation");
             if (fb) {
                 std::lock_guard<std::mutex> lock(mutex);
                 aa_assert(!frameBuffers.count(ref));
@@ -143,8 +494,28 @@ public:
             frameBuffers.erase(ref);
         }
 
-        processor.enqueue([buf, ref]() {
-            buf->destroy();
+        std::shared_ptr<FrameBuffer> transferBuf;
+        if (options.transferProcessor) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = transferFrameBuffers.find(ref);
+            if (it != transferFrameBuffers.end()) {
+                transferBuf = it->second;
+                transferFrameBuffers.erase(it);
+            }
+        }
+        ScopedUnboundedEnqueue unbounded;
+        Future transferBufDestroyed = Future::instantlyResolved();
+        if (transferBuf) transferBufDestroyed = options.transferProcessor->enqueue([transferBuf]() { transferBuf->destroy(); });
+
+        auto p = pool;
+        std::shared_ptr<PendingTransfers> transfers;
+        if (options.transferProcessor) transfers = pendingTransfers;
+        processor.enqueue([buf, ref, p, transfers, transferBufDestroyed]() mutable {
+            // the texture may be recycled only after the transfers
+            if (transfers) transfers->sync(ref);
+            // the shared texture is deleted by its last user
+            transferBufDestroyed.wait();
+            if (!p || !p->release(buf)) buf->destroy();
             (void)ref;
             LOG_TRACE("frame buffer for reference %p destroyed", (void*)ref);
         });
@@ -154,12 +525,24 @@ public:
         std::lock_guard<std::mutex> lock(mutex);
         return frameBuffers.at(ref);
     }
+
+    // in the transfer thread, created on first use
+    std::shared_ptr<FrameBuffer> getTransferFrameBuffer(const Reference *ref) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!frameBuffers.count(ref)) {
+            log_warn("no reference %p found in transfer (already destroyed?)", (void*)ref);
+            return {};
+        }
+        auto &fb = transferFrameBuffers[ref];
+        if (!fb) fb = frameBuffers.at(ref)->createSharedContextReference();
+        return fb;
+    }
 };
 
 class FrameBufferManager::Reference : public ImplementationBase {
 private:
     std::weak_ptr<FrameBufferManager> manager;
-    std::function<Future(std::uint8_t*)> readAdpater;
+    std::function<Future(std::uint8_t*, std::size_t)> readAdpater;
 
 public:
     Reference(int w, int h, const ImageTypeSpec &spec, std::weak_ptr<FrameBufferManager> man, std::unique_ptr<FrameBuffer> existing)
@@ -170,12 +553,25 @@ public:
         auto m = manager.lock();
         aa_assert(m);
         LOG_TRACE("created buffer reference %p", (void*)this);
-        m->addFrameBuffer(this, [w, h, s, fb]() {
+        auto pool = m->pool;
+        m->addFrameBuffer(this, [w, h, s, fb, pool]() {
             if (fb) return fb;
+            if (pool) return pool->acquire(w, h, s);
             return std::shared_ptr<FrameBuffer>(FrameBuffer::create(w, h, s));
         });
     }
 
+    // the frame buffer is created by the builder in the GL thread (never pooled)
+    Reference(int w, int h, const ImageTypeSpec &spec, std::weak_ptr<FrameBufferManager> man,
+        const std::function<std::shared_ptr<FrameBuffer>()> &builder)
+    : ImplementationBase(w, h, spec), manager(man)
+    {
+        auto m = manager.lock();
+        aa_assert(m);
+        LOG_TRACE("created buffer reference %p", (void*)this);
+        m->addFrameBuffer(this, builder);
+    }
+
     // ROI
     Reference(int x0, int y0, int w, int h, std::weak_ptr<FrameBufferManager> man, Reference &existing)
     : ImplementationBase(w, h, existing), manager(man)
@@ -207,11 +603,21 @@ public:
     int getTextureId() const final {
         auto m = const_cast<Reference&>(*this).manager.lock();
         aa_assert(m && "frame buffer manager destroyed");
+        m->syncTransfers(this);
         // TODO: not optimal
         return m->getFrameBuffer(this)->getTextureId();
     }
 
     Future readRaw(std::uint8_t *outputData) final {
+        return readRaw(outputData, width * bytesPerPixel());
+    }
+
+    Future writeRaw(const std::uint8_t *inputData) final {
+        return writeRaw(inputData, width * bytesPerPixel());
+    }
+
+    Future readRaw(std::uint8_t *outputData, std::size_t rowPitch) final {
+        aa_assert(rowPitch >= width * bytesPerPixel());
         auto m = manager.lock();
         aa_assert(m && "frame buffer manager destroyed");
         if (!supportsDirectRead()) {
@@ -219,25 +625,33 @@ public:
                 log_warn("frame buffer ref %p does not support direct read, trying to create adapter buffer", (void*)this);
                 readAdpater = createReadAdpater(
                     *this,
-                    m->processor,
                     m->imageFactory,
                     *m->converterFactory);
             }
-            return readAdpater(outputData);
+            return readAdpater(outputData, rowPitch);
         }
         LOG_TRACE("reading frame buffer reference %p", (void*)this);
-        return m->enqueue(this, [outputData](FrameBuffer &fb) {
-            fb.readPixels(outputData);
+        if (m->options.transferProcessor) return m->enqueueTransfer(this, [outputData, rowPitch](FrameBuffer &fb) {
+            fb.readPixels(outputData, rowPitch);
+        });
+        if (m->options.asyncReadBuffers > 0) return m->enqueueAsyncRead(this, outputData, size(), rowPitch);
+        return m->enqueue(this, [outputData, rowPitch](FrameBuffer &fb) {
+            fb.readPixels(outputData, rowPitch);
         });
     }
 
-    Future writeRaw(const std::uint8_t *inputData) final {
+    Future writeRaw(const std::uint8_t *inputData, std::size_t rowPitch) final {
         aa_assert(supportsDirectWrite());
+        aa_assert(rowPitch >= width * bytesPerPixel());
         auto m = manager.lock();
         aa_assert(m && "frame buffer manager destroyed");
         LOG_TRACE("writing frame buffer reference %p", (void*)this);
-        return m->enqueue(this, [inputData](FrameBuffer &fb) {
-            fb.writePixels(inputData);
+        if (m->options.transferProcessor) return m->enqueueTransfer(this, [inputData, rowPitch](FrameBuffer &fb) {
+            fb.writePixels(inputData, rowPitch);
+        });
+        if (m->options.uploadBuffers > 0) return m->enqueueUpload(this, inputData, size(), rowPitch);
+        return m->enqueue(this, [inputData, rowPitch](FrameBuffer &fb) {
+            fb.writePixels(inputData, rowPitch);
         });
     }
 
@@ -249,7 +663,8 @@ public:
             #ifdef ACCELERATED_ARRAYS_MAX_COMPATIBILITY_READS
                 if (channels != 4 || bytesPerChannel() != 1) return false;
             #endif
-            return bytesPerChannel() != 2;
+            // half floats are read as GL_HALF_FLOAT (EXT_color_buffer_half_float)
+            return bytesPerChannel() != 2 || dataType == DataType::FLOAT16;
         #else
             #ifdef ACCELERATED_ARRAYS_DODGY_READS
                 return true;
@@ -266,6 +681,7 @@ public:
     FrameBuffer &getFrameBuffer() final {
         auto m = manager.lock();
         aa_assert(m && "frame buffer manager destroyed");
+        m->syncTransfers(this);
         auto fb = m->getFrameBuffer(this);
         aa_assert(fb && "frame buffer object not created yet");
         return *fb;
@@ -276,24 +692,45 @@ public:
     }
 };
 
-class GpuImageFactory final : public Image::Factory {
+class GpuImageFactory final : public Image::PooledFactory {
 private:
     std::shared_ptr<FrameBufferManager> manager;
 
 public:
-    GpuImageFactory(Processor &p) : manager(new FrameBufferManager(p, *this)) {}
+    GpuImageFactory(Processor &p, const Image::FactoryOptions &options, std::shared_ptr<FrameBufferPool> pool) :
+        manager(new FrameBufferManager(p, *this, options, pool)) {}
+
+    Stats getStats() const final {
+        if (!manager->pool) return {};
+        return manager->pool->getStats();
+    }
+
+    Future releaseUnused() final {
+        auto pool = manager->pool;
+        if (!pool) return Future::instantlyResolved();
+        ScopedUnboundedEnqueue unbounded;
+        return manager->processor.enqueue([pool]() { pool->releaseUnused(); });
+    }
 
     std::unique_ptr<Image> wrapTexture(int textureId, int w, int h, const ImageTypeSpec &spec) final {
         return std::unique_ptr<Image>(new ExternalImage(w, h, textureId, spec));
     }
 
+    std::unique_ptr<Image> wrapEglImage(void *eglImage, int w, int h, const ImageTypeSpec &spec) final {
+        aa_assert(spec.storageType == ImageTypeSpec::StorageType::GPU_OPENGL);
+        return std::unique_ptr<Image>(new FrameBufferManager::Reference(w, h, spec, manager,
+            [eglImage, w, h, spec]() {
+                return std::shared_ptr<FrameBuffer>(FrameBuffer::createFromEglImage(eglImage, w, h, spec));
+            }));
+    }
+
     ImageTypeSpec getSpec(int channels, ImageTypeSpec::DataType dtype) final {
         return Image::getSpec(channels, dtype);
     }
 
     std::unique_ptr<::accelerated::Image> create(int w, int h, int channels, ImageTypeSpec::DataType dtype) {
         return std::unique_ptr<::accelerated::Image>(new FrameBufferManager::Reference(w, h,
-            Image::getSpec(channels, dtype, ImageTypeSpec::StorageType::GPU_OPENGL), manager, {}));
+            Image::getSpec(channels, dtype, ImageTypeSpec::StorageType::GPU_OPENGL), manager, std::unique_ptr<FrameBuffer>()));
     }
 
     std::unique_ptr<Image> wrapFrameBuffer(int fboId, int w, int h, const ImageTypeSpec &spec) {
@@ -331,7 +768,31 @@ Image &Image::castFrom(::accelerated::Image &image) {
 }
 
 std::unique_ptr<Image::Factory> Image::createFactory(Processor &p) {
-    return std::unique_ptr<Image::Factory>(new GpuImageFactory(p));
+    return createFactory(p, FactoryOptions());
+}
+
+std::unique_ptr<Image::Factory> Image::createFactory(Processor &p, const FactoryOptions &options) {
+    aa_assert(options.asyncReadBuffers >= 0 && options.uploadBuffers >= 0);
+    return std::unique_ptr<Image::Factory>(new GpuImageFactory(p, options, {}));
+}
+
+std::unique_ptr<Image::PooledFactory> Image::createPooledFactory(Processor &p, std::size_t maxPooledBytes) {
+    return createPooledFactory(p, maxPooledBytes, FactoryOptions());
+}
+
+std::unique_ptr<Image::PooledFactory> Image::createPooledFactory(Processor &p, std::size_t maxPooledBytes, const FactoryOptions &options) {
+    aa_assert(options.asyncReadBuffers >= 0 && options.uploadBuffers >= 0);
+    return std::unique_ptr<Image::PooledFactory>(new GpuImageFactory(p, options,
+        std::make_shared<FrameBufferPool>(maxPooledBytes)));
+}
+
+YuvImage Image::Factory::wrapYuvTextures(int yTextureId, int uvTextureId, int w, int h, YuvLayout layout) {
+    typedef FixedPoint<std::uint8_t> Byte;
+    YuvImage yuv;
+    yuv.layout = layout;
+    yuv.y = wrapTexture<Byte, 1>(yTextureId, w, h);
+    yuv.uv = wrapTexture<Byte, 2>(uvTextureId, YuvImage::getChromaSize(w), YuvImage::getChromaSize(h));
+    return yuv;
 }
 
 Image::Image(int w, int h, const ImageTypeSpec &spec) :
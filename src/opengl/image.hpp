@@ -79,11 +79,82 @@ public:
          */
         virtual std::unique_ptr<Image> wrapScreen(int w, int h) = 0;
 
+        /**
+         * Wrap the planes of an NV12 or NV21 frame that are already in two
+         * textures: a single-channel w x h Y texture (e.g., GL_R8) and a
+         * two-channel UV texture (e.g., GL_RG8) of YuvImage::getChromaSize
+         */
+        YuvImage wrapYuvTextures(int yTextureId, int uvTextureId, int w, int h, YuvLayout layout);
+
         virtual std::unique_ptr<Image> wrapTexture(int textureId, int w, int h, const ImageTypeSpec &spec) = 0;
+        /**
+         * Create a read-write image whose texture storage is an existing
+         * EGLImage, e.g., from egl::importDmaBuf or egl::importHardwareBuffer
+         * (see egl.hpp), without copying. The spec must match the format of
+         * the buffer and the EGLImage must outlive the image. OpenGL ES only
+         */
+        virtual std::unique_ptr<Image> wrapEglImage(void *eglImage, int w, int h, const ImageTypeSpec &spec) = 0;
         virtual std::unique_ptr<Image> wrapFrameBuffer(int frameBufferId, int w, int h, const ImageTypeSpec &spec) = 0;
     };
 
+    struct FactoryOptions {
+        /**
+         * If > 0, readRaw does not wait for the GPU in the OpenGL thread.
+         * Instead, the pixels are read to a ring of this many pixel pack
+         * buffers, and copied to the output memory when the returned Future
+         * is waited for (or earlier, if the data is already available).
+         * Note that this means the Future may need to enqueue work to the
+         * processor in wait(), or do it inline if waited in the OpenGL
+         * thread. 2-3 buffers are usually enough.
+         */
+        int asyncReadBuffers = 0;
+
+        /**
+         * If > 0, writeRaw copies the data to a ring of this many pixel
+         * unpack buffers, from which the texture is updated without
+         * stalling the OpenGL thread. The Future returned by writeRaw
+         * resolves when the input data has been copied.
+         */
+        int uploadBuffers = 0;
+
+        /**
+         * If set, readRaw and writeRaw are executed in this processor, whose
+         * GL context must share objects with the main one, e.g., from
+         * createGLFWTransferProcessor. The transfers are ordered with the
+         * operations using GL fences: a transfer waits (on the GPU) for the
+         * operations enqueued before it, and the next operation using the
+         * image waits for the transfer, but other operations are not blocked.
+         * Overrides asyncReadBuffers and uploadBuffers.
+         */
+        Processor *transferProcessor = nullptr;
+    };
+
+    /**
+     * Image factory that recycles the textures and frame buffers of
+     * destroyed images for new images with the same dimensions and type.
+     * Unused buffers are kept until their total size exceeds the budget,
+     * after which the least recently used ones are deleted. The contents
+     * of new images are undefined.
+     */
+    class PooledFactory : public Factory {
+    public:
+        struct Stats {
+            std::size_t hits = 0;
+            std::size_t misses = 0;
+            std::size_t pooledBuffers = 0; // currently unused
+            std::size_t pooledBytes = 0;
+            std::size_t bytesInUse = 0;
+        };
+
+        virtual Stats getStats() const = 0;
+        /** Delete all the currently unused buffers (in the GL thread) */
+        virtual Future releaseUnused() = 0;
+    };
+
     static std::unique_ptr<Factory> createFactory(Processor &processor);
+    static std::unique_ptr<Factory> createFactory(Processor &processor, const FactoryOptions &options);
+    static std::unique_ptr<PooledFactory> createPooledFactory(Processor &processor, std::size_t maxPooledBytes);
+    static std::unique_ptr<PooledFactory> createPooledFactory(Processor &processor, std::size_t maxPooledBytes, const FactoryOptions &options);
     static Image &castFrom(::accelerated::Image &image);
     static bool isCompatible(ImageTypeSpec::StorageType stype);
 
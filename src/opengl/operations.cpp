@@ -1,12 +1,17 @@
+#include <algorithm>
 #include <atomic>
 #include <cmath>
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #include "adapters.hpp"
 #include "operations.hpp"
 #include "image.hpp"
 #include "glsl_helpers.hpp"
 #include "../log.hpp"
+#include "../tracing.hpp"
 
 namespace accelerated {
 namespace opengl {
@@ -18,12 +23,32 @@ typedef ::accelerated::operations::swizzle::Spec SwizzleSpec;
 typedef ::accelerated::operations::fixedConvolution2D::Spec FixedConvolution2DSpec;
 typedef ::accelerated::operations::pixelwiseAffineCombination::Spec PixelwiseAffineCombinationSpec;
 typedef ::accelerated::operations::channelwiseAffine::Spec ChannelwiseAffineSpec;
+typedef ::accelerated::operations::pixelwiseChain::Spec PixelwiseChainSpec;
+typedef ::accelerated::operations::pyramid::Spec PyramidSpec;
+typedef ::accelerated::operations::yuvToRgb::Spec YuvToRgbSpec;
+typedef ::accelerated::operations::warp::Spec WarpSpec;
+typedef ::accelerated::operations::reduce::Spec ReduceSpec;
 using ::accelerated::operations::Function;
+using ::accelerated::operations::MultiOutputFunction;
 
 void checkSpec(const ImageTypeSpec &spec) {
     aa_assert(Image::isCompatible(spec.storageType));
 }
 
+// binds the input textures with their own border & interpolation settings
+void bindInputTextures(GlslPipeline &pipeline, Image **inputs, const std::vector<ImageTypeSpec> &inSpecs, std::vector<Binder::Target*> &textureBinders) {
+    for (std::size_t i = 0; i < inSpecs.size(); ++i) {
+        auto &input = *inputs[i];
+        aa_assert(input == inSpecs.at(i));
+        auto border = input.getBorder();
+        auto interpolation = input.getInterpolation();
+        if (border != Image::Border::UNDEFINED) pipeline.setTextureBorder(i, border);
+        if (interpolation != Image::Interpolation::UNDEFINED) pipeline.setTextureInterpolation(i, interpolation);
+        textureBinders.at(i) = &pipeline.bindTexture(i, input.getTextureId());
+        textureBinders.at(i)->bind();
+    }
+}
+
 Shader<NAry>::Builder defaultNAryBuilder(std::string fragmentShaderBody, const std::vector<ImageTypeSpec> &inSpecs, const ImageTypeSpec &outSpec) {
     return [fragmentShaderBody, inSpecs, outSpec]() {
         std::unique_ptr< Shader<NAry> > shader(new Shader<NAry>);
@@ -40,16 +65,7 @@ Shader<NAry>::Builder defaultNAryBuilder(std::string fragmentShaderBody, const s
             Binder binder(pipeline);
 
             aa_assert(output == outSpec);
-            for (std::size_t i = 0; i < inSpecs.size(); ++i) {
-                auto &input = *inputs[i];
-                aa_assert(input == inSpecs.at(i));
-                auto border = input.getBorder();
-                auto interpolation = input.getInterpolation();
-                if (border != Image::Border::UNDEFINED) pipeline.setTextureBorder(i, border);
-                if (interpolation != Image::Interpolation::UNDEFINED) pipeline.setTextureInterpolation(i, interpolation);
-                textureBinders->at(i) = &pipeline.bindTexture(i, input.getTextureId());
-                textureBinders->at(i)->bind();
-            }
+            bindInputTextures(pipeline, inputs, inSpecs, *textureBinders);
             pipeline.call(output.getFrameBuffer());
             for (auto *b : *textureBinders) b->unbind();
         };
@@ -58,6 +74,65 @@ Shader<NAry>::Builder defaultNAryBuilder(std::string fragmentShaderBody, const s
     };
 }
 
+// Resources of operations that consist of several shader passes and/or
+// non-image frame buffers
+struct MultiPassShader : Destroyable {
+    std::vector< std::unique_ptr<GlslPipeline> > passes;
+    // intermediate results, (re)allocated lazily when the size changes
+    std::vector< std::unique_ptr<FrameBuffer> > buffers;
+
+    FrameBuffer &getBuffer(unsigned index, int w, int h, const ImageTypeSpec &spec) {
+        if (buffers.size() <= index) buffers.resize(index + 1);
+        auto &buf = buffers.at(index);
+        if (buf && (buf->getViewportWidth() != w || buf->getViewportHeight() != h)) {
+            buf->destroy();
+            buf.reset();
+        }
+        if (!buf) buf = FrameBuffer::create(w, h, spec);
+        return *buf;
+    }
+
+    void destroy() final {
+        for (auto &p : passes) p->destroy();
+        for (auto &b : buffers) if (b) b->destroy();
+        passes.clear();
+        buffers.clear();
+    }
+};
+
+Shader<MultiOutputNAry>::Builder multiOutputBuilder(std::string fragmentShaderBody, const std::vector<ImageTypeSpec> &inSpecs, const std::vector<ImageTypeSpec> &outSpecs) {
+    return [fragmentShaderBody, inSpecs, outSpecs]() {
+        std::unique_ptr< Shader<MultiOutputNAry> > shader(new Shader<MultiOutputNAry>);
+        std::unique_ptr<MultiPassShader> resources(new MultiPassShader);
+        resources->passes.push_back(GlslPipeline::create(fragmentShaderBody.c_str(), inSpecs, outSpecs));
+        std::unique_ptr<MultiTargetFrameBuffer> targetsPtr = MultiTargetFrameBuffer::create();
+        MultiTargetFrameBuffer &targets = *targetsPtr;
+        resources->buffers.push_back(std::move(targetsPtr));
+        GlslPipeline &pipeline = *resources->passes.at(0);
+        shader->resources = std::move(resources);
+
+        auto textureBinders = std::make_shared< std::vector<Binder::Target*> >(inSpecs.size(), nullptr);
+        auto frameBuffers = std::make_shared< std::vector<FrameBuffer*> >(outSpecs.size(), nullptr);
+
+        shader->function = [&pipeline, &targets, inSpecs, outSpecs, textureBinders, frameBuffers](Image **inputs, int n, Image **outputs, int nOutputs) {
+            aa_assert(n == int(inSpecs.size()));
+            aa_assert(nOutputs == int(outSpecs.size()));
+            for (int i = 0; i < nOutputs; ++i) {
+                aa_assert(*outputs[i] == outSpecs.at(i));
+                frameBuffers->at(i) = &outputs[i]->getFrameBuffer();
+            }
+            targets.setTargets(frameBuffers->data(), nOutputs);
+
+            Binder binder(pipeline);
+            bindInputTextures(pipeline, inputs, inSpecs, *textureBinders);
+            pipeline.call(targets);
+            for (auto *b : *textureBinders) b->unbind();
+        };
+
+        return shader;
+    };
+}
+
 namespace impl {
 Shader<NAry>::Builder fill(const FillSpec &spec, const ImageTypeSpec &imageSpec) {
     aa_assert(!spec.value.empty());
@@ -78,8 +153,44 @@ Shader<NAry>::Builder fill(const FillSpec &spec, const ImageTypeSpec &imageSpec)
 }
 
 Shader<Unary>::Builder rescale(const RescaleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    const bool area = spec.interpolation == Image::Interpolation::AREA;
+
     std::string fragmentShaderBody;
-    {
+    if (area) {
+        // Box average over the input pixels [a, a + |alpha|) in each axis,
+        // as on the CPU. Each LINEAR lookup between two adjacent pixels
+        // (in both axes) averages them with the weights of their overlaps
+        std::ostringstream oss;
+        oss.precision(10);
+        oss << "const vec2 scale = vec2(" << spec.xScale << ", " << spec.yScale << ");\n"
+            << "const vec2 trans = vec2(" << spec.xTranslation << ", " << spec.yTranslation << ");\n"
+            << "vec2 overlap(vec2 i, vec2 a, vec2 b) {\n"
+            << "    return max(min(b, i + 1.0) - max(a, i), 0.0);\n"
+            << "}\n"
+            << "void main() {\n"
+            << "    vec2 texSize = vec2(textureSize(u_texture, 0));\n"
+            << "    vec2 alpha = scale * texSize / vec2(u_outSize);\n"
+            << "    vec2 width = abs(alpha);\n"
+            << "    vec2 a = floor(v_texCoord * vec2(u_outSize)) * alpha + trans * texSize;\n"
+            << "    a = mix(a, a + alpha, lessThan(alpha, vec2(0.0)));\n"
+            << "    vec2 b = a + width;\n"
+            << "    vec2 i0 = floor(a);\n"
+            << "    ivec2 n = ivec2(ceil(b) - i0);\n"
+            << "    vec4 sum = vec4(0.0);\n"
+            << "    for (int ky = 0; ky < n.y; ky += 2) {\n"
+            << "        for (int kx = 0; kx < n.x; kx += 2) {\n"
+            << "            vec2 i = i0 + vec2(kx, ky);\n"
+            << "            vec2 w0 = overlap(i, a, b), w1 = overlap(i + 1.0, a, b);\n"
+            << "            vec2 w = w0 + w1;\n"
+            << "            sum += w.x * w.y * vec4(texture(u_texture, (i + 0.5 + w1 / w) / texSize));\n"
+            << "        }\n"
+            << "    }\n"
+            << "    outValue = " << getGlslVecType(outSpec)
+            << "((sum / (width.x * width.y))." << glsl::swizzleSubset(outSpec.channels) << ");\n"
+            << "}\n";
+
+        fragmentShaderBody = oss.str();
+    } else {
         // ((v_texCoord * u_outSize - 0.5) * alpha + trans * texSize + 0.5) / texSize
         // = (v_texCoord * u_outSize * alpha + 0.5 * (1 - alpha)) / texSize + trans
         // = v_texCoord * u_outSize * alpha / texSize + 0.5 * (1 - alpha) / texSize + trans
@@ -91,7 +202,6 @@ Shader<Unary>::Builder rescale(const RescaleSpec &spec, const ImageTypeSpec &inS
         //           = trans + pixCenterOffset
 
         std::ostringstream oss;
-        const auto swiz = glsl::swizzleSubset(inSpec.channels);
         oss << "const vec2 scale = vec2(" << spec.xScale << ", " << spec.yScale << ");\n"
             << "const vec2 trans = vec2(" << spec.xTranslation << ", " << spec.yTranslation << ");\n"
             << "void main() {\n"
@@ -105,8 +215,8 @@ Shader<Unary>::Builder rescale(const RescaleSpec &spec, const ImageTypeSpec &inS
         fragmentShaderBody = oss.str();
     }
 
-    if (spec.interpolation == Image::Interpolation::LINEAR && ImageTypeSpec::isIntegerType(inSpec.dataType)) {
-        log_warn("Using LINEAR interpolation with integer GL texture data types does not work in rescale (falls back to NEAREST)");
+    if ((area || spec.interpolation == Image::Interpolation::LINEAR) && ImageTypeSpec::isIntegerType(inSpec.dataType)) {
+        log_warn("Using LINEAR or AREA interpolation with integer GL texture data types does not work in rescale (falls back to NEAREST)");
     }
 
     return [fragmentShaderBody, inSpec, outSpec, spec]() {
@@ -115,7 +225,9 @@ Shader<Unary>::Builder rescale(const RescaleSpec &spec, const ImageTypeSpec &inS
         GlslPipeline &pipeline = reinterpret_cast<GlslPipeline&>(*shader->resources);
 
         pipeline.setTextureBorder(0, spec.border);
-        pipeline.setTextureInterpolation(0, spec.interpolation);
+        // AREA is computed with LINEAR lookups
+        pipeline.setTextureInterpolation(0, spec.interpolation == Image::Interpolation::AREA
+            ? Image::Interpolation::LINEAR : spec.interpolation);
 
         shader->function = [&pipeline, inSpec, outSpec](Image &input, Image &output) {
             aa_assert(input == inSpec);
@@ -130,6 +242,103 @@ Shader<Unary>::Builder rescale(const RescaleSpec &spec, const ImageTypeSpec &inS
     };
 }
 
+/**
+ * The source point is computed per fragment and sampled with the texture
+ * unit settings (interpolation & border). The ZERO border is computed in
+ * the shader with texelFetch instead, since OpenGL ES has no
+ * GL_CLAMP_TO_BORDER, and this also makes LINEAR work for integer textures
+ */
+Shader<NAry>::Builder warp(const WarpSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    aa_assert(inSpec.channels == outSpec.channels);
+    aa_assert(spec.interpolation != Image::Interpolation::AREA && "warp supports NEAREST and LINEAR interpolation");
+    const bool useMap = spec.usesMap();
+    const bool zeroBorder = spec.border == Image::Border::ZERO;
+    const bool linear = spec.interpolation == Image::Interpolation::LINEAR;
+    const std::string tex = useMap ? "u_texture1" : "u_texture";
+
+    std::string fragmentShaderBody;
+    {
+        std::ostringstream oss;
+        oss.precision(10);
+        if (!useMap) {
+            const auto h = spec.getHomography();
+            for (int row = 0; row < 3; ++row) {
+                oss << "const vec3 h" << row << " = vec3("
+                    << h.at(row * 3) << ", " << h.at(row * 3 + 1) << ", " << h.at(row * 3 + 2) << ");\n";
+            }
+        }
+        if (zeroBorder) {
+            oss << "vec4 fetch(ivec2 p, ivec2 size) {\n";
+            oss << "    if (any(lessThan(p, ivec2(0))) || any(greaterThanEqual(p, size))) return vec4(0);\n";
+            oss << "    return vec4(texelFetch(" << tex << ", p, 0));\n";
+            oss << "}\n";
+        }
+
+        oss << "void main() {\n";
+        if (useMap) {
+            oss << "vec2 src = texelFetch(u_texture2, ivec2(v_texCoord * vec2(u_outSize)), 0).xy;\n";
+        } else {
+            // pixel centers at integer coordinates
+            oss << "vec3 p = vec3(v_texCoord * vec2(u_outSize) - 0.5, 1.0);\n";
+            oss << "vec2 src = vec2(dot(h0, p), dot(h1, p)) / dot(h2, p);\n";
+        }
+        oss << "ivec2 size = textureSize(" << tex << ", 0);\n";
+        if (!zeroBorder) {
+            oss << "vec4 v = vec4(texture(" << tex << ", (src + 0.5) / vec2(size)));\n";
+        } else if (linear) {
+            oss << "vec2 f = floor(src);\n";
+            oss << "vec2 a = src - f;\n";
+            oss << "ivec2 i = ivec2(f);\n";
+            oss << "vec4 v = mix(\n";
+            oss << "    mix(fetch(i, size), fetch(i + ivec2(1, 0), size), a.x),\n";
+            oss << "    mix(fetch(i + ivec2(0, 1), size), fetch(i + ivec2(1, 1), size), a.x), a.y);\n";
+        } else {
+            oss << "vec4 v = fetch(ivec2(floor(src + 0.5)), size);\n";
+        }
+        oss << "outValue = " << getGlslVecType(outSpec) << "(v." << glsl::swizzleSubset(outSpec.channels) << ");\n";
+        oss << "}\n";
+        fragmentShaderBody = oss.str();
+    }
+
+    if (linear && !zeroBorder && ImageTypeSpec::isIntegerType(inSpec.dataType)) {
+        log_warn("Using LINEAR interpolation with integer GL texture data types does not work in warp (falls back to NEAREST) except with the ZERO border");
+    }
+
+    std::vector<ImageTypeSpec> inSpecs = { inSpec };
+    if (useMap) inSpecs.push_back(ImageTypeSpec { 2, ImageTypeSpec::DataType::FLOAT32, ImageTypeSpec::StorageType::GPU_OPENGL });
+    const auto interpolation = spec.interpolation;
+    const auto border = spec.border;
+    return [fragmentShaderBody, inSpecs, outSpec, interpolation, border, zeroBorder]() {
+        std::unique_ptr< Shader<NAry> > shader(new Shader<NAry>);
+        shader->resources = GlslPipeline::create(fragmentShaderBody.c_str(), inSpecs, outSpec);
+        GlslPipeline &pipeline = reinterpret_cast<GlslPipeline&>(*shader->resources);
+        if (!zeroBorder) {
+            pipeline.setTextureBorder(0, border);
+            pipeline.setTextureInterpolation(0, interpolation);
+        }
+
+        auto textureBinders = std::make_shared< std::vector<Binder::Target*> >(inSpecs.size(), nullptr);
+        shader->function = [&pipeline, inSpecs, outSpec, textureBinders](Image **inputs, int n, Image &output) {
+            aa_assert(n == int(inSpecs.size()));
+            aa_assert(output == outSpec);
+            if (n == 2) {
+                aa_assert(inputs[1]->width == output.width && inputs[1]->height == output.height);
+            }
+
+            Binder binder(pipeline);
+            for (int i = 0; i < n; ++i) {
+                aa_assert(*inputs[i] == inSpecs.at(i));
+                textureBinders->at(i) = &pipeline.bindTexture(i, inputs[i]->getTextureId());
+                textureBinders->at(i)->bind();
+            }
+            pipeline.call(output.getFrameBuffer());
+            for (auto *b : *textureBinders) b->unbind();
+        };
+
+        return shader;
+    };
+}
+
 Shader<Unary>::Builder swizzle(const SwizzleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
     std::string fragmentShaderBody;
     {
@@ -193,6 +402,25 @@ Shader<Unary>::Builder swizzle(const SwizzleSpec &spec, const ImageTypeSpec &inS
     };
 }
 
+// column-major GLSL mat4 constant from a row-major matrix, zero-padded
+void writeMat4(std::ostringstream &oss, const std::string &name, const std::vector< std::vector<double> > &mat) {
+    oss << "const mat4 " << name << " = mat4(";
+    for (int col = 0; col < 4; ++col) {
+        oss << "vec4(";
+        for (int row = 0; row < 4; ++row) {
+            if (row > 0) oss << ", ";
+            if (row < int(mat.size()) && col < int(mat.at(row).size()))
+                oss << mat.at(row).at(col);
+            else
+                oss << "0";
+        }
+        oss << ")";
+        if (col < 3) oss << ",";
+        oss << "\n";
+    }
+    oss << ");\n";
+}
+
 Shader<NAry>::Builder pixelwiseAffineCombination(const PixelwiseAffineCombinationSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
 
     const int nInputs = spec.linear.size();
@@ -210,21 +438,9 @@ Shader<NAry>::Builder pixelwiseAffineCombination(const PixelwiseAffineCombinatio
             aa_assert(inSpec.channels == int(mat.at(0).size()));
             // TODO: could use smaller mat or dot product for different
             // special cases for perhaps improved performance
-            oss << "const mat4 m" << i << " = mat4(";
-            for (int col = 0; col < 4; ++col) {
-                oss << "vec4(";
-                for (int row = 0; row < 4; ++row) {
-                    if (row > 0) oss << ", ";
-                    if (row < int(mat.size()) && col < int(mat.at(row).size()))
-                        oss << mat.at(row).at(col);
-                    else
-                        oss << "0";
-                }
-                oss << ")";
-                if (col < 3) oss << ",";
-                oss << "\n";
-            }
-            oss << ");\n";
+            std::ostringstream name;
+            name << "m" << i;
+            writeMat4(oss, name.str(), mat);
         }
 
         oss << "void main() {\n";
@@ -276,9 +492,503 @@ Shader<NAry>::Builder channelwiseAffine(const ChannelwiseAffineSpec &spec, const
     return defaultNAryBuilder(fragmentShaderBody, { inSpec }, outSpec);
 }
 
+// inputs: Y plane (u_texture1) and the half-resolution UV plane (u_texture2)
+Shader<NAry>::Builder yuvToRgb(const YuvToRgbSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    aa_assert(inSpec.channels == 1);
+    aa_assert(outSpec.channels != 2);
+    const auto c = spec.getCoefficients();
+    std::string fragmentShaderBody;
+    {
+        std::ostringstream oss;
+        oss << "void main() {\n";
+        oss << "ivec2 coord = ivec2(v_texCoord * vec2(u_outSize));\n";
+        oss << "float luma = float(" << c.y << ") * (texelFetch(u_texture1, coord, 0).r - float(" << c.yOffset << "));\n";
+        if (outSpec.channels == 1) {
+            oss << "outValue = " << getGlslVecType(outSpec) << "(clamp(luma, 0.0, 1.0));\n";
+        } else {
+            const char *uvSwiz = spec.layout == Image::YuvLayout::NV21 ? "gr" : "rg";
+            oss << "vec2 uv = texelFetch(u_texture2, coord / 2, 0)." << uvSwiz << " - vec2(" << c.chromaOffset << ");\n";
+            oss << "vec4 rgba = clamp(vec4("
+                << "luma + float(" << c.rv << ") * uv.y, "
+                << "luma + float(" << c.gu << ") * uv.x + float(" << c.gv << ") * uv.y, "
+                << "luma + float(" << c.bu << ") * uv.x, 1.0), 0.0, 1.0);\n";
+            oss << "outValue = " << getGlslVecType(outSpec) << "(rgba." << glsl::swizzleSubset(outSpec.channels) << ");\n";
+        }
+        oss << "}\n";
+        fragmentShaderBody = oss.str();
+    }
+
+    const ImageTypeSpec uvSpec { 2, inSpec.dataType, inSpec.storageType };
+    return defaultNAryBuilder(fragmentShaderBody, { inSpec, uvSpec }, outSpec);
+}
+
+// GLSL statements that round and clamp the vec4 v like storing it to an
+// image of the given type and reading it back (as on the CPU)
+std::string quantize(const std::string &v, ImageTypeSpec::DataType dataType) {
+    if (dataType == ImageTypeSpec::DataType::FLOAT32) return "";
+    std::ostringstream oss;
+    if (dataType == ImageTypeSpec::DataType::FLOAT16) {
+    #ifdef __APPLE__
+        // the shaders are GLSL 3.30 there, without packHalf2x16
+        aa_assert(false && "FLOAT16 intermediate steps not supported on macOS");
+    #endif
+        oss << v << " = " << glslHalfOverflowToInf(v, 4) << ";\n";
+        oss << v << " = vec4(unpackHalf2x16(packHalf2x16(" << v << ".xy)), "
+            << "unpackHalf2x16(packHalf2x16(" << v << ".zw)));\n";
+        return oss.str();
+    }
+    const int bits = 8 * ImageTypeSpec { 1, dataType, ImageTypeSpec::StorageType::GPU_OPENGL }.bytesPerChannel();
+    const bool isSigned = ImageTypeSpec::isSigned(dataType);
+    if (ImageTypeSpec::isFixedPoint(dataType)) {
+        const double scale = std::pow(2.0, isSigned ? bits - 1 : bits) - 1;
+        oss << v << " = clamp(round(" << v << " * float(" << scale << ")) / float(" << scale << "), "
+            << (isSigned ? "-1.0" : "0.0") << ", 1.0);\n";
+    } else {
+        // integers saturate. The limits are written as float literals,
+        // e.g., 4294967295.0, which is not a valid int literal
+        const double minValue = isSigned ? -std::pow(2.0, bits - 1) : 0;
+        const double maxValue = std::pow(2.0, isSigned ? bits - 1 : bits) - 1;
+        oss.setf(std::ios::fixed);
+        oss.precision(1);
+        oss << v << " = clamp(trunc(" << v << "), " << minValue << ", " << maxValue << ");\n";
+    }
+    return oss.str();
+}
+
+Shader<NAry>::Builder pixelwiseChain(const PixelwiseChainSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    typedef ::accelerated::operations::pixelwiseChain::AffineStep AffineStep;
+    const int nInputs = spec.getInputCount();
+    const std::vector<AffineStep> steps = spec.getAffineSteps(nInputs > 0 ? inSpec.channels : 0);
+    aa_assert(steps.back().channels == outSpec.channels);
+    aa_assert(steps.back().dataType == outSpec.dataType);
+
+    std::string fragmentShaderBody;
+    {
+        std::ostringstream oss;
+        for (std::size_t s = 0; s < steps.size(); ++s) {
+            for (std::size_t i = 0; i < steps.at(s).linear.size(); ++i) {
+                std::ostringstream name;
+                name << "m" << s << "_" << i;
+                writeMat4(oss, name.str(), steps.at(s).linear.at(i));
+            }
+        }
+
+        oss << "void main() {\n";
+        for (int i = 0; i < nInputs; ++i) {
+            oss << "vec4 texValue" << i << " = vec4(texelFetch(u_texture";
+            if (nInputs > 1) oss << (i + 1);
+            oss << ", ivec2(v_texCoord * vec2(u_outSize)), 0));\n";
+        }
+        // the intermediary values never leave the registers
+        oss << "vec4 v;\n";
+        for (std::size_t s = 0; s < steps.size(); ++s) {
+            const auto &step = steps.at(s);
+            std::vector<double> bias = step.bias;
+            bias.resize(4, 0.0);
+            oss << "v = " << glsl::wrapToFloatVec(bias);
+            for (std::size_t i = 0; i < step.linear.size(); ++i) {
+                oss << " + m" << s << "_" << i << " * " << (s == 0 ? "texValue" + std::to_string(i) : "v");
+            }
+            oss << ";\n";
+            if (s + 1 < steps.size()) oss << quantize("v", step.dataType);
+        }
+        oss << "outValue = " << getGlslVecType(outSpec) << "(v." << glsl::swizzleSubset(outSpec.channels) << ");\n";
+        oss << "}\n";
+        fragmentShaderBody = oss.str();
+    }
+
+    std::vector<ImageTypeSpec> inSpecs;
+    for (int i = 0; i < nInputs; ++i) inSpecs.emplace_back(inSpec);
+    return defaultNAryBuilder(fragmentShaderBody, inSpecs, outSpec);
+}
+
+bool supportsLinearFiltering(const ImageTypeSpec &spec) {
+    if (ImageTypeSpec::isFixedPoint(spec.dataType)) return spec.bytesPerChannel() <= 2;
+    // half float textures are always filterable
+    if (spec.dataType == ImageTypeSpec::DataType::FLOAT16) return true;
+#ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+    return false; // float textures would need OES_texture_float_linear
+#else
+    return spec.dataType == ImageTypeSpec::DataType::FLOAT32;
+#endif
+}
+
+struct ConvolutionTap {
+    double position, weight;
+};
+
+/**
+ * Non-zero taps of a 1D kernel. If mergeLinear is set and the kernel is
+ * symmetric, pairs of neighboring taps of the same sign are merged to a
+ * single linearly interpolated texture fetch between them
+ */
+std::vector<ConvolutionTap> convolutionTaps(const std::vector<double> &kernel, bool mergeLinear) {
+    const int n = kernel.size();
+    if (mergeLinear && n % 2 == 1) {
+        double maxAbs = 0;
+        for (double k : kernel) maxAbs = std::max(maxAbs, std::fabs(k));
+        for (int i = 0; i < n / 2; ++i) {
+            if (std::fabs(kernel[i] - kernel[n - 1 - i]) > 1e-9 * maxAbs) mergeLinear = false;
+        }
+    } else {
+        mergeLinear = false;
+    }
+
+    std::vector<ConvolutionTap> taps;
+    const auto add = [&taps](double position, double weight) {
+        if (weight != 0) taps.push_back({ position, weight });
+    };
+    if (!mergeLinear) {
+        for (int i = 0; i < n; ++i) add(i, kernel[i]);
+        return taps;
+    }
+
+    const int center = n / 2;
+    add(center, kernel[center]);
+    for (int dir : { -1, 1 }) {
+        for (int d = 1; d <= center; ) {
+            const double w0 = kernel[center + dir * d];
+            if (d < center && w0 * kernel[center + dir * (d + 1)] > 0) {
+                const double w1 = kernel[center + dir * (d + 1)];
+                add(center + dir * (d + w1 / (w0 + w1)), w0 + w1);
+                d += 2;
+            } else {
+                add(center + dir * d, w0);
+                d++;
+            }
+        }
+    }
+    return taps;
+}
+
+/**
+ * One horizontal or vertical pass of a separable convolution. See the
+ * comments in fixedConvolution2D for the coordinate transformation
+ */
+std::string convolution1DShaderBody(
+    const std::vector<ConvolutionTap> &taps,
+    bool vertical,
+    int stride,
+    int kernelOffset,
+    double bias,
+    int channels,
+    const ImageTypeSpec &outSpec)
+{
+    std::ostringstream oss;
+    oss.precision(10);
+    const auto vtype = glsl::floatVecType(channels);
+    const char *axis = vertical ? "y" : "x";
+
+    oss << "void main() {\n";
+    oss << "vec2 pos = v_texCoord * vec2(u_outSize);\n";
+    oss << "pos." << axis << " = pos." << axis << " * float(" << stride << ") + float(" << (kernelOffset + 0.5 * (1 - stride)) << ");\n";
+    oss << "vec2 invSize = 1.0 / vec2(textureSize(u_texture, 0));\n";
+    oss << vtype << " v = " << vtype << "(" << bias << ");\n";
+    for (const auto &tap : taps) {
+        oss << "v += float(" << tap.weight << ") * " << vtype << "(texture(u_texture, (pos + vec2(";
+        if (vertical) oss << "0.0, float(" << tap.position << ")";
+        else oss << "float(" << tap.position << "), 0.0";
+        oss << ")) * invSize));\n";
+    }
+    if (outSpec.channels > channels) {
+        // padded intermediate buffer
+        oss << "outValue = " << getGlslVecType(outSpec) << "(v, " << glsl::floatVecType(outSpec.channels - channels) << "(0));\n";
+    } else {
+        oss << "outValue = " << getGlslVecType(outSpec) << "(v);\n";
+    }
+    oss << "}\n";
+    return oss.str();
+}
+
+/**
+ * Separable kernels are computed in two 1D passes (horizontal, vertical)
+ * through a floating point intermediate buffer, which has the output width
+ * and the input height. The border handling is exact also in this case,
+ * since the first pass does not mix rows and bias is only added at the end.
+ */
+struct SeparableConvolution {
+    std::string xBody, yBody;
+    bool interpolateX, interpolateY;
+    Image::Border border;
+    ImageTypeSpec inSpec, outSpec, bufferSpec;
+
+    // 3-channel float textures are not necessarily color-renderable
+    static ImageTypeSpec getBufferSpec(int channels) {
+        return ImageTypeSpec {
+            channels == 3 ? 4 : channels,
+            ImageTypeSpec::DataType::FLOAT32,
+            ImageTypeSpec::StorageType::GPU_OPENGL
+        };
+    }
+
+    SeparableConvolution(
+        const FixedConvolution2DSpec &spec,
+        const std::vector<double> &column,
+        const std::vector<double> &row,
+        const ImageTypeSpec &inSpec,
+        const ImageTypeSpec &outSpec)
+    :
+        border(spec.border),
+        inSpec(inSpec),
+        outSpec(outSpec),
+        bufferSpec(getBufferSpec(outSpec.channels))
+    {
+        const int channels = outSpec.channels;
+        const auto xTaps = convolutionTaps(row, supportsLinearFiltering(inSpec));
+        const auto yTaps = convolutionTaps(column, supportsLinearFiltering(bufferSpec));
+        LOG_TRACE("separable convolution with %d + %d taps", int(xTaps.size()), int(yTaps.size()));
+
+        xBody = convolution1DShaderBody(xTaps, false,
+            spec.xStride, spec.getKernelXOffset(), 0.0, channels, bufferSpec);
+        yBody = convolution1DShaderBody(yTaps, true,
+            spec.yStride, spec.getKernelYOffset(), spec.bias, channels, outSpec);
+        const auto hasFractionalTaps = [](const std::vector<ConvolutionTap> &taps) {
+            for (const auto &tap : taps) if (tap.position != std::floor(tap.position)) return true;
+            return false;
+        };
+        interpolateX = hasFractionalTaps(xTaps);
+        interpolateY = hasFractionalTaps(yTaps);
+    }
+
+    /** Add the horizontal and vertical pass to the resources (GL thread) */
+    void createPasses(MultiPassShader &resources) const {
+        const auto interpolation = [](bool linear) {
+            return linear ? Image::Interpolation::LINEAR : Image::Interpolation::NEAREST;
+        };
+        resources.passes.push_back(GlslPipeline::create(xBody.c_str(), { inSpec }, bufferSpec));
+        resources.passes.back()->setTextureBorder(0, border);
+        resources.passes.back()->setTextureInterpolation(0, interpolation(interpolateX));
+        resources.passes.push_back(GlslPipeline::create(yBody.c_str(), { bufferSpec }, outSpec));
+        resources.passes.back()->setTextureBorder(0, border);
+        resources.passes.back()->setTextureInterpolation(0, interpolation(interpolateY));
+    }
+
+    static void run(GlslPipeline &xPass, GlslPipeline &yPass, Image &input, FrameBuffer &buffer, FrameBuffer &output) {
+        {
+            Binder binder(xPass);
+            Binder inputBinder(xPass.bindTexture(0, input.getTextureId()));
+            xPass.call(buffer);
+        }
+        Binder binder(yPass);
+        Binder inputBinder(yPass.bindTexture(0, buffer.getTextureId()));
+        yPass.call(output);
+    }
+};
+
+Shader<Unary>::Builder separableConvolution2D(
+    const FixedConvolution2DSpec &spec,
+    const std::vector<double> &column,
+    const std::vector<double> &row,
+    const ImageTypeSpec &inSpec,
+    const ImageTypeSpec &outSpec)
+{
+    const SeparableConvolution conv(spec, column, row, inSpec, outSpec);
+    return [conv]() {
+        std::unique_ptr< Shader<Unary> > shader(new Shader<Unary>);
+        std::unique_ptr<MultiPassShader> resources(new MultiPassShader);
+        conv.createPasses(*resources);
+
+        MultiPassShader &multiPass = *resources;
+        shader->resources = std::move(resources);
+        const ImageTypeSpec bufferSpec = conv.bufferSpec;
+        shader->function = [&multiPass, bufferSpec](Image &input, Image &output) {
+            FrameBuffer &buffer = multiPass.getBuffer(0, output.width, input.height, bufferSpec);
+            SeparableConvolution::run(*multiPass.passes.at(0), *multiPass.passes.at(1), input, buffer, output.getFrameBuffer());
+        };
+
+        return shader;
+    };
+}
+
+/**
+ * All levels in one GL thread call. The passes for the first level (from
+ * the input type) and the other levels are separate programs (shared by
+ * the program cache if the types match), and each level has its own
+ * intermediate buffer, so nothing is reallocated between frames.
+ */
+Shader<MultiOutputNAry>::Builder pyramid(const PyramidSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    const auto levelConv = spec.getLevelConvolution();
+    const SeparableConvolution first(levelConv, spec.kernel, spec.kernel, inSpec, outSpec);
+    const SeparableConvolution next(levelConv, spec.kernel, spec.kernel, outSpec, outSpec);
+    const int levels = spec.levels;
+
+    return [first, next, levels]() {
+        std::unique_ptr< Shader<MultiOutputNAry> > shader(new Shader<MultiOutputNAry>);
+        std::unique_ptr<MultiPassShader> resources(new MultiPassShader);
+        first.createPasses(*resources);
+        next.createPasses(*resources);
+
+        MultiPassShader &multiPass = *resources;
+        shader->resources = std::move(resources);
+        const ImageTypeSpec bufferSpec = first.bufferSpec;
+        shader->function = [&multiPass, bufferSpec, levels](Image **inputs, int nInputs, Image **outputs, int nOutputs) {
+            aa_assert(nInputs == 1 && nOutputs == levels);
+            (void)nInputs; (void)nOutputs;
+            for (int level = 0; level < levels; ++level) {
+                Image &input = level == 0 ? *inputs[0] : *outputs[level - 1];
+                Image &output = *outputs[level];
+                aa_assert(output.width == PyramidSpec::getLevelSize(input.width, 1));
+                aa_assert(output.height == PyramidSpec::getLevelSize(input.height, 1));
+                const int pass = level == 0 ? 0 : 2;
+                FrameBuffer &buffer = multiPass.getBuffer(level, output.width, input.height, bufferSpec);
+                SeparableConvolution::run(*multiPass.passes.at(pass), *multiPass.passes.at(pass + 1), input, buffer, output.getFrameBuffer());
+            }
+        };
+
+        return shader;
+    };
+}
+
+/**
+ * Reductions in several passes through floating point buffers. Each pass
+ * reduces blocks of BLOCK x BLOCK pixels to one until the rest fits in a
+ * single block, which the last pass reduces to the output. Histograms
+ * first count the pixels of each row in each bin (a bins x height buffer,
+ * which costs bins texel fetches per pixel) and then sum the counts in
+ * blocks of BLOCK rows. The mean is computed as the sum of the scaled
+ * values.
+ */
+struct Reduction {
+    static constexpr int BLOCK = 4;
+    typedef ::accelerated::operations::reduce::Type Type;
+    std::string firstBody, reduceBody, lastBody;
+    int xBlock, yBlock, outputWidth;
+    ImageTypeSpec inSpec, outSpec, bufferSpec;
+
+    static int divUp(int a, int b) {
+        return (a + b - 1) / b;
+    }
+
+    static std::string blockReduceBody(Type type, int xBlock, int yBlock, bool scaleToMean, const ImageTypeSpec &outSpec) {
+        std::ostringstream oss;
+        oss << "const ivec2 block = ivec2(" << xBlock << ", " << yBlock << ");\n";
+        oss << "void main() {\n";
+        oss << "ivec2 size = textureSize(u_texture, 0);\n";
+        oss << "ivec2 origin = ivec2(v_texCoord * vec2(u_outSize)) * block;\n";
+        oss << "vec4 v = vec4(texelFetch(u_texture, origin, 0));\n";
+        oss << "for (int i = 0; i < block.y; i++) {\n";
+        oss << "for (int j = 0; j < block.x; j++) {\n";
+        oss << "    ivec2 coord = origin + ivec2(j, i);\n";
+        oss << "    if ((i > 0 || j > 0) && coord.x < size.x && coord.y < size.y) {\n";
+        oss << "        vec4 value = vec4(texelFetch(u_texture, coord, 0));\n";
+        switch (type) {
+        case Type::MIN: oss << "        v = min(v, value);\n"; break;
+        case Type::MAX: oss << "        v = max(v, value);\n"; break;
+        default: oss << "        v += value;\n"; break;
+        }
+        oss << "    }\n";
+        oss << "}\n";
+        oss << "}\n";
+        if (scaleToMean) oss << "v /= float(size.x) * float(size.y);\n";
+        oss << "outValue = " << getGlslVecType(outSpec) << "(v." << glsl::swizzleSubset(outSpec.channels) << ");\n";
+        oss << "}\n";
+        return oss.str();
+    }
+
+    static std::string histogramBody(const ReduceSpec &spec, const ImageTypeSpec &outSpec) {
+        std::ostringstream oss;
+        oss.precision(10);
+        // same as ReduceSpec::getBin
+        oss << "const float binOffset = float(" << spec.histogramMin << ");\n";
+        oss << "const float binScale = float(" << (spec.bins / (spec.histogramMax - spec.histogramMin)) << ");\n";
+        oss << "void main() {\n";
+        oss << "ivec2 coord = ivec2(v_texCoord * vec2(u_outSize));\n";
+        oss << "int width = textureSize(u_texture, 0).x;\n";
+        oss << "vec4 v = vec4(0);\n";
+        oss << "for (int x = 0; x < width; x++) {\n";
+        oss << "    vec4 value = vec4(texelFetch(u_texture, ivec2(x, coord.y), 0));\n";
+        oss << "    ivec4 bin = ivec4(clamp(floor((value - binOffset) * binScale), 0.0, float(" << (spec.bins - 1) << ")));\n";
+        oss << "    v += vec4(equal(bin, ivec4(coord.x)));\n";
+        oss << "}\n";
+        oss << "outValue = " << getGlslVecType(outSpec) << "(v." << glsl::swizzleSubset(outSpec.channels) << ");\n";
+        oss << "}\n";
+        return oss.str();
+    }
+
+    Reduction(const ReduceSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) :
+        inSpec(inSpec),
+        outSpec(outSpec),
+        bufferSpec(SeparableConvolution::getBufferSpec(inSpec.channels))
+    {
+        outputWidth = spec.getOutputWidth();
+        aa_assert(inSpec.channels == outSpec.channels);
+        if (spec.type == Type::HISTOGRAM) {
+            aa_assert(spec.bins >= 1 && spec.histogramMax > spec.histogramMin);
+            xBlock = 1;
+            yBlock = BLOCK;
+            firstBody = histogramBody(spec, bufferSpec);
+            reduceBody = blockReduceBody(Type::SUM, xBlock, yBlock, false, bufferSpec);
+            lastBody = blockReduceBody(Type::SUM, xBlock, yBlock, false, outSpec);
+        } else {
+            xBlock = yBlock = BLOCK;
+            firstBody = blockReduceBody(spec.type, xBlock, yBlock, spec.type == Type::MEAN, bufferSpec);
+            reduceBody = blockReduceBody(spec.type, xBlock, yBlock, false, bufferSpec);
+            lastBody = blockReduceBody(spec.type, xBlock, yBlock, false, outSpec);
+        }
+    }
+
+    /** The first pass, the intermediate passes and the last pass */
+    void createPasses(MultiPassShader &resources) const {
+        resources.passes.push_back(GlslPipeline::create(firstBody.c_str(), { inSpec }, bufferSpec));
+        resources.passes.push_back(GlslPipeline::create(reduceBody.c_str(), { bufferSpec }, bufferSpec));
+        resources.passes.push_back(GlslPipeline::create(lastBody.c_str(), { bufferSpec }, outSpec));
+    }
+
+    static void runPass(GlslPipeline &pass, int textureId, FrameBuffer &output) {
+        Binder binder(pass);
+        Binder inputBinder(pass.bindTexture(0, textureId));
+        pass.call(output);
+    }
+
+    void run(MultiPassShader &multiPass, Image &input, Image &output) const {
+        aa_assert(output.width == outputWidth && output.height == 1);
+        // the histogram pass keeps the rows
+        const bool histogram = xBlock == 1;
+        int w = histogram ? outputWidth : divUp(input.width, xBlock);
+        int h = histogram ? input.height : divUp(input.height, yBlock);
+        FrameBuffer *buffer = &multiPass.getBuffer(0, w, h, bufferSpec);
+        runPass(*multiPass.passes.at(0), input.getTextureId(), *buffer);
+
+        for (unsigned level = 1; divUp(w, xBlock) != outputWidth || divUp(h, yBlock) != 1; ++level) {
+            w = divUp(w, xBlock);
+            h = divUp(h, yBlock);
+            FrameBuffer &next = multiPass.getBuffer(level, w, h, bufferSpec);
+            runPass(*multiPass.passes.at(1), buffer->getTextureId(), next);
+            buffer = &next;
+        }
+        runPass(*multiPass.passes.at(2), buffer->getTextureId(), output.getFrameBuffer());
+    }
+};
+
+Shader<Unary>::Builder reduce(const ReduceSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    const Reduction reduction(spec, inSpec, outSpec);
+    return [reduction]() {
+        std::unique_ptr< Shader<Unary> > shader(new Shader<Unary>);
+        std::unique_ptr<MultiPassShader> resources(new MultiPassShader);
+        reduction.createPasses(*resources);
+
+        MultiPassShader &multiPass = *resources;
+        shader->resources = std::move(resources);
+        shader->function = [&multiPass, reduction](Image &input, Image &output) {
+            aa_assert(input == reduction.inSpec);
+            aa_assert(output == reduction.outSpec);
+            reduction.run(multiPass, input, output);
+        };
+
+        return shader;
+    };
+}
+
 Shader<Unary>::Builder fixedConvolution2D(const FixedConvolution2DSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
     aa_assert(!spec.kernel.empty());
 
+    {
+        std::vector<double> column, row;
+        if (spec.getSeparableFactors(column, row)) {
+            return separableConvolution2D(spec, column, row, inSpec, outSpec);
+        }
+    }
+
     std::string fragmentShaderBody;
     {
         std::ostringstream oss;
@@ -350,20 +1060,809 @@ Shader<Unary>::Builder fixedConvolution2D(const FixedConvolution2DSpec &spec, co
 }
 }
 
+/**
+ * Compute shader implementations (FactoryOptions::computeShaders). Each
+ * falls back to the fragment shader implementation if the GL context does
+ * not support compute shaders or the output cannot be bound as an image
+ */
+namespace compute {
+// the minimum GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS in OpenGL ES 3.1
+constexpr int LOCAL_W = 16, LOCAL_H = 8;
+constexpr int LOCAL_SIZE = LOCAL_W * LOCAL_H;
+// the minimum GL_MAX_COMPUTE_SHARED_MEMORY_SIZE
+constexpr int MAX_SHARED_BYTES = 16384;
+
+int divUp(int a, int b) {
+    return (a + b - 1) / b;
+}
+
+bool supportsTypes(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    return inSpec.storageType == ImageTypeSpec::StorageType::GPU_OPENGL &&
+        !getGlslImageFormat(outSpec).empty();
+}
+
+// in the GL thread
+bool isSupported() {
+    if (GlslComputeShader::isSupported()) return true;
+    static std::atomic<bool> warned(false);
+    if (!warned.exchange(true)) log_warn("compute shaders not supported, using fragment shaders");
+    return false;
+}
+
+// imageStore takes all 4 components
+std::string storeValue(const std::string &v, int channels, const ImageTypeSpec &outSpec) {
+    std::ostringstream oss;
+    if (ImageTypeSpec::isIntegerType(outSpec.dataType)) {
+        oss << (ImageTypeSpec::isSigned(outSpec.dataType) ? "i" : "u");
+    }
+    oss << "vec4(";
+    if (outSpec.dataType == ImageTypeSpec::DataType::FLOAT16) oss << glslHalfOverflowToInf(v, channels);
+    else oss << v;
+    if (channels == 2 || channels == 3) oss << ", " << glsl::floatVecType(4 - channels) << "(0)";
+    oss << ")";
+    return oss.str();
+}
+
+int sharedBytesPerPixel(int channels) {
+    return 4 * (channels == 3 ? 4 : channels);
+}
+
+struct ComputeShaderResources : Destroyable {
+    std::vector< std::unique_ptr<GlslComputeShader> > passes;
+    std::vector< std::unique_ptr<ShaderStorageBuffer> > buffers;
+    // the fragment shader implementation, see Fallback
+    std::unique_ptr<Destroyable> fallbackResources;
+
+    // (re)allocated lazily if too small
+    ShaderStorageBuffer &getBuffer(unsigned index, std::size_t size) {
+        if (buffers.size() <= index) buffers.resize(index + 1);
+        auto &buf = buffers.at(index);
+        if (buf && buf->size() < size) {
+            buf->destroy();
+            buf.reset();
+        }
+        if (!buf) buf = ShaderStorageBuffer::create(size);
+        return *buf;
+    }
+
+    void destroy() final {
+        for (auto &p : passes) p->destroy();
+        for (auto &b : buffers) if (b) b->destroy();
+        if (fallbackResources) fallbackResources->destroy();
+        passes.clear();
+        buffers.clear();
+        fallbackResources.reset();
+    }
+};
+
+// The fragment shader implementation for outputs that do not support image
+// stores (e.g., ROIs or the screen), built on first use
+template <class F> class Fallback {
+private:
+    typename Shader<F>::Builder builder;
+    ComputeShaderResources &resources;
+    F function;
+
+public:
+    Fallback(const typename Shader<F>::Builder &builder, ComputeShaderResources &resources) :
+        builder(builder), resources(resources) {}
+
+    F &get() {
+        if (!function) {
+            LOG_TRACE("building fragment shader fallback");
+            auto shader = builder();
+            function = std::move(shader->function);
+            resources.fallbackResources = std::move(shader->resources);
+        }
+        return function;
+    }
+};
+
+/**
+ * Each work group convolves a tile of LOCAL_W x LOCAL_H output pixels. The
+ * input pixels of the tile (and the kernel margins) are first fetched to
+ * shared memory, so each texel is fetched once per tile instead of once per
+ * kernel tap. Separable kernels are then convolved horizontally to a second
+ * shared array and vertically from there, so the two passes take a single
+ * dispatch and no intermediate texture. Border handling is done by the
+ * texture sampler, as in the fragment shader version.
+ */
+struct TiledConvolution {
+    std::string body;
+    int sharedBytes;
+    Image::Border border;
+    ImageTypeSpec inSpec, outSpec;
+
+    TiledConvolution(
+        const FixedConvolution2DSpec &spec,
+        const std::vector<double> *column,
+        const std::vector<double> *row,
+        const ImageTypeSpec &inSpec,
+        const ImageTypeSpec &outSpec)
+    :
+        border(spec.border),
+        inSpec(inSpec),
+        outSpec(outSpec)
+    {
+        const int kernelH = spec.kernel.size();
+        const int kernelW = spec.kernel.at(0).size();
+        const int tileW = (LOCAL_W - 1) * spec.xStride + kernelW;
+        const int tileH = (LOCAL_H - 1) * spec.yStride + kernelH;
+        const bool separable = column != nullptr;
+        const int channels = outSpec.channels;
+        sharedBytes = (tileW * tileH + (separable ? LOCAL_W * tileH : 0)) * sharedBytesPerPixel(channels);
+
+        std::ostringstream oss;
+        oss.precision(10);
+        const auto vtype = glsl::floatVecType(channels);
+        oss << "const int TILE_W = " << tileW << ";\n";
+        oss << "const int TILE_H = " << tileH << ";\n";
+        oss << "shared " << vtype << " tile[TILE_W * TILE_H];\n";
+        if (separable) {
+            oss << "shared " << vtype << " rows[" << LOCAL_W << " * TILE_H];\n";
+        } else {
+            oss << "const float kernel[" << (kernelH * kernelW) << "] = float[" << (kernelH * kernelW) << "](\n";
+            for (int i = 0; i < kernelH; ++i) {
+                if (i > 0) oss << ",\n";
+                for (int j = 0; j < kernelW; ++j) {
+                    if (j > 0) oss << ", ";
+                    oss << "float(" << spec.kernel.at(i).at(j) << ")";
+                }
+            }
+            oss << "\n);\n";
+        }
+
+        oss << "void main() {\n";
+        oss << "vec2 invSize = 1.0 / vec2(textureSize(u_texture, 0));\n";
+        oss << "ivec2 origin = ivec2(gl_WorkGroupID.xy) * ivec2("
+            << (LOCAL_W * spec.xStride) << ", " << (LOCAL_H * spec.yStride) << ") + ivec2("
+            << spec.getKernelXOffset() << ", " << spec.getKernelYOffset() << ");\n";
+        oss << "int index = int(gl_LocalInvocationIndex);\n";
+        oss << "for (int i = index; i < TILE_W * TILE_H; i += " << LOCAL_SIZE << ") {\n";
+        oss << "    vec2 pos = vec2(origin + ivec2(i % TILE_W, i / TILE_W)) + 0.5;\n";
+        oss << "    tile[i] = " << vtype << "(textureLod(u_texture, pos * invSize, 0.0));\n";
+        oss << "}\n";
+        oss << "barrier();\n";
+        oss << "ivec2 local = ivec2(gl_LocalInvocationID.xy);\n";
+        oss << vtype << " v = " << vtype << "(" << spec.bias << ");\n";
+        if (separable) {
+            oss << "for (int i = index; i < " << LOCAL_W << " * TILE_H; i += " << LOCAL_SIZE << ") {\n";
+            oss << "    int base = (i / " << LOCAL_W << ") * TILE_W + (i % " << LOCAL_W << ") * " << spec.xStride << ";\n";
+            oss << "    " << vtype << " h = " << vtype << "(0);\n";
+            for (int j = 0; j < kernelW; ++j) {
+                if (row->at(j) != 0) oss << "    h += float(" << row->at(j) << ") * tile[base + " << j << "];\n";
+            }
+            oss << "    rows[i] = h;\n";
+            oss << "}\n";
+            oss << "barrier();\n";
+            oss << "int base = local.y * " << (spec.yStride * LOCAL_W) << " + local.x;\n";
+            for (int i = 0; i < kernelH; ++i) {
+                if (column->at(i) != 0) oss << "v += float(" << column->at(i) << ") * rows[base + " << (i * LOCAL_W) << "];\n";
+            }
+        } else {
+            oss << "ivec2 base = local * ivec2(" << spec.xStride << ", " << spec.yStride << ");\n";
+            oss << "for (int i = 0; i < " << kernelH << "; i++) {\n";
+            oss << "for (int j = 0; j < " << kernelW << "; j++) {\n";
+            oss << "    v += kernel[i * " << kernelW << " + j] * tile[(base.y + i) * TILE_W + base.x + j];\n";
+            oss << "}\n";
+            oss << "}\n";
+        }
+        oss << "ivec2 coord = ivec2(gl_GlobalInvocationID.xy);\n";
+        oss << "if (coord.x < u_outSize.x && coord.y < u_outSize.y) {\n";
+        oss << "    imageStore(u_output, coord, " << storeValue("v", channels, outSpec) << ");\n";
+        oss << "}\n";
+        oss << "}\n";
+        body = oss.str();
+    }
+
+    bool isSupported() const {
+        return supportsTypes(inSpec, outSpec) && sharedBytes <= MAX_SHARED_BYTES;
+    }
+
+    /** Add the program to the resources (GL thread) */
+    void createPass(ComputeShaderResources &resources) const {
+        resources.passes.push_back(GlslComputeShader::create(body.c_str(), { inSpec }, outSpec, LOCAL_W, LOCAL_H));
+        resources.passes.back()->setTextureBorder(0, border);
+    }
+
+    static void run(GlslComputeShader &pass, Image &input, FrameBuffer &output) {
+        Binder binder(pass);
+        Binder inputBinder(pass.bindTexture(0, input.getTextureId()));
+        pass.dispatch(output,
+            divUp(output.getViewportWidth(), LOCAL_W),
+            divUp(output.getViewportHeight(), LOCAL_H));
+    }
+};
+
+Shader<Unary>::Builder fixedConvolution2D(const FixedConvolution2DSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec, const Shader<Unary>::Builder &fallback) {
+    std::vector<double> column, row;
+    const bool separable = spec.getSeparableFactors(column, row);
+    const TiledConvolution conv(spec,
+        separable ? &column : nullptr,
+        separable ? &row : nullptr,
+        inSpec, outSpec);
+    if (!conv.isSupported()) {
+        LOG_TRACE("convolution not supported by compute shaders (%d bytes of shared memory)", conv.sharedBytes);
+        return fallback;
+    }
+
+    return [conv, fallback]() {
+        if (!isSupported()) return fallback();
+        std::unique_ptr< Shader<Unary> > shader(new Shader<Unary>);
+        std::unique_ptr<ComputeShaderResources> resources(new ComputeShaderResources);
+        conv.createPass(*resources);
+
+        ComputeShaderResources &compute = *resources;
+        shader->resources = std::move(resources);
+        auto fallbackShader = std::make_shared< Fallback<Unary> >(fallback, compute);
+        shader->function = [&compute, fallbackShader](Image &input, Image &output) {
+            FrameBuffer &fb = output.getFrameBuffer();
+            if (!fb.supportsImageStore()) return fallbackShader->get()(input, output);
+            TiledConvolution::run(*compute.passes.at(0), input, fb);
+        };
+
+        return shader;
+    };
+}
+
+/**
+ * One dispatch per level, without intermediate buffers, see
+ * TiledConvolution
+ */
+Shader<MultiOutputNAry>::Builder pyramid(const PyramidSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec, const Shader<MultiOutputNAry>::Builder &fallback) {
+    const auto levelConv = spec.getLevelConvolution();
+    const TiledConvolution first(levelConv, &spec.kernel, &spec.kernel, inSpec, outSpec);
+    const TiledConvolution next(levelConv, &spec.kernel, &spec.kernel, outSpec, outSpec);
+    if (!first.isSupported() || !next.isSupported()) return fallback;
+    const int levels = spec.levels;
+
+    return [first, next, levels, fallback]() {
+        if (!isSupported()) return fallback();
+        std::unique_ptr< Shader<MultiOutputNAry> > shader(new Shader<MultiOutputNAry>);
+        std::unique_ptr<ComputeShaderResources> resources(new ComputeShaderResources);
+        first.createPass(*resources);
+        next.createPass(*resources);
+
+        ComputeShaderResources &compute = *resources;
+        shader->resources = std::move(resources);
+        auto fallbackShader = std::make_shared< Fallback<MultiOutputNAry> >(fallback, compute);
+        shader->function = [&compute, fallbackShader, levels](Image **inputs, int nInputs, Image **outputs, int nOutputs) {
+            aa_assert(nInputs == 1 && nOutputs == levels);
+            for (int level = 0; level < levels; ++level) {
+                if (!outputs[level]->getFrameBuffer().supportsImageStore()) {
+                    return fallbackShader->get()(inputs, nInputs, outputs, nOutputs);
+                }
+            }
+            for (int level = 0; level < levels; ++level) {
+                Image &input = level == 0 ? *inputs[0] : *outputs[level - 1];
+                Image &output = *outputs[level];
+                aa_assert(output.width == PyramidSpec::getLevelSize(input.width, 1));
+                aa_assert(output.height == PyramidSpec::getLevelSize(input.height, 1));
+                TiledConvolution::run(*compute.passes.at(level == 0 ? 0 : 1), input, output.getFrameBuffer());
+            }
+        };
+
+        return shader;
+    };
+}
+
+/**
+ * Reductions in a single dispatch. Each invocation reduces PIXELS x PIXELS
+ * pixels (LOCAL_W and LOCAL_H pixels apart, for coalesced fetches) and each
+ * work group reduces those in shared memory to a partial result in a
+ * storage buffer. The last work group to finish, found with an atomic
+ * counter, reduces the partial results to the output and resets the
+ * counter. Histograms are counted with shared memory atomics per work
+ * group and then added to the counts in the storage buffer, which the
+ * last group writes to the output and clears.
+ */
+struct Reduction {
+    static constexpr int PIXELS = 4;
+    typedef ::accelerated::operations::reduce::Type Type;
+    std::string body;
+    bool histogram;
+    int outputWidth, sharedBytes;
+    ImageTypeSpec inSpec, outSpec;
+
+    // the tree reduction of values[] to values[0] (barrier() is not
+    // allowed in loops)
+    static void sharedReduce(std::ostringstream &oss) {
+        for (int s = LOCAL_SIZE / 2; s > 0; s /= 2) {
+            oss << "if (index < " << s << "u) values[index] = combine(values[index], values[index + " << s << "u]);\n";
+            oss << "barrier();\n";
+        }
+    }
+
+    static void forEachPixel(std::ostringstream &oss, const std::string &statement) {
+        oss << "ivec2 size = textureSize(u_texture, 0);\n";
+        oss << "ivec2 origin = ivec2(gl_WorkGroupID.xy) * ivec2(" << (LOCAL_W * PIXELS) << ", " << (LOCAL_H * PIXELS)
+            << ") + ivec2(gl_LocalInvocationID.xy);\n";
+        oss << "for (int i = 0; i < " << PIXELS << "; i++) {\n";
+        oss << "for (int j = 0; j < " << PIXELS << "; j++) {\n";
+        oss << "    ivec2 coord = origin + ivec2(j * " << LOCAL_W << ", i * " << LOCAL_H << ");\n";
+        oss << "    if (coord.x < size.x && coord.y < size.y) {\n";
+        oss << "        vec4 value = vec4(texelFetch(u_texture, coord, 0));\n";
+        oss << "        " << statement << "\n";
+        oss << "    }\n";
+        oss << "}\n";
+        oss << "}\n";
+    }
+
+    static std::string reduceBody(Type type, const ImageTypeSpec &outSpec) {
+        std::ostringstream oss;
+        std::string identity = "vec4(0)";
+        if (type == Type::MIN) identity = "vec4(3.0e38)";
+        if (type == Type::MAX) identity = "vec4(-3.0e38)";
+
+        oss << "layout(std430, binding = 0) coherent buffer Partials {\n";
+        oss << "    uint finished;\n";
+        oss << "    vec4 partials[];\n";
+        oss << "};\n";
+        oss << "shared vec4 values[" << LOCAL_SIZE << "];\n";
+        oss << "shared bool isLast;\n";
+        oss << "vec4 combine(vec4 a, vec4 b) {\n";
+        switch (type) {
+        case Type::MIN: oss << "return min(a, b);\n"; break;
+        case Type::MAX: oss << "return max(a, b);\n"; break;
+        default: oss << "return a + b;\n"; break;
+        }
+        oss << "}\n";
+
+        oss << "void main() {\n";
+        oss << "uint index = gl_LocalInvocationIndex;\n";
+        oss << "uint nGroups = gl_NumWorkGroups.x * gl_NumWorkGroups.y;\n";
+        oss << "vec4 v = " << identity << ";\n";
+        forEachPixel(oss, "v = combine(v, value);");
+        oss << "values[index] = v;\n";
+        oss << "barrier();\n";
+        sharedReduce(oss);
+        oss << "if (index == 0u) {\n";
+        oss << "    partials[gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x] = values[0];\n";
+        oss << "    memoryBarrierBuffer();\n";
+        oss << "    isLast = atomicAdd(finished, 1u) == nGroups - 1u;\n";
+        oss << "}\n";
+        oss << "barrier();\n";
+        // other groups reduce identities, since barrier() must be reached by all
+        oss << "v = " << identity << ";\n";
+        oss << "if (isLast) {\n";
+        oss << "    for (uint i = index; i < nGroups; i += " << LOCAL_SIZE << "u) v = combine(v, partials[i]);\n";
+        oss << "}\n";
+        oss << "values[index] = v;\n";
+        oss << "barrier();\n";
+        sharedReduce(oss);
+        oss << "if (isLast && index == 0u) {\n";
+        oss << "    v = values[0];\n";
+        if (type == Type::MEAN) oss << "    v /= float(size.x) * float(size.y);\n";
+        oss << "    imageStore(u_output, ivec2(0, 0), " << storeValue("v", 4, outSpec) << ");\n";
+        oss << "    finished = 0u;\n";
+        oss << "}\n";
+        oss << "}\n";
+        return oss.str();
+    }
+
+    static std::string histogramBody(const ReduceSpec &spec, const ImageTypeSpec &outSpec) {
+        std::ostringstream oss;
+        oss.precision(10);
+        const int channels = outSpec.channels;
+        oss << "const uint N_COUNTS = " << (spec.bins * channels) << "u;\n";
+        // same as ReduceSpec::getBin
+        oss << "const float binOffset = float(" << spec.histogramMin << ");\n";
+        oss << "const float binScale = float(" << (spec.bins / (spec.histogramMax - spec.histogramMin)) << ");\n";
+        oss << "layout(std430, binding = 0) coherent buffer Counts {\n";
+        oss << "    uint finished;\n";
+        oss << "    uint counts[];\n";
+        oss << "};\n";
+        oss << "shared uint bins[N_COUNTS];\n";
+        oss << "shared bool isLast;\n";
+
+        oss << "void main() {\n";
+        oss << "uint index = gl_LocalInvocationIndex;\n";
+        oss << "uint nGroups = gl_NumWorkGroups.x * gl_NumWorkGroups.y;\n";
+        oss << "for (uint i = index; i < N_COUNTS; i += " << LOCAL_SIZE << "u) bins[i] = 0u;\n";
+        oss << "barrier();\n";
+        {
+            std::ostringstream statement;
+            statement << "ivec4 bin = ivec4(clamp(floor((value - binOffset) * binScale), 0.0, float(" << (spec.bins - 1) << ")));\n";
+            for (int c = 0; c < channels; ++c) {
+                statement << "        atomicAdd(bins[bin[" << c << "] * " << channels << " + " << c << "], 1u);\n";
+            }
+            forEachPixel(oss, statement.str());
+        }
+        oss << "barrier();\n";
+        oss << "for (uint i = index; i < N_COUNTS; i += " << LOCAL_SIZE << "u) {\n";
+        oss << "    if (bins[i] > 0u) atomicAdd(counts[i], bins[i]);\n";
+        oss << "}\n";
+        oss << "memoryBarrierBuffer();\n";
+        oss << "barrier();\n";
+        oss << "if (index == 0u) isLast = atomicAdd(finished, 1u) == nGroups - 1u;\n";
+        oss << "barrier();\n";
+        oss << "if (isLast) {\n";
+        oss << "    for (uint i = index; i < " << spec.bins << "u; i += " << LOCAL_SIZE << "u) {\n";
+        oss << "        vec4 v = vec4(0);\n";
+        for (int c = 0; c < channels; ++c) {
+            oss << "        v[" << c << "] = float(atomicExchange(counts[i * " << channels << "u + " << c << "u], 0u));\n";
+        }
+        oss << "        imageStore(u_output, ivec2(int(i), 0), " << storeValue("v", 4, outSpec) << ");\n";
+        oss << "    }\n";
+        oss << "    if (index == 0u) finished = 0u;\n";
+        oss << "}\n";
+        oss << "}\n";
+        return oss.str();
+    }
+
+    Reduction(const ReduceSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) :
+        histogram(spec.type == Type::HISTOGRAM),
+        outputWidth(spec.getOutputWidth()),
+        inSpec(inSpec),
+        outSpec(outSpec)
+    {
+        aa_assert(inSpec.channels == outSpec.channels);
+        if (histogram) {
+            aa_assert(spec.bins >= 1 && spec.histogramMax > spec.histogramMin);
+            sharedBytes = 4 * spec.bins * outSpec.channels + 4;
+            body = histogramBody(spec, outSpec);
+        } else {
+            sharedBytes = 16 * LOCAL_SIZE + 4;
+            body = reduceBody(spec.type, outSpec);
+        }
+    }
+
+    bool isSupported() const {
+        return supportsTypes(inSpec, outSpec) && sharedBytes <= MAX_SHARED_BYTES;
+    }
+
+    void createPass(ComputeShaderResources &resources) const {
+        resources.passes.push_back(GlslComputeShader::create(body.c_str(), { inSpec }, outSpec, LOCAL_W, LOCAL_H));
+    }
+
+    void run(ComputeShaderResources &resources, Image &input, FrameBuffer &output) const {
+        aa_assert(output.getViewportWidth() == outputWidth && output.getViewportHeight() == 1);
+        const int groupsX = divUp(input.width, LOCAL_W * PIXELS);
+        const int groupsY = divUp(input.height, LOCAL_H * PIXELS);
+        // the counter (padded to 16 bytes) and the partial results or counts
+        const std::size_t bufferSize = histogram
+            ? 4 * (1 + outputWidth * outSpec.channels)
+            : 16 * (1 + groupsX * groupsY);
+
+        GlslComputeShader &pass = *resources.passes.at(0);
+        Binder binder(pass);
+        Binder inputBinder(pass.bindTexture(0, input.getTextureId()));
+        resources.getBuffer(0, bufferSize).bind(0);
+        pass.dispatch(output, groupsX, groupsY);
+    }
+};
+
+Shader<Unary>::Builder reduce(const ReduceSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec, const Shader<Unary>::Builder &fallback) {
+    const Reduction reduction(spec, inSpec, outSpec);
+    if (!reduction.isSupported()) return fallback;
+
+    return [reduction, fallback]() {
+        if (!isSupported()) return fallback();
+        std::unique_ptr< Shader<Unary> > shader(new Shader<Unary>);
+        std::unique_ptr<ComputeShaderResources> resources(new ComputeShaderResources);
+        reduction.createPass(*resources);
+
+        ComputeShaderResources &compute = *resources;
+        shader->resources = std::move(resources);
+        auto fallbackShader = std::make_shared< Fallback<Unary> >(fallback, compute);
+        shader->function = [&compute, fallbackShader, reduction](Image &input, Image &output) {
+            aa_assert(input == reduction.inSpec);
+            aa_assert(output == reduction.outSpec);
+            FrameBuffer &fb = output.getFrameBuffer();
+            if (!fb.supportsImageStore()) return fallbackShader->get()(input, output);
+            reduction.run(compute, input, fb);
+        };
+
+        return shader;
+    };
+}
+}
+
+// Resolved when the GPU has executed the commands issued before the fence
+struct GpuCompletionState : Future::State, std::enable_shared_from_this<GpuCompletionState> {
+    // blocking waits warn (once) if the GPU takes longer than this
+    static constexpr std::chrono::seconds SLOW_FENCE_WARNING { 5 };
+
+    Processor &processor;
+    std::shared_ptr<FenceTracker> tracker;
+    std::shared_ptr<FenceTracker::Fence> fence;
+    // resolved when the operation has run and the fence has been inserted
+    // in the GL thread. Fails if the operation was not executed
+    Future issued;
+    std::shared_ptr< std::atomic<std::thread::id> > glThread;
+    std::shared_ptr<std::atomic<bool>> pollPending;
+
+    GpuCompletionState(Processor &processor, std::shared_ptr<FenceTracker> tracker, std::shared_ptr< std::atomic<std::thread::id> > glThread) :
+        processor(processor), tracker(tracker),
+        fence(std::make_shared<FenceTracker::Fence>()),
+        issued(std::shared_ptr<Future::State>()),
+        glThread(glThread),
+        pollPending(std::make_shared<std::atomic<bool>>(false))
+    {}
+
+    // in the GL thread
+    static void blockUntilSignaled(FenceTracker &t, const FenceTracker::Fence &f) {
+        if (t.wait(f, SLOW_FENCE_WARNING)) return;
+        log_warn("GPU fence not signaled in %d s, still waiting", int(SLOW_FENCE_WARNING.count()));
+        t.wait(f, std::chrono::nanoseconds::max());
+    }
+
+    void wait() final {
+        aa_assert(std::this_thread::get_id() != glThread->load() && "waiting for a GPU completion Future in the GL thread (deadlock)");
+        issued.wait();
+        if (fence->signaled || issued.isFailed()) return;
+        auto t = tracker;
+        auto f = fence;
+        ScopedUnboundedEnqueue unbounded;
+        processor.enqueue([t, f]() { blockUntilSignaled(*t, *f); }).wait();
+    }
+
+    bool waitFor(std::chrono::nanoseconds timeout) final {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        if (!issued.waitFor(timeout)) return false;
+        if (fence->signaled || issued.isFailed()) return true;
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) return isReady();
+        auto t = tracker;
+        auto f = fence;
+        // the GL thread does not block past the deadline, even if this
+        // task only gets to run after it
+        ScopedUnboundedEnqueue unbounded;
+        processor.enqueue([t, f, deadline]() {
+            t->wait(*f, deadline - std::chrono::steady_clock::now());
+        }).waitFor(deadline - now);
+        return fence->signaled;
+    }
+
+    bool isReady() final {
+        if (!issued.isReady()) return false;
+        if (fence->signaled || issued.isFailed()) return true;
+        // at most one pending poll per Future
+        if (!pollPending->exchange(true)) {
+            auto t = tracker;
+            auto pending = pollPending;
+            ScopedUnboundedEnqueue unbounded;
+            processor.enqueue([t, pending]() {
+                t->poll();
+                *pending = false;
+            });
+        }
+        return false;
+    }
+
+    // the callback is called in the GL thread
+    void onReady(const std::function<void()> &callback) final {
+        auto self = shared_from_this();
+        issued.state->onReady([self, callback]() {
+            if (self->fence->signaled || self->issued.isFailed()) {
+                callback();
+                return;
+            }
+            auto t = self->tracker;
+            auto f = self->fence;
+            ScopedUnboundedEnqueue unbounded;
+            self->processor.enqueue([t, f, callback]() {
+                blockUntilSignaled(*t, *f);
+                callback();
+            });
+        });
+    }
+
+    bool isFailed() final {
+        return issued.isFailed();
+    }
+};
+
+constexpr std::chrono::seconds GpuCompletionState::SLOW_FENCE_WARNING;
+
+// GPU timing statistics per label. begin/end/destroy are called in the GL
+// thread and the rest from any thread
+class Profiler {
+private:
+    static constexpr std::size_t MAX_RECENT_SAMPLES = 1000;
+
+    struct Entry {
+        ProfilingStats stats;
+        std::size_t timedCount = 0;
+        double totalMilliseconds = 0;
+        std::vector<double> recent; // ring buffer
+    };
+
+    std::mutex mutex;
+    std::vector<Entry> entries;
+    std::map<std::string, int> tags;
+    std::unique_ptr<TimerQueries> timers; // created lazily in the GL thread
+
+    void record(int tag, double ms) {
+        // mutex must be locked
+        Entry &e = entries.at(tag);
+        if (e.recent.size() < MAX_RECENT_SAMPLES) e.recent.push_back(ms);
+        else e.recent.at(e.timedCount % MAX_RECENT_SAMPLES) = ms;
+        e.timedCount++;
+        e.totalMilliseconds += ms;
+    }
+
+public:
+    int getTag(const std::string &label) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = tags.find(label);
+        if (it != tags.end()) return it->second;
+        const int tag = entries.size();
+        entries.emplace_back();
+        entries.back().stats.label = label;
+        tags[label] = tag;
+        return tag;
+    }
+
+    void begin(int tag) {
+        if (!timers) timers = TimerQueries::create();
+        timers->poll([this](int t, double ms) {
+            std::lock_guard<std::mutex> lock(mutex);
+            record(t, ms);
+        });
+        timers->begin(tag);
+    }
+
+    void end(int tag, std::size_t pixels) {
+        timers->end();
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry &e = entries.at(tag);
+        e.stats.count++;
+        e.stats.pixels += pixels;
+    }
+
+    std::vector<ProfilingStats> getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<ProfilingStats> result;
+        for (const auto &e : entries) {
+            ProfilingStats stats = e.stats;
+            if (e.timedCount > 0) {
+                stats.meanGpuMilliseconds = e.totalMilliseconds / e.timedCount;
+                auto sorted = e.recent;
+                std::sort(sorted.begin(), sorted.end());
+                std::size_t idx = std::size_t(std::ceil(0.99 * sorted.size()));
+                stats.p99GpuMilliseconds = sorted.at(std::max(idx, std::size_t(1)) - 1);
+            }
+            result.push_back(stats);
+        }
+        return result;
+    }
+
+    void destroy() {
+        if (timers) timers->destroy();
+        timers.reset();
+    }
+};
+
+template <class Call> void runOperation(const std::shared_ptr<Profiler> &profiler, int tag, std::size_t pixels, const Call &call) {
+    if (profiler) profiler->begin(tag);
+    call();
+    if (profiler) profiler->end(tag, pixels);
+    checkOperationErrors("GPU operation");
+}
+
+// Forwards to another image, but with its texture ID and frame buffer
+// looked up once per CommandList replay instead of once per operation
+class ResolvedImage : public Image {
+private:
+    Image &image;
+    int textureId = 0;
+    FrameBuffer *frameBuffer = nullptr;
+
+public:
+    bool usedAsInput = false, usedAsOutput = false;
+
+    ResolvedImage(Image &image) : Image(image.width, image.height, image), image(image) {}
+
+    // in the GL thread. Also syncs pending transfers to the image
+    void resolve() {
+        if (usedAsInput) textureId = image.getTextureId();
+        if (usedAsOutput) frameBuffer = &image.getFrameBuffer();
+    }
+
+    int getTextureId() const final { return textureId; }
+    FrameBuffer &getFrameBuffer() final { return *frameBuffer; }
+    bool supportsDirectRead() const final { return image.supportsDirectRead(); }
+    bool supportsDirectWrite() const final { return image.supportsDirectWrite(); }
+    Border getBorder() const final { return image.getBorder(); }
+    void setBorder(Border b) final { image.setBorder(b); }
+    Interpolation getInterpolation() const final { return image.getInterpolation(); }
+    void setInterpolation(Interpolation i) final { image.setInterpolation(i); }
+    Future readRaw(std::uint8_t *outputData) final { return image.readRaw(outputData); }
+    Future writeRaw(const std::uint8_t *inputData) final { return image.writeRaw(inputData); }
+    Future readRaw(std::uint8_t *outputData, std::size_t rowPitch) final { return image.readRaw(outputData, rowPitch); }
+    Future writeRaw(const std::uint8_t *inputData, std::size_t rowPitch) final { return image.writeRaw(inputData, rowPitch); }
+    std::unique_ptr<::accelerated::Image> createROI(int x0, int y0, int w, int h) final {
+        return image.createROI(x0, y0, w, h);
+    }
+};
+
+// What is needed for recording a call of a Function to a CommandList
+struct RecordableOperation {
+    // returns the shader function, in the GL thread
+    std::function<MultiOutputNAry()> resolve;
+    std::shared_ptr<Profiler> profiler;
+    int tag = 0;
+};
+
+struct RecordedCall {
+    std::shared_ptr<RecordableOperation> operation;
+    MultiOutputNAry function; // resolved on the first replay
+    std::vector<Image*> inputs, outputs;
+};
+
+class CommandRecorder {
+private:
+    std::map<::accelerated::Image*, std::size_t> imageIndex;
+
+    Image *resolved(::accelerated::Image *image, bool output) {
+        auto it = imageIndex.find(image);
+        if (it == imageIndex.end()) {
+            it = imageIndex.insert({ image, images.size() }).first;
+            images.emplace_back(new ResolvedImage(Image::castFrom(*image)));
+        }
+        auto &r = *images.at(it->second);
+        if (output) r.usedAsOutput = true;
+        else r.usedAsInput = true;
+        return &r;
+    }
+
+public:
+    const void *owner;
+    std::vector< std::unique_ptr<ResolvedImage> > images;
+    std::vector<RecordedCall> calls;
+
+    CommandRecorder(const void *owner) : owner(owner) {}
+
+    void add(const std::shared_ptr<RecordableOperation> &op,
+        ::accelerated::Image **inputs, int nInputs,
+        ::accelerated::Image **outputs, int nOutputs)
+    {
+        RecordedCall call;
+        call.operation = op;
+        for (int i = 0; i < nInputs; ++i) call.inputs.push_back(resolved(inputs[i], false));
+        for (int i = 0; i < nOutputs; ++i) call.outputs.push_back(resolved(outputs[i], true));
+        calls.push_back(std::move(call));
+    }
+
+    // in the GL thread
+    void replay() {
+        for (auto &image : images) image->resolve();
+        for (auto &call : calls) {
+            if (!call.function) call.function = call.operation->resolve();
+            const auto &out = *call.outputs.at(0);
+            runOperation(call.operation->profiler, call.operation->tag, std::size_t(out.width) * out.height, [&call]() {
+                call.function(call.inputs.data(), call.inputs.size(), call.outputs.data(), call.outputs.size());
+            });
+        }
+    }
+};
+
+// set in Factory::record, per thread
+thread_local CommandRecorder *activeRecorder = nullptr;
+
 class GpuFactory : public Factory {
 public:
     // used to enable convenient weak_ptr
     struct Data {
         Processor &processor;
         bool debug = false;
+        // only used if options.gpuCompletionFutures is set
+        std::shared_ptr<FenceTracker> fences;
+        // only used if options.gpuTimers is set
+        std::shared_ptr<Profiler> profiler;
+        std::string profilingLabel;
+        bool computeShaders = false;
+        // set by the GL thread tasks, see GpuCompletionState
+        const std::shared_ptr< std::atomic<std::thread::id> > glThread = std::make_shared< std::atomic<std::thread::id> >();
         Data(Processor &processor) : processor(processor) {}
     };
 private:
     std::shared_ptr<Data> data;
 
-    class ShaderWrapper {
+    template <class F> class ShaderWrapper {
     private:
-        typedef Shader<NAry> S;
+        typedef Shader<F> S;
         std::weak_ptr<Data> data;
         std::shared_ptr< S > shader;
 
@@ -375,10 +1874,19 @@ private:
             auto d = data.lock();
             aa_assert(d);
             if (d->debug) {
-                // TODO: hacky
-                auto &p = reinterpret_cast<GlslPipeline&>(*tmp->resources);
-                log_debug("vertex shader:\n%s", p.getVertexShaderSource().c_str());
-                log_debug("fragment shader:\n%s", p.getFragmentShaderSource().c_str());
+                std::vector<const GlslProgram*> programs;
+                if (auto *multiPass = dynamic_cast<const MultiPassShader*>(tmp->resources.get())) {
+                    for (const auto &p : multiPass->passes) programs.push_back(p.get());
+                } else if (auto *p = dynamic_cast<const GlslProgram*>(tmp->resources.get())) {
+                    programs.push_back(p);
+                }
+                if (auto *compute = dynamic_cast<const compute::ComputeShaderResources*>(tmp->resources.get())) {
+                    for (const auto &p : compute->passes) log_debug("compute shader:\n%s", p->getComputeShaderSource().c_str());
+                }
+                for (const auto *p : programs) {
+                    log_debug("vertex shader:\n%s", p->getVertexShaderSource().c_str());
+                    log_debug("fragment shader:\n%s", p->getFragmentShaderSource().c_str());
+                }
             }
             std::atomic_store(&shader, tmp);
         }
@@ -387,6 +1895,7 @@ private:
             std::shared_ptr<S> tmp = std::atomic_load(&shader);
             if (tmp) {
                 if (auto d = data.lock()) {
+                    ScopedUnboundedEnqueue unbounded;
                     d->processor.enqueue([tmp]() {
                         if (tmp->resources) tmp->resources->destroy();
                         tmp->resources.reset();
@@ -397,7 +1906,7 @@ private:
             }
         }
 
-        NAry &get() {
+        F &get() {
             // should never be called at the same time with other actions
             std::shared_ptr<S> tmp = std::atomic_load(&shader);
             aa_assert(tmp && tmp->function);
@@ -406,68 +1915,310 @@ private:
     };
 
 public:
-    GpuFactory(Processor &processor) : data(new Data(processor)) {}
+    GpuFactory(Processor &processor, const FactoryOptions &options) : data(new Data(processor)) {
+        if (options.gpuCompletionFutures) data->fences = FenceTracker::create();
+        if (options.gpuTimers) data->profiler = std::make_shared<Profiler>();
+        data->computeShaders = options.computeShaders;
+    }
+
+    ~GpuFactory() {
+        ScopedUnboundedEnqueue unbounded;
+        if (data->fences) {
+            auto fences = data->fences;
+            data->processor.enqueue([fences]() { fences->destroy(); });
+        }
+        if (data->profiler) {
+            auto profiler = data->profiler;
+            data->processor.enqueue([profiler]() { profiler->destroy(); });
+        }
+    }
 
     void debugLogShaders(bool enabled) {
         data->debug = enabled;
     }
 
+    void setProfilingLabel(const std::string &label) final {
+        data->profilingLabel = label;
+    }
+
+    std::vector<ProfilingStats> getProfilingStats() final {
+        if (!data->profiler) return {};
+        return data->profiler->getStats();
+    }
+
     Function wrapShader(
         const std::string &fragmentShaderBody,
         const std::vector<ImageTypeSpec> &inputs,
         const ImageTypeSpec &output) final {
-        return wrapNAry(defaultNAryBuilder(fragmentShaderBody, inputs, output));
+        return wrapLabeled(defaultNAryBuilder(fragmentShaderBody, inputs, output), "shader");
     };
 
     Function wrapNAry(const Shader<NAry>::Builder &builder) final {
-        std::shared_ptr<ShaderWrapper> wrapper(new ShaderWrapper(data));
-        data->processor.enqueue([builder, wrapper]() { wrapper->initialize(builder()); });
-        return ::accelerated::operations::sync::wrap<Image>([wrapper](Image **inputs, int nInputs, Image &output) {
-            wrapper->get()(inputs, nInputs, output);
-        }, data->processor);
+        return wrapLabeled(builder, "custom");
     }
 
+    MultiOutputFunction wrapShader(
+        const std::string &fragmentShaderBody,
+        const std::vector<ImageTypeSpec> &inputs,
+        const std::vector<ImageTypeSpec> &outputs) final {
+        for (const auto &spec : outputs) checkSpec(spec);
+        return wrapMultiOutputLabeled(multiOutputBuilder(fragmentShaderBody, inputs, outputs), "shader");
+    }
+
+    MultiOutputFunction wrapMultiOutput(const Shader<MultiOutputNAry>::Builder &builder) final {
+        return wrapMultiOutputLabeled(builder, "custom");
+    }
+
+    CommandList record(const std::function<void()> &calls) final {
+        aa_assert(!activeRecorder && "nested recording");
+        auto recorder = std::make_shared<CommandRecorder>(data.get());
+        activeRecorder = recorder.get();
+        calls();
+        activeRecorder = nullptr;
+
+        Processor &processor = data->processor;
+        std::shared_ptr<FenceTracker> fences = data->fences;
+        auto glThread = data->glThread;
+        return [recorder, &processor, fences, glThread]() -> Future {
+            tracing::ScopedLabel scopedLabel("commandList");
+            if (!fences) return processor.enqueue([recorder]() { recorder->replay(); });
+            return completionFuture(processor, fences, glThread, [recorder, &processor](const std::function<void()> &insertFence) {
+                return processor.enqueue([recorder, insertFence]() {
+                    recorder->replay();
+                    insertFence();
+                });
+            });
+        };
+    }
+
+private:
+    template <class F> std::shared_ptr< ShaderWrapper<F> > initialize(const typename Shader<F>::Builder &builder) {
+        std::shared_ptr< ShaderWrapper<F> > wrapper(new ShaderWrapper<F>(data));
+        auto glThread = data->glThread;
+        // the Function cannot be used if this fails
+        ScopedUnboundedEnqueue unbounded;
+        data->processor.enqueue([builder, wrapper, glThread]() {
+            *glThread = std::this_thread::get_id();
+            wrapper->initialize(builder());
+            checkOperationErrors("shader initialization");
+        });
+        return wrapper;
+    }
+
+    const char *tracingLabel(const char *defaultLabel) {
+        if (data->profilingLabel.empty()) return defaultLabel;
+        return tracing::intern(data->profilingLabel);
+    }
+
+    int profilingTag(const char *defaultLabel) {
+        if (!data->profiler) return 0;
+        return data->profiler->getTag(data->profilingLabel.empty() ? defaultLabel : data->profilingLabel);
+    }
+
+    /**
+     * Future resolved when the GPU has executed an operation. enqueueOp must
+     * enqueue the operation and call insertFence after it in the same task
+     */
+    static Future completionFuture(Processor &processor, const std::shared_ptr<FenceTracker> &fences,
+        const std::shared_ptr< std::atomic<std::thread::id> > &glThread,
+        const std::function<Future(const std::function<void()> &insertFence)> &enqueueOp)
+    {
+        auto state = std::make_shared<GpuCompletionState>(processor, fences, glThread);
+        auto fence = state->fence;
+        state->issued = enqueueOp([fences, fence, glThread]() {
+            fences->insert(fence);
+            *glThread = std::this_thread::get_id();
+        });
+        return Future(state);
+    }
+
+    template <class T> Function wrapLabeled(const typename Shader<T>::Builder &builder, const char *defaultLabel) {
+        return wrapLabeled(convertToNAry<T>(builder), defaultLabel);
+    }
+
+    Function wrapLabeled(const Shader<NAry>::Builder &builder, const char *defaultLabel) {
+        auto wrapper = initialize<NAry>(builder);
+        auto op = std::make_shared<RecordableOperation>();
+        op->resolve = [wrapper]() -> MultiOutputNAry {
+            NAry &f = wrapper->get();
+            return [&f](Image **inputs, int nInputs, Image **outputs, int nOutputs) {
+                aa_assert(nOutputs == 1); (void)nOutputs;
+                f(inputs, nInputs, *outputs[0]);
+            };
+        };
+        op->profiler = data->profiler;
+        op->tag = profilingTag(defaultLabel);
+        const std::function<void(Image **inputs, int nInputs, Image &output)> body = [wrapper, op](Image **inputs, int nInputs, Image &output) {
+            runOperation(op->profiler, op->tag, std::size_t(output.width) * output.height, [&]() {
+                wrapper->get()(inputs, nInputs, output);
+            });
+        };
+        auto function = ::accelerated::operations::sync::wrap<Image>(body, data->processor);
+
+        Processor &processor = data->processor;
+        std::shared_ptr<FenceTracker> fences = data->fences;
+        auto glThread = data->glThread;
+        const void *owner = data.get();
+        const char *label = tracingLabel(defaultLabel);
+        return [function, body, op, owner, label, &processor, fences, glThread](::accelerated::Image **inputs, int nInputs, ::accelerated::Image &output) -> Future {
+            tracing::ScopedLabel scopedLabel(label);
+            if (activeRecorder && activeRecorder->owner == owner) {
+                ::accelerated::Image *outputs[1] = { &output };
+                activeRecorder->add(op, inputs, nInputs, outputs, 1);
+                return Future::instantlyResolved();
+            }
+            if (!fences) return function(inputs, nInputs, output);
+            // run the operation and insert the fence in the same task
+            return completionFuture(processor, fences, glThread, [&](const std::function<void()> &insertFence) {
+                return ::accelerated::operations::sync::wrapBody<Image>([body, insertFence](Image **in, int nIn, Image &out) {
+                    body(in, nIn, out);
+                    insertFence();
+                }, inputs, nInputs, output, processor);
+            });
+        };
+    }
+
+    MultiOutputFunction wrapMultiOutputLabeled(const Shader<MultiOutputNAry>::Builder &builder, const char *defaultLabel) {
+        auto wrapper = initialize<MultiOutputNAry>(builder);
+        auto op = std::make_shared<RecordableOperation>();
+        op->resolve = [wrapper]() -> MultiOutputNAry { return wrapper->get(); };
+        op->profiler = data->profiler;
+        op->tag = profilingTag(defaultLabel);
+        const std::function<void(Image **inputs, int nInputs, Image **outputs, int nOutputs)> body = [wrapper, op](Image **inputs, int nInputs, Image **outputs, int nOutputs) {
+            runOperation(op->profiler, op->tag, std::size_t(outputs[0]->width) * outputs[0]->height, [&]() {
+                wrapper->get()(inputs, nInputs, outputs, nOutputs);
+            });
+        };
+        auto function = ::accelerated::operations::sync::wrapMultiOutput<Image>(body, data->processor);
+
+        Processor &processor = data->processor;
+        std::shared_ptr<FenceTracker> fences = data->fences;
+        auto glThread = data->glThread;
+        const void *owner = data.get();
+        const char *label = tracingLabel(defaultLabel);
+        return [function, body, op, owner, label, &processor, fences, glThread](::accelerated::Image **inputs, int nInputs, ::accelerated::Image **outputs, int nOutputs) -> Future {
+            tracing::ScopedLabel scopedLabel(label);
+            if (activeRecorder && activeRecorder->owner == owner) {
+                activeRecorder->add(op, inputs, nInputs, outputs, nOutputs);
+                return Future::instantlyResolved();
+            }
+            if (!fences) return function(inputs, nInputs, outputs, nOutputs);
+            // run the operation and insert the fence in the same task
+            return completionFuture(processor, fences, glThread, [&](const std::function<void()> &insertFence) {
+                return ::accelerated::operations::sync::wrapMultiOutput<Image>([body, insertFence](Image **in, int nIn, Image **out, int nOut) {
+                    body(in, nIn, out, nOut);
+                    insertFence();
+                }, processor)(inputs, nInputs, outputs, nOutputs);
+            });
+        };
+    }
+
+public:
     Function create(const FixedConvolution2DSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
         checkSpec(inSpec);
         checkSpec(outSpec);
-        return wrap<Unary>(impl::fixedConvolution2D(spec, inSpec, outSpec));
+        auto builder = impl::fixedConvolution2D(spec, inSpec, outSpec);
+        if (data->computeShaders) builder = compute::fixedConvolution2D(spec, inSpec, outSpec, builder);
+        return wrapLabeled<Unary>(builder, "fixedConvolution2D");
     }
 
     Function create(const FillSpec &spec, const ImageTypeSpec &imageSpec) final {
         checkSpec(imageSpec);
-        return wrapNAry(impl::fill(spec, imageSpec));
+        return wrapLabeled(impl::fill(spec, imageSpec), "fill");
     }
 
     Function create(const RescaleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
         checkSpec(inSpec);
         checkSpec(outSpec);
-        return wrap<Unary>(impl::rescale(spec, inSpec, outSpec));
+        return wrapLabeled<Unary>(impl::rescale(spec, inSpec, outSpec), "rescale");
     }
 
     Function create(const SwizzleSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
         checkSpec(inSpec);
         checkSpec(outSpec);
-        return wrap<Unary>(impl::swizzle(spec, inSpec, outSpec));
+        return wrapLabeled<Unary>(impl::swizzle(spec, inSpec, outSpec), "swizzle");
     }
 
     Function create(const PixelwiseAffineCombinationSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
         checkSpec(inSpec);
         checkSpec(outSpec);
-        return wrapNAry(impl::pixelwiseAffineCombination(spec, inSpec, outSpec));
+        return wrapLabeled(impl::pixelwiseAffineCombination(spec, inSpec, outSpec), "pixelwiseAffineCombination");
     }
 
     Function create(const ChannelwiseAffineSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
         checkSpec(inSpec);
         checkSpec(outSpec);
-        return wrapNAry(impl::channelwiseAffine(spec, inSpec, outSpec));
+        return wrapLabeled(impl::channelwiseAffine(spec, inSpec, outSpec), "channelwiseAffine");
+    }
+
+    Function create(const PixelwiseChainSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
+        checkSpec(inSpec);
+        checkSpec(outSpec);
+        return wrapLabeled(impl::pixelwiseChain(spec, inSpec, outSpec), "pixelwiseChain");
+    }
+
+    Function create(const YuvToRgbSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
+        checkSpec(inSpec);
+        checkSpec(outSpec);
+        return wrapLabeled(impl::yuvToRgb(spec, inSpec, outSpec), "yuvToRgb");
+    }
+
+    Function create(const WarpSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
+        checkSpec(inSpec);
+        checkSpec(outSpec);
+        return wrapLabeled(impl::warp(spec, inSpec, outSpec), "warp");
+    }
+
+    Function create(const ReduceSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
+        checkSpec(inSpec);
+        checkSpec(outSpec);
+        auto builder = impl::reduce(spec, inSpec, outSpec);
+        if (data->computeShaders) builder = compute::reduce(spec, inSpec, outSpec, builder);
+        return wrapLabeled<Unary>(builder, "reduce");
+    }
+
+    MultiOutputFunction create(const PyramidSpec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) final {
+        checkSpec(inSpec);
+        checkSpec(outSpec);
+        auto builder = impl::pyramid(spec, inSpec, outSpec);
+        if (data->computeShaders) builder = compute::pyramid(spec, inSpec, outSpec, builder);
+        return wrapMultiOutputLabeled(builder, "pyramid");
     }
 };
 }
 
 std::unique_ptr<Factory> createFactory(Processor &processor) {
-    return std::unique_ptr<Factory>(new GpuFactory(processor));
+    return createFactory(processor, FactoryOptions());
 }
 
+std::unique_ptr<Factory> createFactory(Processor &processor, const FactoryOptions &options) {
+    return std::unique_ptr<Factory>(new GpuFactory(processor, options));
 }
+}
+
+void setProgramBinaryCacheDirectory(const std::string &directory) {
+    programCache::setBinaryDirectory(directory);
+}
+
+void setCurrentContext(const void *context) {
+    programCache::setCurrentContext(context);
+}
+
+void forgetContext(const void *context) {
+    programCache::forgetContext(context);
+}
+
+void setStateCaching(bool enabled) {
+    glState::setCaching(enabled);
+}
+
+void invalidateStateCache() {
+    glState::invalidate();
+}
+
+void setPerOperationErrorChecks(bool enabled) {
+    glState::setPerOperationErrorChecks(enabled);
+}
+
 }
 }
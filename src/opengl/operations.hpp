@@ -12,6 +12,7 @@ typedef std::function< void(Image **inputs, int nInputs, Image &output) > NAry;
 typedef std::function< void(Image &output) > Nullary;
 typedef std::function< void(Image &input, Image &output) > Unary;
 typedef std::function< void(Image &a, Image &b, Image &output) > Binary;
+typedef std::function< void(Image **inputs, int nInputs, Image **outputs, int nOutputs) > MultiOutputNAry;
 
 template <class F> struct Shader {
     /** Will be invoked in the GL thread */
@@ -25,6 +26,22 @@ template <class F> struct Shader {
     typedef std::function< std::unique_ptr<Shader<F>>() > Builder;
 };
 
+/**
+ * A recorded sequence of GPU operations, see Factory::record. Each call
+ * replays the whole sequence and returns a Future for all of it
+ */
+typedef std::function< Future() > CommandList;
+
+struct ProfilingStats {
+    std::string label;
+    /** Number of calls and output pixels, including calls not yet timed */
+    std::size_t count = 0;
+    std::size_t pixels = 0;
+    /** GPU time statistics over the timed calls (p99 over the recent ones) */
+    double meanGpuMilliseconds = 0;
+    double p99GpuMilliseconds = 0;
+};
+
 class Factory : public ::accelerated::operations::StandardFactory {
 public:
     /**
@@ -43,9 +60,48 @@ public:
         const std::vector<ImageTypeSpec> &inputs,
         const ImageTypeSpec &output) = 0;
 
+    /**
+     * Shader with several outputs of the same size (multiple render
+     * targets), which the fragment shader body writes to outValue1,
+     * outValue2, ... The maximum number is GL_MAX_DRAW_BUFFERS (at least 4).
+     * Useful when the outputs are computed from the same texture fetches.
+     */
+    virtual ::accelerated::operations::MultiOutputFunction wrapShader(
+        const std::string &fragmentShaderBody,
+        const std::vector<ImageTypeSpec> &inputs,
+        const std::vector<ImageTypeSpec> &outputs) = 0;
+
+    virtual ::accelerated::operations::MultiOutputFunction wrapMultiOutput(const Shader<MultiOutputNAry>::Builder &builder) = 0;
+
+    /**
+     * Record the calls to the Functions of this factory made in the given
+     * function (in the calling thread) into a CommandList instead of
+     * running them. The shader programs, textures and frame buffers are
+     * looked up once per replay instead of once per operation, and the
+     * whole list costs a single Processor::enqueue and Future, which pays
+     * off with many small operations per frame. The Futures returned by
+     * the recorded calls are meaningless (instantly resolved). The images
+     * must outlive the CommandList.
+     */
+    virtual CommandList record(const std::function<void()> &calls) = 0;
+
     virtual void debugLogShaders(bool enabled) = 0;
 
-private:
+    /**
+     * Label for the profiling statistics and traces (see tracing.hpp) of
+     * the Functions created after this call. If empty (the default), the
+     * Functions are labeled by the operation type, e.g., "rescale".
+     */
+    virtual void setProfilingLabel(const std::string &label) = 0;
+
+    /**
+     * GPU timing statistics for each label, if FactoryOptions::gpuTimers is
+     * set. The timings are collected asynchronously in the GL thread so the
+     * latest calls may not be included yet.
+     */
+    virtual std::vector<ProfilingStats> getProfilingStats() = 0;
+
+protected:
     template <class T> static Shader<NAry>::Builder convertToNAry(const typename Shader<T>::Builder &otherAryBuilder) {
         return [otherAryBuilder]() {
            auto otherAry = otherAryBuilder();
@@ -57,9 +113,88 @@ private:
     }
 };
 
+struct FactoryOptions {
+    /**
+     * If true, the Futures returned by the Functions of the factory are
+     * resolved when the GPU has executed the operation (tracked with GL
+     * sync objects), instead of when the commands have been issued in the
+     * GL thread. Waiting for or polling these Futures with waitFor and
+     * isReady may enqueue work to the processor, and wait() must not be
+     * called in the GL thread.
+     */
+    bool gpuCompletionFutures = false;
+
+    /**
+     * Time each operation on the GPU with timer queries (GL_TIME_ELAPSED,
+     * or EXT_disjoint_timer_query in OpenGL ES) and collect the results,
+     * see Factory::getProfilingStats
+     */
+    bool gpuTimers = false;
+
+    /**
+     * Compute fixedConvolution2D, reduce and pyramid with compute shaders
+     * (OpenGL ES 3.1 / OpenGL 4.3) if the GL context supports them. The
+     * convolutions fetch the input pixels of each tile once to shared
+     * memory instead of once per kernel tap, and the reductions and each
+     * pyramid level take a single dispatch. Falls back to the fragment
+     * shaders otherwise and for outputs that cannot be bound as images,
+     * e.g., ROIs, the screen, 3-channel types and, in OpenGL ES, 2-channel
+     * and most 1-channel types. Has no effect unless the library is built
+     * with compute shader support (WITH_COMPUTE_SHADERS in CMake).
+     */
+    bool computeShaders = false;
+};
+
 std::unique_ptr<Factory> createFactory(Processor &processor);
+std::unique_ptr<Factory> createFactory(Processor &processor, const FactoryOptions &options);
 }
 
+/**
+ * Store linked GLSL programs as program binaries in the given (existing)
+ * directory, so that they do not need to be recompiled on the next run.
+ * The binaries are invalidated if the GL driver changes. Identical programs
+ * are always shared in memory. An empty string disables persistence (the
+ * default).
+ */
+void setProgramBinaryCacheDirectory(const std::string &directory);
+
+/**
+ * Identify the GL context of the calling thread. The linked programs and
+ * the tracked GL state are cached per context. By default, the key is the
+ * current EGL context in OpenGL ES builds and otherwise the thread, which
+ * is fine if each thread only uses one context. Set automatically by the
+ * GLFW processors. Pass nullptr to restore the default.
+ */
+void setCurrentContext(const void *context);
+
+/**
+ * Forget the cached programs and GL state of a destroyed or lost context,
+ * by default the current one. A recreated context may reuse the key and
+ * the program IDs of the old one, so call this in the GL thread after a
+ * context loss (e.g., in GLSurfaceView.Renderer.onSurfaceCreated on
+ * Android with Processor::createQueue) before using the library in the new
+ * context. The Images and Functions of the old context must not be used.
+ */
+void forgetContext(const void *context = nullptr);
+
+/**
+ * Track the GL state set by this library and skip redundant binds,
+ * texture parameter updates and state queries (such as glIsEnabled). The
+ * previous state is then also not restored after each operation. Only safe
+ * if nothing else modifies the GL state of the contexts (or deletes their
+ * textures), or if invalidateStateCache() is called after doing so.
+ * Disabled by default.
+ */
+void setStateCaching(bool enabled);
+/** Forget the tracked GL state of all contexts */
+void invalidateStateCache();
+/**
+ * Only check glGetError once after each operation instead of after each
+ * GL call, which can stall the pipeline on some drivers. Errors are still
+ * fatal, but harder to locate. Disabled by default.
+ */
+void setPerOperationErrorChecks(bool enabled);
+
 enum class GLFWProcessorMode {
     /** Prefer ASYNC but fall back to SYNC if that's not available (on Mac) */
     AUTO,
@@ -82,6 +217,16 @@ enum class GLFWProcessorMode {
 std::unique_ptr<Processor> createGLFWProcessor(GLFWProcessorMode mode = GLFWProcessorMode::AUTO);
 
 
+/**
+ * Create a processor with its own thread and a hidden GLFW context that
+ * shares textures and other objects with the context of the given
+ * processor, which must be from createGLFWProcessor or createGLFWWindow in
+ * ASYNC mode. Use as Image::FactoryOptions::transferProcessor to overlap
+ * uploads and readbacks with the operations. Must be destroyed before
+ * glfwProcessor.
+ */
+std::unique_ptr<Processor> createGLFWTransferProcessor(Processor &glfwProcessor);
+
 /**
  * Same as createGLFWProcessor but with a visible window of given size
  * and title. To draw to the window, first create an opengl::Image::Factory,
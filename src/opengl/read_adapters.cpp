@@ -1,4 +1,5 @@
 #include <cstring>
+#include <mutex>
 
 #include "read_adapters.hpp"
 #include "glsl_helpers.hpp"
@@ -10,38 +11,80 @@ namespace opengl {
 namespace operations {
 namespace {
 struct Adapter {
-    std::vector<std::uint8_t> cpuBuffer;
-    std::function<void(std::uint8_t*)> cpuFunction;
+    // (input, output, output row pitch)
+    std::function<void(const std::uint8_t*, std::uint8_t*, std::size_t)> cpuFunction;
 
     std::unique_ptr<::accelerated::Image> buffer;
     ::accelerated::operations::Function function;
 
     bool setRepackFunction(const Image &image) {
         if (buffer->size() == image.size()) return false;
-        cpuBuffer.resize(buffer->size());
         const int origRowWidth = image.width * image.bytesPerPixel();
         const int bufRowWidth = buffer->width * buffer->bytesPerPixel();
         aa_assert(origRowWidth < bufRowWidth);
         log_debug("repacking to rows of %d bytes from rows of length %d", origRowWidth, bufRowWidth);
 
-        cpuFunction = [this, origRowWidth, bufRowWidth](std::uint8_t *out) {
+        cpuFunction = [this, origRowWidth, bufRowWidth](const std::uint8_t *in, std::uint8_t *out, std::size_t outPitch) {
             const int nRows = buffer->height;
 
-            //for (const auto &el : cpuBuffer) LOG_TRACE("cpu-buffer-unpacked: %d", int(el));
-
-            int inOffset = 0, outOffset = 0;
+            std::size_t inOffset = 0, outOffset = 0;
             for (int i = 0; i < nRows; ++i) {
-                std::memcpy(out + outOffset, cpuBuffer.data() + inOffset, origRowWidth);
-                outOffset += origRowWidth;
+                std::memcpy(out + outOffset, in + inOffset, origRowWidth);
+                outOffset += outPitch;
                 inOffset += bufRowWidth;
             }
-            //for (const auto &el : cpuBuffer) LOG_TRACE("cpu-buffer-packed: %d", int(el));
-            aa_assert(inOffset == int(buffer->size()));
+            aa_assert(inOffset == buffer->size());
         };
         return true;
     }
 };
 
+// CPU repacking after the GPU read, which may be asynchronous. Each read
+// has its own temporary buffer so several reads can be in flight
+struct RepackState : Future::State, std::enable_shared_from_this<RepackState> {
+    Future read;
+    std::shared_ptr<Adapter> adapter;
+    std::vector<std::uint8_t> buffer;
+    std::uint8_t *outData;
+    std::size_t outPitch;
+    std::once_flag repacked;
+
+    RepackState(std::shared_ptr<Adapter> adapter, std::uint8_t *outData, std::size_t outPitch) :
+        read(std::shared_ptr<Future::State>()), adapter(adapter),
+        buffer(adapter->buffer->size()), outData(outData), outPitch(outPitch)
+    {}
+
+    void repack() {
+        std::call_once(repacked, [this]() {
+            LOG_TRACE("CPU copy");
+            adapter->cpuFunction(buffer.data(), outData, outPitch);
+        });
+    }
+
+    void wait() final {
+        read.wait();
+        repack();
+    }
+
+    bool waitFor(std::chrono::nanoseconds timeout) final {
+        if (!read.waitFor(timeout)) return false;
+        repack();
+        return true;
+    }
+
+    bool isReady() final {
+        return waitFor(std::chrono::nanoseconds(0));
+    }
+
+    void onReady(const std::function<void()> &callback) final {
+        auto self = shared_from_this();
+        read.state->onReady([self, callback]() {
+            self->repack();
+            callback();
+        });
+    }
+};
+
 operations::Shader<Unary>::Builder createFunction(const Image &img, int targetChannels, int &targetWidth) {
     int origChannelsPerRow = img.channels * img.width;
 
@@ -96,9 +139,8 @@ operations::Shader<Unary>::Builder createFunction(const Image &img, int targetCh
 }
 }
 
-std::function<Future(std::uint8_t*)> createReadAdpater(
+std::function<Future(std::uint8_t*, std::size_t)> createReadAdpater(
     Image &image,
-    Processor &processor,
     Image::Factory &imageFactory,
     Factory &opFactory)
 {
@@ -135,18 +177,17 @@ std::function<Future(std::uint8_t*)> createReadAdpater(
         log_warn("image read dimensions not optimal, need CPU repacking");
     }
 
-    return [adapter, &image, &processor](std::uint8_t *outData) -> Future {
+    return [adapter, &image](std::uint8_t *outData, std::size_t rowPitch) -> Future {
         // aa_assert(adapter->buffer->supportsDirectRead());
         ::accelerated::operations::callUnary(adapter->function, image, *adapter->buffer);
-        // no need to wait if single-threaded
         if (adapter->cpuFunction) {
-            adapter->buffer->readRaw(adapter->cpuBuffer.data());
-            return processor.enqueue([adapter, outData]() {
-                LOG_TRACE("CPU copy");
-                adapter->cpuFunction(outData);
-            });
+            // repacked straight to the (possibly padded) output rows
+            auto state = std::make_shared<RepackState>(adapter, outData, rowPitch);
+            state->read = adapter->buffer->readRaw(state->buffer.data());
+            return Future(state);
         } else {
-            return adapter->buffer->readRaw(outData);
+            // same row size: the driver handles the row pitch
+            return adapter->buffer->readRaw(outData, rowPitch);
         }
     };
 }
@@ -5,9 +5,12 @@
 namespace accelerated {
 namespace opengl {
 namespace operations {
-std::function<Future(std::uint8_t*)> createReadAdpater(
+/**
+ * Read through a shader that converts the image to a directly readable
+ * format. The returned function takes the output data and its row pitch
+ */
+std::function<Future(std::uint8_t*, std::size_t)> createReadAdpater(
     Image &image,
-    Processor &processor,
     Image::Factory &imageFactory,
     operations::Factory &opFactory);
 }
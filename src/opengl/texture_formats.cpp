@@ -47,6 +47,7 @@ int getTextureInternalFormat(const ImageTypeSpec &spec) {
             case ImageTypeSpec::DataType::UINT32: X(GL_R32UI);
             case ImageTypeSpec::DataType::SINT32: X(GL_R32I);
             case ImageTypeSpec::DataType::FLOAT32: X(GL_R32F);
+            case ImageTypeSpec::DataType::FLOAT16: X(GL_R16F);
             case ImageTypeSpec::DataType::UFIXED8: X(GL_R8);
             case ImageTypeSpec::DataType::SFIXED8: X(GL_R8_SNORM);
         #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
@@ -70,6 +71,7 @@ int getTextureInternalFormat(const ImageTypeSpec &spec) {
             case ImageTypeSpec::DataType::UINT32: X(GL_RG32UI);
             case ImageTypeSpec::DataType::SINT32: X(GL_RG32I);
             case ImageTypeSpec::DataType::FLOAT32: X(GL_RG32F);
+            case ImageTypeSpec::DataType::FLOAT16: X(GL_RG16F);
             case ImageTypeSpec::DataType::UFIXED8: X(GL_RG8);
             case ImageTypeSpec::DataType::SFIXED8: X(GL_RG8_SNORM);
         #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
@@ -93,6 +95,7 @@ int getTextureInternalFormat(const ImageTypeSpec &spec) {
             case ImageTypeSpec::DataType::UINT32: X(GL_RGB32UI);
             case ImageTypeSpec::DataType::SINT32: X(GL_RGB32I);
             case ImageTypeSpec::DataType::FLOAT32: X(GL_RGB32F);
+            case ImageTypeSpec::DataType::FLOAT16: X(GL_RGB16F);
             case ImageTypeSpec::DataType::UFIXED8: X(GL_RGB8);
             case ImageTypeSpec::DataType::SFIXED8: X(GL_RGB8_SNORM);
         #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
@@ -116,6 +119,7 @@ int getTextureInternalFormat(const ImageTypeSpec &spec) {
             case ImageTypeSpec::DataType::UINT32: X(GL_RGBA32UI);
             case ImageTypeSpec::DataType::SINT32: X(GL_RGBA32I);
             case ImageTypeSpec::DataType::FLOAT32: X(GL_RGBA32F);
+            case ImageTypeSpec::DataType::FLOAT16: X(GL_RGBA16F);
             case ImageTypeSpec::DataType::UFIXED8: X(GL_RGBA8);
             case ImageTypeSpec::DataType::SFIXED8: X(GL_RGBA8_SNORM);
         #ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
@@ -174,6 +178,7 @@ std::string getGlslPrecision(const ImageTypeSpec &spec) {
         case ImageTypeSpec::DataType::UINT32: X("highp");
         case ImageTypeSpec::DataType::SINT32: X("highp");
         case ImageTypeSpec::DataType::FLOAT32: X("highp");
+        case ImageTypeSpec::DataType::FLOAT16: X("mediump");
         case ImageTypeSpec::DataType::UFIXED8: X("lowp");
         case ImageTypeSpec::DataType::SFIXED8: X("lowp");
         case ImageTypeSpec::DataType::UFIXED16: X("highp");
@@ -221,6 +226,59 @@ std::string getGlslVecType(const ImageTypeSpec &spec) {
     return oss.str();
 }
 
+std::string glslHalfOverflowToInf(const std::string &v, int channels) {
+    std::ostringstream oss;
+    oss << "mix(" << v << ", sign(" << v << ") * uintBitsToFloat(0x7f800000u), ";
+    // 65520 and above round to infinity
+    if (channels == 1) oss << "abs(" << v << ") >= 65520.0)";
+    else oss << "greaterThanEqual(abs(" << v << "), vec" << channels << "(65520.0)))";
+    return oss.str();
+}
+
+std::string getGlslImageFormat(const ImageTypeSpec &spec) {
+    if (spec.storageType != ImageTypeSpec::StorageType::GPU_OPENGL) return "";
+    std::string suffix;
+    switch (spec.dataType) {
+        case ImageTypeSpec::DataType::UINT8: suffix = "8ui"; break;
+        case ImageTypeSpec::DataType::SINT8: suffix = "8i"; break;
+        case ImageTypeSpec::DataType::UINT16: suffix = "16ui"; break;
+        case ImageTypeSpec::DataType::SINT16: suffix = "16i"; break;
+        case ImageTypeSpec::DataType::UINT32: suffix = "32ui"; break;
+        case ImageTypeSpec::DataType::SINT32: suffix = "32i"; break;
+        case ImageTypeSpec::DataType::FLOAT32: suffix = "32f"; break;
+        case ImageTypeSpec::DataType::FLOAT16: suffix = "16f"; break;
+        case ImageTypeSpec::DataType::UFIXED8: suffix = "8"; break;
+        case ImageTypeSpec::DataType::SFIXED8: suffix = "8_snorm"; break;
+    #ifndef ACCELERATED_ARRAYS_USE_OPENGL_ES
+        case ImageTypeSpec::DataType::UFIXED16: suffix = "16"; break;
+        case ImageTypeSpec::DataType::SFIXED16: suffix = "16_snorm"; break;
+    #endif
+        default: return "";
+    }
+
+#ifdef ACCELERATED_ARRAYS_USE_OPENGL_ES
+    // OpenGL ES 3.1 only has 4-channel formats and r32f, r32i & r32ui
+    if (spec.channels == 1 && spec.bytesPerChannel() == 4) return "r" + suffix;
+    if (spec.channels == 4) return "rgba" + suffix;
+#else
+    switch (spec.channels) {
+        case 1: return "r" + suffix;
+        case 2: return "rg" + suffix;
+        case 4: return "rgba" + suffix;
+        default: break;
+    }
+#endif
+    return "";
+}
+
+std::string getGlslImageType(const ImageTypeSpec &spec) {
+    if (ImageTypeSpec::isIntegerType(spec.dataType)) {
+        if (ImageTypeSpec::isSigned(spec.dataType)) return "iimage2D";
+        return "uimage2D";
+    }
+    return "image2D";
+}
+
 int getReadPixelFormat(const ImageTypeSpec &spec) {
     #define X(x) LOG_TRACE("getReadPixelFormat:%s", #x); return x
     if (ImageTypeSpec::isIntegerType(spec.dataType)) {
@@ -266,6 +324,7 @@ int getCpuType(const ImageTypeSpec &spec) {
         case ImageTypeSpec::DataType::UINT32: X(GL_UNSIGNED_INT);
         case ImageTypeSpec::DataType::SINT32: X(GL_INT);
         case ImageTypeSpec::DataType::FLOAT32: X(GL_FLOAT);
+        case ImageTypeSpec::DataType::FLOAT16: X(GL_HALF_FLOAT);
         // check these...
         case ImageTypeSpec::DataType::UFIXED8: X(GL_UNSIGNED_BYTE);
         case ImageTypeSpec::DataType::SFIXED8: X(GL_BYTE);
@@ -1,31 +1,44 @@
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <deque>
 #include <mutex>
 #include <thread>
 #include <vector>
 
 #include "future.hpp"
+#include "tracing.hpp"
 #include "assert.hpp"
 
 namespace accelerated {
 namespace {
+thread_local bool unboundedEnqueue = false;
+
 struct BlockingQueue : Queue {
     virtual bool waitAndProcessOne() = 0;
     virtual void processUntilDestroyed() = 0;
 };
 
+// the task is also the state of its Future, i.e., a single allocation
+struct QueueTask : ResolvableState {
+    std::function<void()> func;
+    tracing::TaskTrace trace;
+    bool coalescing = false;
+    // internal task, ignores the capacity (see ScopedUnboundedEnqueue)
+    const bool unbounded = unboundedEnqueue;
+    int key = 0;
+    QueueTask(const std::function<void()> &func) : func(func) {}
+};
+
 class QueueImplementation : public BlockingQueue {
 private:
-    struct Task {
-        std::unique_ptr<Promise> promise;
-        std::function<void()> func;
-    };
-
-    std::deque< Task > tasks;
+    const QueueOptions options;
+    std::deque< std::shared_ptr<QueueTask> > tasks;
     std::mutex mutex;
-    std::condition_variable emptyCondition, subscribeCondition;
+    std::condition_variable emptyCondition, subscribeCondition, notFullCondition;
     bool shouldQuit = false;
     int nSubscribed = 0;
+    QueueStats stats;
 
     bool process(bool many, bool waitForData) {
         bool any = false;
@@ -41,10 +54,15 @@ private:
             }
             auto task = std::move(tasks.front());
             tasks.pop_front();
+            if (options.capacity > 0) notFullCondition.notify_one();
             lock.unlock();
 
-            task.func();
-            task.promise->resolve();
+            task->trace.run(task->func);
+            // the captures may enqueue more tasks when destroyed (e.g., GL
+            // resource cleanup): release them before locking the mutex again
+            task->func = nullptr;
+            task->resolve();
+            task.reset();
             any = true;
 
             lock.lock();
@@ -55,29 +73,94 @@ private:
         return any;
     }
 
+    bool isFull() const {
+        return options.capacity > 0 && tasks.size() >= options.capacity;
+    }
+
+    // mutex must be locked
+    std::shared_ptr<QueueTask> removeOldest(int key) {
+        for (auto it = tasks.begin(); it != tasks.end(); ++it) {
+            if ((*it)->coalescing && (*it)->key == key) {
+                auto task = std::move(*it);
+                tasks.erase(it);
+                return task;
+            }
+        }
+        return {};
+    }
+
+    Future add(std::shared_ptr<QueueTask> task) {
+        Future future(task);
+        std::shared_ptr<QueueTask> dropped;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stats.enqueued++;
+            if (!shouldQuit && !task->unbounded && isFull()) {
+                typedef QueueOptions::FullPolicy Policy;
+                if (options.fullPolicy == Policy::DROP_OLDEST && task->coalescing) {
+                    dropped = removeOldest(task->key);
+                    if (dropped) stats.dropped++;
+                }
+                if (options.fullPolicy == Policy::REJECT) {
+                    stats.rejected++;
+                    lock.unlock();
+                    task->fail();
+                    return future;
+                }
+                if (!dropped) notFullCondition.wait(lock, [this] {
+                    return shouldQuit || !isFull();
+                });
+            }
+            if (shouldQuit) {
+                lock.unlock();
+                task->fail();
+                return future;
+            }
+            task->trace.enqueued(tasks.size());
+            tasks.emplace_back(std::move(task));
+            if (tasks.size() > stats.maxDepth) stats.maxDepth = tasks.size();
+            emptyCondition.notify_one();
+        }
+        // may run callbacks, do not hold the lock
+        if (dropped) dropped->fail();
+        return future;
+    }
+
 public:
+    QueueImplementation(const QueueOptions &options = {}) : options(options) {}
+
     ~QueueImplementation() {
         std::unique_lock<std::mutex> lock(mutex);
         shouldQuit = true;
         emptyCondition.notify_all();
+        notFullCondition.notify_all();
 
         subscribeCondition.wait(lock, [this] {
             return nSubscribed == 0;
         });
+
+        // never executed
+        auto remaining = std::move(tasks);
+        lock.unlock();
+        for (auto &task : remaining) task->fail();
     }
 
     Future enqueue(const std::function<void()> &op) final {
-        Task task;
-        task.promise = Promise::create();
-        auto future = task.promise->getFuture();
-        task.func = op;
+        return add(std::make_shared<QueueTask>(op));
+    }
 
-        {
-            std::lock_guard<std::mutex> lock(mutex);
-            tasks.emplace_back(std::move(task));
-            emptyCondition.notify_one();
-        }
-        return future;
+    Future enqueueCoalescing(int key, const std::function<void()> &op) final {
+        auto task = std::make_shared<QueueTask>(op);
+        task->coalescing = true;
+        task->key = key;
+        return add(std::move(task));
+    }
+
+    QueueStats getQueueStats() final {
+        std::lock_guard<std::mutex> lock(mutex);
+        QueueStats s = stats;
+        s.depth = tasks.size();
+        return s;
     }
 
     void waitUntilNSubscribed(int n) {
@@ -110,7 +193,7 @@ public:
         for (auto &thread : pool) thread.join();
     }
 
-    ThreadPool(int nThreads) : queue(new QueueImplementation) {
+    ThreadPool(int nThreads, const QueueOptions &options) : queue(new QueueImplementation(options)) {
         aa_assert(nThreads > 0);
         for (int i = 0; i < nThreads; ++i) {
             pool.emplace_back([this]{ work(); });
@@ -120,25 +203,277 @@ public:
     Future enqueue(const std::function<void()> &op) final {
         return queue->enqueue(op);
     }
+
+    Future enqueueCoalescing(int key, const std::function<void()> &op) final {
+        return queue->enqueueCoalescing(key, op);
+    }
+
+    QueueStats getQueueStats() final {
+        return queue->getQueueStats();
+    }
+};
+
+struct PoolTask : ResolvableState {
+    std::function<void()> func;
+    tracing::TaskTrace trace;
+    // keeps the task alive while it is referenced by raw pointers in the queues
+    std::shared_ptr<PoolTask> self;
+    PoolTask(const std::function<void()> &func) : func(func) {}
+
+    static void run(PoolTask *task) {
+        auto keepAlive = std::move(task->self);
+        task->trace.run(task->func);
+        task->resolve();
+    }
+
+    // never executed
+    static void discard(PoolTask *task) {
+        auto keepAlive = std::move(task->self);
+        task->fail();
+    }
+};
+
+// Chase-Lev work-stealing deque (Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models", 2013). Only the owner thread may
+// push and take (LIFO end), other threads steal from the FIFO end
+class WorkStealingDeque {
+private:
+    struct Array {
+        const std::int64_t capacity;
+        std::unique_ptr< std::atomic<PoolTask*>[] > items;
+
+        Array(std::int64_t capacity) : capacity(capacity), items(new std::atomic<PoolTask*>[capacity]) {}
+
+        PoolTask *get(std::int64_t i) const {
+            return items[i & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(std::int64_t i, PoolTask *task) {
+            items[i & (capacity - 1)].store(task, std::memory_order_relaxed);
+        }
+    };
+
+    std::atomic<std::int64_t> top, bottom;
+    std::atomic<Array*> array;
+    // thieves may still read old arrays, which are only freed in the destructor
+    std::vector< std::unique_ptr<Array> > arrays;
+
+    Array *grow(Array *old, std::int64_t t, std::int64_t b) {
+        arrays.emplace_back(new Array(old->capacity * 2));
+        Array *a = arrays.back().get();
+        for (std::int64_t i = t; i < b; ++i) a->put(i, old->get(i));
+        array.store(a, std::memory_order_release);
+        return a;
+    }
+
+public:
+    WorkStealingDeque() : top(0), bottom(0) {
+        arrays.emplace_back(new Array(64));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    ~WorkStealingDeque() {
+        while (PoolTask *task = take()) PoolTask::discard(task);
+    }
+
+    void push(PoolTask *task) {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = top.load(std::memory_order_acquire);
+        Array *a = array.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1) a = grow(a, t, b);
+        a->put(b, task);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    PoolTask *take() {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array *a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top.load(std::memory_order_relaxed);
+
+        PoolTask *task = nullptr;
+        if (t <= b) {
+            task = a->get(b);
+            if (t == b) {
+                // last item, race against the thieves
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    task = nullptr;
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    // returns nullptr if empty or if another thread won the race
+    PoolTask *steal() {
+        std::int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        Array *a = array.load(std::memory_order_acquire);
+        PoolTask *task = a->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return task;
+    }
+};
+
+class WorkStealingPool;
+thread_local WorkStealingPool *currentPool = nullptr;
+thread_local int currentWorker = -1;
+
+class WorkStealingPool : public Processor {
+private:
+    // failed attempts to find work before a worker goes to sleep
+    static constexpr int SPIN_ROUNDS = 64;
+
+    std::vector< std::unique_ptr<WorkStealingDeque> > deques;
+    std::vector< std::thread > threads;
+
+    // tasks enqueued from other threads than the workers
+    std::deque< PoolTask* > injected;
+    std::atomic<int> nInjected;
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::atomic<int> nPending, nSleeping;
+    std::atomic<bool> shouldQuit;
+
+    PoolTask *findTask(int index) {
+        if (PoolTask *task = deques.at(index)->take()) return task;
+
+        if (nInjected.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!injected.empty()) {
+                PoolTask *task = injected.front();
+                injected.pop_front();
+                nInjected--;
+                return task;
+            }
+        }
+
+        const int n = deques.size();
+        for (int i = 1; i < n; ++i) {
+            if (PoolTask *task = deques.at((index + i) % n)->steal()) return task;
+        }
+        return nullptr;
+    }
+
+    void work(int index) {
+        currentPool = this;
+        currentWorker = index;
+
+        int idleRounds = 0;
+        while (!shouldQuit.load()) {
+            if (PoolTask *task = findTask(index)) {
+                nPending--;
+                PoolTask::run(task);
+                idleRounds = 0;
+                continue;
+            }
+
+            if (++idleRounds < SPIN_ROUNDS) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            nSleeping++;
+            wakeUp.wait(lock, [this] {
+                return shouldQuit.load() || nPending.load() > 0;
+            });
+            nSleeping--;
+            idleRounds = 0;
+        }
+    }
+
+public:
+    WorkStealingPool(int nThreads) : nInjected(0), nPending(0), nSleeping(0), shouldQuit(false) {
+        aa_assert(nThreads > 0);
+        for (int i = 0; i < nThreads; ++i) deques.emplace_back(new WorkStealingDeque);
+        for (int i = 0; i < nThreads; ++i) {
+            threads.emplace_back([this, i]{ work(i); });
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shouldQuit = true;
+            wakeUp.notify_all();
+        }
+        for (auto &thread : threads) thread.join();
+        for (PoolTask *task : injected) PoolTask::discard(task);
+    }
+
+    Future enqueue(const std::function<void()> &op) final {
+        auto owned = std::make_shared<PoolTask>(op);
+        PoolTask *task = owned.get();
+        task->self = owned;
+        task->trace.enqueued(nPending.load(std::memory_order_relaxed));
+        Future future(owned);
+
+        if (currentPool == this) {
+            // stays in the local deque unless someone steals it
+            deques.at(currentWorker)->push(task);
+        } else {
+            std::lock_guard<std::mutex> lock(mutex);
+            injected.push_back(task);
+            nInjected++;
+        }
+
+        nPending++;
+        if (nSleeping.load() > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            wakeUp.notify_one();
+        }
+        return future;
+    }
 };
 
 struct InstantProcessor : Processor {
     Future enqueue(const std::function<void()> &op) final {
-        op();
+        tracing::TaskTrace trace;
+        trace.enqueued(0);
+        trace.run(op);
         return Future::instantlyResolved();
     }
 };
 }
 
+ScopedUnboundedEnqueue::ScopedUnboundedEnqueue() : previous(unboundedEnqueue) {
+    unboundedEnqueue = true;
+}
+
+ScopedUnboundedEnqueue::~ScopedUnboundedEnqueue() {
+    unboundedEnqueue = previous;
+}
+
 std::unique_ptr<Processor> Processor::createInstant() {
     return std::unique_ptr<Processor>(new InstantProcessor);
 }
 
 std::unique_ptr<Processor> Processor::createThreadPool(int nThreads) {
-    return std::unique_ptr<Processor>(new ThreadPool(nThreads));
+    return createThreadPool(nThreads, QueueOptions());
+}
+
+std::unique_ptr<Processor> Processor::createThreadPool(int nThreads, const QueueOptions &options) {
+    return std::unique_ptr<Processor>(new ThreadPool(nThreads, options));
+}
+
+std::unique_ptr<Processor> Processor::createWorkStealingPool(int nThreads) {
+    return std::unique_ptr<Processor>(new WorkStealingPool(nThreads));
 }
 
 std::unique_ptr<Queue> Processor::createQueue() {
-    return std::unique_ptr<Queue>(new QueueImplementation);
+    return createQueue(QueueOptions());
+}
+
+std::unique_ptr<Queue> Processor::createQueue(const QueueOptions &options) {
+    return std::unique_ptr<Queue>(new QueueImplementation(options));
 }
 }
@@ -1,4 +1,6 @@
 #include "standard_ops.hpp"
+#include <algorithm>
+#include <cmath>
 #include <map>
 #include <string>
 
@@ -27,9 +29,97 @@ DEF_FUNC(fixedConvolution2D)
 DEF_FUNC(channelwiseAffine)
 DEF_FUNC(pixelwiseAffine)
 DEF_FUNC(pixelwiseAffineCombination)
+DEF_FUNC(pixelwiseChain)
+DEF_FUNC(warp)
+DEF_FUNC(reduce)
+
+Function yuvToRgb::Spec::build(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    aa_assert(factory != nullptr);
+    return factory->create(*this, inSpec, outSpec);
+}
 
 #undef DEF_FUNC
 
+MultiOutputFunction pyramid::Spec::build(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    aa_assert(factory != nullptr);
+    return factory->create(*this, inSpec, outSpec);
+}
+
+MultiOutputFunction pyramid::Spec::build(const ImageTypeSpec &spec) { return build(spec, spec); }
+
+fixedConvolution2D::Spec pyramid::Spec::getLevelConvolution() const {
+    aa_assert(levels >= 1);
+    aa_assert(!kernel.empty());
+    fixedConvolution2D::Spec conv;
+    conv.factory = factory;
+    for (double c : kernel) {
+        conv.kernel.push_back({});
+        for (double r : kernel) conv.kernel.back().push_back(c * r);
+    }
+    return conv.setStride(2).setBorder(border);
+}
+
+yuvToRgb::Spec::Coefficients yuvToRgb::Spec::getCoefficients() const {
+    if (limitedRange) {
+        // chroma in [16, 240]
+        return { 16 / 255.0, 255 / 219.0, 1.596027, -0.391762, -0.812968, 2.017232, 128 / 255.0 };
+    }
+    return { 0.0, 1.0, 1.402, -0.344136, -0.714136, 1.772, 128 / 255.0 };
+}
+
+std::vector<double> warp::Spec::getHomography() const {
+    aa_assert(matrix.size() == 2 || matrix.size() == 3);
+    std::vector<double> h;
+    for (const auto &row : matrix) {
+        aa_assert(row.size() == 3);
+        h.insert(h.end(), row.begin(), row.end());
+    }
+    if (matrix.size() == 2) h.insert(h.end(), { 0, 0, 1 });
+    return h;
+}
+
+int reduce::Spec::getBin(double value) const {
+    aa_assert(bins >= 1 && histogramMax > histogramMin);
+    const double bin = std::floor((value - histogramMin) / (histogramMax - histogramMin) * bins);
+    return int(std::min(double(bins - 1), std::max(0.0, bin)));
+}
+
+bool fixedConvolution2D::Spec::getSeparableFactors(std::vector<double> &column, std::vector<double> &row) const {
+    aa_assert(!kernel.empty());
+    const int height = kernel.size(), width = kernel.at(0).size();
+
+    double maxAbs = 0;
+    int pivotRow = 0, pivotCol = 0;
+    for (int i = 0; i < height; ++i) {
+        aa_assert(int(kernel.at(i).size()) == width);
+        for (int j = 0; j < width; ++j) {
+            if (std::fabs(kernel.at(i).at(j)) > maxAbs) {
+                maxAbs = std::fabs(kernel.at(i).at(j));
+                pivotRow = i;
+                pivotCol = j;
+            }
+        }
+    }
+
+    // only worth it if there are fewer taps in total in the two passes
+    if (maxAbs <= 0 || width + height >= width * height) return false;
+
+    // a rank-1 kernel is the outer product of its pivot column and row
+    const double pivot = kernel.at(pivotRow).at(pivotCol);
+    constexpr double relativeTolerance = 1e-6;
+    for (int i = 0; i < height; ++i) {
+        for (int j = 0; j < width; ++j) {
+            const double rank1 = kernel.at(i).at(pivotCol) * kernel.at(pivotRow).at(j) / pivot;
+            if (std::fabs(kernel.at(i).at(j) - rank1) > relativeTolerance * maxAbs) return false;
+        }
+    }
+    column.clear();
+    row.clear();
+    for (int i = 0; i < height; ++i) column.push_back(kernel.at(i).at(pivotCol));
+    for (int j = 0; j < width; ++j) row.push_back(kernel.at(pivotRow).at(j) / pivot);
+    return true;
+}
+
 Function StandardFactory::create(const pixelwiseAffine::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
     pixelwiseAffineCombination::Spec comboSpec;
     comboSpec.factory = spec.factory;
@@ -42,6 +132,111 @@ Function StandardFactory::create(const copy::Spec &spec, const ImageTypeSpec &in
     return create(swizzle::Spec(std::string("rgba").substr(0, outSpec.channels)), inSpec, outSpec);
 }
 
+Function StandardFactory::create(const pixelwiseChain::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) {
+    aa_assert(spec.steps.size() == 1);
+    const auto &step = spec.steps.at(0);
+    aa_assert(step.dataType == outSpec.dataType);
+    switch (step.type) {
+    case pixelwiseChain::Spec::StepType::FILL:
+        return create(spec.fills.at(step.index), outSpec);
+    case pixelwiseChain::Spec::StepType::SWIZZLE:
+        return create(spec.swizzles.at(step.index), inSpec, outSpec);
+    case pixelwiseChain::Spec::StepType::PIXELWISE_AFFINE:
+        return create(spec.affines.at(step.index), inSpec, outSpec);
+    case pixelwiseChain::Spec::StepType::CHANNELWISE_AFFINE:
+        return create(spec.channelwiseAffines.at(step.index), inSpec, outSpec);
+    }
+    aa_assert(false);
+    return {};
+}
+
+int pixelwiseChain::Spec::getInputCount() const {
+    aa_assert(!steps.empty());
+    const auto &first = steps.at(0);
+    switch (first.type) {
+    case StepType::FILL: return 0;
+    case StepType::PIXELWISE_AFFINE: return affines.at(first.index).linear.size();
+    default: return 1;
+    }
+}
+
+std::vector<pixelwiseChain::AffineStep> pixelwiseChain::Spec::getAffineSteps(int inputChannels) const {
+    std::vector<AffineStep> result;
+    int nInputs = getInputCount();
+    int channels = inputChannels;
+    for (const auto &step : steps) {
+        AffineStep affine;
+        affine.dataType = step.dataType;
+        const auto zeroMatrix = [&channels](int outChannels) {
+            return std::vector< std::vector<double> >(outChannels, std::vector<double>(channels, 0.0));
+        };
+
+        switch (step.type) {
+        case StepType::FILL: {
+            affine.bias = fills.at(step.index).value;
+            affine.channels = affine.bias.size();
+            if (nInputs > 0) affine.linear.push_back(zeroMatrix(affine.channels));
+            break;
+        }
+        case StepType::SWIZZLE: {
+            const auto &swiz = swizzles.at(step.index);
+            affine.channels = swiz.channelList.size();
+            affine.linear.push_back(zeroMatrix(affine.channels));
+            for (int c = 0; c < affine.channels; ++c) {
+                const int chan = swiz.channelList.at(c);
+                if (chan < 0) {
+                    affine.bias.push_back(swiz.constantList.at(c));
+                } else {
+                    aa_assert(chan < channels);
+                    affine.linear.back().at(c).at(chan) = 1;
+                    affine.bias.push_back(0);
+                }
+            }
+            break;
+        }
+        case StepType::PIXELWISE_AFFINE: {
+            const auto &spec = affines.at(step.index);
+            aa_assert(!spec.linear.empty());
+            affine.channels = spec.linear.at(0).empty() ? channels : spec.linear.at(0).size();
+            for (const auto &part : spec.linear) {
+                auto m = zeroMatrix(affine.channels);
+                if (part.empty()) {
+                    // identity
+                    aa_assert(affine.channels == channels);
+                    for (int c = 0; c < channels; ++c) m.at(c).at(c) = 1;
+                } else {
+                    aa_assert(int(part.size()) == affine.channels);
+                    for (int i = 0; i < affine.channels; ++i) {
+                        aa_assert(int(part.at(i).size()) <= channels);
+                        for (std::size_t j = 0; j < part.at(i).size(); ++j) m.at(i).at(j) = part.at(i).at(j);
+                    }
+                }
+                affine.linear.push_back(m);
+            }
+            affine.bias = spec.bias;
+            affine.bias.resize(affine.channels, 0.0);
+            break;
+        }
+        case StepType::CHANNELWISE_AFFINE: {
+            const auto &spec = channelwiseAffines.at(step.index);
+            affine.channels = channels;
+            affine.linear.push_back(zeroMatrix(channels));
+            for (int c = 0; c < channels; ++c) affine.linear.back().at(c).at(c) = spec.scale;
+            affine.bias.resize(channels, spec.bias);
+            break;
+        }
+        }
+
+        aa_assert(int(affine.linear.size()) == nInputs);
+        aa_assert(affine.channels >= 1 && affine.channels <= 4);
+        result.push_back(affine);
+        // all the following steps are unary
+        nInputs = 1;
+        channels = affine.channels;
+    }
+    return result;
+}
+
 swizzle::Spec::Spec(const std::string &s) {
     const std::map<char, int> chanLookup = {
         {'r', 0},
@@ -96,6 +96,13 @@ namespace fixedConvolution2D {
             return -(kernel.size() / 2) + yOffset;
         }
 
+        /**
+         * If the kernel is separable, i.e., kernel[i][j] = column[i] * row[j],
+         * and two 1D passes need fewer taps in total, store the factors and
+         * return true
+         */
+        bool getSeparableFactors(std::vector<double> &column, std::vector<double> &row) const;
+
         Function build(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec);
         Function build(const ImageTypeSpec &spec);
     };
@@ -257,6 +264,255 @@ namespace swizzle {
     };
 }
 
+/**
+ * A chain of pixelwise operations (fill, swizzle, pixelwiseAffine,
+ * pixelwiseAffineCombination, channelwiseAffine) computed as a single
+ * operation without intermediary images, if supported by the implementation.
+ * The result of each step is converted to the given data type, as if it
+ * were written to an intermediary image of that type. However, the
+ * arithmetic of the fused chain may be more precise than that of the
+ * individual operations. The data type of the last step must match the
+ * output image.
+ *
+ * The first step defines the inputs: zero for fill, N for a combination
+ * with N linear parts and one otherwise. The other steps are unary.
+ */
+namespace pixelwiseChain {
+    /** Any step as y = A_1 * x_1 + ... + A_n * x_n + b */
+    struct AffineStep {
+        std::vector< std::vector< std::vector<double> > > linear;
+        std::vector<double> bias;
+        int channels;
+        ImageTypeSpec::DataType dataType;
+    };
+
+    struct Spec : Builder {
+        std::vector<fill::Spec> fills;
+        std::vector<swizzle::Spec> swizzles;
+        std::vector<pixelwiseAffineCombination::Spec> affines;
+        std::vector<channelwiseAffine::Spec> channelwiseAffines;
+
+        enum class StepType { FILL, SWIZZLE, PIXELWISE_AFFINE, CHANNELWISE_AFFINE };
+        struct Step {
+            StepType type;
+            int index; // in the corresponding vector above
+            ImageTypeSpec::DataType dataType;
+        };
+        std::vector<Step> steps;
+
+        Spec add(const fill::Spec &spec, ImageTypeSpec::DataType dataType) {
+            return addStep(fills, spec, StepType::FILL, dataType);
+        }
+
+        Spec add(const swizzle::Spec &spec, ImageTypeSpec::DataType dataType) {
+            return addStep(swizzles, spec, StepType::SWIZZLE, dataType);
+        }
+
+        Spec add(const pixelwiseAffineCombination::Spec &spec, ImageTypeSpec::DataType dataType) {
+            return addStep(affines, spec, StepType::PIXELWISE_AFFINE, dataType);
+        }
+
+        Spec add(const pixelwiseAffine::Spec &spec, ImageTypeSpec::DataType dataType) {
+            pixelwiseAffineCombination::Spec combo;
+            return add(combo.addLinearPart(spec.linear).setBias(spec.bias), dataType);
+        }
+
+        Spec add(const channelwiseAffine::Spec &spec, ImageTypeSpec::DataType dataType) {
+            return addStep(channelwiseAffines, spec, StepType::CHANNELWISE_AFFINE, dataType);
+        }
+
+        /** Number of input images */
+        int getInputCount() const;
+
+        /** The steps in a uniform format, given the number of input channels */
+        std::vector<AffineStep> getAffineSteps(int inputChannels) const;
+
+        Function build(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec);
+        Function build(const ImageTypeSpec &spec);
+
+    private:
+        template <class T> Spec addStep(std::vector<T> &v, const T &spec, StepType type, ImageTypeSpec::DataType dataType) {
+            steps.push_back({ type, int(v.size()), dataType });
+            v.push_back(spec);
+            return *this;
+        }
+    };
+}
+
+/**
+ * Gaussian-type image pyramid computed in a single call: each level is the
+ * previous one convolved with a separable kernel (kernel x kernel) at
+ * stride 2. The outputs of the MultiOutputFunction are the levels 1, 2,
+ * ..., levels (level 0 is the input), and the size of each level must be
+ * getLevelWidth x getLevelHeight. All the outputs have the same type.
+ */
+namespace pyramid {
+    struct Spec : Builder {
+        int levels = 3;
+        /** 1D kernel, binomial approximation of a Gaussian by default */
+        std::vector<double> kernel = { 1/16.0, 4/16.0, 6/16.0, 4/16.0, 1/16.0 };
+        Image::Border border = Image::Border::CLAMP;
+
+        Spec setLevels(int n) {
+            levels = n;
+            return *this;
+        }
+
+        Spec setKernel(const std::vector<double> &k) {
+            kernel = k;
+            return *this;
+        }
+
+        Spec setBorder(Image::Border b) {
+            border = b;
+            return *this;
+        }
+
+        /** The output size of the given level (>= 1), rounded up at each level */
+        static int getLevelSize(int inputSize, int level) {
+            for (int i = 0; i < level; ++i) inputSize = (inputSize + 1) / 2;
+            return inputSize;
+        }
+        static int getLevelWidth(const Image &input, int level) { return getLevelSize(input.width, level); }
+        static int getLevelHeight(const Image &input, int level) { return getLevelSize(input.height, level); }
+
+        /** The convolution that computes each level from the previous one */
+        fixedConvolution2D::Spec getLevelConvolution() const;
+
+        MultiOutputFunction build(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec);
+        MultiOutputFunction build(const ImageTypeSpec &spec);
+    };
+}
+
+/**
+ * Geometric warp: each output pixel is sampled from the input at the
+ * point given by a 2x3 affine or 3x3 homography matrix, which maps output
+ * pixel coordinates (x, y, 1) to input pixel coordinates (i.e., the
+ * inverse of the transform applied to the image). Pixel centers are at
+ * integer coordinates. Without a matrix, the operation is binary and the
+ * second input is a map image: a 2-channel FLOAT32 image of the output
+ * size that contains the input coordinates of each output pixel, e.g.,
+ * callBinary(f, input, map, output). The number of channels of the input
+ * and the output must match.
+ */
+namespace warp {
+    struct Spec : Builder {
+        /** 2x3 or 3x3, row-major. Empty means a map image */
+        std::vector< std::vector<double> > matrix;
+        /** NEAREST or LINEAR */
+        Image::Interpolation interpolation = Image::Interpolation::LINEAR;
+        Image::Border border = Image::Border::ZERO;
+
+        Spec setMatrix(const std::vector< std::vector<double> > &m) {
+            matrix = m;
+            return *this;
+        }
+
+        Spec setInterpolation(Image::Interpolation i) {
+            interpolation = i;
+            return *this;
+        }
+
+        Spec setBorder(Image::Border b) {
+            border = b;
+            return *this;
+        }
+
+        bool usesMap() const { return matrix.empty(); }
+
+        /** The matrix as a 3x3 homography, 9 elements in row-major order */
+        std::vector<double> getHomography() const;
+
+        Function build(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec);
+        Function build(const ImageTypeSpec &spec);
+    };
+}
+
+/**
+ * Reduce the whole image to one value per channel: the output is a 1x1
+ * image with the same number of channels as the input, or a bins x 1 image
+ * of pixel counts for HISTOGRAM. The input values are as in
+ * Image::get<float>, i.e., fixed point values are normalized to [0, 1]
+ * or [-1, 1], and the results are stored as with set<float>, so the output
+ * is typically FLOAT32. Reading the result is much cheaper than reading
+ * the whole image from the GPU.
+ */
+namespace reduce {
+    enum class Type { SUM, MIN, MAX, MEAN, HISTOGRAM };
+
+    struct Spec : Builder {
+        Type type = Type::SUM;
+
+        /**
+         * Histogram bins of equal width over [histogramMin, histogramMax).
+         * Values outside the range are counted in the first or the last bin
+         */
+        int bins = 256;
+        double histogramMin = 0.0;
+        double histogramMax = 1.0;
+
+        Spec setType(Type t) {
+            type = t;
+            return *this;
+        }
+
+        Spec setHistogram(int nBins, double minValue = 0.0, double maxValue = 1.0) {
+            type = Type::HISTOGRAM;
+            bins = nBins;
+            histogramMin = minValue;
+            histogramMax = maxValue;
+            return *this;
+        }
+
+        int getOutputWidth() const { return type == Type::HISTOGRAM ? bins : 1; }
+        int getOutputHeight() const { return 1; }
+
+        /** The histogram bin of the given value */
+        int getBin(double value) const;
+
+        Function build(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec);
+        Function build(const ImageTypeSpec &spec);
+    };
+}
+
+/**
+ * Convert a YuvImage (BT.601) to gray (1 output channel), RGB (3) or RGBA
+ * (4, alpha = 1). The inputs of the binary function are the Y and UV
+ * planes, e.g., callBinary(f, *yuv.y, *yuv.uv, rgb), inSpec is the spec of
+ * the Y plane and the output must be the size of the Y plane. The output
+ * type can be fixed point or float.
+ */
+namespace yuvToRgb {
+    struct Spec : Builder {
+        Image::YuvLayout layout = Image::YuvLayout::NV21;
+        /** Limited "video" range (Y in [16, 235]) instead of the full JPEG range */
+        bool limitedRange = false;
+
+        Spec setLayout(Image::YuvLayout l) {
+            layout = l;
+            return *this;
+        }
+
+        Spec setLimitedRange(bool limited) {
+            limitedRange = limited;
+            return *this;
+        }
+
+        /**
+         * In normalized units, with U and V centered at chromaOffset:
+         * R = y * (Y - yOffset) + rv * V, G = y * (Y - yOffset) + gu * U + gv * V
+         * and B = y * (Y - yOffset) + bu * U, clamped to [0, 1]
+         */
+        struct Coefficients {
+            double yOffset, y, rv, gu, gv, bu;
+            double chromaOffset; // 128 / 255
+        };
+        Coefficients getCoefficients() const;
+
+        Function build(const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec);
+    };
+}
+
 struct StandardFactory : Builder {
     virtual ~StandardFactory();
 
@@ -290,6 +546,34 @@ struct StandardFactory : Builder {
       return setFactory(fixedConvolution2D::Spec{}.setKernel(kernel));
     }
 
+    pixelwiseChain::Spec pixelwiseChain() {
+      return setFactory(pixelwiseChain::Spec{});
+    }
+
+    pyramid::Spec pyramid(int levels) {
+      return setFactory(pyramid::Spec{}.setLevels(levels));
+    }
+
+    yuvToRgb::Spec yuvToRgb(Image::YuvLayout layout) {
+      return setFactory(yuvToRgb::Spec{}.setLayout(layout));
+    }
+
+    warp::Spec warp(const std::vector< std::vector<double> > &matrix) {
+      return setFactory(warp::Spec{}.setMatrix(matrix));
+    }
+
+    warp::Spec remap() {
+      return setFactory(warp::Spec{});
+    }
+
+    reduce::Spec reduce(reduce::Type type) {
+      return setFactory(reduce::Spec{}.setType(type));
+    }
+
+    reduce::Spec histogram(int bins, double minValue = 0.0, double maxValue = 1.0) {
+      return setFactory(reduce::Spec{}.setHistogram(bins, minValue, maxValue));
+    }
+
     // actual implementation
     virtual Function create(const fill::Spec &spec, const ImageTypeSpec &imageSpec) = 0;
     virtual Function create(const swizzle::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) = 0;
@@ -297,10 +581,16 @@ struct StandardFactory : Builder {
     virtual Function create(const fixedConvolution2D::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) = 0;
     virtual Function create(const pixelwiseAffineCombination::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) = 0;
     virtual Function create(const channelwiseAffine::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) = 0;
+    virtual MultiOutputFunction create(const pyramid::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) = 0;
+    virtual Function create(const yuvToRgb::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) = 0;
+    virtual Function create(const warp::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) = 0;
+    virtual Function create(const reduce::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec) = 0;
 
     // with default implementations
     virtual Function create(const pixelwiseAffine::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec);
     virtual Function create(const copy::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec);
+    // note: the default implementation only supports single-step chains
+    virtual Function create(const pixelwiseChain::Spec &spec, const ImageTypeSpec &inSpec, const ImageTypeSpec &outSpec);
 
 
 private:
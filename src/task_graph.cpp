@@ -0,0 +1,181 @@
+#include <map>
+
+#include "task_graph.hpp"
+#include "cpu/image.hpp"
+
+namespace accelerated {
+namespace {
+bool isCpu(const ImageTypeSpec &spec) {
+    return spec.storageType == ImageTypeSpec::StorageType::CPU;
+}
+
+Future transfer(Image &from, Image &to) {
+    if (isCpu(from)) return cpu::Image::castFrom(from).copyTo(to);
+    return cpu::Image::castFrom(to).copyFrom(from);
+}
+
+struct Step {
+    operations::MultiOutputFunction op;
+    std::vector<Image*> inputs, outputs;
+
+    Future call() {
+        return op(inputs.data(), inputs.size(), outputs.data(), outputs.size());
+    }
+};
+
+class TaskGraphImplementation : public TaskGraph {
+private:
+    // copy of an image on the other device (CPU vs GPU)
+    struct Mirror {
+        std::unique_ptr<Image> image;
+        // in sync with the original at this point of the recording
+        bool fresh = false;
+    };
+
+    // last accesses to an image in the runs dispatched so far
+    struct Access {
+        Future write;
+        std::vector<Future> reads;
+        Access() : write(std::shared_ptr<Future::State>()) {}
+    };
+
+    std::vector< std::shared_ptr<Step> > steps;
+    std::map<Image*, Mirror> mirrors;
+    int nTransfers = 0;
+    std::map<Image*, Access> accesses;
+
+    void addStep(const operations::MultiOutputFunction &op, std::vector<Image*> inputs, std::vector<Image*> outputs) {
+        auto step = std::make_shared<Step>();
+        step->op = op;
+        step->inputs = std::move(inputs);
+        step->outputs = std::move(outputs);
+        steps.push_back(step);
+    }
+
+    void addTransfer(Image &from, Image &to) {
+        addStep([](Image **inputs, int nInputs, Image **outputs, int nOutputs) -> Future {
+            aa_assert(nInputs == 1 && nOutputs == 1); (void)nInputs; (void)nOutputs;
+            return transfer(*inputs[0], *outputs[0]);
+        }, { &from }, { &to });
+        nTransfers++;
+    }
+
+    Mirror &getMirror(Image &image, Image::Factory &device) {
+        auto &mirror = mirrors[&image];
+        if (!mirror.image) mirror.image = device.createLike(image);
+        return mirror;
+    }
+
+    // note: the given futures may be invalid (null state)
+    static void addValid(std::vector<Future> &deps, const Future &f) {
+        if (f.state) deps.push_back(f);
+    }
+
+public:
+    void add(const operations::MultiOutputFunction &f,
+        const std::vector<Image*> &inputs,
+        const std::vector<Image*> &outputs,
+        Image::Factory &device) final
+    {
+        const bool cpuDevice = isCpu(device.getSpec(1, ImageTypeSpec::DataType::UINT8));
+
+        std::vector<Image*> stepInputs, stepOutputs;
+        for (Image *input : inputs) {
+            aa_assert(input);
+            if (isCpu(*input) == cpuDevice) {
+                stepInputs.push_back(input);
+                continue;
+            }
+            auto &mirror = getMirror(*input, device);
+            if (!mirror.fresh) {
+                addTransfer(*input, *mirror.image);
+                mirror.fresh = true;
+            }
+            stepInputs.push_back(mirror.image.get());
+        }
+
+        std::vector< std::pair<Image*, Image*> > writeBacks;
+        for (Image *output : outputs) {
+            aa_assert(output);
+            if (isCpu(*output) == cpuDevice) {
+                auto it = mirrors.find(output);
+                if (it != mirrors.end()) it->second.fresh = false;
+                stepOutputs.push_back(output);
+                continue;
+            }
+            auto &mirror = getMirror(*output, device);
+            writeBacks.push_back({ mirror.image.get(), output });
+            mirror.fresh = true;
+            stepOutputs.push_back(mirror.image.get());
+        }
+
+        addStep(f, std::move(stepInputs), std::move(stepOutputs));
+        for (auto &wb : writeBacks) addTransfer(*wb.first, *wb.second);
+    }
+
+    Future run() final {
+        std::vector<Future> all;
+        all.reserve(steps.size());
+
+        for (auto &step : steps) {
+            std::vector<Future> deps;
+            for (Image *input : step->inputs) addValid(deps, accesses[input].write);
+            for (Image *output : step->outputs) {
+                auto &access = accesses[output];
+                addValid(deps, access.write);
+                for (auto &read : access.reads) deps.push_back(read);
+            }
+
+            auto done = std::make_shared<ResolvableState>();
+            Future future(done);
+            Future::whenAll(deps).state->onReady([step, done]() {
+                step->call().state->onReady([done]() { done->resolve(); });
+            });
+
+            for (Image *input : step->inputs) accesses[input].reads.push_back(future);
+            for (Image *output : step->outputs) {
+                auto &access = accesses[output];
+                access.write = future;
+                access.reads.clear();
+            }
+            all.push_back(future);
+        }
+
+        // drop references to the resolved futures
+        for (auto &it : accesses) {
+            auto &reads = it.second.reads;
+            std::size_t n = 0;
+            for (auto &read : reads) if (!read.isReady()) reads[n++] = read;
+            reads.erase(reads.begin() + n, reads.end());
+        }
+
+        return Future::whenAll(all);
+    }
+
+    int size() const final {
+        return int(steps.size());
+    }
+
+    int numberOfTransfers() const final {
+        return nTransfers;
+    }
+};
+}
+
+TaskGraph::~TaskGraph() = default;
+
+void TaskGraph::add(const operations::Function &f,
+    const std::vector<Image*> &inputs,
+    Image &output,
+    Image::Factory &device)
+{
+    add([f](Image **inputs, int nInputs, Image **outputs, int nOutputs) -> Future {
+        aa_assert(nOutputs == 1); (void)nOutputs;
+        return f(inputs, nInputs, *outputs[0]);
+    }, inputs, { &output }, device);
+}
+
+std::unique_ptr<TaskGraph> TaskGraph::create() {
+    return std::unique_ptr<TaskGraph>(new TaskGraphImplementation);
+}
+}
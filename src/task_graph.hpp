@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "function.hpp"
+#include "image.hpp"
+
+namespace accelerated {
+/**
+ * Records operations together with the Images they read and write and
+ * runs them as soon as their dependencies allow. Read-after-write,
+ * write-after-read and write-after-write hazards are inferred from the
+ * images. Each operation is called (i.e., enqueued to its own Processor)
+ * when the operations it depends on are resolved, so independent CPU and
+ * GPU operations run concurrently, without blocking any thread.
+ *
+ * Every operation is assigned to a device by the Image::Factory of that
+ * device (CPU or OpenGL). If it accesses an image stored on the other
+ * device, the graph creates a copy of the image on the right device and
+ * inserts the transfers automatically.
+ *
+ * The hazards are also tracked across run() calls: if run() is called
+ * again before the previous run has finished, e.g., for the next frame,
+ * its operations only wait for the operations of the previous run that
+ * access the same images. For example, the CPU preprocessing of frame N+1
+ * can run while the later GPU stages of frame N are still running.
+ *
+ * Not thread-safe: record and run from a single thread. The graph must
+ * not be destroyed before the Futures returned by run() are resolved.
+ */
+class TaskGraph {
+public:
+    virtual ~TaskGraph();
+
+    /** Record an operation that runs on the device of the given factory */
+    virtual void add(const operations::MultiOutputFunction &f,
+        const std::vector<Image*> &inputs,
+        const std::vector<Image*> &outputs,
+        Image::Factory &device) = 0;
+
+    void add(const operations::Function &f,
+        const std::vector<Image*> &inputs,
+        Image &output,
+        Image::Factory &device);
+
+    /** Dispatch all recorded operations. Resolved when all of them are */
+    virtual Future run() = 0;
+
+    /** Number of operations recorded, including the inserted transfers */
+    virtual int size() const = 0;
+    /** Number of CPU <-> GPU transfers inserted per run */
+    virtual int numberOfTransfers() const = 0;
+
+    static std::unique_ptr<TaskGraph> create();
+};
+}
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "tracing.hpp"
+
+namespace accelerated {
+namespace tracing {
+namespace {
+struct Event {
+    const char *label;
+    std::int64_t enqueueTime, startTime, endTime;
+    std::size_t queueDepth;
+    int enqueueThread;
+};
+
+// written by its own thread, read when dumping
+struct ThreadBuffer {
+    int id = 0;
+    std::string name;
+    std::mutex mutex;
+    std::vector<Event> events; // ring buffer
+    std::size_t count = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    // kept after the threads exit
+    std::vector< std::shared_ptr<ThreadBuffer> > threads;
+    std::set<std::string> labels;
+};
+
+std::atomic<bool> enabled(false);
+std::atomic<std::size_t> bufferSize(10000);
+const auto epoch = std::chrono::steady_clock::now();
+thread_local const char *currentLabel = nullptr;
+
+Registry &registry() {
+    static Registry r;
+    return r;
+}
+
+ThreadBuffer &threadBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer) {
+        buffer = std::make_shared<ThreadBuffer>();
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        buffer->id = r.threads.size() + 1;
+        r.threads.push_back(buffer);
+    }
+    return *buffer;
+}
+
+// nanoseconds, never 0
+std::int64_t now() {
+    const auto t = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch);
+    return std::max(std::int64_t(1), std::int64_t(t.count()));
+}
+
+void record(const Event &event) {
+    auto &buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    const std::size_t capacity = std::max(std::size_t(1), bufferSize.load(std::memory_order_relaxed));
+    if (buffer.events.size() < capacity) buffer.events.push_back(event);
+    else buffer.events.at(buffer.count % buffer.events.size()) = event;
+    buffer.count++;
+}
+
+void writeString(std::ostream &out, const char *s) {
+    out << '"';
+    for (; *s; ++s) {
+        const char c = *s;
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+        else out << c;
+    }
+    out << '"';
+}
+
+// Chrome trace timestamps are in microseconds
+double micros(std::int64_t ns) {
+    return ns * 1e-3;
+}
+}
+
+void setEnabled(bool e) {
+    enabled.store(e);
+}
+
+bool isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void setBufferSize(std::size_t eventsPerThread) {
+    bufferSize.store(eventsPerThread);
+}
+
+void clear() {
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto &buffer : r.threads) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->events.clear();
+        buffer->count = 0;
+    }
+}
+
+void setThreadName(const std::string &name) {
+    auto &buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.name = name;
+}
+
+const char *intern(const std::string &label) {
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.labels.insert(label).first->c_str();
+}
+
+void writeChromeTrace(std::ostream &out) {
+    std::vector< std::shared_ptr<ThreadBuffer> > threads;
+    {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        threads = r.threads;
+    }
+
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&out, &first]() {
+        if (!first) out << ",";
+        out << "\n";
+        first = false;
+    };
+
+    std::size_t flowId = 0;
+    for (auto &buffer : threads) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        const int tid = buffer->id;
+        const std::string name = buffer->name.empty() ? "thread " + std::to_string(tid) : buffer->name;
+        separator();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+        writeString(out, name.c_str());
+        out << "}}";
+
+        for (const auto &e : buffer->events) {
+            const char *label = e.label ? e.label : "task";
+            separator();
+            out << "{\"name\":";
+            writeString(out, label);
+            out << ",\"cat\":\"task\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << micros(e.startTime)
+                << ",\"dur\":" << micros(e.endTime - e.startTime)
+                << ",\"args\":{\"queueDepth\":" << e.queueDepth
+                << ",\"queuedMicroseconds\":" << micros(e.startTime - e.enqueueTime) << "}}";
+
+            // arrow from the enqueuing thread
+            flowId++;
+            separator();
+            out << "{\"name\":\"enqueue\",\"cat\":\"task\",\"ph\":\"s\",\"id\":" << flowId
+                << ",\"pid\":1,\"tid\":" << e.enqueueThread << ",\"ts\":" << micros(e.enqueueTime) << "}";
+            separator();
+            out << "{\"name\":\"enqueue\",\"cat\":\"task\",\"ph\":\"f\",\"bp\":\"e\",\"id\":" << flowId
+                << ",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << micros(e.startTime) << "}";
+        }
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+ScopedLabel::ScopedLabel(const char *label) : previous(currentLabel) {
+    currentLabel = label;
+}
+
+ScopedLabel::~ScopedLabel() {
+    currentLabel = previous;
+}
+
+void TaskTrace::enqueued(std::size_t depth) {
+    if (!isEnabled()) return;
+    label = currentLabel;
+    queueDepth = depth;
+    enqueueThread = threadBuffer().id;
+    enqueueTime = now();
+}
+
+void TaskTrace::run(const std::function<void()> &func) const {
+    if (!enqueueTime) {
+        func();
+        return;
+    }
+    Event event;
+    event.label = label;
+    event.enqueueTime = enqueueTime;
+    event.queueDepth = queueDepth;
+    event.enqueueThread = enqueueThread;
+    event.startTime = now();
+    func();
+    event.endTime = now();
+    record(event);
+}
+}
+}
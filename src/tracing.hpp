@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace accelerated {
+/**
+ * Optional task-level instrumentation of the Processors: the enqueue,
+ * start and finish times of each task, the thread that ran it, the queue
+ * depth at enqueue and an operation label. The events are stored in
+ * per-thread ring buffers and can be written as Chrome / Perfetto trace
+ * event JSON (chrome://tracing, ui.perfetto.dev). Disabled by default,
+ * in which case the overhead is a flag check per task.
+ */
+namespace tracing {
+void setEnabled(bool enabled);
+bool isEnabled();
+
+/** Maximum number of events kept per thread (the oldest are overwritten) */
+void setBufferSize(std::size_t eventsPerThread);
+
+/** Forget all recorded events */
+void clear();
+
+/**
+ * Write the recorded events as trace event JSON. Each task is a complete
+ * event in the thread that ran it, connected with a flow arrow to the
+ * thread that enqueued it
+ */
+void writeChromeTrace(std::ostream &out);
+
+/** Name the calling thread in the trace, e.g., "GL" */
+void setThreadName(const std::string &name);
+
+/**
+ * Label the tasks enqueued by this thread while the object exists. The
+ * label must outlive the trace (e.g., a string literal or intern())
+ */
+class ScopedLabel {
+private:
+    const char *previous;
+public:
+    ScopedLabel(const char *label);
+    ~ScopedLabel();
+};
+
+/** Returns a permanent copy of the string, usable as a label */
+const char *intern(const std::string &label);
+
+/** Per-task data, used by the Processor implementations */
+struct TaskTrace {
+    const char *label = nullptr;
+    std::int64_t enqueueTime = 0; // 0 if not traced
+    std::size_t queueDepth = 0;
+    int enqueueThread = 0;
+
+    /** Call in the enqueuing thread. No-op if tracing is disabled */
+    void enqueued(std::size_t queueDepth);
+    /** Run the task, recording it if it was traced */
+    void run(const std::function<void()> &func) const;
+};
+}
+}
@@ -0,0 +1,301 @@
+// Throughput benchmarks of the standard operations and image transfers.
+// Results are printed to stdout, one line per case, as CSV (default) or
+// JSON lines (--json). Usage:
+//
+//      ./test/run-benchmarks [--json] [--quick] [--filter=substring]
+//
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu/image.hpp"
+#include "cpu/operations.hpp"
+#include "standard_ops.hpp"
+
+#ifdef TEST_WITH_OPENGL
+#include "opengl/image.hpp"
+#include "opengl/operations.hpp"
+#endif
+
+using namespace accelerated;
+typedef ImageTypeSpec::DataType DataType;
+
+namespace {
+struct Backend {
+    std::string name;
+    std::unique_ptr<Processor> processor;
+    std::unique_ptr<Image::Factory> images;
+    std::unique_ptr<operations::StandardFactory> ops;
+    bool gpu;
+};
+
+struct Case {
+    int width, height, channels;
+    DataType dataType;
+};
+
+struct Settings {
+    bool json = false;
+    bool quick = false;
+    std::string filter;
+    double minSeconds = 0.3;
+    int maxIterations = 1000;
+};
+
+const char *typeName(DataType t) {
+    switch (t) {
+    case DataType::UINT8: return "uint8";
+    case DataType::SINT8: return "sint8";
+    case DataType::UINT16: return "uint16";
+    case DataType::SINT16: return "sint16";
+    case DataType::UINT32: return "uint32";
+    case DataType::SINT32: return "sint32";
+    case DataType::FLOAT32: return "float32";
+    case DataType::UFIXED8: return "ufixed8";
+    case DataType::SFIXED8: return "sfixed8";
+    case DataType::UFIXED16: return "ufixed16";
+    case DataType::SFIXED16: return "sfixed16";
+    case DataType::UFIXED32: return "ufixed32";
+    case DataType::SFIXED32: return "sfixed32";
+    case DataType::FLOAT16: return "float16";
+    }
+    return "?";
+}
+
+// Something to run repeatedly. Returns a future for the (possibly async) work
+typedef std::function<Future()> Runnable;
+
+struct Benchmark {
+    std::string name;
+    int nInputs;
+    bool cpuOnly;
+    // builds the operation for the given images, using the backend factory
+    std::function<Runnable(operations::StandardFactory &ops, std::vector<Image*> &inputs, Image &output)> build;
+    // output dimensions relative to input
+    double outScale;
+};
+
+Runnable callFunction(const operations::Function &f, std::vector<Image*> &inputs, Image &output) {
+    return [f, &inputs, &output]() { return f(inputs.data(), inputs.size(), output); };
+}
+
+std::vector<std::vector<double>> matrix(int rows, int cols) {
+    std::vector<std::vector<double>> m(rows, std::vector<double>(cols, 0.0));
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < cols; ++j)
+            m[i][j] = (i == j ? 0.5 : 0.0) + 0.125 / (1 + i + j);
+    return m;
+}
+
+std::vector<Benchmark> getBenchmarks() {
+    typedef operations::StandardFactory Ops;
+    typedef std::vector<Image*> Inputs;
+    std::vector<Benchmark> b;
+
+    b.push_back({ "fill", 0, false, [](Ops &ops, Inputs &in, Image &out) {
+        return callFunction(ops.fill(std::vector<double>(out.channels, 0.25)).build(out), in, out);
+    }, 1 });
+    b.push_back({ "copy", 1, false, [](Ops &ops, Inputs &in, Image &out) {
+        return callFunction(ops.copy().build(*in[0], out), in, out);
+    }, 1 });
+    b.push_back({ "swizzle", 1, false, [](Ops &ops, Inputs &in, Image &out) {
+        // reverse the channel order
+        return callFunction(ops.swizzle(std::string("abgr").substr(4 - out.channels)).build(*in[0], out), in, out);
+    }, 1 });
+    b.push_back({ "channelwiseAffine", 1, false, [](Ops &ops, Inputs &in, Image &out) {
+        return callFunction(ops.channelwiseAffine(0.5, 0.125).build(*in[0], out), in, out);
+    }, 1 });
+    b.push_back({ "pixelwiseAffine", 1, false, [](Ops &ops, Inputs &in, Image &out) {
+        const int c = out.channels;
+        return callFunction(ops.pixelwiseAffine(matrix(c, c)).setBias(std::vector<double>(c, 0.1))
+            .build(*in[0], out), in, out);
+    }, 1 });
+    b.push_back({ "pixelwiseAffineCombination", 2, false, [](Ops &ops, Inputs &in, Image &out) {
+        const int c = out.channels;
+        operations::pixelwiseAffineCombination::Spec spec;
+        spec.factory = &ops;
+        return callFunction(spec.addLinearPart(matrix(c, c)).addLinearPart(matrix(c, c))
+            .setBias(std::vector<double>(c, 0.1)).build(*in[0], out), in, out);
+    }, 1 });
+    b.push_back({ "fixedConvolution2D-3x3", 1, false, [](Ops &ops, Inputs &in, Image &out) {
+        return callFunction(ops.fixedConvolution2D({{ 1, 2, 1 }, { 2, 4, 2 }, { 1, 2, 1 }})
+            .scaleKernelValues(1 / 16.0).build(*in[0], out), in, out);
+    }, 1 });
+    b.push_back({ "fixedConvolution2D-5x5", 1, false, [](Ops &ops, Inputs &in, Image &out) {
+        return callFunction(ops.fixedConvolution2D(std::vector<std::vector<double>>(5, std::vector<double>(5, 1 / 25.0)))
+            .build(*in[0], out), in, out);
+    }, 1 });
+    b.push_back({ "rescale-half", 1, false, [](Ops &ops, Inputs &in, Image &out) {
+        // integer textures cannot be filtered in OpenGL
+        const auto interp = ImageTypeSpec::isIntegerType(out.dataType)
+            ? Image::Interpolation::NEAREST : Image::Interpolation::LINEAR;
+        return callFunction(ops.rescale().setInterpolation(interp).build(*in[0], out), in, out);
+    }, 0.5 });
+    b.push_back({ "rescale-half-area", 1, true, [](Ops &ops, Inputs &in, Image &out) {
+        return callFunction(ops.rescale().setInterpolation(Image::Interpolation::AREA).build(*in[0], out), in, out);
+    }, 0.5 });
+    b.push_back({ "pixelwiseChain-3", 1, false, [](Ops &ops, Inputs &in, Image &out) {
+        const int c = out.channels;
+        return callFunction(ops.pixelwiseChain()
+            .add(ops.channelwiseAffine(0.5, 0.125), DataType::FLOAT32)
+            .add(ops.pixelwiseAffine(matrix(c, c)), DataType::FLOAT32)
+            .add(ops.channelwiseAffine(2, -0.125), out.dataType)
+            .build(*in[0], out), in, out);
+    }, 1 });
+    b.push_back({ "readRaw", 1, false, [](Ops &, Inputs &in, Image &) -> Runnable {
+        auto buffer = std::make_shared<std::vector<std::uint8_t>>(in[0]->size());
+        Image *img = in[0];
+        return [buffer, img]() { return img->readRaw(buffer->data()); };
+    }, 0 });
+    b.push_back({ "writeRaw", 1, false, [](Ops &, Inputs &in, Image &) -> Runnable {
+        auto buffer = std::make_shared<std::vector<std::uint8_t>>(in[0]->size(), 1);
+        Image *img = in[0];
+        return [buffer, img]() { return img->writeRaw(buffer->data()); };
+    }, 0 });
+    return b;
+}
+
+void printResult(const Settings &settings, const Backend &backend, const Benchmark &bench, const Case &c,
+    int iterations, double seconds, std::size_t bytesPerIteration)
+{
+    const double latencyMs = seconds / iterations * 1000;
+    const double pixelsPerSecond = double(c.width) * c.height * iterations / seconds;
+    const double gbPerSecond = double(bytesPerIteration) * iterations / seconds * 1e-9;
+    if (settings.json) {
+        std::cout << "{\"backend\":\"" << backend.name << "\",\"op\":\"" << bench.name
+            << "\",\"width\":" << c.width << ",\"height\":" << c.height
+            << ",\"channels\":" << c.channels << ",\"type\":\"" << typeName(c.dataType)
+            << "\",\"iterations\":" << iterations << ",\"latency_ms\":" << latencyMs
+            << ",\"pixels_per_s\":" << pixelsPerSecond << ",\"gb_per_s\":" << gbPerSecond
+            << "}" << std::endl;
+    } else {
+        std::cout << backend.name << "," << bench.name << "," << c.width << "," << c.height << ","
+            << c.channels << "," << typeName(c.dataType) << "," << iterations << ","
+            << latencyMs << "," << pixelsPerSecond << "," << gbPerSecond << std::endl;
+    }
+}
+
+void run(const Settings &settings, Backend &backend, const Benchmark &bench, const Case &c) {
+    typedef std::chrono::steady_clock Clock;
+    std::vector<std::unique_ptr<Image>> inputImages;
+    std::vector<Image*> inputs;
+    std::vector<std::uint8_t> data;
+    for (int i = 0; i < bench.nInputs; ++i) {
+        inputImages.push_back(backend.images->create(c.width, c.height, c.channels, c.dataType));
+        inputs.push_back(inputImages.back().get());
+        data.resize(inputs.back()->size());
+        for (std::size_t j = 0; j < data.size(); ++j) data[j] = (j * 31) % 64;
+        inputs.back()->writeRaw(data.data()).wait();
+    }
+
+    // transfer benchmarks (outScale = 0) only use the input image
+    const int outW = std::max(1, int(c.width * bench.outScale)), outH = std::max(1, int(c.height * bench.outScale));
+    auto output = backend.images->create(outW, outH, c.channels, c.dataType);
+    const Runnable runnable = bench.build(*backend.ops, inputs, *output);
+
+    // warm-up: shader compilation, first allocations etc.
+    for (int i = 0; i < 2; ++i) runnable().wait();
+
+    int iterations = 0;
+    const auto t0 = Clock::now();
+    double seconds = 0;
+    while (iterations < settings.maxIterations && seconds < settings.minSeconds) {
+        runnable().wait();
+        // make sure the GPU work is done (GL operations may only be enqueued)
+        if (backend.gpu) backend.processor->enqueue([]() {}).wait();
+        iterations++;
+        seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    }
+
+    std::size_t bytes = 0;
+    if (bench.outScale == 0) bytes = inputs.at(0)->size();
+    else {
+        for (auto *img : inputs) bytes += img->size();
+        bytes += output->size();
+    }
+    printResult(settings, backend, bench, c, iterations, seconds, bytes);
+}
+}
+
+int main(int argc, char *argv[]) {
+    Settings settings;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--json") settings.json = true;
+        else if (arg == "--quick") settings.quick = true;
+        else if (arg.find("--filter=") == 0) settings.filter = arg.substr(std::strlen("--filter="));
+        else {
+            std::cerr << "usage: " << argv[0] << " [--json] [--quick] [--filter=substring]" << std::endl;
+            return 1;
+        }
+    }
+    if (settings.quick) {
+        settings.minSeconds = 0.02;
+        settings.maxIterations = 20;
+    }
+
+    const int nThreads = std::max(2, int(std::thread::hardware_concurrency()));
+    std::vector<Backend> backends;
+    {
+        Backend b;
+        b.name = "cpu";
+        b.processor = Processor::createInstant();
+        b.images = cpu::Image::createFactory();
+        b.ops = cpu::operations::createFactory(*b.processor);
+        b.gpu = false;
+        backends.push_back(std::move(b));
+    }
+    {
+        Backend b;
+        b.name = "cpu-pool-" + std::to_string(nThreads);
+        b.processor = Processor::createThreadPool(nThreads);
+        b.images = cpu::Image::createFactory();
+        b.ops = cpu::operations::createFactory(*b.processor, nThreads);
+        b.gpu = false;
+        backends.push_back(std::move(b));
+    }
+#ifdef TEST_WITH_OPENGL
+    {
+        Backend b;
+        b.name = "opengl";
+        b.processor = opengl::createGLFWProcessor();
+        b.images = opengl::Image::createFactory(*b.processor);
+        b.ops = opengl::operations::createFactory(*b.processor);
+        b.gpu = true;
+        backends.push_back(std::move(b));
+    }
+#endif
+
+    std::vector<std::pair<int, int>> sizes = { { 320, 240 }, { 1280, 720 }, { 1920, 1080 } };
+    std::vector<DataType> types = { DataType::UINT8, DataType::UFIXED8, DataType::FLOAT32 };
+    std::vector<int> channelCounts = { 1, 3, 4 };
+    if (settings.quick) {
+        sizes = { { 320, 240 } };
+        channelCounts = { 1, 4 };
+    }
+
+    if (!settings.json)
+        std::cout << "backend,op,width,height,channels,type,iterations,latency_ms,pixels_per_s,gb_per_s" << std::endl;
+
+    for (auto &backend : backends) {
+        for (const auto &bench : getBenchmarks()) {
+            if (bench.cpuOnly && backend.gpu) continue;
+            if (!settings.filter.empty() && (backend.name + "/" + bench.name).find(settings.filter) == std::string::npos)
+                continue;
+            for (const auto &size : sizes) {
+                for (auto type : types) {
+                    for (int channels : channelCounts) {
+                        // 3-channel textures are not supported in all GL versions
+                        if (backend.gpu && channels == 3) continue;
+                        run(settings, backend, bench, { size.first, size.second, channels, type });
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
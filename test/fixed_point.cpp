@@ -1,7 +1,9 @@
 #include <catch2/catch.hpp>
 #include <cmath>
+#include <vector>
 
 #include "fixed_point.hpp"
+#include "float16.hpp"
 
 TEST_CASE( "Unsigned fixed point", "[accelerated-arrays]" ) {
     using namespace accelerated;
@@ -44,3 +46,102 @@ TEST_CASE( "Signed fixed point", "[accelerated-arrays]" ) {
     auto d = F(-0.6) + a;
     REQUIRE(d == F(-0.1));
 }
+
+namespace {
+// the reference (GPU compatible) definitions of the operations are fromFloat
+// of the double results, except that the truncation in fromFloat should not
+// depend on the double rounding errors when the exact result is an integer
+template <class T> T referenceFromFloat(double value) {
+    typedef accelerated::FixedPoint<T> F;
+    const double c = F::clamp(value);
+    const double v = F::isSigned() ? F::unsignedMax() * c / 2 : F::max() * c + 0.5;
+    const double nearest = std::round(v);
+    if (std::fabs(v - nearest) < 1e-9) return T(nearest);
+    REQUIRE(F::fromFloat(value) == T(v));
+    return T(v);
+}
+
+template <class T> void checkOperations(int a, int b) {
+    using namespace accelerated;
+    typedef FixedPoint<T> F;
+    const F fa = F::fromValue(T(a)), fb = F::fromValue(T(b));
+    const double x = fa.toFloat(), y = fb.toFloat();
+    REQUIRE((fa * fb).value == referenceFromFloat<T>(x * y));
+    REQUIRE((fa + fb).value == referenceFromFloat<T>(x + y));
+    REQUIRE((fa - fb).value == referenceFromFloat<T>(x - y));
+    if (y != 0) REQUIRE((fa / fb).value == referenceFromFloat<T>(x / y));
+}
+
+template <class T> void checkAllEightBitOperations() {
+    using namespace accelerated;
+    typedef FixedPoint<T> F;
+    for (int a = int(F::min()); a <= int(F::max()); ++a) {
+        const F fa = F::fromValue(T(a));
+        const double x = F::isSigned() ? (2.0 * a + 1) / F::unsignedMax() : a / F::max();
+        REQUIRE(fa.toFloat() == x);
+        REQUIRE((-fa).value == referenceFromFloat<T>(-x));
+        for (int b = int(F::min()); b <= int(F::max()); ++b) checkOperations<T>(a, b);
+    }
+}
+
+template <class T> void checkSampledSixteenBitOperations() {
+    using namespace accelerated;
+    typedef FixedPoint<T> F;
+    std::vector<int> samples = { int(F::max()), int(F::max()) - 1, 0, 1, 2 };
+    if (F::isSigned()) samples.insert(samples.end(), { -1, -2, int(F::min()) + 1 });
+    for (int v = int(F::min()); v <= int(F::max()); v += 241) samples.push_back(v);
+    for (int a : samples) {
+        REQUIRE((-F::fromValue(T(a))).value == referenceFromFloat<T>(-F::fromValue(T(a)).toFloat()));
+        for (int b : samples) checkOperations<T>(a, b);
+    }
+}
+}
+
+TEST_CASE( "8-bit fixed point operations", "[accelerated-arrays]" ) {
+    checkAllEightBitOperations<std::uint8_t>();
+    checkAllEightBitOperations<std::int8_t>();
+}
+
+TEST_CASE( "16-bit fixed point operations", "[accelerated-arrays]" ) {
+    checkSampledSixteenBitOperations<std::uint16_t>();
+    checkSampledSixteenBitOperations<std::int16_t>();
+}
+
+TEST_CASE( "Half-precision float", "[accelerated-arrays]" ) {
+    using namespace accelerated;
+    REQUIRE(sizeof(Float16) == 2);
+
+    REQUIRE(Float16(1.0).value == 0x3c00);
+    REQUIRE(Float16(-2.0).value == 0xc000);
+    REQUIRE(Float16(65504.0).value == 0x7bff);
+    REQUIRE(Float16(65519.0).value == 0x7bff);
+    REQUIRE(Float16(65520.0).value == 0x7c00); // rounds to infinity
+    REQUIRE(Float16(std::pow(2.0, -24)).value == 0x0001); // smallest subnormal
+    REQUIRE(Float16(std::pow(2.0, -25)).value == 0x0000); // tie to even
+    REQUIRE(Float16(1.5 * std::pow(2.0, -24)).value == 0x0002);
+    REQUIRE(Float16(1.0 + std::pow(2.0, -11)).value == 0x3c00); // tie to even
+    REQUIRE(Float16(1.0 + 3 * std::pow(2.0, -11)).value == 0x3c02);
+    REQUIRE(std::isnan(float(Float16(std::nan("")))));
+    REQUIRE(std::isinf(float(Float16::fromValue(0xfc00))));
+
+    // every finite half round trips through float
+    for (int i = 0; i < 0x10000; ++i) {
+        const auto h = Float16::fromValue(std::uint16_t(i));
+        const float f = h;
+        if (std::isnan(f)) continue;
+        REQUIRE(Float16(f).value == h.value);
+        if ((i & 0x7c00) != 0x7c00 && (i & 0x7fff) != 0x7bff) {
+            // halfway to the next one rounds to even
+            const float next = Float16::fromValue(std::uint16_t(i + 1));
+            const double mid = (double(f) + next) / 2;
+            REQUIRE(Float16(mid).value == ((i & 1) ? i + 1 : i));
+        }
+    }
+
+    const Float16 a(1.5), b(0.25);
+    REQUIRE(float(a + b) == 1.75f);
+    REQUIRE(float(a * b) == 0.375f);
+    REQUIRE(float(a - b) == 1.25f);
+    REQUIRE(float(a / b) == 6.0f);
+    REQUIRE(float(-a) == -1.5f);
+}
@@ -135,3 +135,44 @@ TEST_CASE( "Fixed point images", "[accelerated-arrays]" ) {
     REQUIRE(cpuImg.get<Type>(2, 0, 0).value == 23);
     REQUIRE(std::fabs(cpuImg.get<float>(2, 0, 0) - 23.001 / 0x7fff) < 0.0001);
 }
+
+TEST_CASE( "Row pitch reads & writes", "[accelerated-arrays]" ) {
+    using namespace accelerated;
+    auto factory = cpu::Image::createFactory();
+
+    auto image = factory->create<std::uint16_t, 3>(5, 4);
+    const std::size_t rowBytes = 5 * 3 * 2, pitch = rowBytes + 6;
+    std::vector<std::uint8_t> padded(pitch * 4, 77);
+    for (int y = 0; y < 4; ++y) {
+        auto *row = reinterpret_cast<std::uint16_t*>(padded.data() + y * pitch);
+        for (int i = 0; i < 5 * 3; ++i) row[i] = y * 100 + i;
+    }
+
+    image->writeRaw(padded.data(), pitch).wait();
+    auto &cpuImg = cpu::Image::castFrom(*image);
+    REQUIRE(cpuImg.get<std::uint16_t>(0, 0, 0) == 0);
+    REQUIRE(cpuImg.get<std::uint16_t>(4, 3, 2) == 314);
+
+    // padding is not touched
+    std::vector<std::uint8_t> out(pitch * 4, 55);
+    image->readRaw(out.data(), pitch).wait();
+    for (int y = 0; y < 4; ++y) {
+        for (std::size_t x = 0; x < pitch; ++x) {
+            if (x < rowBytes) REQUIRE(out[y * pitch + x] == padded[y * pitch + x]);
+            else REQUIRE(int(out[y * pitch + x]) == 55);
+        }
+    }
+
+    // a ROI to a padded buffer
+    auto roi = image->createROI(1, 2, 3, 2);
+    std::vector<std::uint16_t> roiOut(3 * 3 * 2 + 3, 0);
+    roi->read<std::uint16_t>(roiOut.data(), (3 * 3 + 3) * 2).wait();
+    REQUIRE(roiOut.at(0) == 203);
+    REQUIRE(roiOut.at(3 * 3 + 3) == 303);
+    REQUIRE(roiOut.back() == 311);
+
+    // copying between a GPU-like image and a ROI goes through the pitched calls
+    auto target = factory->create<std::uint16_t, 3>(3, 2);
+    cpu::Image::castFrom(*roi).copyTo(*target).wait();
+    REQUIRE(cpu::Image::castFrom(*target).get<std::uint16_t>(2, 1, 2) == 311);
+}
@@ -5,6 +5,9 @@
 #include "opengl/operations.hpp"
 #include "opengl/image.hpp"
 #include "opengl/adapters.hpp"
+#include "cpu/image.hpp"
+#include "cpu/operations.hpp"
+#include "task_graph.hpp"
 
 #ifdef TEST_OPENGL_WITH_VISIBLE_WINDOW
 #include <chrono>
@@ -196,6 +199,967 @@ TEST_CASE( "float image", "[accelerated-arrays-opengl]" ) {
     REQUIRE(std::fabs(outBuf.back() - (-3.14159)) < 1e-5);
 }
 
+TEST_CASE( "half float image", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+
+    typedef Float16 Type;
+    auto image = factory->create<Type, 4>(20, 30);
+    REQUIRE(image->bytesPerPixel() == 8);
+
+    std::vector<Type> inBuf, outBuf;
+    inBuf.resize(image->numberOfScalars(), Type(3.14159));
+    image->write(inBuf);
+    image->read(outBuf).wait();
+    REQUIRE(outBuf[0].value == Type(3.14159).value);
+
+    auto ops = opengl::operations::createFactory(*processor);
+    auto fill = ops->fill({ 201, 202, -3.14159, 1e6 }).build(*image);
+
+    operations::callNullary(fill, *image).wait();
+    image->read(outBuf).wait();
+    REQUIRE(outBuf.at(outBuf.size() - 2).value == Type(-3.14159).value);
+    // out-of-range values become infinite on both backends
+    REQUIRE(outBuf.back().value == 0x7c00);
+    auto cpuProcessor = Processor::createInstant();
+    auto cpuFactory = cpu::Image::createFactory();
+    auto cpuOps = cpu::operations::createFactory(*cpuProcessor);
+    auto cpuImage = cpuFactory->create<Type, 4>(2, 2);
+    operations::callNullary(cpuOps->fill({ 201, 202, -3.14159, 1e6 }).build(*cpuImage), *cpuImage).wait();
+    REQUIRE(cpu::Image::castFrom(*cpuImage).get<Type>(1, 1, 3).value == 0x7c00);
+    REQUIRE(cpu::Image::castFrom(*cpuImage).get<Type>(1, 1, 2).value == outBuf.at(outBuf.size() - 2).value);
+
+    // float -> half in a shader
+    auto floats = factory->create<float, 4>(20, 30);
+    operations::callNullary(ops->fill({ 0.1, 0.2, 0.3, 0.4 }).build(*floats), *floats);
+    operations::callUnary(ops->copy().build(*floats, *image), *floats, *image).wait();
+    image->read(outBuf).wait();
+    REQUIRE(outBuf.at(1).value == Type(0.2).value);
+}
+
+TEST_CASE( "asynchronous reads & buffered uploads", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    auto processor = opengl::createGLFWProcessor();
+    opengl::Image::FactoryOptions options;
+    options.asyncReadBuffers = 2;
+    options.uploadBuffers = 2;
+    auto factory = opengl::Image::createFactory(*processor, options);
+    auto ops = opengl::operations::createFactory(*processor);
+
+    typedef FixedPoint<std::uint8_t> Type;
+    auto image = factory->create<Type, 4>(20, 10);
+    auto twoChannels = factory->create<Type, 2>(19, 17); // uses the read adapter
+    const double s = 1.0 / FixedPoint<std::uint8_t>::max();
+
+    // more reads in flight than there are buffers
+    const int n = 3;
+    std::vector< std::vector<std::uint8_t> > outBufs(n), outBufs2(n);
+    std::vector<Future> reads;
+    for (int i = 0; i < n; ++i) {
+        operations::callNullary(ops->fill({ i * s, 1 * s, 2 * s, 3 * s }).build(*image), *image);
+        operations::callNullary(ops->fill({ i * s, 4 * s }).build(*twoChannels), *twoChannels);
+        reads.push_back(image->readRawFixedPoint(outBufs.at(i)));
+        reads.push_back(twoChannels->readRawFixedPoint(outBufs2.at(i)));
+    }
+    for (auto &f : reads) f.wait();
+
+    for (int i = 0; i < n; ++i) {
+        REQUIRE(int(outBufs.at(i).at(0)) == i);
+        REQUIRE(int(outBufs.at(i).back()) == 3);
+        REQUIRE(int(outBufs2.at(i).at(0)) == i);
+        REQUIRE(int(outBufs2.at(i).back()) == 4);
+    }
+
+    // waiting in the GL thread, e.g., in a continuation, must not deadlock
+    auto read = image->readRawFixedPoint(outBufs.at(0));
+    processor->enqueue([&read]() { read.wait(); }).wait();
+    REQUIRE(int(outBufs.at(0).at(0)) == n - 1);
+
+    std::vector<std::uint8_t> inBuf(image->numberOfScalars());
+    for (int i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < inBuf.size(); ++j) inBuf[j] = (i + j) % 256;
+        image->writeRawFixedPoint(inBuf).wait();
+        image->readRawFixedPoint(outBufs.at(0)).wait();
+        REQUIRE(outBufs.at(0) == inBuf);
+    }
+    std::vector<std::uint8_t> roiBuf(4 * 5 * 4, 205);
+    image->createROI(2, 3, 4, 5)->writeRawFixedPoint(roiBuf).wait();
+    image->readRawFixedPoint(outBufs.at(0)).wait();
+    REQUIRE(int(outBufs.at(0).at((3 * 20 + 2) * 4)) == 205);
+    REQUIRE(int(outBufs.at(0).back()) == int(inBuf.back()));
+}
+
+TEST_CASE( "row pitch transfers", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    auto processor = opengl::createGLFWProcessor();
+    auto cpuFactory = cpu::Image::createFactory();
+
+    for (int asyncBuffers : { 0, 2 }) {
+        opengl::Image::FactoryOptions options;
+        options.asyncReadBuffers = asyncBuffers;
+        options.uploadBuffers = asyncBuffers;
+        auto factory = opengl::Image::createFactory(*processor, options);
+
+        typedef FixedPoint<std::uint8_t> Type;
+        // RGB: pitch 4-byte aligned but not a multiple of the pixel size
+        for (int channels : { 3, 1, 2 }) {
+            auto image = factory->create(7, 5, channels, ImageTypeSpec::DataType::UFIXED8);
+            const std::size_t rowBytes = 7 * channels;
+            for (std::size_t pitch : { rowBytes, rowBytes + 1, (rowBytes + 3) / 4 * 4 + 4 }) {
+                std::vector<std::uint8_t> in(pitch * 5, 201), out(pitch * 5, 202);
+                for (int y = 0; y < 5; ++y)
+                    for (std::size_t x = 0; x < rowBytes; ++x) in[y * pitch + x] = (y * 31 + x) % 200;
+
+                image->writeRaw(in.data(), pitch).wait();
+                image->readRaw(out.data(), pitch).wait();
+                for (int y = 0; y < 5; ++y) {
+                    for (std::size_t x = 0; x < pitch; ++x) {
+                        if (x < rowBytes) REQUIRE(out[y * pitch + x] == in[y * pitch + x]);
+                        else REQUIRE(int(out[y * pitch + x]) == 202);
+                    }
+                }
+            }
+
+            // GPU <-> CPU ROI, no temporary buffer
+            auto cpuImage = cpuFactory->create(9, 6, channels, ImageTypeSpec::DataType::UFIXED8);
+            auto cpuRoi = cpuImage->createROI(1, 1, 7, 5);
+            cpu::Image::castFrom(*cpuRoi).copyFrom(*image).wait();
+            REQUIRE(cpu::Image::castFrom(*cpuImage).get<Type>(1, 1, 0).value == 0);
+            REQUIRE(cpu::Image::castFrom(*cpuImage).get<Type>(7, 5, 0).value == (4 * 31 + 6 * channels) % 200);
+            cpu::Image::castFrom(*cpuRoi).copyTo(*image).wait();
+        }
+    }
+}
+
+TEST_CASE( "shared-context transfers", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = opengl::createGLFWProcessor(opengl::GLFWProcessorMode::ASYNC);
+    auto transferProcessor = opengl::createGLFWTransferProcessor(*processor);
+    {
+        opengl::Image::FactoryOptions options;
+        options.transferProcessor = transferProcessor.get();
+        auto factory = opengl::Image::createFactory(*processor, options);
+        auto ops = opengl::operations::createFactory(*processor);
+
+        const int w = 30, h = 20, n = 3;
+        auto input = factory->create<Type, 4>(w, h);
+        auto output = factory->create<Type, 4>(w, h);
+        auto invert = ops->channelwiseAffine(-1, 1).build(*input);
+
+        std::vector< std::vector<std::uint8_t> > inBufs(n), outBufs(n);
+        std::vector<Future> reads;
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < w * h * 4; ++j) inBufs.at(i).push_back((i * 50 + j) % 256);
+            // no waiting: the fences order the transfers with the operation,
+            // including writing the input while the previous frame uses it
+            input->writeRawFixedPoint(inBufs.at(i));
+            operations::callUnary(invert, *input, *output);
+            reads.push_back(output->readRawFixedPoint(outBufs.at(i)));
+        }
+        for (auto &f : reads) f.wait();
+
+        for (int i = 0; i < n; ++i) {
+            REQUIRE(outBufs.at(i).size() == inBufs.at(i).size());
+            for (std::size_t j = 0; j < outBufs.at(i).size(); ++j) {
+                REQUIRE(int(outBufs.at(i).at(j)) == 255 - int(inBufs.at(i).at(j)));
+            }
+        }
+    }
+}
+
+TEST_CASE( "GPU completion futures", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    opengl::operations::FactoryOptions options;
+    options.gpuCompletionFutures = true;
+    auto ops = opengl::operations::createFactory(*processor, options);
+
+    typedef FixedPoint<std::uint8_t> Type;
+    auto image = factory->create<Type, 4>(64, 32);
+    auto output = factory->create<Type, 4>(64, 32);
+    const double s = 1.0 / FixedPoint<std::uint8_t>::max();
+
+    auto fill = ops->fill({ 1 * s, 2 * s, 3 * s, 4 * s }).build(*image);
+    auto swizzle = ops->swizzle("abgr").build(*image);
+
+    std::vector<Future> futures;
+    for (int i = 0; i < 5; ++i) {
+        futures.push_back(operations::callNullary(fill, *image));
+        futures.push_back(operations::callUnary(swizzle, *image, *output));
+    }
+    futures.back().isReady(); // must not block
+    REQUIRE(futures.back().waitFor(std::chrono::seconds(10)));
+    // completed in order
+    for (auto &f : futures) REQUIRE(f.isReady());
+    futures.at(0).wait();
+
+    std::vector<std::uint8_t> outBuf;
+    output->readRawFixedPoint(outBuf).wait();
+    REQUIRE(int(outBuf.at(0)) == 4);
+    REQUIRE(int(outBuf.back()) == 1);
+}
+
+TEST_CASE( "task graph transfers", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    auto ops = opengl::operations::createFactory(*processor);
+    auto cpuProcessor = Processor::createThreadPool(1);
+    auto cpuFactory = cpu::Image::createFactory();
+    auto cpuOps = cpu::operations::createFactory(*cpuProcessor);
+
+    typedef FixedPoint<std::uint8_t> Type;
+    auto gpuIn = factory->create<Type, 4>(16, 8);
+    auto cpuMid = cpuFactory->create<Type, 4>(16, 8);
+    auto gpuOut = factory->create<Type, 4>(16, 8);
+    const double s = 1.0 / FixedPoint<std::uint8_t>::max();
+
+    auto increment = cpuOps->wrap<cpu::operations::Unary>([](cpu::Image &in, cpu::Image &out) {
+        for (int y = 0; y < out.height; ++y)
+            for (int x = 0; x < out.width; ++x)
+                for (int c = 0; c < out.channels; ++c)
+                    out.set<Type>(x, y, c, Type::fromValue(in.get<Type>(x, y, c).value + 1));
+    });
+
+    auto graph = TaskGraph::create();
+    graph->add(ops->fill({ 1 * s, 2 * s, 3 * s, 4 * s }).build(*gpuIn), {}, *gpuIn, *factory);
+    // CPU operation on a GPU image: download inserted
+    graph->add(increment, { gpuIn.get() }, *cpuMid, *cpuFactory);
+    // GPU operation on a CPU image: upload inserted
+    graph->add(ops->swizzle("abgr").build(*gpuIn), { cpuMid.get() }, *gpuOut, *factory);
+    REQUIRE(graph->numberOfTransfers() == 2);
+
+    for (int i = 0; i < 3; ++i) graph->run();
+    graph->run().wait();
+
+    std::vector<std::uint8_t> outBuf;
+    gpuOut->readRawFixedPoint(outBuf).wait();
+    REQUIRE(int(outBuf.at(0)) == 5);
+    REQUIRE(int(outBuf.back()) == 2);
+}
+
+TEST_CASE( "recorded command list", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    auto ops = opengl::operations::createFactory(*processor);
+
+    typedef FixedPoint<std::uint8_t> Type;
+    auto a = factory->create<Type, 4>(16, 8);
+    auto b = factory->create<Type, 4>(16, 8);
+    auto c = factory->create<Type, 4>(16, 8);
+    const double s = 1.0 / FixedPoint<std::uint8_t>::max();
+
+    auto fill = ops->fill({ 1 * s, 2 * s, 3 * s, 4 * s }).build(*a);
+    auto swizzle = ops->swizzle("abgr").build(*a);
+    auto affine = ops->channelwiseAffine(2.0, 1 * s).build(*a);
+
+    auto frame = ops->record([&]() {
+        operations::callNullary(fill, *a);
+        operations::callUnary(swizzle, *a, *b);
+        operations::callUnary(affine, *b, *c);
+    });
+
+    for (int i = 0; i < 3; ++i) frame();
+    frame().wait();
+
+    std::vector<std::uint8_t> outBuf;
+    c->readRawFixedPoint(outBuf).wait();
+    REQUIRE(int(outBuf.at(0)) == 9);
+    REQUIRE(int(outBuf.at(3)) == 3);
+
+    // the Functions work normally outside the recording
+    operations::callUnary(swizzle, *c, *b).wait();
+    b->readRawFixedPoint(outBuf).wait();
+    REQUIRE(int(outBuf.at(0)) == 3);
+}
+
+TEST_CASE( "program cache", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    auto ops = opengl::operations::createFactory(*processor);
+
+    typedef FixedPoint<std::uint8_t> Type;
+    auto small = factory->create<Type, 4>(20, 10);
+    auto large = factory->create<Type, 4>(40, 30);
+    auto smallOut = factory->create<Type, 4>(20, 10);
+    auto largeOut = factory->create<Type, 4>(40, 30);
+    const double s = 1.0 / FixedPoint<std::uint8_t>::max();
+
+    const auto before = opengl::programCache::getStats();
+    // same shader for a different resolution
+    auto swizzleSmall = ops->swizzle("abgr").build(*small);
+    auto swizzleLarge = ops->swizzle("abgr").build(*large);
+    operations::callNullary(ops->fill({ 1 * s, 2 * s, 3 * s, 4 * s }).build(*small), *small);
+    operations::callNullary(ops->fill({ 5 * s, 6 * s, 7 * s, 8 * s }).build(*large), *large);
+    operations::callUnary(swizzleSmall, *small, *smallOut);
+    operations::callUnary(swizzleLarge, *large, *largeOut).wait();
+    const auto after = opengl::programCache::getStats();
+    REQUIRE(after.hits > before.hits);
+
+    std::vector<std::uint8_t> outBuf;
+    smallOut->readRawFixedPoint(outBuf).wait();
+    REQUIRE(int(outBuf.at(0)) == 4);
+    largeOut->readRawFixedPoint(outBuf).wait();
+    REQUIRE(int(outBuf.at(0)) == 8);
+
+    // as after a context loss: the old programs are not deleted on release
+    processor->enqueue([]() { opengl::forgetContext(); }).wait();
+    const auto beforeForgotten = opengl::programCache::getStats();
+    auto swizzleAgain = ops->swizzle("abgr").build(*large);
+    operations::callUnary(swizzleAgain, *large, *largeOut).wait();
+    REQUIRE(opengl::programCache::getStats().compiled > beforeForgotten.compiled);
+    swizzleSmall = {};
+    swizzleLarge = {};
+    operations::callNullary(ops->fill({ 9 * s, 0, 0, 0 }).build(*large), *large);
+    operations::callUnary(swizzleAgain, *large, *largeOut).wait();
+    largeOut->readRawFixedPoint(outBuf).wait();
+    REQUIRE(int(outBuf.at(3)) == 9);
+}
+
+TEST_CASE( "GL image destroyed in a full rejecting queue", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    auto processor = opengl::createGLFWProcessor();
+    QueueOptions options;
+    options.capacity = 1;
+    options.fullPolicy = QueueOptions::FullPolicy::REJECT;
+    auto queue = Processor::createQueue(options);
+    // the bounded queue is processed in the GL thread
+    auto processQueue = [&processor, &queue]() {
+        processor->enqueue([&queue]() { queue->processAll(); }).wait();
+    };
+
+    auto factory = opengl::Image::createPooledFactory(*queue, 1 << 20);
+    auto image = factory->create<FixedPoint<std::uint8_t>, 4>(8, 8);
+    processQueue();
+    REQUIRE(factory->getStats().bytesInUse > 0);
+
+    REQUIRE(!queue->enqueue([]() {}).isFailed());
+    REQUIRE(queue->enqueue([]() {}).isFailed());
+    image.reset();
+    REQUIRE(queue->getQueueStats().rejected == 1);
+
+    processQueue();
+    const auto stats = factory->getStats();
+    REQUIRE(stats.bytesInUse == 0);
+    REQUIRE(stats.pooledBuffers == 1);
+    REQUIRE(!queue->enqueue([]() {}).isFailed());
+    REQUIRE(!factory->releaseUnused().isFailed());
+    processQueue();
+    REQUIRE(factory->getStats().pooledBuffers == 0);
+}
+
+TEST_CASE( "fused pixelwise chain", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef ImageTypeSpec::DataType DataType;
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    auto ops = opengl::operations::createFactory(*processor);
+
+    const int w = 30, h = 20;
+    auto input = factory->create<Type, 3>(w, h);
+    std::vector<std::uint8_t> inBuf(input->numberOfScalars());
+    for (std::size_t i = 0; i < inBuf.size(); ++i) inBuf[i] = (i * 37) % 256;
+    input->writeRawFixedPoint(inBuf);
+
+    auto swiz = ops->swizzle("bg1");
+    auto affine = ops->pixelwiseAffine({{ 0.25, 0.5, 0.125 }}).setBias({ -0.05 });
+    auto scale = ops->channelwiseAffine(1.5, 0.1);
+
+    // reference: separate operations with intermediary textures
+    auto swizzled = factory->create<Type, 3>(w, h);
+    auto gray = factory->create<Type, 1>(w, h);
+    auto expected = factory->create<Type, 1>(w, h);
+    operations::callUnary(swiz.build(*input), *input, *swizzled);
+    operations::callUnary(affine.build(*swizzled, *gray), *swizzled, *gray);
+    operations::callUnary(scale.build(*gray), *gray, *expected);
+
+    auto output = factory->create<Type, 1>(w, h);
+    auto chain = ops->pixelwiseChain()
+        .add(swiz, DataType::UFIXED8)
+        .add(affine, DataType::UFIXED8)
+        .add(scale, DataType::UFIXED8);
+    operations::callUnary(chain.build(*input, *output), *input, *output);
+
+    std::vector<std::uint8_t> outBuf, expectedBuf;
+    expected->readRawFixedPoint(expectedBuf);
+    output->readRawFixedPoint(outBuf).wait();
+    REQUIRE(outBuf.size() == expectedBuf.size());
+    for (std::size_t i = 0; i < outBuf.size(); ++i) {
+        // GPU rounding may differ slightly
+        REQUIRE(std::abs(int(outBuf.at(i)) - int(expectedBuf.at(i))) <= 1);
+    }
+
+    // half-float and integer intermediary steps round and saturate like
+    // the corresponding images
+    auto floats = factory->create<float, 4>(w, h);
+    auto floatOut = factory->createLike(*floats);
+    const std::vector<float> values = { 0.1f, 1e6f, 3.7f, -300.0f };
+    std::vector<float> floatBuf(floats->numberOfScalars());
+    for (std::size_t i = 0; i < floatBuf.size(); ++i) floatBuf[i] = values.at(i % 4);
+    floats->write(floatBuf);
+    auto identity = ops->channelwiseAffine(1, 0);
+
+    operations::callUnary(ops->pixelwiseChain()
+        .add(identity, DataType::FLOAT16)
+        .add(identity, DataType::FLOAT32)
+        .build(*floats), *floats, *floatOut);
+    floatOut->read(floatBuf).wait();
+    REQUIRE(floatBuf.at(0) == float(Float16(0.1f)));
+    REQUIRE(std::isinf(floatBuf.at(1)));
+    REQUIRE(floatBuf.at(2) == float(Float16(3.7f)));
+    REQUIRE(floatBuf.at(3) == -300.0f);
+
+    operations::callUnary(ops->pixelwiseChain()
+        .add(identity, DataType::SINT8)
+        .add(identity, DataType::FLOAT32)
+        .build(*floats), *floats, *floatOut);
+    floatOut->read(floatBuf).wait();
+    REQUIRE(floatBuf.at(0) == 0);
+    REQUIRE(floatBuf.at(1) == 127);
+    REQUIRE(floatBuf.at(2) == 3);
+    REQUIRE(floatBuf.at(3) == -128);
+}
+
+TEST_CASE( "separable convolution", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    auto ops = opengl::operations::createFactory(*processor);
+    auto cpuProcessor = Processor::createInstant();
+    auto cpuFactory = cpu::Image::createFactory();
+    auto cpuOps = cpu::operations::createFactory(*cpuProcessor);
+
+    const int w = 21, h = 13;
+    std::vector<std::uint8_t> inBuf(w * h * 4);
+    for (std::size_t i = 0; i < inBuf.size(); ++i) inBuf[i] = (i * 37 + 11) % 256;
+
+    // symmetric rows (merged linear taps) and an asymmetric column
+    const std::vector<double> row = { 1, 4, 6, 4, 1 }, column = { 1, 2, -1 };
+    std::vector< std::vector<double> > kernel;
+    for (double c : column) {
+        kernel.push_back({});
+        for (double r : row) kernel.back().push_back(c * r / 32.0);
+    }
+
+    auto input = factory->create<Type, 4>(w, h);
+    auto output = factory->create<Type, 4>((w + 1) / 2, h);
+    input->writeRawFixedPoint(inBuf);
+    auto spec = ops->fixedConvolution2D(kernel)
+        .setBias(0.1)
+        .setStride(2, 1)
+        .setOffset(1, 0)
+        .setBorder(Image::Border::CLAMP);
+    operations::callUnary(spec.build(*input, *output), *input, *output);
+
+    auto cpuInput = cpuFactory->create<Type, 4>(w, h);
+    auto expected = cpuFactory->createLike(*output);
+    cpuInput->writeRawFixedPoint(inBuf).wait();
+    auto cpuSpec = cpuOps->fixedConvolution2D(kernel)
+        .setBias(0.1)
+        .setStride(2, 1)
+        .setOffset(1, 0)
+        .setBorder(Image::Border::CLAMP);
+    operations::callUnary(cpuSpec.build(*cpuInput, *expected), *cpuInput, *expected).wait();
+
+    std::vector<std::uint8_t> outBuf, expectedBuf;
+    expected->readRawFixedPoint(expectedBuf).wait();
+    output->readRawFixedPoint(outBuf).wait();
+    REQUIRE(outBuf.size() == expectedBuf.size());
+    for (std::size_t i = 0; i < outBuf.size(); ++i) {
+        // limited precision of the GPU linear interpolation weights
+        REQUIRE(std::abs(int(outBuf.at(i)) - int(expectedBuf.at(i))) <= 1);
+    }
+}
+
+TEST_CASE( "multiple render targets", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    auto ops = opengl::operations::createFactory(*processor);
+
+    const int w = 12, h = 6;
+    auto input = factory->create<Type, 4>(w, h);
+    std::vector<std::uint8_t> inBuf(input->numberOfScalars());
+    for (std::size_t i = 0; i < inBuf.size(); ++i) inBuf[i] = (i * 37) % 256;
+    input->writeRawFixedPoint(inBuf);
+
+    auto rg = factory->create<Type, 4>(w, h);
+    auto ba = factory->create<Type, 4>(w, h);
+    auto split = ops->wrapShader(R"(
+        void main() {
+            vec4 v = texelFetch(u_texture, ivec2(v_texCoord * vec2(u_outSize)), 0);
+            outValue1 = vec4(v.rg, 0, 1);
+            outValue2 = vec4(v.ba, 0, 1);
+        }
+    )", { *input }, { *rg, *ba });
+
+    std::array<Image*, 1> inputs = {{ input.get() }};
+    std::array<Image*, 2> outputs = {{ rg.get(), ba.get() }};
+    operations::call(split, inputs, outputs);
+
+    std::vector<std::uint8_t> rgBuf, baBuf;
+    rg->readRawFixedPoint(rgBuf);
+    ba->readRawFixedPoint(baBuf).wait();
+    for (int i = 0; i < w * h; ++i) {
+        REQUIRE(rgBuf.at(i * 4 + 0) == inBuf.at(i * 4 + 0));
+        REQUIRE(rgBuf.at(i * 4 + 1) == inBuf.at(i * 4 + 1));
+        REQUIRE(baBuf.at(i * 4 + 0) == inBuf.at(i * 4 + 2));
+        REQUIRE(baBuf.at(i * 4 + 1) == inBuf.at(i * 4 + 3));
+        REQUIRE(int(baBuf.at(i * 4 + 3)) == 255);
+    }
+}
+
+TEST_CASE( "GL image pyramid", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    auto ops = opengl::operations::createFactory(*processor);
+    auto cpuProcessor = Processor::createInstant();
+    auto cpuFactory = cpu::Image::createFactory();
+    auto cpuOps = cpu::operations::createFactory(*cpuProcessor);
+
+    const int w = 40, h = 27, levels = 3;
+    std::vector<std::uint8_t> inBuf(w * h * 4);
+    for (std::size_t i = 0; i < inBuf.size(); ++i) inBuf[i] = (i * 37 + 11) % 256;
+
+    auto input = factory->create<Type, 4>(w, h);
+    auto cpuInput = cpuFactory->create<Type, 4>(w, h);
+    input->writeRawFixedPoint(inBuf);
+    cpuInput->writeRawFixedPoint(inBuf).wait();
+
+    std::vector< std::unique_ptr<Image> > outputs, expected;
+    std::array<Image*, levels> outputPtrs, expectedPtrs;
+    for (int l = 1; l <= levels; ++l) {
+        const int lw = operations::pyramid::Spec::getLevelWidth(*input, l);
+        const int lh = operations::pyramid::Spec::getLevelHeight(*input, l);
+        outputs.push_back(factory->create<Type, 4>(lw, lh));
+        expected.push_back(cpuFactory->create<Type, 4>(lw, lh));
+        outputPtrs[l - 1] = outputs.back().get();
+        expectedPtrs[l - 1] = expected.back().get();
+    }
+
+    std::array<Image*, 1> inputs = {{ input.get() }}, cpuInputs = {{ cpuInput.get() }};
+    operations::call(ops->pyramid(levels).build(*input), inputs, outputPtrs);
+    operations::call(cpuOps->pyramid(levels).build(*cpuInput), cpuInputs, expectedPtrs).wait();
+
+    for (int l = 0; l < levels; ++l) {
+        std::vector<std::uint8_t> outBuf, expectedBuf;
+        outputs.at(l)->readRawFixedPoint(outBuf).wait();
+        expected.at(l)->readRawFixedPoint(expectedBuf).wait();
+        REQUIRE(outBuf.size() == expectedBuf.size());
+        for (std::size_t i = 0; i < outBuf.size(); ++i) {
+            // rounding of the intermediate levels may differ
+            REQUIRE(std::abs(int(outBuf.at(i)) - int(expectedBuf.at(i))) <= 2);
+        }
+    }
+}
+
+TEST_CASE( "GL area rescale", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    auto ops = opengl::operations::createFactory(*processor);
+    auto cpuProcessor = Processor::createInstant();
+    auto cpuFactory = cpu::Image::createFactory();
+    auto cpuOps = cpu::operations::createFactory(*cpuProcessor);
+
+    const int w = 36, h = 20;
+    std::vector<std::uint8_t> inBuf(w * h * 4);
+    for (std::size_t i = 0; i < inBuf.size(); ++i) inBuf[i] = (i * 37 + 11) % 256;
+    auto input = factory->create<Type, 4>(w, h);
+    auto cpuInput = cpuFactory->create<Type, 4>(w, h);
+    input->writeRawFixedPoint(inBuf);
+    cpuInput->writeRawFixedPoint(inBuf).wait();
+
+    // integer and non-integer ratios
+    for (int outW : { 18, 24, 9 }) {
+        const int outH = 10;
+        auto output = factory->create<Type, 4>(outW, outH);
+        auto expected = cpuFactory->createLike(*output);
+        auto spec = ops->rescale().setInterpolation(Image::Interpolation::AREA).setBorder(Image::Border::CLAMP);
+        auto cpuSpec = cpuOps->rescale().setInterpolation(Image::Interpolation::AREA).setBorder(Image::Border::CLAMP);
+        operations::callUnary(spec.build(*input, *output), *input, *output);
+        operations::callUnary(cpuSpec.build(*cpuInput, *expected), *cpuInput, *expected).wait();
+
+        std::vector<std::uint8_t> outBuf, expectedBuf;
+        output->readRawFixedPoint(outBuf).wait();
+        expected->readRawFixedPoint(expectedBuf).wait();
+        REQUIRE(outBuf.size() == expectedBuf.size());
+        for (std::size_t i = 0; i < outBuf.size(); ++i) {
+            // the LINEAR lookup weights have a limited precision on the GPU
+            REQUIRE(std::abs(int(outBuf.at(i)) - int(expectedBuf.at(i))) <= 2);
+        }
+    }
+}
+
+TEST_CASE( "GL warp", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    auto ops = opengl::operations::createFactory(*processor);
+    auto cpuProcessor = Processor::createInstant();
+    auto cpuFactory = cpu::Image::createFactory();
+    auto cpuOps = cpu::operations::createFactory(*cpuProcessor);
+
+    const int w = 40, h = 27;
+    std::vector<std::uint8_t> inBuf(w * h * 4);
+    for (std::size_t i = 0; i < inBuf.size(); ++i) inBuf[i] = (i * 37 + 11) % 256;
+    auto input = factory->create<Type, 4>(w, h);
+    auto cpuInput = cpuFactory->create<Type, 4>(w, h);
+    input->writeRawFixedPoint(inBuf);
+    cpuInput->writeRawFixedPoint(inBuf).wait();
+
+    const double c = std::cos(0.2), s = std::sin(0.2);
+    const std::vector< std::vector<double> > homography = {{ c, -s, 4 }, { s, c, -3 }, { 0.001, 0, 1 }};
+    std::vector<float> mapData;
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            mapData.push_back(0.9 * x + 1.3);
+            mapData.push_back(1.1 * y - 0.7);
+        }
+    }
+    auto map = factory->create<float, 2>(w, h);
+    auto cpuMap = cpuFactory->create<float, 2>(w, h);
+    map->write(mapData);
+    cpuMap->write(mapData).wait();
+
+    for (auto border : { Image::Border::ZERO, Image::Border::CLAMP }) {
+        for (bool useMap : { false, true }) {
+            auto output = factory->create<Type, 4>(w, h);
+            auto expected = cpuFactory->createLike(*output);
+            auto spec = useMap ? ops->remap() : ops->warp(homography);
+            auto cpuSpec = useMap ? cpuOps->remap() : cpuOps->warp(homography);
+            if (useMap) {
+                operations::callBinary(spec.setBorder(border).build(*input), *input, *map, *output);
+                operations::callBinary(cpuSpec.setBorder(border).build(*cpuInput), *cpuInput, *cpuMap, *expected).wait();
+            } else {
+                operations::callUnary(spec.setBorder(border).build(*input), *input, *output);
+                operations::callUnary(cpuSpec.setBorder(border).build(*cpuInput), *cpuInput, *expected).wait();
+            }
+
+            std::vector<std::uint8_t> outBuf, expectedBuf;
+            output->readRawFixedPoint(outBuf).wait();
+            expected->readRawFixedPoint(expectedBuf).wait();
+            REQUIRE(outBuf.size() == expectedBuf.size());
+            int nLarge = 0;
+            for (std::size_t i = 0; i < outBuf.size(); ++i) {
+                // GPU interpolation weights have limited precision
+                if (std::abs(int(outBuf.at(i)) - int(expectedBuf.at(i))) > 3) nLarge++;
+            }
+            REQUIRE(nLarge == 0);
+        }
+    }
+}
+
+TEST_CASE( "GL reductions", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef FixedPoint<std::uint8_t> Type;
+    typedef operations::reduce::Type Reduce;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    auto ops = opengl::operations::createFactory(*processor);
+    auto cpuProcessor = Processor::createInstant();
+    auto cpuFactory = cpu::Image::createFactory();
+    auto cpuOps = cpu::operations::createFactory(*cpuProcessor);
+
+    // several passes with partial blocks
+    const int w = 75, h = 38;
+    std::vector<std::uint8_t> inBuf(w * h * 4);
+    for (std::size_t i = 0; i < inBuf.size(); ++i) inBuf[i] = (i * 37 + 11) % 256;
+    auto input = factory->create<Type, 4>(w, h);
+    auto cpuInput = cpuFactory->create<Type, 4>(w, h);
+    input->writeRawFixedPoint(inBuf);
+    cpuInput->writeRawFixedPoint(inBuf).wait();
+
+    const auto compare = [&](operations::reduce::Spec gpuSpec, operations::reduce::Spec cpuSpec) {
+        auto output = factory->create<float, 4>(gpuSpec.getOutputWidth(), 1);
+        auto expected = cpuFactory->createLike(*output);
+        operations::callUnary(gpuSpec.build(*input, *output), *input, *output);
+        operations::callUnary(cpuSpec.build(*cpuInput, *expected), *cpuInput, *expected).wait();
+        std::vector<float> outBuf, expectedBuf;
+        output->read(outBuf).wait();
+        expected->read(expectedBuf).wait();
+        REQUIRE(outBuf.size() == expectedBuf.size());
+        for (std::size_t i = 0; i < outBuf.size(); ++i)
+            REQUIRE(outBuf.at(i) == Approx(expectedBuf.at(i)).epsilon(1e-3));
+    };
+
+    for (auto type : { Reduce::SUM, Reduce::MEAN, Reduce::MIN, Reduce::MAX })
+        compare(ops->reduce(type), cpuOps->reduce(type));
+    // no 8-bit value on a bin edge: lowp samplers may round across it
+    compare(ops->histogram(8), cpuOps->histogram(8));
+}
+
+TEST_CASE( "YUV camera frame to RGB", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    auto ops = opengl::operations::createFactory(*processor);
+    auto cpuProcessor = Processor::createInstant();
+    auto cpuFactory = cpu::Image::createFactory();
+    auto cpuOps = cpu::operations::createFactory(*cpuProcessor);
+
+    const int w = 40, h = 26;
+    std::vector<std::uint8_t> yData(w * h), uvData(w * (h / 2));
+    for (std::size_t i = 0; i < yData.size(); ++i) yData[i] = (i * 31 + 7) % 256;
+    for (std::size_t i = 0; i < uvData.size(); ++i) uvData[i] = (i * 17 + 101) % 256;
+
+    for (auto layout : { Image::YuvLayout::NV12, Image::YuvLayout::NV21 }) {
+        auto yuv = factory->createYuv(w, h, layout);
+        yuv.y->writeRaw(yData.data());
+        yuv.uv->writeRaw(uvData.data());
+        auto cpuYuv = cpu::Image::createYuvReference(w, h, layout, yData.data(), uvData.data());
+
+        auto output = factory->create<Type, 4>(w, h);
+        auto expected = cpuFactory->create<Type, 4>(w, h);
+        operations::callBinary(ops->yuvToRgb(layout).build(*yuv.y, *output), *yuv.y, *yuv.uv, *output);
+        operations::callBinary(cpuOps->yuvToRgb(layout).build(*cpuYuv.y, *expected), *cpuYuv.y, *cpuYuv.uv, *expected).wait();
+
+        std::vector<std::uint8_t> outBuf, expectedBuf;
+        output->readRawFixedPoint(outBuf).wait();
+        expected->readRawFixedPoint(expectedBuf).wait();
+        REQUIRE(outBuf.size() == expectedBuf.size());
+        for (std::size_t i = 0; i < outBuf.size(); ++i) {
+            // float vs. Q13 fixed-point arithmetic
+            REQUIRE(std::abs(int(outBuf.at(i)) - int(expectedBuf.at(i))) <= 1);
+        }
+    }
+}
+
+TEST_CASE( "pooled GL images", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = opengl::createGLFWProcessor();
+    // room for two 10x10 RGBA images
+    auto pool = opengl::Image::createPooledFactory(*processor, 800);
+    auto ops = opengl::operations::createFactory(*processor);
+    const double s = 1.0 / FixedPoint<std::uint8_t>::max();
+
+    for (int itr = 0; itr < 3; ++itr) {
+        auto image = pool->create<Type, 4>(10, 10);
+        operations::callNullary(ops->fill({ itr * s, 0, 0, 0 }).build(*image), *image);
+        std::vector<std::uint8_t> outBuf;
+        image->readRawFixedPoint(outBuf).wait();
+        REQUIRE(int(outBuf.at(0)) == itr);
+    }
+    // the frame buffers are returned to the pool in the GL thread
+    processor->enqueue([]() {}).wait();
+    auto stats = pool->getStats();
+    REQUIRE(stats.misses == 1);
+    REQUIRE(stats.hits == 2);
+    REQUIRE(stats.pooledBuffers == 1);
+    REQUIRE(stats.pooledBytes == 400);
+    REQUIRE(stats.bytesInUse == 0);
+
+    {
+        std::vector< std::unique_ptr<Image> > images;
+        for (int i = 0; i < 4; ++i) images.push_back(pool->create<Type, 4>(10, 10));
+        processor->enqueue([]() {}).wait();
+        REQUIRE(pool->getStats().bytesInUse == 1600);
+    }
+    processor->enqueue([]() {}).wait();
+    // over budget: the least recently used were deleted
+    REQUIRE(pool->getStats().pooledBuffers == 2);
+    pool->releaseUnused().wait();
+    REQUIRE(pool->getStats().pooledBytes == 0);
+}
+
+TEST_CASE( "GL state caching", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef FixedPoint<std::uint8_t> Type;
+    opengl::setStateCaching(true);
+    opengl::setPerOperationErrorChecks(true);
+    {
+        auto processor = opengl::createGLFWProcessor();
+        auto factory = opengl::Image::createFactory(*processor);
+        auto ops = opengl::operations::createFactory(*processor);
+        const double s = 1.0 / FixedPoint<std::uint8_t>::max();
+
+        auto a = factory->create<Type, 4>(16, 8);
+        auto b = factory->create<Type, 4>(16, 8);
+        auto fill = ops->fill({ 1 * s, 2 * s, 3 * s, 4 * s }).build(*a);
+        auto swizzle = ops->swizzle("abgr").build(*a);
+        auto scale = ops->channelwiseAffine(2, 0).build(*a);
+        for (int i = 0; i < 3; ++i) {
+            operations::callNullary(fill, *a);
+            operations::callUnary(swizzle, *a, *b);
+            operations::callUnary(scale, *b, *a);
+        }
+        // external GL code changing the state
+        processor->enqueue([]() {
+            glUseProgram(0);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            opengl::invalidateStateCache();
+        });
+        operations::callUnary(swizzle, *a, *b);
+
+        std::vector<std::uint8_t> outBuf;
+        b->readRawFixedPoint(outBuf).wait();
+        REQUIRE(int(outBuf.at(0)) == 2);
+        REQUIRE(int(outBuf.at(3)) == 8);
+    }
+    opengl::setStateCaching(false);
+    opengl::setPerOperationErrorChecks(false);
+}
+
+TEST_CASE( "GPU timers", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    opengl::operations::FactoryOptions options;
+    options.gpuTimers = true;
+    auto ops = opengl::operations::createFactory(*processor, options);
+
+    auto a = factory->create<Type, 4>(16, 8);
+    auto b = factory->create<Type, 4>(16, 8);
+    auto fill = ops->fill({ 0.1, 0.2, 0.3, 0.4 }).build(*a);
+    ops->setProfilingLabel("my swizzle");
+    auto swizzle = ops->swizzle("abgr").build(*a);
+    ops->setProfilingLabel("");
+    auto scale = ops->channelwiseAffine(2, 0).build(*a);
+    for (int i = 0; i < 5; ++i) {
+        operations::callNullary(fill, *a);
+        operations::callUnary(swizzle, *a, *b);
+        operations::callUnary(scale, *b, *a).wait();
+    }
+
+    auto stats = ops->getProfilingStats();
+    REQUIRE(stats.size() == 3);
+    REQUIRE(stats.at(0).label == "fill");
+    REQUIRE(stats.at(1).label == "my swizzle");
+    REQUIRE(stats.at(2).label == "channelwiseAffine");
+    for (const auto &s : stats) {
+        REQUIRE(s.count == 5);
+        REQUIRE(s.pixels == 5 * 16 * 8);
+        REQUIRE(s.meanGpuMilliseconds >= 0);
+        REQUIRE(s.p99GpuMilliseconds >= 0);
+    }
+}
+
+TEST_CASE( "compute shader operations", "[accelerated-arrays-opengl]" ) {
+    using namespace accelerated;
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = opengl::createGLFWProcessor();
+    auto factory = opengl::Image::createFactory(*processor);
+    opengl::operations::FactoryOptions options;
+    options.computeShaders = true;
+    auto ops = opengl::operations::createFactory(*processor, options);
+    auto cpuProcessor = Processor::createInstant();
+    auto cpuFactory = cpu::Image::createFactory();
+    auto cpuOps = cpu::operations::createFactory(*cpuProcessor);
+
+    // not multiples of the work group size
+    const int w = 37, h = 21;
+    std::vector<std::uint8_t> inBuf(w * h * 4);
+    for (std::size_t i = 0; i < inBuf.size(); ++i) inBuf[i] = (i * 37 + 11) % 256;
+    auto input = factory->create<Type, 4>(w, h);
+    auto cpuInput = cpuFactory->create<Type, 4>(w, h);
+    input->writeRawFixedPoint(inBuf);
+    cpuInput->writeRawFixedPoint(inBuf).wait();
+
+    const auto compareFixed = [](Image &output, Image &expected, int tolerance) {
+        std::vector<std::uint8_t> outBuf, expectedBuf;
+        output.readRawFixedPoint(outBuf).wait();
+        expected.readRawFixedPoint(expectedBuf).wait();
+        REQUIRE(outBuf.size() == expectedBuf.size());
+        for (std::size_t i = 0; i < outBuf.size(); ++i)
+            REQUIRE(std::abs(int(outBuf.at(i)) - int(expectedBuf.at(i))) <= tolerance);
+    };
+
+    SECTION("convolutions") {
+        const std::vector<double> row = { 1, 4, 6, 4, 1 }, column = { 1, 2, -1 };
+        std::vector< std::vector<double> > separable;
+        for (double c : column) {
+            separable.push_back({});
+            for (double r : row) separable.back().push_back(c * r / 32.0);
+        }
+        const std::vector< std::vector<double> > laplacian = {
+            { 0, 1, 0 },
+            { 1, -4, 1 },
+            { 0, 1, 0 }
+        };
+
+        for (auto border : { Image::Border::CLAMP, Image::Border::REPEAT }) {
+            auto output = factory->create<Type, 4>((w + 1) / 2, h);
+            auto expected = cpuFactory->createLike(*output);
+            auto gpuSpec = ops->fixedConvolution2D(separable).setBias(0.1).setStride(2, 1).setOffset(1, 0).setBorder(border);
+            auto cpuSpec = cpuOps->fixedConvolution2D(separable).setBias(0.1).setStride(2, 1).setOffset(1, 0).setBorder(border);
+            operations::callUnary(gpuSpec.build(*input, *output), *input, *output);
+            operations::callUnary(cpuSpec.build(*cpuInput, *expected), *cpuInput, *expected).wait();
+            compareFixed(*output, *expected, 1);
+        }
+
+        auto output = factory->create<Type, 4>(w, h);
+        auto expected = cpuFactory->createLike(*output);
+        auto gpuSpec = ops->fixedConvolution2D(laplacian).scaleKernelValues(0.25).setBias(0.5).setBorder(Image::Border::REPEAT);
+        auto cpuSpec = cpuOps->fixedConvolution2D(laplacian).scaleKernelValues(0.25).setBias(0.5).setBorder(Image::Border::REPEAT);
+        operations::callUnary(gpuSpec.build(*input, *output), *input, *output);
+        operations::callUnary(cpuSpec.build(*cpuInput, *expected), *cpuInput, *expected).wait();
+        compareFixed(*output, *expected, 1);
+
+        // an ROI output falls back to the fragment shader implementation
+        auto roi = output->createROI(3, 2, 10, 5);
+        auto cpuRoi = cpuFactory->createLike(*roi);
+        operations::callUnary(gpuSpec.build(*input, *roi), *input, *roi);
+        operations::callUnary(cpuSpec.build(*cpuInput, *cpuRoi), *cpuInput, *cpuRoi).wait();
+        compareFixed(*roi, *cpuRoi, 1);
+    }
+
+    SECTION("pyramid") {
+        const int levels = 3;
+        std::vector< std::unique_ptr<Image> > outputs, expected;
+        std::array<Image*, levels> outputPtrs, expectedPtrs;
+        for (int l = 1; l <= levels; ++l) {
+            const int lw = operations::pyramid::Spec::getLevelWidth(*input, l);
+            const int lh = operations::pyramid::Spec::getLevelHeight(*input, l);
+            outputs.push_back(factory->create<Type, 4>(lw, lh));
+            expected.push_back(cpuFactory->create<Type, 4>(lw, lh));
+            outputPtrs[l - 1] = outputs.back().get();
+            expectedPtrs[l - 1] = expected.back().get();
+        }
+
+        std::array<Image*, 1> inputs = {{ input.get() }}, cpuInputs = {{ cpuInput.get() }};
+        operations::call(ops->pyramid(levels).build(*input), inputs, outputPtrs);
+        operations::call(cpuOps->pyramid(levels).build(*cpuInput), cpuInputs, expectedPtrs).wait();
+        for (int l = 0; l < levels; ++l) compareFixed(*outputs.at(l), *expected.at(l), 2);
+    }
+
+    SECTION("reductions") {
+        typedef operations::reduce::Type Reduce;
+        const auto compare = [&](operations::reduce::Spec gpuSpec, operations::reduce::Spec cpuSpec) {
+            auto output = factory->create<float, 4>(gpuSpec.getOutputWidth(), 1);
+            auto expected = cpuFactory->createLike(*output);
+            auto reduce = gpuSpec.build(*input, *output);
+            // the second call checks that the partial results are reset
+            for (int i = 0; i < 2; ++i) operations::callUnary(reduce, *input, *output);
+            operations::callUnary(cpuSpec.build(*cpuInput, *expected), *cpuInput, *expected).wait();
+            std::vector<float> outBuf, expectedBuf;
+            output->read(outBuf).wait();
+            expected->read(expectedBuf).wait();
+            REQUIRE(outBuf.size() == expectedBuf.size());
+            for (std::size_t i = 0; i < outBuf.size(); ++i)
+                REQUIRE(outBuf.at(i) == Approx(expectedBuf.at(i)).epsilon(1e-3));
+        };
+
+        for (auto type : { Reduce::SUM, Reduce::MEAN, Reduce::MIN, Reduce::MAX })
+            compare(ops->reduce(type), cpuOps->reduce(type));
+        compare(ops->histogram(8), cpuOps->histogram(8));
+    }
+}
+
 #ifdef TEST_OPENGL_WITH_VISIBLE_WINDOW
 TEST_CASE( "GLFW draw to window", "[accelerated-arrays-opengl]" ) {
     using namespace accelerated;
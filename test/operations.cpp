@@ -1,7 +1,9 @@
 #include <catch2/catch.hpp>
+#include <cmath>
 #include <iostream>
 
 #include "cpu/image.hpp"
+#include "cpu/kernels.hpp"
 #include "cpu/operations.hpp"
 
 #ifdef TEST_WITH_OPENGL
@@ -87,6 +89,193 @@ TEST_CASE( "Convolution 2D", "[accelerated-arrays]" ) {
     }
 }
 
+TEST_CASE( "Convolution 2D, separable & strided", "[accelerated-arrays]" ) {
+    typedef FixedPoint<std::uint8_t> Type;
+    auto factory = cpu::Image::createFactory();
+    auto processor = Processor::createInstant();
+    auto ops = cpu::operations::createFactory(*processor);
+
+    const int w = 9, h = 7;
+    std::vector<std::uint8_t> inData;
+    for (int i = 0; i < w*h*2; ++i) inData.push_back((i*37 + 11) % 256);
+    auto image = factory->create<Type, 2>(w, h);
+    image->writeRawFixedPoint(inData).wait();
+    auto &inCpu = cpu::Image::castFrom(*image);
+
+    // separable (outer product) and a generic kernel
+    const std::vector< std::vector< std::vector<double> > > kernels = {
+        {
+            { 1, 2, 4, 2, 1 },
+            { 2, 4, 8, 4, 2 },
+            { 1, 2, 4, 2, 1 }
+        },
+        {
+            { 1, -1, 4 },
+            { 0, 2, 1 },
+            { 3, 0, -2 }
+        }
+    };
+
+    for (const auto &kernel : kernels) {
+        for (auto border : { Image::Border::ZERO, Image::Border::MIRROR, Image::Border::CLAMP }) {
+            auto spec = ops->fixedConvolution2D(kernel)
+                .scaleKernelValues(1/32.0)
+                .setBias(0.1)
+                .setStride(2, 1)
+                .setOffset(1, -1)
+                .setBorder(border);
+
+            auto outImage = factory->create<float, 2>((w + 1) / 2, h);
+            auto conv = spec.build(*image, *outImage);
+            operations::callUnary(conv, *image, *outImage).wait();
+            const auto &outCpu = cpu::Image::castFrom(*outImage);
+
+            const int kx0 = spec.getKernelXOffset(), ky0 = spec.getKernelYOffset();
+            for (int y = 0; y < outImage->height; ++y) {
+                for (int x = 0; x < outImage->width; ++x) {
+                    for (int c = 0; c < 2; ++c) {
+                        double expected = spec.bias;
+                        for (int i = 0; i < int(kernel.size()); ++i)
+                            for (int j = 0; j < int(kernel[i].size()); ++j)
+                                expected += spec.kernel[i][j] *
+                                    inCpu.get<float>(x*2 + j + kx0, y + i + ky0, c, border);
+                        REQUIRE(std::abs(outCpu.get<float>(x, y, c) - expected) < 1e-4);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE( "Parallel bands & ROIs", "[accelerated-arrays]" ) {
+    typedef FixedPoint<std::uint8_t> Type;
+    const int w = 37, h = 41, rowWidth = 40, channels = 2;
+
+    std::vector<std::uint8_t> inData(rowWidth * h * channels), outRef, outBands;
+    for (std::size_t i = 0; i < inData.size(); ++i) inData[i] = (i*31 + 7) % 256;
+
+    auto run = [&](operations::StandardFactory &ops, std::vector<std::uint8_t> &outData) {
+        outData.clear();
+        // ROIs: padded rows, which must not be touched
+        outData.resize(inData.size() * 2, 123);
+        std::vector<std::uint8_t> tmpData(inData.size(), 0);
+
+        auto input = cpu::Image::createReference(w, h, channels, ImageTypeSpec::getType<Type>(), inData.data(), rowWidth);
+        auto tmp = cpu::Image::createReference(w, h, channels, ImageTypeSpec::getType<Type>(), tmpData.data(), rowWidth);
+        auto output = cpu::Image::createReference(w, h, channels, ImageTypeSpec::getType<Type>(), outData.data(), rowWidth * 2);
+
+        auto conv = ops.fixedConvolution2D({
+                { 1, 2, 1 },
+                { 2, 4, 2 },
+                { 1, 2, 1 }
+            })
+            .scaleKernelValues(1/16.0)
+            .setBorder(Image::Border::CLAMP)
+            .build(*input);
+        operations::callUnary(conv, *input, *tmp).wait();
+
+        auto affine = ops.pixelwiseAffine({{ 0.5, 0.25 }, { -1, 1 }}).setBias({ 0.1, 0.5 }).build(*tmp);
+        operations::callUnary(affine, *tmp, *output).wait();
+    };
+
+    auto instant = Processor::createInstant();
+    run(*cpu::operations::createFactory(*instant), outRef);
+
+    auto pool = Processor::createThreadPool(4);
+    run(*cpu::operations::createFactory(*pool, 4), outBands);
+
+    REQUIRE(outRef == outBands);
+    // padding untouched
+    REQUIRE(outBands.at(rowWidth * 2 * channels - 1) == 123);
+    REQUIRE(outBands.back() == 123);
+}
+
+namespace {
+// the results of the integer fixed-point kernels are fromFloat of the
+// double-precision results, except that the truncation in fromFloat may go
+// either way if the result is within the rounding errors of an integer
+template <class T> void requireFixedPointResult(FixedPoint<T> result, double value) {
+    typedef FixedPoint<T> F;
+    const double c = F::clamp(value);
+    const double v = F::isSigned() ? F::unsignedMax() * c / 2 : F::max() * c + 0.5;
+    if (std::fabs(v - std::round(v)) < 1e-4) {
+        REQUIRE(std::abs(int(result.value) - int(F::fromFloat(value))) <= 1);
+    } else {
+        REQUIRE(result.value == F::fromFloat(value));
+    }
+}
+
+template <class T> void checkFixedPointKernels() {
+    typedef FixedPoint<T> Type;
+    auto processor = Processor::createInstant();
+    auto ops = cpu::operations::createFactory(*processor);
+    auto factory = cpu::Image::createFactory();
+
+    const int w = 13, h = 9;
+    auto a = factory->create<Type, 2>(w, h);
+    auto b = factory->create<Type, 2>(w, h);
+    auto out = factory->create<Type, 2>(w, h);
+    cpu::Image &aCpu = cpu::Image::castFrom(*a), &bCpu = cpu::Image::castFrom(*b);
+    const cpu::Image &outCpu = cpu::Image::castFrom(*out);
+    const int range = int(Type::max() - Type::min()) + 1;
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            for (int c = 0; c < 2; ++c) {
+                const int i = (y * w + x) * 2 + c;
+                aCpu.set<Type>(x, y, c, Type::fromValue(T(Type::min() + (i * 7919 + 13) % range)));
+                bCpu.set<Type>(x, y, c, Type::fromValue(T(Type::min() + (i * 104729 + 5) % range)));
+            }
+        }
+    }
+    const auto value = [](const cpu::Image &img, int x, int y, int c, Image::Border border) {
+        return img.get<Type>(x, y, c, border).toFloat();
+    };
+
+    operations::callUnary(ops->channelwiseAffine(0.8, 0.15).build(*a, *out), *a, *out).wait();
+    for (int y = 0; y < h; ++y) for (int x = 0; x < w; ++x) for (int c = 0; c < 2; ++c)
+        requireFixedPointResult(outCpu.get<Type>(x, y, c), 0.8 * value(aCpu, x, y, c, Image::Border::ZERO) + 0.15);
+
+    const std::vector< std::vector<double> > matA = {{ 0.5, -0.25 }, { 1, 0.125 }}, matB = {{ 0.3, 0 }, { -0.7, 0.9 }};
+    const std::vector<double> bias = { 0.1, -0.2 };
+    auto combo = ops->affineCombination().addLinearPart(matA).addLinearPart(matB).setBias(bias).build(*a, *out);
+    operations::callBinary(combo, *a, *b, *out).wait();
+    for (int y = 0; y < h; ++y) for (int x = 0; x < w; ++x) for (int c = 0; c < 2; ++c) {
+        double expected = bias[c];
+        for (int j = 0; j < 2; ++j) {
+            expected += matA[c][j] * value(aCpu, x, y, j, Image::Border::ZERO);
+            expected += matB[c][j] * value(bCpu, x, y, j, Image::Border::ZERO);
+        }
+        requireFixedPointResult(outCpu.get<Type>(x, y, c), expected);
+    }
+
+    // separable and generic kernels
+    const std::vector< std::vector< std::vector<double> > > kernels = {
+        {{ 1, 2, 1 }, { 2, 4, 2 }, { 1, 2, 1 }},
+        {{ 1, -1, 4 }, { 0, 2, 1 }, { 3, 0, -2 }}
+    };
+    for (const auto &kernel : kernels) {
+        for (auto border : { Image::Border::ZERO, Image::Border::MIRROR, Image::Border::CLAMP }) {
+            auto spec = ops->fixedConvolution2D(kernel).scaleKernelValues(1/13.0).setBias(0.05).setBorder(border);
+            operations::callUnary(spec.build(*a, *out), *a, *out).wait();
+            for (int y = 0; y < h; ++y) for (int x = 0; x < w; ++x) for (int c = 0; c < 2; ++c) {
+                double expected = spec.bias;
+                for (int i = 0; i < 3; ++i)
+                    for (int j = 0; j < 3; ++j)
+                        expected += spec.kernel[i][j] * value(aCpu, x + j - 1, y + i - 1, c, border);
+                requireFixedPointResult(outCpu.get<Type>(x, y, c), expected);
+            }
+        }
+    }
+}
+}
+
+TEST_CASE( "Fixed-point integer kernels", "[accelerated-arrays]" ) {
+    checkFixedPointKernels<std::uint8_t>();
+    checkFixedPointKernels<std::int8_t>();
+    checkFixedPointKernels<std::uint16_t>();
+    checkFixedPointKernels<std::int16_t>();
+}
+
 TEST_CASE( "Affine pixel ops & copyFrom", "[accelerated-arrays]" ) {
 
     std::vector< ProcessorItem > items;
@@ -193,3 +382,642 @@ TEST_CASE( "Swizzle", "[accelerated-arrays]" ) {
         REQUIRE(outCpu.get<Type>(1, 0, 3) == 1);
     }
 }
+
+TEST_CASE( "Vectorized pixel ops", "[accelerated-arrays]" ) {
+    auto processor = Processor::createInstant();
+    auto ops = cpu::operations::createFactory(*processor);
+    auto factory = cpu::Image::createFactory();
+    const int w = 23, h = 3;
+
+    auto floatIn = factory->create<float, 4>(w, h);
+    auto &floatInCpu = cpu::Image::castFrom(*floatIn);
+    auto bytesIn = factory->create<FixedPoint<std::uint8_t>, 4>(w, h);
+    auto &bytesInCpu = cpu::Image::castFrom(*bytesIn);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            for (int c = 0; c < 4; ++c) {
+                const int i = (y * w + x) * 4 + c;
+                floatInCpu.set<float>(x, y, c, std::sin(i * 0.7) * 100);
+                bytesInCpu.set<float>(x, y, c, ((i * 37) % 256) / 255.0);
+            }
+        }
+    }
+
+    SECTION("pixelwise affine") {
+        const std::vector< std::vector<double> > mat = {
+            { 0.1, -2, 3.3, 0.25 },
+            { 1, 0, 0, -1 },
+            { 0.3, 0.59, 0.11, 0 }
+        };
+        const std::vector<double> bias = { 1, -0.5, 0.01 };
+        auto out = factory->create<float, 3>(w, h);
+        operations::callUnary(ops->pixelwiseAffine(mat).setBias(bias).build(*floatIn, *out), *floatIn, *out).wait();
+        const auto &outCpu = cpu::Image::castFrom(*out);
+        for (int y = 0; y < h; ++y) for (int x = 0; x < w; ++x) for (int i = 0; i < 3; ++i) {
+            float v = float(bias[i]);
+            for (int j = 0; j < 4; ++j) v += float(mat[i][j]) * floatInCpu.get<float>(x, y, j);
+            REQUIRE(outCpu.get<float>(x, y, i) == v);
+        }
+    }
+
+    SECTION("channelwise affine") {
+        const double scale = 0.37, bias = -1.25;
+        auto spec = ops->channelwiseAffine(scale, bias);
+        auto out = factory->create<float, 4>(w, h);
+        const auto &outCpu = cpu::Image::castFrom(*out);
+        for (auto *input : { &floatInCpu, &bytesInCpu }) {
+            operations::callUnary(spec.build(*input, *out), *input, *out).wait();
+            for (int y = 0; y < h; ++y) for (int x = 0; x < w; ++x) for (int c = 0; c < 4; ++c) {
+                const float expected = scale * input->get<float>(x, y, c) + bias;
+                REQUIRE(outCpu.get<float>(x, y, c) == expected);
+            }
+        }
+    }
+
+    SECTION("swizzle") {
+        typedef FixedPoint<std::uint8_t> Type;
+        auto out = factory->create<Type, 3>(w, h);
+        operations::callUnary(ops->swizzle("b1r").build(*bytesIn, *out), *bytesIn, *out).wait();
+        const auto &outCpu = cpu::Image::castFrom(*out);
+        for (int y = 0; y < h; ++y) for (int x = 0; x < w; ++x) {
+            REQUIRE(outCpu.get<Type>(x, y, 0) == bytesInCpu.get<Type>(x, y, 2));
+            REQUIRE(outCpu.get<Type>(x, y, 1).value == 255);
+            REQUIRE(outCpu.get<Type>(x, y, 2) == bytesInCpu.get<Type>(x, y, 0));
+        }
+    }
+}
+
+TEST_CASE( "Rescale", "[accelerated-arrays]" ) {
+    auto processor = Processor::createInstant();
+    auto ops = cpu::operations::createFactory(*processor);
+    auto factory = cpu::Image::createFactory();
+
+    const int w = 12, h = 8;
+    auto input = factory->create<float, 2>(w, h);
+    auto &inCpu = cpu::Image::castFrom(*input);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            for (int c = 0; c < 2; ++c)
+                inCpu.set<float>(x, y, c, x * 10 + y * y + c * 0.25);
+
+    const auto areaMean = [&](int x0, int y0, int f, int c) {
+        double sum = 0;
+        for (int y = y0; y < y0 + f; ++y)
+            for (int x = x0; x < x0 + f; ++x)
+                sum += inCpu.get<float>(x, y, c);
+        return sum / (f * f);
+    };
+
+    SECTION("area, integer ratios") {
+        for (int f : { 2, 4 }) {
+            auto output = factory->create<float, 2>(w / f, h / f);
+            auto resc = ops->rescale().setInterpolation(Image::Interpolation::AREA).build(*input, *output);
+            operations::callUnary(resc, *input, *output).wait();
+            const auto &outCpu = cpu::Image::castFrom(*output);
+            for (int y = 0; y < output->height; ++y)
+                for (int x = 0; x < output->width; ++x)
+                    for (int c = 0; c < 2; ++c)
+                        REQUIRE(std::abs(outCpu.get<float>(x, y, c) - areaMean(x * f, y * f, f, c)) < 1e-4);
+        }
+    }
+
+    SECTION("area, fixed point with non-power-of-two ratio") {
+        typedef FixedPoint<std::uint8_t> Type;
+        auto inFixed = factory->create<Type, 2>(w, h);
+        auto &inFixedCpu = cpu::Image::castFrom(*inFixed);
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+                for (int c = 0; c < 2; ++c)
+                    inFixedCpu.set<float>(x, y, c, inCpu.get<float>(x, y, c) / 200.0);
+
+        auto output = factory->create<Type, 2>(w / 3, h / 2);
+        auto resc = ops->rescale().setInterpolation(Image::Interpolation::AREA).build(*inFixed, *output);
+        operations::callUnary(resc, *inFixed, *output).wait();
+        const auto &outCpu = cpu::Image::castFrom(*output);
+        for (int c = 0; c < 2; ++c) {
+            double sum = 0;
+            for (int y = 2; y < 4; ++y)
+                for (int x = 3; x < 6; ++x)
+                    sum += inFixedCpu.get<float>(x, y, c);
+            REQUIRE(std::abs(outCpu.get<float>(1, 1, c) - sum / 6) < 1.0 / 255);
+        }
+    }
+
+    SECTION("bilinear") {
+        auto output = factory->create<float, 2>(w * 2, h * 2);
+        auto resc = ops->rescale()
+            .setInterpolation(Image::Interpolation::LINEAR)
+            .setBorder(Image::Border::CLAMP)
+            .build(*input, *output);
+        operations::callUnary(resc, *input, *output).wait();
+        const auto &outCpu = cpu::Image::castFrom(*output);
+        // output pixel (x, y) samples the input pixel coordinates (x / 2, y / 2)
+        REQUIRE(outCpu.get<float>(4, 6, 1) == inCpu.get<float>(2, 3, 1));
+        const double expected = 0.5 * (inCpu.get<float>(2, 3, 0) + inCpu.get<float>(3, 3, 0));
+        REQUIRE(std::abs(outCpu.get<float>(5, 6, 0) - expected) < 1e-4);
+        // clamped at the right border
+        REQUIRE(outCpu.get<float>(w * 2 - 1, 0, 0) == inCpu.get<float>(w - 1, 0, 0));
+    }
+
+    SECTION("nearest") {
+        auto output = factory->create<float, 2>(w / 2, h / 2);
+        auto resc = ops->rescale().setInterpolation(Image::Interpolation::NEAREST).build(*input, *output);
+        operations::callUnary(resc, *input, *output).wait();
+        const auto &outCpu = cpu::Image::castFrom(*output);
+        REQUIRE(outCpu.get<float>(3, 2, 1) == inCpu.get<float>(6, 4, 1));
+    }
+}
+
+TEST_CASE( "Custom pixel kernels", "[accelerated-arrays]" ) {
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = Processor::createThreadPool(2);
+    auto ops = cpu::operations::createFactory(*processor);
+    auto factory = cpu::Image::createFactory();
+
+    std::vector<std::uint8_t> inData = {
+        10, 20, 30,  40, 50, 60,  0, 0, 0,
+        0, 0, 255,   1, 2, 3,     99, 0, 0
+    };
+    std::vector<std::uint8_t> paddedData(4 * 2 * 3, 0);
+    for (int y = 0; y < 2; ++y)
+        for (int i = 0; i < 3 * 3; ++i)
+            paddedData[y * 4 * 3 + i] = inData[y * 3 * 3 + i];
+    // row width 4, width 3
+    auto input = cpu::Image::createReference(3, 2, 3, ImageTypeSpec::getType<Type>(), paddedData.data(), 4);
+
+    auto sumChannels = ops->wrap(cpu::operations::pixelwise<Type, 3, float, 1>([](const Type *in, float *out) {
+        out[0] = float(in[0]) + float(in[1]) + float(in[2]);
+    }));
+
+    auto sums = factory->create<float, 1>(3, 2);
+    operations::callUnary(sumChannels, *input, *sums).wait();
+    const auto &sumsCpu = cpu::Image::castFrom(*sums);
+    REQUIRE(std::abs(sumsCpu.get<float>(1, 0) - (40 + 50 + 60) / 255.0) < 1e-6);
+    REQUIRE(std::abs(sumsCpu.get<float>(2, 1) - 99 / 255.0) < 1e-6);
+
+    auto maxOf = ops->wrapNAry(cpu::operations::pixelwise<float, 1, 2, float, 1>(
+        [](const std::array<const float*, 2> &in, float *out) {
+            out[0] = std::max(*in[0], *in[1]);
+        }));
+
+    auto other = factory->create<float, 1>(3, 2);
+    cpu::Image::castFrom(*other).set<float>(1, 1, 0.5);
+    auto result = factory->create<float, 1>(3, 2);
+    std::array<Image*, 2> args = {{ sums.get(), other.get() }};
+    operations::call(maxOf, args, *result).wait();
+    const auto &resultCpu = cpu::Image::castFrom(*result);
+    REQUIRE(resultCpu.get<float>(0, 1) == 1.0f);
+    REQUIRE(resultCpu.get<float>(1, 1) == 0.5f);
+    REQUIRE(resultCpu.get<float>(1, 0) == sumsCpu.get<float>(1, 0));
+}
+
+TEST_CASE( "Multiple outputs", "[accelerated-arrays]" ) {
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = Processor::createThreadPool(2);
+    auto ops = cpu::operations::createFactory(*processor);
+    auto factory = cpu::Image::createFactory();
+
+    const int w = 5, h = 4;
+    auto input = factory->create<Type, 2>(w, h);
+    std::vector<std::uint8_t> inData;
+    for (int i = 0; i < w * h * 2; ++i) inData.push_back((i * 37) % 256);
+    input->writeRawFixedPoint(inData).wait();
+
+    auto split = ops->wrapMultiOutput([](cpu::Image **inputs, int nInputs, cpu::Image **outputs, int nOutputs) {
+        (void)nInputs; (void)nOutputs;
+        const auto &in = *inputs[0];
+        for (int y = 0; y < in.height; ++y) {
+            for (int x = 0; x < in.width; ++x) {
+                outputs[0]->set<Type>(x, y, 0, in.get<Type>(x, y, 0));
+                outputs[1]->set<Type>(x, y, 0, in.get<Type>(x, y, 1));
+            }
+        }
+    });
+    // the same with the fallback using separate functions
+    auto splitFallback = operations::combineOutputs({
+        ops->swizzle("r").build(*input, *factory->create<Type, 1>(w, h)),
+        ops->swizzle("g").build(*input, *factory->create<Type, 1>(w, h))
+    });
+
+    std::vector<std::uint8_t> results[2][2];
+    for (int variant = 0; variant < 2; ++variant) {
+        auto r = factory->create<Type, 1>(w, h), g = factory->create<Type, 1>(w, h);
+        std::array<Image*, 1> inputs = {{ input.get() }};
+        std::array<Image*, 2> outputs = {{ r.get(), g.get() }};
+        operations::call(variant == 0 ? split : splitFallback, inputs, outputs).wait();
+        r->readRawFixedPoint(results[variant][0]).wait();
+        g->readRawFixedPoint(results[variant][1]).wait();
+    }
+    REQUIRE(results[0][0] == results[1][0]);
+    REQUIRE(results[0][1] == results[1][1]);
+    REQUIRE(int(results[0][0].at(1)) == inData.at(2));
+    REQUIRE(int(results[0][1].at(1)) == inData.at(3));
+}
+
+TEST_CASE( "Image pyramid", "[accelerated-arrays]" ) {
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = Processor::createThreadPool(3);
+    auto ops = cpu::operations::createFactory(*processor);
+    auto factory = cpu::Image::createFactory();
+
+    const int w = 37, h = 22, levels = 3;
+    auto input = factory->create<Type, 1>(w, h);
+    std::vector<std::uint8_t> inData;
+    for (int i = 0; i < w * h; ++i) inData.push_back((i * 31 + 7) % 256);
+    input->writeRawFixedPoint(inData).wait();
+
+    auto spec = ops->pyramid(levels);
+    std::vector< std::unique_ptr<Image> > outputs, expected;
+    std::array<Image*, levels> outputPtrs;
+    for (int l = 1; l <= levels; ++l) {
+        outputs.push_back(factory->create<float, 1>(spec.getLevelWidth(*input, l), spec.getLevelHeight(*input, l)));
+        expected.push_back(factory->createLike(*outputs.back()));
+        outputPtrs[l - 1] = outputs.back().get();
+    }
+    REQUIRE(outputs.at(2)->width == 5);
+    REQUIRE(outputs.at(2)->height == 3);
+
+    std::array<Image*, 1> inputs = {{ input.get() }};
+    operations::call(spec.build(*input, *outputs.at(0)), inputs, outputPtrs).wait();
+
+    // reference: one strided convolution per level
+    auto conv = spec.getLevelConvolution();
+    for (int l = 0; l < levels; ++l) {
+        Image &in = l == 0 ? *input : *expected.at(l - 1);
+        operations::callUnary(conv.build(in, *expected.at(l)), in, *expected.at(l)).wait();
+        const auto &out = cpu::Image::castFrom(*outputs.at(l));
+        const auto &ref = cpu::Image::castFrom(*expected.at(l));
+        for (int y = 0; y < out.height; ++y)
+            for (int x = 0; x < out.width; ++x)
+                REQUIRE(out.get<float>(x, y) == ref.get<float>(x, y));
+    }
+}
+
+TEST_CASE( "YUV to RGB", "[accelerated-arrays]" ) {
+    typedef FixedPoint<std::uint8_t> Type;
+    auto processor = Processor::createThreadPool(2);
+    auto ops = cpu::operations::createFactory(*processor);
+    auto factory = cpu::Image::createFactory();
+
+    // odd size and padded rows, like some camera buffers
+    const int w = 37, h = 9, yStride = 40, uvStride = 44;
+    const int cw = YuvImage::getChromaSize(w), ch = YuvImage::getChromaSize(h);
+    std::vector<std::uint8_t> yData(yStride * h), uvData(uvStride * ch);
+    for (std::size_t i = 0; i < yData.size(); ++i) yData[i] = (i * 31 + 7) % 256;
+    for (std::size_t i = 0; i < uvData.size(); ++i) uvData[i] = (i * 17 + 101) % 256;
+
+    for (bool limited : { false, true }) {
+        auto yuv = cpu::Image::createYuvReference(w, h, Image::YuvLayout::NV21,
+            yData.data(), uvData.data(), yStride, uvStride);
+        REQUIRE(yuv.uv->width == cw);
+        REQUIRE(yuv.uv->height == ch);
+
+        auto spec = ops->yuvToRgb(Image::YuvLayout::NV21).setLimitedRange(limited);
+        const auto c = spec.getCoefficients();
+
+        auto rgba = factory->create<Type, 4>(w, h);
+        auto rgb = factory->create<Type, 3>(w, h);
+        auto rgbFloat = factory->create<float, 3>(w, h);
+        auto gray = factory->create<Type, 1>(w, h);
+        operations::callBinary(spec.build(*yuv.y, *rgba), *yuv.y, *yuv.uv, *rgba).wait();
+        operations::callBinary(spec.build(*yuv.y, *rgb), *yuv.y, *yuv.uv, *rgb).wait();
+        operations::callBinary(spec.build(*yuv.y, *rgbFloat), *yuv.y, *yuv.uv, *rgbFloat).wait();
+        operations::callBinary(spec.build(*yuv.y, *gray), *yuv.y, *yuv.uv, *gray).wait();
+
+        const auto &outRgba = cpu::Image::castFrom(*rgba);
+        const auto &outRgb = cpu::Image::castFrom(*rgb);
+        const auto &outFloat = cpu::Image::castFrom(*rgbFloat);
+        const auto &outGray = cpu::Image::castFrom(*gray);
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                const double luma = c.y * (yData[y * yStride + x] / 255.0 - c.yOffset);
+                const double v = uvData[(y / 2) * uvStride + (x / 2) * 2] / 255.0 - c.chromaOffset;
+                const double u = uvData[(y / 2) * uvStride + (x / 2) * 2 + 1] / 255.0 - c.chromaOffset;
+                const double expected[3] = {
+                    luma + c.rv * v,
+                    luma + c.gu * u + c.gv * v,
+                    luma + c.bu * u
+                };
+                for (int i = 0; i < 3; ++i) {
+                    const double e = std::min(1.0, std::max(0.0, expected[i]));
+                    REQUIRE(std::fabs(outFloat.get<float>(x, y, i) - e) < 1e-5);
+                    REQUIRE(std::fabs(outRgba.get<Type>(x, y, i).value - e * 255) <= 1);
+                    REQUIRE(outRgb.get<Type>(x, y, i).value == outRgba.get<Type>(x, y, i).value);
+                }
+                REQUIRE(outRgba.get<Type>(x, y, 3).value == 255);
+                REQUIRE(std::fabs(outGray.get<Type>(x, y).value - std::min(1.0, std::max(0.0, luma)) * 255) <= 1);
+            }
+        }
+    }
+}
+
+TEST_CASE( "Pooled CPU images", "[accelerated-arrays]" ) {
+    auto processor = Processor::createInstant();
+    auto ops = cpu::operations::createFactory(*processor);
+    auto pool = cpu::Image::createPooledFactory(true);
+
+    std::vector<float> inData;
+    for (int i = 0; i < 5 * 3 * 3; ++i) inData.push_back(i * 0.5);
+
+    for (int itr = 0; itr < 3; ++itr) {
+        auto input = pool->create<float, 3>(5, 3);
+        auto output = pool->create<float, 3>(5, 3);
+        auto &inCpu = cpu::Image::castFrom(*input);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(inCpu.getDataRaw()) % 64 == 0);
+        REQUIRE(inCpu.bytesPerRow() % 64 == 0);
+
+        input->write(inData).wait();
+        auto scale = ops->channelwiseAffine(2, 1).build(*input, *output);
+        operations::callUnary(scale, *input, *output).wait();
+
+        std::vector<float> outData;
+        output->read(outData).wait();
+        REQUIRE(outData.size() == inData.size());
+        for (std::size_t i = 0; i < inData.size(); ++i) REQUIRE(outData[i] == inData[i] * 2 + 1);
+
+        // copy to a contiguous image
+        auto copy = cpu::Image::createFactory()->createLike(*output);
+        cpu::Image::castFrom(*copy).copyFrom(*output).wait();
+        REQUIRE(cpu::Image::castFrom(*copy).get<float>(4, 2, 2) == outData.back());
+    }
+
+    auto stats = pool->getStats();
+    REQUIRE(stats.misses == 2);
+    REQUIRE(stats.hits == 4);
+    REQUIRE(stats.pooledBuffers == 2);
+    pool->releaseUnused();
+    REQUIRE(pool->getStats().allocatedBytes == 0);
+}
+
+TEST_CASE( "Fused pixelwise chain", "[accelerated-arrays]" ) {
+    typedef ImageTypeSpec::DataType DataType;
+    auto processor = Processor::createInstant();
+    auto ops = cpu::operations::createFactory(*processor, 2);
+    auto factory = cpu::Image::createFactory();
+
+    const int w = 70, h = 9; // more than one block per row
+    auto input = factory->create<std::uint8_t, 3>(w, h);
+    auto &inCpu = cpu::Image::castFrom(*input);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            for (int c = 0; c < 3; ++c)
+                inCpu.set<std::uint8_t>(x, y, c, (x * 7 + y * 13 + c * 101) % 256);
+
+    auto swiz = ops->swizzle("bg1");
+    auto affine = ops->pixelwiseAffine({{ 0.25, 0.5, 0.125 }}).setBias({ -10 });
+    auto scale = ops->channelwiseAffine(1.5, 3);
+
+    // reference: separate operations with intermediary images
+    auto swizzled = factory->create<std::uint8_t, 3>(w, h);
+    auto gray = factory->create<std::int16_t, 1>(w, h);
+    auto expected = factory->create<FixedPoint<std::uint8_t>, 1>(w, h);
+    operations::callUnary(swiz.build(*input, *swizzled), *input, *swizzled).wait();
+    operations::callUnary(affine.build(*swizzled, *gray), *swizzled, *gray).wait();
+    auto scaleFactory = ops->channelwiseAffine(1.0 / 255, 0.1);
+    operations::callUnary(scaleFactory.build(*gray, *expected), *gray, *expected).wait();
+
+    auto output = factory->create<FixedPoint<std::uint8_t>, 1>(w, h);
+    auto chain = ops->pixelwiseChain()
+        .add(swiz, DataType::UINT8)
+        .add(affine, DataType::SINT16)
+        .add(scaleFactory, DataType::UFIXED8);
+    operations::callUnary(chain.build(*input, *output), *input, *output).wait();
+
+    const auto &outCpu = cpu::Image::castFrom(*output);
+    const auto &expectedCpu = cpu::Image::castFrom(*expected);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            REQUIRE(outCpu.get<float>(x, y) == expectedCpu.get<float>(x, y));
+
+    // binary first step, and a fill in the middle of the chain
+    auto floats = factory->create<float, 2>(w, h);
+    auto sum = factory->create<float, 2>(w, h);
+    auto binary = ops->pixelwiseChain()
+        .add(operations::pixelwiseAffineCombination::Spec().addLinearPart({}).addLinearPart({}), DataType::FLOAT32)
+        .add(scale, DataType::FLOAT32);
+    cpu::Image::castFrom(*floats).set<float>(3, 4, 1, 2.5);
+    std::array<Image*, 2> args = {{ floats.get(), floats.get() }};
+    operations::call(binary.build(*floats, *sum), args, *sum).wait();
+    REQUIRE(cpu::Image::castFrom(*sum).get<float>(3, 4, 1) == (2.5f + 2.5f) * 1.5f + 3);
+    REQUIRE(cpu::Image::castFrom(*sum).get<float>(3, 4, 0) == 3);
+
+    auto filled = ops->pixelwiseChain()
+        .add(scale, DataType::FLOAT32)
+        .add(ops->fill({ 1, 2 }), DataType::FLOAT32)
+        .add(scale, DataType::FLOAT32);
+    operations::callUnary(filled.build(*floats), *floats, *sum).wait();
+    REQUIRE(cpu::Image::castFrom(*sum).get<float>(3, 4, 1) == 2 * 1.5f + 3);
+
+    // integer intermediary steps saturate
+    auto identity = ops->channelwiseAffine(1, 0);
+    auto saturated = ops->pixelwiseChain()
+        .add(identity, DataType::SINT8)
+        .add(identity, DataType::FLOAT32);
+    cpu::Image::castFrom(*floats).set<float>(3, 4, 0, 1000);
+    cpu::Image::castFrom(*floats).set<float>(3, 4, 1, -1000);
+    operations::callUnary(saturated.build(*floats), *floats, *sum).wait();
+    REQUIRE(cpu::Image::castFrom(*sum).get<float>(3, 4, 0) == 127);
+    REQUIRE(cpu::Image::castFrom(*sum).get<float>(3, 4, 1) == -128);
+}
+
+TEST_CASE( "Copy, fill & convert", "[accelerated-arrays]" ) {
+    auto processor = Processor::createInstant();
+    auto ops = cpu::operations::createFactory(*processor);
+    auto factory = cpu::Image::createFactory();
+
+    const int w = 5, h = 4, rowWidth = 7;
+    std::vector<float> floatData(rowWidth * h * 2, -1);
+    auto floats = cpu::Image::createReference(w, h, 2, ImageTypeSpec::DataType::FLOAT32,
+        reinterpret_cast<std::uint8_t*>(floatData.data()), rowWidth);
+
+    // pixel pattern fill to a ROI
+    operations::callNullary(ops->fill({ 300.5, -2 }).build(*floats), *floats).wait();
+    REQUIRE(floatData.at(0) == 300.5f);
+    REQUIRE(floatData.at((rowWidth * 3 + 4) * 2 + 1) == -2.0f);
+    REQUIRE(floatData.at((rowWidth * 3 + 5) * 2) == -1.0f); // padding
+    floatData.at(2) = 100.75;
+
+    // saturating conversion
+    auto bytes = factory->create<std::uint8_t, 2>(w, h);
+    operations::callUnary(ops->copy().build(*floats, *bytes), *floats, *bytes).wait();
+    const auto &bytesCpu = cpu::Image::castFrom(*bytes);
+    REQUIRE(int(bytesCpu.get<std::uint8_t>(0, 0, 0)) == 255);
+    REQUIRE(int(bytesCpu.get<std::uint8_t>(0, 0, 1)) == 0);
+    REQUIRE(int(bytesCpu.get<std::uint8_t>(1, 0, 0)) == 100);
+
+    auto fixed = factory->create<FixedPoint<std::uint8_t>, 2>(w, h);
+    operations::callUnary(ops->copy().build(*bytes, *fixed), *bytes, *fixed).wait();
+    REQUIRE(cpu::Image::castFrom(*fixed).get<float>(1, 0, 0) == 1.0f);
+    auto backToFloat = factory->create<float, 2>(w, h);
+    operations::callUnary(ops->copy().build(*fixed, *backToFloat), *fixed, *backToFloat).wait();
+    REQUIRE(cpu::Image::castFrom(*backToFloat).get<float>(1, 0, 1) == 0.0f);
+
+    // same-type copy from a ROI and zero fill (memset)
+    auto copied = factory->create<float, 2>(w, h);
+    operations::callUnary(ops->copy().build(*floats), *floats, *copied).wait();
+    REQUIRE(cpu::Image::castFrom(*copied).get<float>(1, 0, 0) == 100.75f);
+    REQUIRE(cpu::Image::castFrom(*copied).get<float>(4, 3, 1) == -2.0f);
+
+    operations::callNullary(ops->fill({ 0, 0 }).build(*copied), *copied).wait();
+    REQUIRE(cpu::Image::castFrom(*copied).get<float>(4, 3, 1) == 0.0f);
+}
+
+TEST_CASE( "Half-float images", "[accelerated-arrays]" ) {
+    auto processor = Processor::createInstant();
+    auto ops = cpu::operations::createFactory(*processor);
+    auto factory = cpu::Image::createFactory();
+
+    // wide enough for the vectorized conversions and their scalar tails
+    const int w = 37, h = 3;
+    auto floats = factory->create<float, 3>(w, h);
+    auto halves = factory->create<Float16, 3>(w, h);
+    auto back = factory->create<float, 3>(w, h);
+    REQUIRE(halves->bytesPerPixel() == 6);
+
+    std::vector<float> data(floats->numberOfScalars());
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = (i % 2 ? -1 : 1) * std::pow(1.37f, float(i % 60) - 30);
+    }
+    data.at(5) = 1.0f + std::pow(2.0f, -11); // tie
+    data.at(6) = 70000; // overflow
+    floats->write(data).wait();
+
+    operations::callUnary(ops->copy().build(*floats, *halves), *floats, *halves).wait();
+    operations::callUnary(ops->copy().build(*halves, *back), *halves, *back).wait();
+    std::vector<float> out;
+    back->read(out).wait();
+    const auto &halfCpu = cpu::Image::castFrom(*halves);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        const int x = (i / 3) % w, y = i / (3 * w), c = i % 3;
+        REQUIRE(halfCpu.get<Float16>(x, y, c).value == Float16(data[i]).value);
+        REQUIRE(out[i] == float(Float16(data[i])));
+    }
+    REQUIRE(out.at(5) == 1.0f);
+    REQUIRE(std::isinf(out.at(6)));
+
+    // through the row loaders (vectorized) and get/set<float>
+    auto small = factory->create<Float16, 3>(w / 2, h);
+    operations::callUnary(ops->rescale(0.5, 1).build(*halves, *small), *halves, *small).wait();
+    auto smallFloats = factory->create<float, 3>(w / 2, h);
+    operations::callUnary(ops->rescale(0.5, 1).build(*back, *smallFloats), *back, *smallFloats).wait();
+    const auto &smallCpu = cpu::Image::castFrom(*small);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w / 2; ++x)
+            for (int c = 0; c < 3; ++c)
+                REQUIRE(smallCpu.get<Float16>(x, y, c).value == Float16(cpu::Image::castFrom(*smallFloats).get<float>(x, y, c)).value);
+
+    cpu::Image::castFrom(*small).set<float>(0, 0, 0, 0.1f);
+    REQUIRE(smallCpu.get<Float16>(0, 0, 0).value == Float16(0.1f).value);
+}
+
+TEST_CASE( "Reductions", "[accelerated-arrays]" ) {
+    typedef FixedPoint<std::uint8_t> Type;
+    typedef operations::reduce::Type Reduce;
+    auto factory = cpu::Image::createFactory();
+
+    const int w = 13, h = 41;
+    auto input = factory->create<Type, 2>(w, h);
+    std::vector<std::uint8_t> inData;
+    for (int i = 0; i < w * h * 2; ++i) inData.push_back((i * 31 + 7) % 256);
+    input->writeRawFixedPoint(inData).wait();
+
+    // reference
+    double sum[2] = { 0, 0 }, minValue[2] = { 1, 1 }, maxValue[2] = { 0, 0 };
+    const int bins = 5;
+    std::vector<int> histogram(bins * 2, 0);
+    for (int i = 0; i < w * h * 2; ++i) {
+        const double v = inData.at(i) / 255.0;
+        sum[i % 2] += v;
+        minValue[i % 2] = std::min(minValue[i % 2], v);
+        maxValue[i % 2] = std::max(maxValue[i % 2], v);
+        histogram.at(std::min(bins - 1, inData.at(i) * bins / 255) * 2 + i % 2)++;
+    }
+
+    for (int nBands : { 1, 4 }) {
+        auto processor = Processor::createThreadPool(3);
+        auto ops = cpu::operations::createFactory(*processor, nBands);
+        auto result = factory->create<float, 2>(1, 1);
+        const auto reduce = [&](Reduce type, int c) -> float {
+            operations::callUnary(ops->reduce(type).build(*input, *result), *input, *result).wait();
+            return cpu::Image::castFrom(*result).get<float>(0, 0, c);
+        };
+        for (int c = 0; c < 2; ++c) {
+            REQUIRE(reduce(Reduce::SUM, c) == Approx(sum[c]));
+            REQUIRE(reduce(Reduce::MEAN, c) == Approx(sum[c] / (w * h)));
+            REQUIRE(reduce(Reduce::MIN, c) == Approx(minValue[c]));
+            REQUIRE(reduce(Reduce::MAX, c) == Approx(maxValue[c]));
+        }
+
+        auto spec = ops->histogram(bins);
+        REQUIRE(spec.getBin(1.0) == bins - 1);
+        REQUIRE(spec.getBin(-0.5) == 0);
+        auto counts = factory->create<float, 2>(spec.getOutputWidth(), spec.getOutputHeight());
+        operations::callUnary(spec.build(*input, *counts), *input, *counts).wait();
+        for (int bin = 0; bin < bins; ++bin)
+            for (int c = 0; c < 2; ++c)
+                REQUIRE(cpu::Image::castFrom(*counts).get<float>(bin, 0, c) == histogram.at(bin * 2 + c));
+    }
+}
+
+TEST_CASE( "Warp", "[accelerated-arrays]" ) {
+    auto processor = Processor::createThreadPool(2);
+    auto ops = cpu::operations::createFactory(*processor, 2);
+    auto factory = cpu::Image::createFactory();
+
+    const int w = 70, h = 9;
+    auto input = factory->create<float, 2>(w, h);
+    auto &in = cpu::Image::castFrom(*input);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            in.set<float, 2>(x, y, {{ float(x + 100 * y), float(x * y) }});
+
+    auto output = factory->createLike(*input);
+    const auto &out = cpu::Image::castFrom(*output);
+    const auto run = [&](operations::warp::Spec spec) {
+        operations::callUnary(spec.build(*input), *input, *output).wait();
+    };
+
+    // output (x, y) <- input (x + 1, y + 2)
+    run(ops->warp({{ 1, 0, 1 }, { 0, 1, 2 }}));
+    REQUIRE(out.get<float>(3, 4, 0) == in.get<float>(4, 6, 0));
+    REQUIRE(out.get<float>(68, 6, 1) == in.get<float>(69, 8, 1));
+    REQUIRE(out.get<float>(69, 0, 0) == 0);
+    REQUIRE(out.get<float>(0, 7, 0) == 0);
+
+    run(ops->warp({{ 1, 0, 1 }, { 0, 1, 2 }}).setBorder(Image::Border::CLAMP));
+    REQUIRE(out.get<float>(69, 0, 0) == in.get<float>(69, 2, 0));
+    REQUIRE(out.get<float>(0, 7, 0) == in.get<float>(1, 8, 0));
+
+    // homography, scaled identity
+    run(ops->warp({{ 2, 0, 0 }, { 0, 2, 0 }, { 0, 0, 2 }}));
+    REQUIRE(out.get<float>(33, 5, 0) == in.get<float>(33, 5, 0));
+
+    // zero denominator at x = 2 (and large coordinates around it): out of
+    // bounds, but defined
+    for (auto border : { Image::Border::ZERO, Image::Border::CLAMP, Image::Border::REPEAT }) {
+        run(ops->warp({{ 1, 0, 0 }, { 0, 1, 0 }, { 1, 0, -2 }}).setBorder(border));
+        if (border == Image::Border::ZERO) REQUIRE(out.get<float>(2, 3, 0) == 0);
+        REQUIRE(out.get<float>(3, 3, 0) == in.get<float>(3, 3, 0));
+    }
+
+    // bilinear interpolation between pixels
+    run(ops->warp({{ 1, 0, 0.5 }, { 0, 1, 0.25 }}));
+    REQUIRE(out.get<float>(10, 3, 0) == Approx(10.5 + 100 * 3.25));
+    run(ops->warp({{ 1, 0, 0.4 }, { 0, 1, 0 }}).setInterpolation(Image::Interpolation::NEAREST));
+    REQUIRE(out.get<float>(10, 3, 0) == in.get<float>(10, 3, 0));
+
+    // map image with the same coordinates as a rotation matrix
+    const double angle = 0.1, c = std::cos(angle), s = std::sin(angle);
+    const std::vector< std::vector<double> > rotation = {{ c, -s, 3 }, { s, c, -2 }};
+    auto map = factory->create<float, 2>(w, h);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            cpu::Image::castFrom(*map).set<float, 2>(x, y, {{ float(c * x - s * y + 3), float(s * x + c * y - 2) }});
+    auto expected = factory->createLike(*input);
+    run(ops->warp(rotation));
+    operations::callBinary(ops->remap().build(*input), *input, *map, *expected).wait();
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            for (int ch = 0; ch < 2; ++ch)
+                REQUIRE(out.get<float>(x, y, ch) == Approx(cpu::Image::castFrom(*expected).get<float>(x, y, ch)).margin(0.05));
+}
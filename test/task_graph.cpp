@@ -0,0 +1,73 @@
+#include <catch2/catch.hpp>
+
+#include "task_graph.hpp"
+#include "cpu/image.hpp"
+#include "cpu/operations.hpp"
+
+TEST_CASE( "Task graph hazards", "[accelerated-arrays]" ) {
+    using namespace accelerated;
+    typedef std::int32_t Type;
+
+    // two manually processed queues to check the dispatch order
+    auto queueA = Processor::createQueue();
+    auto queueB = Processor::createQueue();
+    auto opsA = cpu::operations::createFactory(*queueA);
+    auto opsB = cpu::operations::createFactory(*queueB);
+    auto factory = cpu::Image::createFactory();
+
+    auto a = factory->create<Type, 1>(3, 2);
+    auto b = factory->create<Type, 1>(3, 2);
+
+    Type frame = 0;
+    auto fillA = opsA->wrap<cpu::operations::Nullary>([&frame](cpu::Image &out) {
+        for (int y = 0; y < out.height; ++y)
+            for (int x = 0; x < out.width; ++x)
+                out.set<Type>(x, y, frame);
+    });
+    auto doubleAtoB = opsB->wrap<cpu::operations::Unary>([](cpu::Image &in, cpu::Image &out) {
+        for (int y = 0; y < out.height; ++y)
+            for (int x = 0; x < out.width; ++x)
+                out.set<Type>(x, y, in.get<Type>(x, y) * 2);
+    });
+    auto incrementA = opsA->wrap<cpu::operations::Unary>([](cpu::Image &in, cpu::Image &out) {
+        for (int y = 0; y < out.height; ++y)
+            for (int x = 0; x < out.width; ++x)
+                out.set<Type>(x, y, in.get<Type>(x, y) + 1);
+    });
+
+    auto graph = TaskGraph::create();
+    graph->add(fillA, {}, *a, *factory);
+    graph->add(doubleAtoB, { a.get() }, *b, *factory);
+    // write-after-read: must wait for doubleAtoB
+    graph->add(incrementA, { b.get() }, *a, *factory);
+    REQUIRE(graph->size() == 3);
+    REQUIRE(graph->numberOfTransfers() == 0);
+
+    frame = 5;
+    auto done = graph->run();
+    REQUIRE(!done.isReady());
+
+    // read-after-write: not dispatched before fillA is done
+    REQUIRE(!queueB->processOne());
+    REQUIRE(queueA->processOne());
+    REQUIRE(!queueA->processOne());
+    REQUIRE(queueB->processOne());
+    REQUIRE(cpu::Image::castFrom(*b).get<Type>(2, 1) == 10);
+    REQUIRE(queueA->processOne());
+    REQUIRE(done.isReady());
+    REQUIRE(cpu::Image::castFrom(*a).get<Type>(2, 1) == 11);
+
+    // the next run waits for the previous one
+    auto first = graph->run();
+    auto second = graph->run();
+    REQUIRE(queueA->processOne());
+    REQUIRE(!queueA->processOne());
+    queueB->processAll();
+    queueA->processAll();
+    REQUIRE(first.isReady());
+    REQUIRE(!second.isReady());
+    queueB->processAll();
+    queueA->processAll();
+    REQUIRE(second.isReady());
+    REQUIRE(cpu::Image::castFrom(*a).get<Type>(0, 0) == 11);
+}
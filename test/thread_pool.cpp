@@ -1,7 +1,11 @@
 #include <catch2/catch.hpp>
 
 #include <atomic>
+#include <sstream>
+#include <thread>
 #include "cpu/operations.hpp"
+#include "cpu/image.hpp"
+#include "tracing.hpp"
 
 TEST_CASE( "Thread pool", "[accelerated-arrays]" ) {
     using namespace accelerated;
@@ -28,3 +32,227 @@ TEST_CASE( "Thread pool", "[accelerated-arrays]" ) {
         REQUIRE(val.load() == 10);
     }
 }
+
+TEST_CASE( "Work-stealing pool", "[accelerated-arrays]" ) {
+    using namespace accelerated;
+
+    for (unsigned itr = 0; itr < 20; ++itr) {
+        auto processor = Processor::createWorkStealingPool(4);
+        std::atomic<int> val;
+        val.store(0);
+
+        std::vector<Future> parallelOps;
+        for (unsigned j = 0; j < 200; ++j) {
+            parallelOps.push_back(processor->enqueue([&val]() {
+                val++;
+            }));
+        }
+        for (auto fut : parallelOps) fut.wait();
+        REQUIRE(val.load() == 200);
+
+        // tasks enqueued from the workers (more than the deque capacity)
+        std::vector<Future> nestedOps(8 * 100, Future::instantlyResolved());
+        std::vector<Future> outerOps;
+        for (unsigned j = 0; j < 8; ++j) {
+            outerOps.push_back(processor->enqueue([&val, &processor, &nestedOps, j]() {
+                for (unsigned k = 0; k < 100; ++k) {
+                    nestedOps.at(j * 100 + k) = processor->enqueue([&val]() {
+                        val++;
+                    });
+                }
+            }));
+        }
+        Future::all(outerOps).wait();
+        Future::all(nestedOps).wait();
+        REQUIRE(val.load() == 1000);
+    }
+}
+
+TEST_CASE( "Future continuations", "[accelerated-arrays]" ) {
+    using namespace accelerated;
+
+    auto queue = Processor::createQueue();
+    int order = 0, first = -1, second = -1, all = -1;
+
+    auto a = queue->enqueue([&order, &first]() { first = order++; });
+    auto b = queue->enqueue([&order, &second]() { second = order++; });
+    auto chained = a.then([&order]() { order += 10; }).then([&order]() { order *= 2; });
+    auto both = Future::whenAll({ a, b }).then([&order, &all]() { all = order; });
+
+    REQUIRE(!a.isReady());
+    REQUIRE(!chained.isReady());
+    REQUIRE(!both.isReady());
+
+    // callbacks run in the thread that resolves the future
+    REQUIRE(queue->processOne());
+    REQUIRE(a.isReady());
+    REQUIRE(chained.isReady());
+    REQUIRE(!both.isReady());
+    REQUIRE(first == 0);
+    REQUIRE(order == 22);
+
+    queue->processAll();
+    REQUIRE(both.isReady());
+    REQUIRE(second == 22);
+    REQUIRE(all == 23);
+
+    // already resolved
+    bool called = false;
+    a.then([&called]() { called = true; }).wait();
+    REQUIRE(called);
+
+    auto pool = Processor::createWorkStealingPool(3);
+    std::atomic<int> val;
+    val.store(0);
+    std::vector<Future> futures;
+    for (int i = 0; i < 100; ++i) {
+        futures.push_back(pool->enqueue([&val]() { val++; }).then([&val]() { val += 100; }));
+    }
+    Future::whenAll(futures).wait();
+    REQUIRE(val.load() == 100 * 101);
+}
+
+TEST_CASE( "Custom Future states", "[accelerated-arrays]" ) {
+    using namespace accelerated;
+
+    // only overrides the mandatory wait and the timed wait
+    struct FlagState : Future::State {
+        std::atomic<bool> done;
+        FlagState() : done(false) {}
+        void wait() final { while (!done.load()) std::this_thread::yield(); }
+        bool waitFor(std::chrono::nanoseconds) final { return done.load(); }
+    };
+
+    auto state = std::make_shared<FlagState>();
+    Future future(state);
+    auto both = Future::whenAll({ future, Future::instantlyResolved() });
+    REQUIRE(!future.isReady());
+    REQUIRE(!both.isReady());
+
+    state->done = true;
+    REQUIRE(future.isReady());
+    REQUIRE(both.isReady());
+    REQUIRE(!future.isFailed());
+}
+
+TEST_CASE( "Bounded queues", "[accelerated-arrays]" ) {
+    using namespace accelerated;
+
+    QueueOptions options;
+    options.capacity = 2;
+
+    SECTION( "reject" ) {
+        options.fullPolicy = QueueOptions::FullPolicy::REJECT;
+        auto queue = Processor::createQueue(options);
+        int count = 0;
+        auto a = queue->enqueue([&count]() { count++; });
+        auto b = queue->enqueue([&count]() { count++; });
+        auto c = queue->enqueue([&count]() { count++; });
+        REQUIRE(c.isReady());
+        REQUIRE(c.isFailed());
+        REQUIRE(c.then([&count]() { count += 100; }).isFailed());
+        REQUIRE(!a.isFailed());
+
+        auto stats = queue->getQueueStats();
+        REQUIRE(stats.depth == 2);
+        REQUIRE(stats.enqueued == 3);
+        REQUIRE(stats.rejected == 1);
+
+        queue->processAll();
+        REQUIRE(count == 2);
+        REQUIRE(a.isReady());
+        REQUIRE(!a.isFailed());
+        REQUIRE(queue->getQueueStats().depth == 0);
+        REQUIRE(queue->getQueueStats().maxDepth == 2);
+    }
+
+    SECTION( "internal tasks are always admitted" ) {
+        options.fullPolicy = QueueOptions::FullPolicy::REJECT;
+        auto queue = Processor::createQueue(options);
+        int count = 0;
+        queue->enqueue([&count]() { count++; });
+        queue->enqueue([&count]() { count++; });
+        Future cleanup = [&queue, &count]() {
+            ScopedUnboundedEnqueue unbounded;
+            return queue->enqueue([&count]() { count += 10; });
+        }();
+        REQUIRE(!cleanup.isFailed());
+        REQUIRE(queue->enqueue([&count]() { count += 100; }).isFailed());
+        REQUIRE(queue->getQueueStats().depth == 3);
+
+        queue->processAll();
+        REQUIRE(count == 12);
+        REQUIRE(cleanup.isReady());
+    }
+
+    SECTION( "latest frame wins" ) {
+        options.fullPolicy = QueueOptions::FullPolicy::DROP_OLDEST;
+        auto queue = Processor::createQueue(options);
+        const int FRAME = 1;
+        std::vector<int> processed;
+        auto other = queue->enqueue([&processed]() { processed.push_back(-1); });
+        std::vector<Future> frames;
+        for (int i = 0; i < 5; ++i) {
+            frames.push_back(queue->enqueueCoalescing(FRAME, [&processed, i]() { processed.push_back(i); }));
+        }
+        for (int i = 0; i < 4; ++i) REQUIRE(frames.at(i).isFailed());
+        REQUIRE(queue->getQueueStats().dropped == 4);
+
+        queue->processAll();
+        REQUIRE(processed == std::vector<int>({ -1, 4 }));
+        REQUIRE(!frames.back().isFailed());
+    }
+
+    SECTION( "block" ) {
+        auto pool = Processor::createThreadPool(1, options);
+        std::atomic<int> val;
+        val.store(0);
+        for (int i = 0; i < 100; ++i) {
+            pool->enqueue([&val]() { val++; });
+            REQUIRE(pool->getQueueStats().depth <= 2);
+        }
+        pool->enqueue([]() {}).wait();
+        REQUIRE(val.load() == 100);
+        REQUIRE(pool->getQueueStats().maxDepth <= 2);
+    }
+}
+
+TEST_CASE( "Tracing", "[accelerated-arrays]" ) {
+    using namespace accelerated;
+
+    auto pool = Processor::createThreadPool(2);
+    auto factory = cpu::Image::createFactory();
+    auto ops = cpu::operations::createFactory(*pool);
+    auto image = factory->create<float, 1>(8, 8);
+    auto fill = ops->fill(1.0).build(*image);
+
+    tracing::clear();
+    operations::callNullary(fill, *image).wait();
+
+    tracing::setEnabled(true);
+    std::vector<Future> futures;
+    for (int i = 0; i < 3; ++i) futures.push_back(operations::callNullary(fill, *image));
+    Future::whenAll(futures).wait();
+    {
+        tracing::ScopedLabel label("custom \"label\"");
+        pool->enqueue([]() {}).wait();
+    }
+    tracing::setEnabled(false);
+
+    std::ostringstream trace;
+    tracing::writeChromeTrace(trace);
+    const std::string json = trace.str();
+    REQUIRE(json.find("{\"traceEvents\":[") == 0);
+    REQUIRE(json.find("\"name\":\"fill\"") != std::string::npos);
+    REQUIRE(json.find("\"name\":\"custom \\\"label\\\"\"") != std::string::npos);
+    REQUIRE(json.find("\"queueDepth\":") != std::string::npos);
+
+    std::size_t nTasks = 0;
+    for (std::size_t pos = json.find("\"ph\":\"X\""); pos != std::string::npos; pos = json.find("\"ph\":\"X\"", pos + 1)) nTasks++;
+    REQUIRE(nTasks == 4);
+
+    tracing::clear();
+    std::ostringstream empty;
+    tracing::writeChromeTrace(empty);
+    REQUIRE(empty.str().find("\"ph\":\"X\"") == std::string::npos);
+}